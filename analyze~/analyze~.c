@@ -16,7 +16,18 @@
 
 #define MAX_AUDIO_SECONDS 60
 #define ANALYSIS_HOP_MS 100
+// @lowmem capture ring: the 15 s analysis window, the 200 ms active region and one hop, plus the
+// FFT overlap the analyzer reads back before each hop
+#define LOWMEM_AUDIO_SECONDS (15.0 + 0.2 + ANALYSIS_HOP_MS / 1000.0)
+#define LOWMEM_OVERLAP_SAMPLES 2048
 #define MAX_ANALYZE_CHANNELS 1024
+// Degradation governor (@governor): tiers climbed as the worker's backlog reaches @governor_tiers
+#define GOVERNOR_TIERS 3
+#define GOVERNOR_TIER_NO_VISUALIZE 1    // Skip the visualizer packets
+#define GOVERNOR_TIER_STRIDE 2          // Also compute the spectrum of every GOVERNOR_FRAME_STRIDE-th frame only
+#define GOVERNOR_TIER_SNAPSHOTS 3       // Also skip the snapshots of peaks on low-energy bands
+#define GOVERNOR_FRAME_STRIDE 4
+#define GOVERNOR_SNAPSHOT_FLOOR 0.25    // Bands under a quarter of the loudest band's average
 
 typedef struct _analyze_shared_buffer {
     t_object ob;
@@ -63,6 +74,32 @@ void* analyze_shared_buffer_new(t_symbol* s, long argc, t_atom* argv) {
     return x;
 }
 
+// Sections of the worker's hop loop, timed on every hop for the stats message
+enum {
+    HOP_STAGE_PUSH,         // Pushing the hop through the STFT
+    HOP_STAGE_ANALYZE,      // Preparing and committing the chunk
+    HOP_STAGE_PEAKS,        // Emitting the chunk's peaks
+    HOP_STAGE_METRICS,      // Bar length and metrics output
+    HOP_STAGE_VISUALIZE,    // Building and sending the visualizer packet
+    HOP_STAGE_TOTAL,        // The whole hop
+    NUM_HOP_STAGES
+};
+
+static const char* const hop_stage_names[NUM_HOP_STAGES] = { "push", "analyze", "peaks", "metrics", "visualize", "hop" };
+
+typedef struct _analyze_stats {
+    double seconds[NUM_HOP_STAGES];
+    LatencyHistogram stages[NUM_HOP_STAGES];
+    LatencyHistogram lag;           // current_sample_count - last_analysis_frame at the start of each hop
+    long long hops;
+    long long late_hops;            // Hops that took longer than ANALYSIS_HOP_MS to analyze
+    long long wakeups;              // Worker tasks that found at least one hop waiting
+    long long backlog_sum;          // Hops waiting at those wakeups
+    long long backlog_max;
+    long long tier_hops[GOVERNOR_TIERS + 1]; // Hops analyzed at each governor tier
+    AnalyzerProfile analyzer;       // The analyzer's own stages as of the last hop, while @profile is on
+} t_analyze_stats;
+
 typedef struct _analyze {
     t_pxobject obj;
 
@@ -81,7 +118,14 @@ typedef struct _analyze {
     t_symbol* group_name;
     long weighted_bar;
     double tolerance;
+    long metrics_mode;
+    long lowmem;
     long visualize_enabled;
+    long profile;
+    long stats_interval;
+    long governor;
+    long governor_tiers[GOVERNOR_TIERS];
+    int governor_tier;          // Tier in force, only changed by the worker
     int viz_port;
     int instance_id;
     int viz_initialized;
@@ -105,6 +149,7 @@ typedef struct _analyze {
 
     // Async Worker
     t_async_worker* worker;
+    t_async_trigger* trigger;   // Preallocated analysis task, armed from perform64
     t_critical lock;
     int invalidated;
     int pending_analysis;
@@ -114,12 +159,20 @@ typedef struct _analyze {
 
     ChunkAnalysisResult* result_buffer;
 
+    // Worker instrumentation, written by the worker under lock
+    t_analyze_stats stats;
+    int stats_reset;            // Set by stats reset; the worker clears the analyzer's profile at its next task
+
 } t_analyze;
 
 void* analyze_new(t_symbol* s, long argc, t_atom* argv);
 void analyze_free(t_analyze* x);
 void analyze_clear(t_analyze* x);
 void analyze_pause(t_analyze* x, t_symbol* s, long argc, t_atom* argv);
+void analyze_memory(t_analyze* x);
+void analyze_stats(t_analyze* x, t_symbol* s, long argc, t_atom* argv);
+void analyze_output_stats(t_analyze* x, t_symbol* s, long argc, t_atom* argv);
+void analyze_output_governor(t_analyze* x, t_symbol* s, long argc, t_atom* argv);
 void analyze_group_settor(t_analyze* x, void* attr, long argc, t_atom* argv);
 void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv);
 void analyze_output_metrics(t_analyze* x, t_symbol* s, long argc, t_atom* argv);
@@ -330,6 +383,37 @@ void ext_main(void* r) {
     CLASS_ATTR_LABEL(c, "tolerance", 0, "Tolerance (ms)");
     CLASS_ATTR_DEFAULT(c, "tolerance", 0, "29.0");
 
+    CLASS_ATTR_LONG(c, "metrics", 0, t_analyze, metrics_mode);
+    CLASS_ATTR_FILTER_CLIP(c, "metrics", 0, 2);
+    CLASS_ATTR_ENUMINDEX(c, "metrics", 0, "Full Incremental Validate");
+    CLASS_ATTR_LABEL(c, "metrics", 0, "Metrics Computation");
+    CLASS_ATTR_DEFAULT(c, "metrics", 0, "0");
+
+    CLASS_ATTR_LONG(c, "lowmem", 0, t_analyze, lowmem);
+    CLASS_ATTR_FILTER_CLIP(c, "lowmem", 0, 1);
+    CLASS_ATTR_STYLE_LABEL(c, "lowmem", 0, "checkbox", "Low Memory Capture Buffer");
+    CLASS_ATTR_DEFAULT(c, "lowmem", 0, "0");
+
+    CLASS_ATTR_LONG(c, "profile", 0, t_analyze, profile);
+    CLASS_ATTR_FILTER_CLIP(c, "profile", 0, 1);
+    CLASS_ATTR_STYLE_LABEL(c, "profile", 0, "checkbox", "Profile Analyzer Stages");
+    CLASS_ATTR_DEFAULT(c, "profile", 0, "0");
+
+    CLASS_ATTR_LONG(c, "stats_interval", 0, t_analyze, stats_interval);
+    CLASS_ATTR_FILTER_MIN(c, "stats_interval", 0);
+    CLASS_ATTR_LABEL(c, "stats_interval", 0, "Stream Stats Every N Hops");
+    CLASS_ATTR_DEFAULT(c, "stats_interval", 0, "0");
+
+    CLASS_ATTR_LONG(c, "governor", 0, t_analyze, governor);
+    CLASS_ATTR_FILTER_CLIP(c, "governor", 0, 1);
+    CLASS_ATTR_STYLE_LABEL(c, "governor", 0, "checkbox", "Degrade When Behind");
+    CLASS_ATTR_DEFAULT(c, "governor", 0, "0");
+
+    CLASS_ATTR_LONG_ARRAY(c, "governor_tiers", 0, t_analyze, governor_tiers, GOVERNOR_TIERS);
+    CLASS_ATTR_FILTER_MIN(c, "governor_tiers", 0);
+    CLASS_ATTR_LABEL(c, "governor_tiers", 0, "Governor Tier Backlogs (hops)");
+    CLASS_ATTR_DEFAULT(c, "governor_tiers", 0, "2 4 8");
+
     CLASS_ATTR_LONG(c, "visualize", 0, t_analyze, visualize_enabled);
     CLASS_ATTR_FILTER_CLIP(c, "visualize", 0, 1);
     CLASS_ATTR_LABEL(c, "visualize", 0, "Enable Real-Time Visualization");
@@ -340,6 +424,8 @@ void ext_main(void* r) {
     class_addmethod(c, (method)analyze_assist, "assist", A_CANT, 0);
     class_addmethod(c, (method)analyze_clear, "clear", 0);
     class_addmethod(c, (method)analyze_pause, "pause", A_GIMME, 0);
+    class_addmethod(c, (method)analyze_memory, "memory", 0);
+    class_addmethod(c, (method)analyze_stats, "stats", A_GIMME, 0);
 
     class_dspinit(c);
     class_register(CLASS_BOX, c);
@@ -365,6 +451,7 @@ void* analyze_new(t_symbol* s, long argc, t_atom* argv) {
         x->group_name = gensym("");
         x->analyzer = NULL;
         x->worker = async_worker_create();
+        x->trigger = async_worker_trigger_new(x->worker, x, (method)analyze_worker_task, gensym("analyze"));
 
         x->audio_buffer = NULL;
         x->clock_buffer = NULL;
@@ -380,6 +467,17 @@ void* analyze_new(t_symbol* s, long argc, t_atom* argv) {
         x->log_enabled = 0;
         x->weighted_bar = 1;
         x->tolerance = 29.0;
+        x->metrics_mode = CT_METRICS_FULL;
+        x->lowmem = 0;
+        x->profile = 0;
+        x->stats_interval = 0;
+        x->governor = 0;
+        x->governor_tiers[0] = 2;
+        x->governor_tiers[1] = 4;
+        x->governor_tiers[2] = 8;
+        x->governor_tier = 0;
+        memset(&x->stats, 0, sizeof(x->stats));
+        x->stats_reset = 0;
         x->sample_rate = 44100.0;
         x->active = 1;
         x->visualize_enabled = 0;
@@ -415,6 +513,7 @@ void analyze_free(t_analyze* x) {
     critical_exit(x->lock);
 
     if (x->worker) {
+        async_worker_trigger_free(x->trigger);
         async_worker_release(x->worker);
     }
 
@@ -554,10 +653,155 @@ void analyze_pause(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
     analyze_log(x, "updated pause state");
 }
 
+// Reports heap usage out of the log outlet as: memory <capture ring> <analyzer> <results> <shared tables> <total>
+void analyze_memory(t_analyze* x) {
+    critical_enter(x->lock);
+    t_atom_long ring = (t_atom_long)x->audio_buffer_size * (sizeof(float) + sizeof(double));
+    critical_exit(x->lock);
+    t_atom_long analysis = (t_atom_long)analyzer_memory_usage(x->analyzer);
+    t_atom_long results = x->result_buffer ? (t_atom_long)sizeof(ChunkAnalysisResult) : 0;
+    t_atom_long tables = (t_atom_long)analyzer_shared_tables_usage();
+
+    t_atom av[5];
+    atom_setlong(av, ring);
+    atom_setlong(av + 1, analysis);
+    atom_setlong(av + 2, results);
+    atom_setlong(av + 3, tables);
+    atom_setlong(av + 4, ring + analysis + results + tables);
+    if (x->outlet_log) outlet_anything(x->outlet_log, gensym("memory"), 5, av);
+}
+
+// One stats line per timed section: stats <kind> <name> <count> <mean ms> <p50 ms> <p99 ms> <max ms>
+static void analyze_stats_stage(t_analyze* x, t_symbol* kind, const char* name, long long count, double seconds, const LatencyHistogram* h) {
+    t_atom av[7];
+    atom_setsym(av, kind);
+    atom_setsym(av + 1, gensym(name));
+    atom_setlong(av + 2, (t_atom_long)count);
+    atom_setfloat(av + 3, count > 0 ? seconds * 1000.0 / (double)count : 0.0);
+    atom_setfloat(av + 4, latency_histogram_quantile(h, 0.5) * 1000.0);
+    atom_setfloat(av + 5, latency_histogram_quantile(h, 0.99) * 1000.0);
+    atom_setfloat(av + 6, h->max_seconds * 1000.0);
+    outlet_anything(x->outlet_log, gensym("stats"), 7, av);
+}
+
+// Fold one hop's section times (negative for sections that did not run) into the stats. Called
+// with x->lock held.
+static void analyze_stats_hop(t_analyze* x, const double* times, long long lag_samples) {
+    t_analyze_stats* st = &x->stats;
+    for (int k = 0; k < NUM_HOP_STAGES; k++) {
+        if (times[k] < 0.0) continue;
+        st->seconds[k] += times[k];
+        latency_histogram_add(&st->stages[k], times[k]);
+    }
+    latency_histogram_add(&st->lag, (double)lag_samples / x->sample_rate);
+    st->hops++;
+    st->tier_hops[x->governor_tier]++;
+    if (times[HOP_STAGE_TOTAL] * 1000.0 > ANALYSIS_HOP_MS) st->late_hops++;
+    if (x->profile && x->analyzer && !x->stats_reset) {
+        analyzer_get_profile(x->analyzer, &st->analyzer);
+    }
+    if (x->stats_interval > 0 && st->hops % x->stats_interval == 0) {
+        defer(x, (method)analyze_output_stats, NULL, 0, NULL);
+    }
+}
+
+// Pick the governor tier for the next hop from the backlog in hops: drop back to full analysis once
+// caught up, climb to the highest tier whose backlog is reached and otherwise hold the tier in force.
+// Called by the worker only.
+static void analyze_governor_update(t_analyze* x, long long backlog) {
+    int tier = x->governor_tier;
+    if (!x->governor || backlog <= 1) tier = 0;
+    if (x->governor) {
+        int reached = 0;
+        for (int i = 0; i < GOVERNOR_TIERS; i++) {
+            if (x->governor_tiers[i] > 0 && backlog >= x->governor_tiers[i]) reached = i + 1;
+        }
+        if (reached > tier) tier = reached;
+    }
+    if (tier != x->governor_tier) {
+        if (x->analyzer) {
+            analyzer_set_frame_stride(x->analyzer, tier >= GOVERNOR_TIER_STRIDE ? GOVERNOR_FRAME_STRIDE : 1);
+            analyzer_set_snapshot_floor(x->analyzer, tier >= GOVERNOR_TIER_SNAPSHOTS ? GOVERNOR_SNAPSHOT_FLOOR : 0.0);
+        }
+        x->governor_tier = tier;
+        t_atom a;
+        atom_setlong(&a, tier);
+        defer(x, (method)analyze_output_governor, NULL, 1, &a);
+    }
+}
+
+// stats reports the worker's timing out of the log outlet; stats reset clears it. The report is
+//   stats hops <hops> <late hops> <load>
+//   stats backlog <hops waiting now> <mean at wakeup> <max at wakeup>
+//   stats lag <now ms> <p50 ms> <p99 ms> <max ms>
+//   stats governor <tier in force> <hops analyzed at tier 0> <tier 1> <tier 2> <tier 3>
+//   stats stage <push|analyze|peaks|metrics|visualize|hop> <count> <mean ms> <p50 ms> <p99 ms> <max ms>
+// followed with @profile on by the same per-call line for each analyzer stage as stats analyzer.
+void analyze_stats(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
+    if (argc > 0 && atom_gettype(argv) == A_SYM && atom_getsym(argv) == gensym("reset")) {
+        critical_enter(x->lock);
+        memset(&x->stats, 0, sizeof(x->stats));
+        x->stats_reset = 1;
+        critical_exit(x->lock);
+        return;
+    }
+    analyze_output_stats(x, NULL, 0, NULL);
+}
+
+void analyze_output_stats(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
+    if (x->invalidated || !x->outlet_log) return;
+
+    t_analyze_stats* st = (t_analyze_stats*)malloc(sizeof(t_analyze_stats));
+    if (!st) return;
+    critical_enter(x->lock);
+    *st = x->stats;
+    long long lag_samples = x->current_sample_count - x->last_analysis_frame;
+    critical_exit(x->lock);
+
+    double hop_seconds = ANALYSIS_HOP_MS / 1000.0;
+    int hop_samples = (int)(x->sample_rate * hop_seconds);
+    t_atom av[5];
+
+    atom_setsym(av, gensym("hops"));
+    atom_setlong(av + 1, (t_atom_long)st->hops);
+    atom_setlong(av + 2, (t_atom_long)st->late_hops);
+    atom_setfloat(av + 3, st->hops > 0 ? st->seconds[HOP_STAGE_TOTAL] / (st->hops * hop_seconds) : 0.0);
+    outlet_anything(x->outlet_log, gensym("stats"), 4, av);
+
+    atom_setsym(av, gensym("backlog"));
+    atom_setlong(av + 1, hop_samples > 0 ? (t_atom_long)(lag_samples / hop_samples) : 0);
+    atom_setfloat(av + 2, st->wakeups > 0 ? (double)st->backlog_sum / (double)st->wakeups : 0.0);
+    atom_setlong(av + 3, (t_atom_long)st->backlog_max);
+    outlet_anything(x->outlet_log, gensym("stats"), 4, av);
+
+    atom_setsym(av, gensym("lag"));
+    atom_setfloat(av + 1, lag_samples * 1000.0 / x->sample_rate);
+    atom_setfloat(av + 2, latency_histogram_quantile(&st->lag, 0.5) * 1000.0);
+    atom_setfloat(av + 3, latency_histogram_quantile(&st->lag, 0.99) * 1000.0);
+    atom_setfloat(av + 4, st->lag.max_seconds * 1000.0);
+    outlet_anything(x->outlet_log, gensym("stats"), 5, av);
+
+    t_atom gv[GOVERNOR_TIERS + 3];
+    atom_setsym(gv, gensym("governor"));
+    atom_setlong(gv + 1, x->governor_tier);
+    for (int i = 0; i <= GOVERNOR_TIERS; i++) atom_setlong(gv + 2 + i, (t_atom_long)st->tier_hops[i]);
+    outlet_anything(x->outlet_log, gensym("stats"), GOVERNOR_TIERS + 3, gv);
+
+    for (int k = 0; k < NUM_HOP_STAGES; k++) {
+        analyze_stats_stage(x, gensym("stage"), hop_stage_names[k], st->stages[k].total, st->seconds[k], &st->stages[k]);
+    }
+    if (x->profile) {
+        for (int k = 0; k < CT_NUM_STAGES; k++) {
+            analyze_stats_stage(x, gensym("analyzer"), analyzer_stage_name(k), st->analyzer.calls[k], st->analyzer.seconds[k], &st->analyzer.latency[k]);
+        }
+    }
+    free(st);
+}
+
 void analyze_assist(t_analyze* x, void* b, long m, long a, char* s) {
     if (m == ASSIST_INLET) {
         switch (a) {
-            case 0: sprintf(s, "(signal) Audio Input, (messages) clear, pause"); break;
+            case 0: sprintf(s, "(signal) Audio Input, (messages) clear, pause, memory, stats"); break;
             case 1: sprintf(s, "(signal) Transport Clock Input"); break;
         }
     } else {
@@ -568,7 +812,7 @@ void analyze_assist(t_analyze* x, void* b, long m, long a, char* s) {
             case 3: sprintf(s, "(float) Standard Deviation"); break;
             case 4: sprintf(s, "(float) Contrast Score"); break;
             case 5: sprintf(s, "(float) Bar Length Stability"); break;
-            case 6: sprintf(s, "(symbol) Log Diagnostics"); break;
+            case 6: sprintf(s, "(symbol) Log Diagnostics, Memory Report, Stats"); break;
         }
     }
 }
@@ -598,9 +842,10 @@ void analyze_dsp64(t_analyze* x, t_object* dsp64, short* count, double samplerat
     x->clock_connected = count[1];
     analyzer_set_sample_rate(x->analyzer, (int)samplerate);
 
-    int new_size = (int)(samplerate * MAX_AUDIO_SECONDS);
+    double seconds = x->lowmem ? LOWMEM_AUDIO_SECONDS : MAX_AUDIO_SECONDS;
+    int new_size = (int)(samplerate * seconds) + (x->lowmem ? LOWMEM_OVERLAP_SAMPLES : 0);
     if (x->audio_buffer_size != new_size) {
-        analyze_log(x, "reallocating audio and clock buffers: %d samples (%.1f seconds at %.1f Hz)", new_size, MAX_AUDIO_SECONDS, samplerate);
+        analyze_log(x, "reallocating audio and clock buffers: %d samples (%.1f seconds at %.1f Hz)", new_size, seconds, samplerate);
         free(x->audio_buffer);
         free(x->clock_buffer);
         x->audio_buffer = (float*)calloc(new_size, sizeof(float));
@@ -635,8 +880,7 @@ void analyze_perform64(t_analyze* x, t_object* dsp64, double** ins, long numins,
     if (x->current_sample_count >= x->last_analysis_frame + hop_samples) {
         if (!x->pending_analysis) {
             x->pending_analysis = 1;
-            analyze_log(x, "triggering worker task, current_sample_count: %lld, last_analysis_frame: %lld", x->current_sample_count, x->last_analysis_frame);
-            async_worker_enqueue(x->worker, x, (method)analyze_worker_task, gensym("analyze"), 0, NULL);
+            async_worker_trigger(x->trigger);
         }
     }
 }
@@ -651,14 +895,35 @@ void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
 
     critical_enter(x->lock);
     long start_seq = x->clear_sequence;
+    analyze_log(x, "worker task triggered, current_sample_count: %lld, last_analysis_frame: %lld", x->current_sample_count, x->last_analysis_frame);
     if (x->analyzer) {
         x->analyzer->tolerance = x->tolerance;
+        if (x->analyzer->metrics_mode != x->metrics_mode && !analyzer_set_metrics_mode(x->analyzer, (int)x->metrics_mode)) {
+            analyze_log(x, "could not allocate incremental metrics state, using full scans");
+            x->metrics_mode = CT_METRICS_FULL;
+        }
+        if (x->analyzer->profiling != (x->profile != 0)) {
+            analyzer_set_profiling(x->analyzer, (int)x->profile);
+        }
+        if (x->stats_reset) {
+            analyzer_reset_profile(x->analyzer);
+            x->stats_reset = 0;
+        }
     }
     critical_exit(x->lock);
 
     int hop_samples = (int)(x->sample_rate * 0.1);
     int ms_samples = (int)(x->sample_rate * 0.001);
 
+    critical_enter(x->lock);
+    long long backlog = hop_samples > 0 ? (x->current_sample_count - x->last_analysis_frame) / hop_samples : 0;
+    if (backlog > 0) {
+        x->stats.wakeups++;
+        x->stats.backlog_sum += backlog;
+        if (backlog > x->stats.backlog_max) x->stats.backlog_max = backlog;
+    }
+    critical_exit(x->lock);
+
     int hops_processed = 0;
     while (1) {
         critical_enter(x->lock);
@@ -669,31 +934,32 @@ void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
         long long cur_samples = x->current_sample_count;
         int cur_write_ptr = x->audio_buffer_write_ptr;
         long long target_analysis_frame = x->last_analysis_frame + hop_samples;
+        long long lag_samples = cur_samples - x->last_analysis_frame;
         critical_exit(x->lock);
 
-        long long hop_start_samples = target_analysis_frame - hop_samples;
+        analyze_governor_update(x, hop_samples > 0 ? lag_samples / hop_samples : 0);
+
+        double hop_times[NUM_HOP_STAGES];
+        for (int k = 0; k < NUM_HOP_STAGES; k++) hop_times[k] = -1.0;
+        double hop_start_time = analyzer_profile_clock();
 
-        float* hop_audio = (float*)malloc(sizeof(float) * hop_samples);
-        if (!hop_audio) break;
+        long long hop_start_samples = target_analysis_frame - hop_samples;
 
         long long samples_ago = cur_samples - hop_start_samples;
         if (samples_ago < 0) samples_ago = 0;
         if (x->audio_buffer_size > 0 && samples_ago >= x->audio_buffer_size) samples_ago = x->audio_buffer_size - 1;
 
-        int read_ptr = (int)((cur_write_ptr - samples_ago + x->audio_buffer_size) % x->audio_buffer_size);
+        // The analyzer reads the hop in place, reaching back over the samples its next frames still need
+        long long history = x->analyzer ? analyzer_view_history(x->analyzer) : 0;
+        if (samples_ago + history > x->audio_buffer_size) history = x->audio_buffer_size - samples_ago;
 
-        for (int i = 0; i < hop_samples; i++) {
-            hop_audio[i] = x->audio_buffer[read_ptr];
-            read_ptr = (read_ptr + 1) % x->audio_buffer_size;
-        }
+        int read_ptr = (int)((cur_write_ptr - samples_ago - history + 2LL * x->audio_buffer_size) % x->audio_buffer_size);
+        AudioView hop_view;
+        audio_view_from_ring(&hop_view, x->audio_buffer, x->audio_buffer_size, read_ptr, (int)history + hop_samples);
 
         int active_start_samples = (int)(target_analysis_frame - hop_samples - (int)(x->sample_rate * 0.2));
         int active_start_frame = active_start_samples / ms_samples;
 
-        int window_start_samples = active_start_samples - (int)(x->sample_rate * 15.0);
-        if (window_start_samples < 0) window_start_samples = 0;
-        int buffer_start_frame = window_start_samples / ms_samples;
-
         int is_paused = 0;
         critical_enter(x->lock);
         is_paused = x->paused_channels[1];
@@ -702,13 +968,14 @@ void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
         if (is_paused) {
             if (x->analyzer) {
                 analyzer_cleanup_snapshots(x->analyzer, active_start_frame);
-                analyzer_push_audio(x->analyzer, hop_audio, hop_samples, (int)x->sample_rate);
+                analyzer_push_audio_view(x->analyzer, &hop_view, hop_samples, (int)x->sample_rate);
             }
-            free(hop_audio);
+            hop_times[HOP_STAGE_PUSH] = hop_times[HOP_STAGE_TOTAL] = analyzer_profile_clock() - hop_start_time;
 
             critical_enter(x->lock);
             if (x->clear_sequence == start_seq) {
                 x->last_analysis_frame = target_analysis_frame;
+                analyze_stats_hop(x, hop_times, lag_samples);
             } else {
                 critical_exit(x->lock);
                 break;
@@ -717,7 +984,18 @@ void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
             continue;
         }
 
-        if (x->result_buffer && analyzer_analyze_chunk(x->analyzer, hop_audio, hop_samples, (int)x->sample_rate, buffer_start_frame, active_start_frame, x->result_buffer)) {
+        int analyzed = 0;
+        double t = hop_start_time;
+        if (x->result_buffer) {
+            analyzer_push_audio_view(x->analyzer, &hop_view, hop_samples, (int)x->sample_rate);
+            hop_times[HOP_STAGE_PUSH] = analyzer_profile_clock() - t;
+            t += hop_times[HOP_STAGE_PUSH];
+            analyzer_chunk_prepare_pushed(x->analyzer, active_start_frame);
+            analyzed = analyzer_chunk_commit(x->analyzer, x->result_buffer);
+            hop_times[HOP_STAGE_ANALYZE] = analyzer_profile_clock() - t;
+            t += hop_times[HOP_STAGE_ANALYZE];
+        }
+        if (analyzed) {
             hops_processed++;
 
             for (int i = 0; i < x->result_buffer->peak_list.num_peaks; i++) {
@@ -743,6 +1021,8 @@ void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
                     defer(x, (method)analyze_output_peak, NULL, 2, out_args);
                 }
             }
+            hop_times[HOP_STAGE_PEAKS] = analyzer_profile_clock() - t;
+            t += hop_times[HOP_STAGE_PEAKS];
 
             t_atom out_args[5];
             atom_setfloat(out_args, x->result_buffer->metrics.rating);
@@ -750,24 +1030,12 @@ void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
             atom_setfloat(out_args + 2, x->result_buffer->metrics.contrast);
             atom_setfloat(out_args + 3, x->result_buffer->metrics.stability_score);
 
-            double max_score = -1.0;
             int best_bar_length = 0;
             critical_enter(x->lock);
             if (x->analyzer) {
-                for (int i = 0; i <= 5000; i++) {
-                    int count = x->analyzer->bar_length_counts[i];
-                    if (count > 0) {
-                        double score = 0.0;
-                        if (x->weighted_bar) {
-                            score = (double)count * ((double)i / 5000.0);
-                        } else {
-                            score = (double)count;
-                        }
-                        if (score > max_score) {
-                            max_score = score;
-                            best_bar_length = i;
-                        }
-                    }
+                best_bar_length = analyzer_get_bar_length(x->analyzer, (int)x->weighted_bar);
+                if (x->analyzer->metrics_mode == CT_METRICS_VALIDATE) {
+                    analyze_log(x, "metrics validation: max relative deviation %g", x->analyzer->metrics_max_deviation);
                 }
             }
             critical_exit(x->lock);
@@ -775,8 +1043,10 @@ void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
 
             atom_setfloat(out_args + 4, barlen);
             defer(x, (method)analyze_output_metrics, NULL, 5, out_args);
+            hop_times[HOP_STAGE_METRICS] = analyzer_profile_clock() - t;
+            t += hop_times[HOP_STAGE_METRICS];
 
-            if (x->visualize_enabled && x->viz_port > 0) {
+            if (x->visualize_enabled && x->viz_port > 0 && x->governor_tier < GOVERNOR_TIER_NO_VISUALIZE) {
                 char *json_buf = (char *)malloc(131072);
                 if (json_buf) {
                     char *ptr = json_buf;
@@ -881,12 +1151,13 @@ void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
                     if (n > 0 && n < remaining) { ptr += n; remaining -= n; }
                     for (int i = 0; i < x->result_buffer->peak_list.num_peaks; i++) {
                         PeakResult *p_res = &x->result_buffer->peak_list.peaks[i];
+                        Qualifier *p_quals = &x->result_buffer->peak_list.qualifiers[p_res->qualifier_start];
                         n = snprintf(ptr, remaining, "{\"time\":%.4f,\"peak_val\":%.4f,\"total_score\":%.4f,\"band_idx\":%d,\"p_idx\":%d,\"qualifiers\":[",
                                      p_res->time, p_res->peak_val, p_res->total_score, p_res->band_idx, p_res->p_idx);
                         if (n > 0 && n < remaining) { ptr += n; remaining -= n; }
                         for (int q = 0; q < p_res->num_qualifiers; q++) {
                             n = snprintf(ptr, remaining, "{\"ms\":%.4f,\"val\":%.4f,\"orig_ms\":%.4f}%s",
-                                         p_res->qualifiers[q].ms, p_res->qualifiers[q].val, p_res->qualifiers[q].orig_ms,
+                                         p_quals[q].ms, p_quals[q].val, p_quals[q].orig_ms,
                                          (q == p_res->num_qualifiers - 1) ? "" : ",");
                             if (n > 0 && n < remaining) { ptr += n; remaining -= n; }
                         }
@@ -900,14 +1171,15 @@ void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
                     visualize_to_port(x, x->viz_port, "analyze", json_buf);
                     free(json_buf);
                 }
+                hop_times[HOP_STAGE_VISUALIZE] = analyzer_profile_clock() - t;
             }
         }
-
-        free(hop_audio);
+        hop_times[HOP_STAGE_TOTAL] = analyzer_profile_clock() - hop_start_time;
 
         critical_enter(x->lock);
         if (x->clear_sequence == start_seq) {
             x->last_analysis_frame = target_analysis_frame;
+            analyze_stats_hop(x, hop_times, lag_samples);
         } else {
             critical_exit(x->lock);
             break;
@@ -926,6 +1198,13 @@ void analyze_worker_task(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
     critical_exit(x->lock);
 }
 
+// Reports a change of governor tier out of the log outlet as: governor <tier>
+void analyze_output_governor(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
+    if (!x->invalidated && x->outlet_log) {
+        outlet_anything(x->outlet_log, gensym("governor"), argc, argv);
+    }
+}
+
 void analyze_output_peak(t_analyze* x, t_symbol* s, long argc, t_atom* argv) {
     outlet_list(x->outlet_list, NULL, argc, argv);
 }
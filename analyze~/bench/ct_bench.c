@@ -0,0 +1,421 @@
+// Native benchmark of the transient analyzer (Linux). Runs synthetic material and any WAV files
+// through the live push and chunk paths and the batch/stream API, one forked process per case, and
+// prints one JSON object per case on stdout. Build with the Makefile next to this file.
+#include "cumulative_transience.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#ifndef CT_BENCH_VERSION
+#define CT_BENCH_VERSION "unknown"
+#endif
+
+#define BENCH_MAX_FILES 64
+
+// Heap calls made by the analyzer and the harness, counted through the linker's --wrap
+static long long alloc_calls;
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t size);
+void __real_free(void* p);
+void* __wrap_malloc(size_t size) { alloc_calls++; return __real_malloc(size); }
+void* __wrap_calloc(size_t n, size_t size) { alloc_calls++; return __real_calloc(n, size); }
+void* __wrap_realloc(void* p, size_t size) { alloc_calls++; return __real_realloc(p, size); }
+void __wrap_free(void* p) { __real_free(p); }
+
+typedef struct {
+    char name[128];
+    float* y;
+    int len;
+    int sr;
+} Material;
+
+typedef struct {
+    int seconds;
+    int sr;
+    int threads;
+    int profile;
+    int synthetic;
+    const char* modes;
+    int metrics;            // CT_METRICS_* for chunk mode
+} BenchOptions;
+
+typedef struct {
+    long long frames;
+    int peaks;
+    double wall_s;
+    int hops;
+    double hop_max_ms;      // Slowest 100 ms hop (chunk mode)
+    double hop_p99_ms;
+    int has_profile;
+    AnalyzerProfile profile;
+} BenchResult;
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static unsigned int noise_state = 12345;
+static float noise(void) {
+    noise_state = noise_state * 1103515245u + 12345u;
+    return (float)((noise_state >> 8) & 0xffff) / 32768.0f - 1.0f;
+}
+
+// Decaying burst at sample s: noise for clicks (freq 0) or a sine otherwise
+static void add_burst(float* y, int len, int sr, int s, float amp, double freq) {
+    int n = sr / 20;
+    for (int j = 0; j < n && s + j < len; j++) {
+        float env = amp * expf(-(float)j / (float)(sr / 400));
+        y[s + j] += (freq > 0) ? env * (float)sin(2.0 * M_PI * freq * j / sr) : env * noise();
+    }
+}
+
+static float* material_alloc(Material* m, const char* name, int len, int sr) {
+    snprintf(m->name, sizeof(m->name), "%s", name);
+    m->sr = sr;
+    m->len = len;
+    m->y = (float*)calloc((size_t)m->len, sizeof(float));
+    return m->y;
+}
+
+// 120 BPM clicks over a quiet noise floor
+static int make_clicks(Material* m, int seconds, int sr) {
+    float* y = material_alloc(m, "clicks", seconds * sr, sr);
+    if (!y) return 0;
+    for (int i = 0; i < m->len; i++) y[i] = 0.005f * noise();
+    for (int s = sr / 10; s < m->len; s += sr / 2) add_burst(y, m->len, sr, s, 0.8f, 0.0);
+    return 1;
+}
+
+static int make_noise(Material* m, int seconds, int sr) {
+    float* y = material_alloc(m, "noise", seconds * sr, sr);
+    if (!y) return 0;
+    for (int i = 0; i < m->len; i++) y[i] = 0.3f * noise();
+    return 1;
+}
+
+// Pitched hits cycling through the bands while the tempo rises from 60 to 240 BPM
+static int make_sweep(Material* m, int seconds, int sr) {
+    static const double freqs[4] = { 80.0, 600.0, 3000.0, 9000.0 };
+    float* y = material_alloc(m, "sweep", seconds * sr, sr);
+    if (!y) return 0;
+    for (int i = 0; i < m->len; i++) y[i] = 0.005f * noise();
+    double t = 0.1;
+    for (int k = 0; t < seconds; k++) {
+        add_burst(y, m->len, sr, (int)(t * sr), 0.4f + 0.1f * (k % 5), freqs[k % 4]);
+        double bpm = 60.0 + 180.0 * t / seconds;
+        t += 60.0 / bpm;
+    }
+    return 1;
+}
+
+static unsigned int read_le(const unsigned char* p, int bytes) {
+    unsigned int v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+// PCM 16/24/32 bit or float32 WAV, mixed down to mono
+static int load_wav(Material* m, const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char* data = (unsigned char*)malloc((size_t)size);
+    int ok = data && fread(data, 1, (size_t)size, f) == (size_t)size && size >= 12 &&
+             !memcmp(data, "RIFF", 4) && !memcmp(data + 8, "WAVE", 4);
+    fclose(f);
+    if (!ok) { free(data); return 0; }
+
+    int format = 0, channels = 0, bits = 0, sr = 0;
+    const unsigned char* pcm = NULL;
+    long pcm_len = 0;
+    for (long pos = 12; pos + 8 <= size;) {
+        long chunk = (long)read_le(data + pos + 4, 4);
+        if (chunk > size - pos - 8) chunk = size - pos - 8;
+        if (!memcmp(data + pos, "fmt ", 4) && chunk >= 16) {
+            format = (int)read_le(data + pos + 8, 2);
+            channels = (int)read_le(data + pos + 10, 2);
+            sr = (int)read_le(data + pos + 12, 4);
+            bits = (int)read_le(data + pos + 22, 2);
+            if (format == 0xFFFE && chunk >= 26) format = (int)read_le(data + pos + 32, 2);
+        } else if (!memcmp(data + pos, "data", 4)) {
+            pcm = data + pos + 8;
+            pcm_len = chunk;
+        }
+        pos += 8 + chunk + (chunk & 1);
+    }
+    int bytes = bits / 8;
+    if (!pcm || channels <= 0 || sr <= 0 || !((format == 1 && bytes >= 2 && bytes <= 4) || (format == 3 && bytes == 4))) {
+        free(data);
+        return 0;
+    }
+
+    const char* base = strrchr(path, '/');
+    int frames = (int)(pcm_len / (bytes * channels));
+    if (!material_alloc(m, base ? base + 1 : path, frames, sr)) { free(data); return 0; }
+    for (int i = 0; i < frames; i++) {
+        double sum = 0;
+        for (int c = 0; c < channels; c++) {
+            const unsigned char* p = pcm + ((long)i * channels + c) * bytes;
+            if (format == 3) {
+                float v;
+                memcpy(&v, p, 4);
+                sum += v;
+            } else {
+                unsigned int u = read_le(p, bytes) << (32 - bits);
+                sum += (double)(int)u / 2147483648.0;
+            }
+        }
+        m->y[i] = (float)(sum / channels);
+    }
+    free(data);
+    return 1;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// analyzer_push_audio in 100 ms pieces: the front end alone
+static void run_push(const Material* m, const BenchOptions* opt, BenchResult* r) {
+    TransientAnalyzer* a = analyzer_create(1.0, NULL, NULL, NULL, NULL);
+    analyzer_set_sample_rate(a, m->sr);
+    analyzer_set_profiling(a, opt->profile);
+    int hop = (int)(m->sr * 0.1);
+    long long calls0 = alloc_calls;
+    double t0 = now_s();
+    for (int pos = 0; pos + hop <= m->len; pos += hop) {
+        analyzer_push_audio(a, m->y + pos, hop, m->sr);
+        r->hops++;
+    }
+    r->wall_s = now_s() - t0;
+    alloc_calls -= calls0;
+    r->frames = a->total_frames_pushed;
+    r->has_profile = opt->profile;
+    analyzer_get_profile(a, &r->profile);
+    analyzer_destroy(a);
+}
+
+// analyzer_analyze_chunk every 100 ms with the frame ranges analyze~ uses
+static void run_chunk(const Material* m, const BenchOptions* opt, BenchResult* r) {
+    TransientAnalyzer* a = analyzer_create(1.0, NULL, NULL, NULL, NULL);
+    ChunkAnalysisResult* res = (ChunkAnalysisResult*)malloc(sizeof(ChunkAnalysisResult));
+    int sr = m->sr, hop = (int)(sr * 0.1), ms = (int)(sr * 0.001);
+    int max_hops = m->len / hop;
+    double* hop_ms = (double*)malloc(sizeof(double) * (max_hops > 0 ? max_hops : 1));
+    analyzer_set_sample_rate(a, sr);
+    if (!analyzer_set_metrics_mode(a, opt->metrics)) {
+        fprintf(stderr, "ct_bench: could not allocate the incremental metrics state\n");
+        _exit(1);
+    }
+    analyzer_set_profiling(a, opt->profile);
+
+    long long calls0 = alloc_calls;
+    double t0 = now_s();
+    for (long long target = hop; target <= m->len; target += hop) {
+        int active_start_samples = (int)(target - hop - (int)(sr * 0.2));
+        int window_start_samples = active_start_samples - (int)(sr * 15.0);
+        if (window_start_samples < 0) window_start_samples = 0;
+        double h0 = now_s();
+        if (analyzer_analyze_chunk(a, m->y + target - hop, hop, sr, window_start_samples / ms, active_start_samples / ms, res)) {
+            r->peaks += res->peak_list.num_peaks;
+        }
+        hop_ms[r->hops++] = (now_s() - h0) * 1000.0;
+    }
+    r->wall_s = now_s() - t0;
+    alloc_calls -= calls0;
+    r->frames = a->total_frames_pushed;
+    r->has_profile = opt->profile;
+    analyzer_get_profile(a, &r->profile);
+    if (r->hops > 0) {
+        qsort(hop_ms, r->hops, sizeof(double), compare_double);
+        r->hop_max_ms = hop_ms[r->hops - 1];
+        r->hop_p99_ms = hop_ms[(int)(0.99 * (r->hops - 1))];
+    }
+    free(hop_ms);
+    free(res);
+    analyzer_destroy(a);
+}
+
+// analyzer_batch_analyze_threads: the whole result in memory
+static void run_batch(const Material* m, const BenchOptions* opt, BenchResult* r) {
+    FullAnalysisResult res;
+    long long calls0 = alloc_calls;
+    double t0 = now_s();
+    int ok = analyzer_batch_analyze_profiled(m->y, m->len, m->sr, opt->threads, &res, opt->profile ? &r->profile : NULL);
+    r->wall_s = now_s() - t0;
+    alloc_calls -= calls0;
+    r->hops = (int)(m->len / (int)(m->sr * 0.1));
+    r->has_profile = opt->profile;
+    if (!ok) return;
+    r->frames = res.num_frames;
+    for (int b = 0; b < MAX_BANDS; b++) r->peaks += res.bands[b].num_peaks;
+    analyzer_free_analysis(&res);
+}
+
+static void count_frames(void* ctx, const AnalysisFrame* frames, int count) {
+    (void)frames;
+    ((BenchResult*)ctx)->frames += count;
+}
+
+static void count_peaks(void* ctx, const PeakResult* peaks, int count, const Qualifier* qualifiers) {
+    (void)peaks; (void)qualifiers;
+    ((BenchResult*)ctx)->peaks += count;
+}
+
+// The streaming batch API in 100 ms pieces, with the result discarded
+static void run_stream(const Material* m, const BenchOptions* opt, BenchResult* r) {
+    AnalysisSink sink = { r, count_frames, count_peaks, NULL };
+    AnalysisStream* s = analyzer_stream_create(m->sr, opt->threads, &sink);
+    if (!s) return;
+    analyzer_stream_set_profiling(s, opt->profile);
+    int hop = (int)(m->sr * 0.1);
+    long long calls0 = alloc_calls;
+    double t0 = now_s();
+    for (int pos = 0; pos < m->len; pos += hop) {
+        analyzer_stream_push(s, m->y + pos, (m->len - pos < hop) ? m->len - pos : hop);
+        r->hops++;
+    }
+    analyzer_stream_finish(s);
+    r->wall_s = now_s() - t0;
+    alloc_calls -= calls0;
+    r->has_profile = opt->profile;
+    analyzer_stream_get_profile(s, &r->profile);
+    analyzer_stream_destroy(s);
+}
+
+static void print_json_string(const char* s) {
+    putchar('"');
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') putchar('\\');
+        if ((unsigned char)*s >= 0x20) putchar(*s);
+    }
+    putchar('"');
+}
+
+static void report(const Material* m, const char* mode, const BenchOptions* opt, const BenchResult* r) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    double audio_s = (double)m->len / m->sr;
+    double us_per_frame = r->frames > 0 ? r->wall_s * 1e6 / (double)r->frames : 0.0;
+
+    printf("{\"version\":");
+    print_json_string(CT_BENCH_VERSION);
+    printf(",\"material\":");
+    print_json_string(m->name);
+    printf(",\"mode\":\"%s\",\"sr\":%d,\"threads\":%d,\"profiled\":%s", mode, m->sr,
+           (!strcmp(mode, "batch") || !strcmp(mode, "stream")) ? opt->threads : 1, opt->profile ? "true" : "false");
+    printf(",\"audio_s\":%.3f,\"frames\":%lld,\"peaks\":%d,\"wall_s\":%.6f", audio_s, r->frames, r->peaks, r->wall_s);
+    printf(",\"frames_per_s\":%.1f,\"realtime_x\":%.2f", r->wall_s > 0 ? (double)r->frames / r->wall_s : 0.0, r->wall_s > 0 ? audio_s / r->wall_s : 0.0);
+    // Each 1 ms frame has a 1 ms real-time budget
+    printf(",\"us_per_frame\":%.3f,\"budget_used\":%.5f", us_per_frame, us_per_frame / 1000.0);
+    if (!strcmp(mode, "chunk")) {
+        printf(",\"metrics\":\"%s\",\"hop_max_ms\":%.3f,\"hop_p99_ms\":%.3f", opt->metrics == CT_METRICS_INCREMENTAL ? "incremental" : "full",
+               r->hop_max_ms, r->hop_p99_ms);
+    }
+    printf(",\"stages\":");
+    if (r->has_profile) {
+        printf("{");
+        for (int k = 0; k < CT_NUM_STAGES; k++) {
+            const LatencyHistogram* h = &r->profile.latency[k];
+            printf("%s\"%s\":{\"s\":%.6f,\"calls\":%lld,\"p50_us\":%.2f,\"p99_us\":%.2f,\"max_us\":%.2f}", k ? "," : "",
+                   analyzer_stage_name(k), r->profile.seconds[k], r->profile.calls[k],
+                   latency_histogram_quantile(h, 0.5) * 1e6, latency_histogram_quantile(h, 0.99) * 1e6, h->max_seconds * 1e6);
+        }
+        printf("}");
+    } else {
+        printf("null");
+    }
+    printf(",\"allocs\":%lld,\"allocs_per_hop\":%.3f,\"peak_rss_kb\":%ld}\n",
+           alloc_calls, r->hops > 0 ? (double)alloc_calls / r->hops : 0.0, ru.ru_maxrss);
+    fflush(stdout);
+}
+
+// Each case runs in its own process so peak RSS and the allocation count are its own
+static void run_case(const Material* m, const char* mode, const BenchOptions* opt) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) { perror("fork"); return; }
+    if (pid > 0) {
+        int status;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) fprintf(stderr, "ct_bench: %s/%s failed\n", m->name, mode);
+        return;
+    }
+    BenchResult r;
+    memset(&r, 0, sizeof(r));
+    alloc_calls = 0;
+    if (!strcmp(mode, "push")) run_push(m, opt, &r);
+    else if (!strcmp(mode, "chunk")) run_chunk(m, opt, &r);
+    else if (!strcmp(mode, "batch")) run_batch(m, opt, &r);
+    else run_stream(m, opt, &r);
+    report(m, mode, opt, &r);
+    _exit(0);
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: ct_bench [options] [file.wav ...]\n"
+            "  --seconds N     length of the synthetic material (default 60)\n"
+            "  --sr N          sample rate of the synthetic material (default 44100)\n"
+            "  --modes LIST    comma separated from push,chunk,batch,stream (default all)\n"
+            "  --threads N     front end threads for batch and stream (default 1)\n"
+            "  --metrics MODE  full or incremental metrics for chunk (default full)\n"
+            "  --no-profile    skip the per-stage timers\n"
+            "  --no-synthetic  only run the given files\n");
+}
+
+int main(int argc, char** argv) {
+    static const char* const modes[] = { "push", "chunk", "batch", "stream" };
+    BenchOptions opt = { 60, 44100, 1, 1, 1, "push,chunk,batch,stream", CT_METRICS_FULL };
+    const char* files[BENCH_MAX_FILES];
+    int num_files = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        int has_value = i + 1 < argc;
+        if (!strcmp(arg, "--seconds") && has_value) opt.seconds = atoi(argv[++i]);
+        else if (!strcmp(arg, "--sr") && has_value) opt.sr = atoi(argv[++i]);
+        else if (!strcmp(arg, "--modes") && has_value) opt.modes = argv[++i];
+        else if (!strcmp(arg, "--threads") && has_value) opt.threads = atoi(argv[++i]);
+        else if (!strcmp(arg, "--metrics") && has_value) {
+            const char* v = argv[++i];
+            if (!strcmp(v, "full")) opt.metrics = CT_METRICS_FULL;
+            else if (!strcmp(v, "incremental")) opt.metrics = CT_METRICS_INCREMENTAL;
+            else { usage(); return 2; }
+        }
+        else if (!strcmp(arg, "--no-profile")) opt.profile = 0;
+        else if (!strcmp(arg, "--no-synthetic")) opt.synthetic = 0;
+        else if (arg[0] == '-') { usage(); return 2; }
+        else if (num_files < BENCH_MAX_FILES) files[num_files++] = arg;
+    }
+    if (opt.seconds <= 0 || opt.sr < 1000 || opt.threads < 1) { usage(); return 2; }
+
+    // Materials are made one at a time so each case's peak RSS only includes its own input
+    typedef int (*make_material)(Material* m, int seconds, int sr);
+    static const make_material synthetic[] = { make_clicks, make_noise, make_sweep };
+    int num_synthetic = opt.synthetic ? 3 : 0;
+    for (int i = 0; i < num_synthetic + num_files; i++) {
+        Material m;
+        int ok = (i < num_synthetic) ? synthetic[i](&m, opt.seconds, opt.sr) : load_wav(&m, files[i - num_synthetic]);
+        if (!ok) {
+            if (i >= num_synthetic) fprintf(stderr, "ct_bench: could not read %s\n", files[i - num_synthetic]);
+            continue;
+        }
+        for (int k = 0; k < 4; k++) {
+            if (strstr(opt.modes, modes[k])) run_case(&m, modes[k], &opt);
+        }
+        free(m.y);
+    }
+    return 0;
+}
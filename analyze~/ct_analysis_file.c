@@ -0,0 +1,161 @@
+#include "ct_analysis_file.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define ANALYSIS_FILE_VERSION 1
+
+struct AnalysisFileWriter {
+    FILE* fp;
+    int failed;
+    void* column;               // Scratch for one column of the largest record
+};
+
+static int column_capacity(void) {
+    int n = ANALYSIS_FRAME_BATCH;
+    if (MAX_PEAKS_PER_CHUNK > n) n = MAX_PEAKS_PER_CHUNK;
+    if (MAX_CHUNK_QUALIFIERS > n) n = MAX_CHUNK_QUALIFIERS;
+    return n;
+}
+
+// Writes count values of size bytes each, little-endian whatever the host's byte order (floats are
+// assumed to share the integers' order, as on every platform Max runs on)
+static void file_write(AnalysisFileWriter* w, const void* data, size_t size, size_t count) {
+    static const uint16_t probe = 1;
+    if (count == 0) return;
+    if (size == 1 || *(const uint8_t*)&probe == 1) {
+        if (fwrite(data, size, count, w->fp) != count) w->failed = 1;
+        return;
+    }
+    unsigned char swapped[512];
+    const unsigned char* src = (const unsigned char*)data;
+    size_t per_pass = sizeof(swapped) / size;
+    while (count > 0) {
+        size_t n = count < per_pass ? count : per_pass;
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = 0; j < size; j++) swapped[i * size + j] = src[i * size + size - 1 - j];
+        }
+        if (fwrite(swapped, size, n, w->fp) != n) { w->failed = 1; return; }
+        src += n * size;
+        count -= n;
+    }
+}
+
+static void file_record(AnalysisFileWriter* w, const char* tag, int32_t count) {
+    file_write(w, tag, 1, 4);
+    file_write(w, &count, sizeof(count), 1);
+}
+
+// Gather expr for rows [0, count) into the scratch column and write it
+#define WRITE_COLUMN(w, type, count, expr) do { \
+        type* col_ = (type*)(w)->column; \
+        for (int i = 0; i < (count); i++) col_[i] = (type)(expr); \
+        file_write((w), col_, sizeof(type), (size_t)(count)); \
+    } while (0)
+
+static void file_frames(void* ctx, const AnalysisFrame* fr, int count) {
+    AnalysisFileWriter* w = (AnalysisFileWriter*)ctx;
+    file_record(w, "FRMS", count);
+    WRITE_COLUMN(w, int32_t, count, fr[i].frame);
+    WRITE_COLUMN(w, float, count, fr[i].time);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].envelope[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].dynamic_smoothing[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].prominence[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].prominence_avg[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].prominence_half_max[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].smoothing_avg[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].flux_avg[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].threshold[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].lookback[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].avg_delta[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, float, count, fr[i].total_delta[b]);
+    for (int b = 0; b < MAX_BANDS; b++) WRITE_COLUMN(w, int32_t, count, fr[i].p_count[b]);
+    WRITE_COLUMN(w, double, count, fr[i].rating);
+    WRITE_COLUMN(w, double, count, fr[i].std_dev);
+    WRITE_COLUMN(w, double, count, fr[i].mean);
+    WRITE_COLUMN(w, double, count, fr[i].contrast);
+    WRITE_COLUMN(w, double, count, fr[i].stability_score);
+    WRITE_COLUMN(w, double, count, fr[i].highest_peak_ms);
+    WRITE_COLUMN(w, double, count, fr[i].demarcation_line);
+    WRITE_COLUMN(w, float, count, fr[i].global_flux_avg);
+    WRITE_COLUMN(w, float, count, fr[i].global_smoothing_avg);
+}
+
+// One field of the peaks' qualifiers, gathered out of the chunk pool in peak order
+static void file_qualifier_column(AnalysisFileWriter* w, const PeakResult* p, int count, const Qualifier* qualifiers, size_t field) {
+    double* col = (double*)w->column;
+    int n = 0;
+    for (int k = 0; k < count; k++) {
+        for (int j = 0; j < p[k].num_qualifiers; j++) col[n++] = *(const double*)((const char*)&qualifiers[p[k].qualifier_start + j] + field);
+    }
+    file_write(w, col, sizeof(double), (size_t)n);
+}
+
+static void file_peaks(void* ctx, const PeakResult* p, int count, const Qualifier* qualifiers) {
+    AnalysisFileWriter* w = (AnalysisFileWriter*)ctx;
+    file_record(w, "PEAK", count);
+    WRITE_COLUMN(w, int32_t, count, p[i].p_idx);
+    WRITE_COLUMN(w, int32_t, count, p[i].band_idx);
+    WRITE_COLUMN(w, double, count, p[i].time);
+    WRITE_COLUMN(w, double, count, p[i].peak_val);
+    WRITE_COLUMN(w, double, count, p[i].total_score);
+    WRITE_COLUMN(w, double, count, p[i].detected_peak_val);
+    WRITE_COLUMN(w, double, count, p[i].thresh_val);
+    WRITE_COLUMN(w, double, count, p[i].left_min);
+    WRITE_COLUMN(w, double, count, p[i].right_min);
+    WRITE_COLUMN(w, double, count, p[i].prominence);
+    WRITE_COLUMN(w, int32_t, count, p[i].num_qualifiers);
+    WRITE_COLUMN(w, int32_t, count, p[i].snapshot.p_idx);
+    WRITE_COLUMN(w, int32_t, count, p[i].snapshot.src_offset);
+    WRITE_COLUMN(w, double, count, p[i].snapshot.norm);
+
+    int32_t n = 0;
+    for (int k = 0; k < count; k++) n += p[k].num_qualifiers;
+    file_write(w, &n, sizeof(n), 1);
+    file_qualifier_column(w, p, count, qualifiers, offsetof(Qualifier, ms));
+    file_qualifier_column(w, p, count, qualifiers, offsetof(Qualifier, val));
+    file_qualifier_column(w, p, count, qualifiers, offsetof(Qualifier, orig_ms));
+}
+
+static void file_finish(void* ctx, const AnalysisSummary* summary) {
+    AnalysisFileWriter* w = (AnalysisFileWriter*)ctx;
+    int32_t num_frames = summary->num_frames;
+    file_record(w, "SUMM", 1);
+    file_write(w, &num_frames, sizeof(num_frames), 1);
+    file_write(w, &summary->max_peak_value, sizeof(float), 1);
+    file_write(w, &summary->min_score_seen, sizeof(double), 1);
+    file_write(w, &summary->max_score_seen, sizeof(double), 1);
+    file_write(w, &summary->tolerance, sizeof(double), 1);
+}
+
+AnalysisFileWriter* analysis_file_open(const char* path, int sr, AnalysisSink* sink_out) {
+    AnalysisFileWriter* w = (AnalysisFileWriter*)calloc(1, sizeof(AnalysisFileWriter));
+    if (!w) return NULL;
+    w->column = malloc(sizeof(double) * column_capacity());
+    w->fp = fopen(path, "wb");
+    if (!w->column || !w->fp) {
+        if (w->fp) fclose(w->fp);
+        free(w->column); free(w);
+        return NULL;
+    }
+    int32_t header[3] = { ANALYSIS_FILE_VERSION, sr, ANALYSIS_FRAME_BATCH };
+    file_write(w, "CTAF", 1, 4);
+    file_write(w, header, sizeof(int32_t), 3);
+
+    sink_out->ctx = w;
+    sink_out->frames = file_frames;
+    sink_out->peaks = file_peaks;
+    sink_out->finish = file_finish;
+    return w;
+}
+
+int analysis_file_close(AnalysisFileWriter* w) {
+    if (!w) return 0;
+    if (fclose(w->fp) != 0) w->failed = 1;
+    int ok = !w->failed;
+    free(w->column);
+    free(w);
+    return ok;
+}
@@ -0,0 +1,26 @@
+#ifndef CT_ANALYSIS_FILE_H
+#define CT_ANALYSIS_FILE_H
+
+#include "cumulative_transience.h"
+
+// Columnar binary file written from an AnalysisStream sink. All values are little-endian.
+//
+//   header   "CTAF", int32 version (1), int32 sample rate, int32 ANALYSIS_FRAME_BATCH
+//   records  char tag[4], int32 count, then count values per column:
+//     FRMS   the AnalysisFrame fields in declaration order: frame (int32), time (float32), then
+//            each per-band field as MAX_BANDS columns (band 0 first; p_count int32, others
+//            float32), the seven double metrics (float64) and the two global averages (float32)
+//     PEAK   p_idx, band_idx (int32), time, peak_val, total_score, detected_peak_val, thresh_val,
+//            left_min, right_min, prominence (float64), num_qualifiers, snapshot p_idx,
+//            snapshot src_offset (int32), snapshot norm (float64); then int32 n and the peaks'
+//            qualifiers in peak order as columns ms, val, orig_ms (float64) of n values
+//     SUMM   count 1: num_frames (int32), max_peak_value (float32), min_score_seen,
+//            max_score_seen, tolerance (float64)
+typedef struct AnalysisFileWriter AnalysisFileWriter;
+
+// Opens path for writing and fills sink_out with callbacks that append to it. NULL on failure.
+AnalysisFileWriter* analysis_file_open(const char* path, int sr, AnalysisSink* sink_out);
+// Closes the file. Returns 0 if any write failed.
+int analysis_file_close(AnalysisFileWriter* writer);
+
+#endif // CT_ANALYSIS_FILE_H
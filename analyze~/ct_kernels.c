@@ -0,0 +1,281 @@
+#include "ct_kernels.h"
+#include <stddef.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CT_HAVE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define CT_HAVE_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define CT_TARGET_SSE2 __attribute__((target("sse2")))
+#define CT_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CT_TARGET_SSE2
+#define CT_TARGET_AVX2
+#endif
+
+// --- Scalar reference kernels ---
+
+static void scalar_window_deinterleave(const float* x, const double* win, double* even, double* odd, int n) {
+    for (int i = 0; i < n / 2; i++) {
+        even[i] = (double)x[2 * i] * win[2 * i];
+        odd[i] = (double)x[2 * i + 1] * win[2 * i + 1];
+    }
+}
+
+static double scalar_dot(const double* a, const double* b, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+static void scalar_clamp_floor(double* x, int n, double floor) {
+    for (int i = 0; i < n; i++) if (x[i] < floor) x[i] = floor;
+}
+
+static double scalar_positive_diff_sum(const double* cur, const double* prev, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        double d = cur[i] - prev[i];
+        if (d > 0) sum += d;
+    }
+    return sum;
+}
+
+static const CtKernels scalar_kernels = {
+    "scalar", CT_SIMD_SCALAR,
+    scalar_window_deinterleave, scalar_dot, scalar_clamp_floor, scalar_positive_diff_sum,
+    NULL, NULL
+};
+
+#if CT_HAVE_X86
+
+// --- SSE2 kernels (2 doubles per register) ---
+
+CT_TARGET_SSE2 static void sse2_window_deinterleave(const float* x, const double* win, double* even, double* odd, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 xf = _mm_loadu_ps(x + i);
+        __m128d lo = _mm_mul_pd(_mm_cvtps_pd(xf), _mm_loadu_pd(win + i));
+        __m128d hi = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(xf, xf)), _mm_loadu_pd(win + i + 2));
+        _mm_storeu_pd(even + i / 2, _mm_unpacklo_pd(lo, hi));
+        _mm_storeu_pd(odd + i / 2, _mm_unpackhi_pd(lo, hi));
+    }
+    for (; i < n; i += 2) {
+        even[i / 2] = (double)x[i] * win[i];
+        odd[i / 2] = (double)x[i + 1] * win[i + 1];
+    }
+}
+
+CT_TARGET_SSE2 static double sse2_dot(const double* a, const double* b, int n) {
+    __m128d acc = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 2 <= n; i += 2) acc = _mm_add_pd(acc, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    double sum = lanes[0] + lanes[1];
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+CT_TARGET_SSE2 static void sse2_clamp_floor(double* x, int n, double floor) {
+    __m128d f = _mm_set1_pd(floor);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(x + i, _mm_max_pd(_mm_loadu_pd(x + i), f));
+    for (; i < n; i++) if (x[i] < floor) x[i] = floor;
+}
+
+CT_TARGET_SSE2 static double sse2_positive_diff_sum(const double* cur, const double* prev, int n) {
+    __m128d acc = _mm_setzero_pd(), zero = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 2 <= n; i += 2) acc = _mm_add_pd(acc, _mm_max_pd(_mm_sub_pd(_mm_loadu_pd(cur + i), _mm_loadu_pd(prev + i)), zero));
+    double lanes[2];
+    _mm_storeu_pd(lanes, acc);
+    double sum = lanes[0] + lanes[1];
+    for (; i < n; i++) {
+        double d = cur[i] - prev[i];
+        if (d > 0) sum += d;
+    }
+    return sum;
+}
+
+static const CtKernels sse2_kernels = {
+    "sse2", CT_SIMD_SSE2,
+    sse2_window_deinterleave, sse2_dot, sse2_clamp_floor, sse2_positive_diff_sum,
+    NULL, NULL
+};
+
+// --- AVX2 kernels (4 doubles per register) ---
+
+CT_TARGET_AVX2 static void avx2_window_deinterleave(const float* x, const double* win, double* even, double* odd, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 xf = _mm256_loadu_ps(x + i);
+        __m256d lo = _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(xf)), _mm256_loadu_pd(win + i));
+        __m256d hi = _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(xf, 1)), _mm256_loadu_pd(win + i + 4));
+        // unpack gives [x0 x4 x2 x6] / [x1 x5 x3 x7]; the lane permute restores sample order
+        _mm256_storeu_pd(even + i / 2, _mm256_permute4x64_pd(_mm256_unpacklo_pd(lo, hi), 0xD8));
+        _mm256_storeu_pd(odd + i / 2, _mm256_permute4x64_pd(_mm256_unpackhi_pd(lo, hi), 0xD8));
+    }
+    for (; i < n; i += 2) {
+        even[i / 2] = (double)x[i] * win[i];
+        odd[i / 2] = (double)x[i + 1] * win[i + 1];
+    }
+}
+
+CT_TARGET_AVX2 static double avx2_dot(const double* a, const double* b, int n) {
+    __m256d acc = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) acc = _mm256_add_pd(acc, _mm256_mul_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i)));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < n; i++) sum += a[i] * b[i];
+    return sum;
+}
+
+CT_TARGET_AVX2 static void avx2_clamp_floor(double* x, int n, double floor) {
+    __m256d f = _mm256_set1_pd(floor);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(x + i, _mm256_max_pd(_mm256_loadu_pd(x + i), f));
+    for (; i < n; i++) if (x[i] < floor) x[i] = floor;
+}
+
+CT_TARGET_AVX2 static double avx2_positive_diff_sum(const double* cur, const double* prev, int n) {
+    __m256d acc = _mm256_setzero_pd(), zero = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) acc = _mm256_add_pd(acc, _mm256_max_pd(_mm256_sub_pd(_mm256_loadu_pd(cur + i), _mm256_loadu_pd(prev + i)), zero));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, acc);
+    double sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < n; i++) {
+        double d = cur[i] - prev[i];
+        if (d > 0) sum += d;
+    }
+    return sum;
+}
+
+// One register holds the same element of all four lanes
+CT_TARGET_AVX2 static void avx2_rfft_power_lanes(double* re, double* im, const double* tw_re, const double* tw_im, const int* bitrev, int n_fft, double* power_out) {
+    const int m = n_fft / 2;
+    for (int i = 0; i < m; i++) {
+        int j = bitrev[i];
+        if (i < j) {
+            __m256d tr = _mm256_loadu_pd(re + i * CT_LANES), ti = _mm256_loadu_pd(im + i * CT_LANES);
+            _mm256_storeu_pd(re + i * CT_LANES, _mm256_loadu_pd(re + j * CT_LANES));
+            _mm256_storeu_pd(im + i * CT_LANES, _mm256_loadu_pd(im + j * CT_LANES));
+            _mm256_storeu_pd(re + j * CT_LANES, tr);
+            _mm256_storeu_pd(im + j * CT_LANES, ti);
+        }
+    }
+    for (int len = 2; len <= m; len <<= 1) {
+        int half = len >> 1, step = n_fft / len;
+        for (int i = 0; i < m; i += len) {
+            for (int k = 0; k < half; k++) {
+                __m256d w_r = _mm256_set1_pd(tw_re[k * step]), w_i = _mm256_set1_pd(tw_im[k * step]);
+                double* pu_r = re + (i + k) * CT_LANES; double* pu_i = im + (i + k) * CT_LANES;
+                double* px_r = re + (i + k + half) * CT_LANES; double* px_i = im + (i + k + half) * CT_LANES;
+                __m256d x_r = _mm256_loadu_pd(px_r), x_i = _mm256_loadu_pd(px_i);
+                __m256d v_r = _mm256_sub_pd(_mm256_mul_pd(x_r, w_r), _mm256_mul_pd(x_i, w_i));
+                __m256d v_i = _mm256_add_pd(_mm256_mul_pd(x_r, w_i), _mm256_mul_pd(x_i, w_r));
+                __m256d u_r = _mm256_loadu_pd(pu_r), u_i = _mm256_loadu_pd(pu_i);
+                _mm256_storeu_pd(pu_r, _mm256_add_pd(u_r, v_r)); _mm256_storeu_pd(pu_i, _mm256_add_pd(u_i, v_i));
+                _mm256_storeu_pd(px_r, _mm256_sub_pd(u_r, v_r)); _mm256_storeu_pd(px_i, _mm256_sub_pd(u_i, v_i));
+            }
+        }
+    }
+    const __m256d norm = _mm256_set1_pd(1.0 / ((double)n_fft * (double)n_fft));
+    const __m256d half_pos = _mm256_set1_pd(0.5), half_neg = _mm256_set1_pd(-0.5), sign = _mm256_set1_pd(-0.0);
+    for (int k = 0; k <= m; k++) {
+        int a = (k == m) ? 0 : k, b = (k == 0) ? 0 : m - k;
+        __m256d zr = _mm256_loadu_pd(re + a * CT_LANES), zi = _mm256_loadu_pd(im + a * CT_LANES);
+        __m256d cr = _mm256_loadu_pd(re + b * CT_LANES), ci = _mm256_xor_pd(_mm256_loadu_pd(im + b * CT_LANES), sign);
+        __m256d e_r = _mm256_mul_pd(half_pos, _mm256_add_pd(zr, cr)), e_i = _mm256_mul_pd(half_pos, _mm256_add_pd(zi, ci));
+        __m256d o_r = _mm256_mul_pd(half_pos, _mm256_sub_pd(zi, ci)), o_i = _mm256_mul_pd(half_neg, _mm256_sub_pd(zr, cr));
+        __m256d t_r = _mm256_set1_pd(tw_re[k]), t_i = _mm256_set1_pd(tw_im[k]);
+        __m256d x_r = _mm256_sub_pd(_mm256_add_pd(e_r, _mm256_mul_pd(t_r, o_r)), _mm256_mul_pd(t_i, o_i));
+        __m256d x_i = _mm256_add_pd(_mm256_add_pd(e_i, _mm256_mul_pd(t_r, o_i)), _mm256_mul_pd(t_i, o_r));
+        _mm256_storeu_pd(power_out + k * CT_LANES, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(x_r, x_r), _mm256_mul_pd(x_i, x_i)), norm));
+    }
+}
+
+// Four accumulators per lane (i mod 4), combined like avx2_dot
+CT_TARGET_AVX2 static void avx2_dot_lanes(const double* a, const double* b, int n, double* out) {
+    __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd(), acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm256_add_pd(acc0, _mm256_mul_pd(_mm256_loadu_pd(a + i * CT_LANES), _mm256_set1_pd(b[i])));
+        acc1 = _mm256_add_pd(acc1, _mm256_mul_pd(_mm256_loadu_pd(a + (i + 1) * CT_LANES), _mm256_set1_pd(b[i + 1])));
+        acc2 = _mm256_add_pd(acc2, _mm256_mul_pd(_mm256_loadu_pd(a + (i + 2) * CT_LANES), _mm256_set1_pd(b[i + 2])));
+        acc3 = _mm256_add_pd(acc3, _mm256_mul_pd(_mm256_loadu_pd(a + (i + 3) * CT_LANES), _mm256_set1_pd(b[i + 3])));
+    }
+    __m256d sum = _mm256_add_pd(_mm256_add_pd(acc0, acc1), _mm256_add_pd(acc2, acc3));
+    for (; i < n; i++) sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_loadu_pd(a + i * CT_LANES), _mm256_set1_pd(b[i])));
+    _mm256_storeu_pd(out, sum);
+}
+
+static const CtKernels avx2_kernels = {
+    "avx2", CT_SIMD_AVX2,
+    avx2_window_deinterleave, avx2_dot, avx2_clamp_floor, avx2_positive_diff_sum,
+    avx2_rfft_power_lanes, avx2_dot_lanes
+};
+
+#endif
+
+int ct_kernels_detect_level(void) {
+#if CT_HAVE_X86
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    int max_leaf = regs[0];
+    __cpuid(regs, 1);
+    int has_sse2 = (regs[3] >> 26) & 1;
+    int has_osxsave_avx = ((regs[2] >> 27) & 1) && ((regs[2] >> 28) & 1);
+    int has_avx2 = 0;
+    if (has_osxsave_avx && max_leaf >= 7 && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(regs, 7, 0);
+        has_avx2 = (regs[1] >> 5) & 1;
+    }
+    if (has_avx2) return CT_SIMD_AVX2;
+    if (has_sse2) return CT_SIMD_SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return CT_SIMD_AVX2;
+    if (__builtin_cpu_supports("sse2")) return CT_SIMD_SSE2;
+#endif
+#endif
+    return CT_SIMD_SCALAR;
+}
+
+static const CtKernels* kernels_for_level(int level) {
+#if CT_HAVE_X86
+    if (level >= CT_SIMD_AVX2) return &avx2_kernels;
+    if (level >= CT_SIMD_SSE2) return &sse2_kernels;
+#endif
+    return &scalar_kernels;
+}
+
+// Selected once and only ever replaced by another immutable table, so concurrent readers are safe.
+static const CtKernels* volatile active_kernels = NULL;
+
+int ct_kernels_set_level(int level) {
+    int max_level = ct_kernels_detect_level();
+    if (level > max_level) level = max_level;
+    if (level < CT_SIMD_SCALAR) level = CT_SIMD_SCALAR;
+    active_kernels = kernels_for_level(level);
+    return active_kernels->level;
+}
+
+const CtKernels* ct_kernels_get(void) {
+    const CtKernels* k = active_kernels;
+    if (!k) {
+        k = kernels_for_level(ct_kernels_detect_level());
+        active_kernels = k;
+    }
+    return k;
+}
@@ -0,0 +1,53 @@
+#ifndef CT_KERNELS_H
+#define CT_KERNELS_H
+
+// Data-parallel inner loops of the transient analyzer's per-frame path, with scalar, SSE2 and
+// AVX2 implementations selected at runtime from the host CPU.
+
+#define CT_SIMD_SCALAR 0
+#define CT_SIMD_SSE2 1
+#define CT_SIMD_AVX2 2
+
+// Channels processed together by the lane kernels, one per double lane of an AVX2 register
+#define CT_LANES 4
+
+typedef struct {
+    const char* name;
+    int level;
+
+    // even[i] = x[2i] * win[2i], odd[i] = x[2i+1] * win[2i+1] for i in [0, n/2). n must be even.
+    void (*window_deinterleave)(const float* x, const double* win, double* even, double* odd, int n);
+
+    // Sum of a[i] * b[i] for i in [0, n)
+    double (*dot)(const double* a, const double* b, int n);
+
+    // x[i] = max(x[i], floor) for i in [0, n)
+    void (*clamp_floor)(double* x, int n, double floor);
+
+    // Sum of max(cur[i] - prev[i], 0) for i in [0, n)
+    double (*positive_diff_sum)(const double* cur, const double* prev, int n);
+
+    // Lane kernels work on CT_LANES channels at once, interleaved so that element i of lane l is
+    // x[i * CT_LANES + l]. Each lane's result is bit-identical to the single-channel path. Only the
+    // AVX2 table has them (four doubles per register); they are NULL at lower levels, where
+    // interleaving costs more than it saves.
+
+    // Real-input FFT power spectrum of one frame per lane, the lane form of rfft_power in
+    // cumulative_transience.c: re/im hold n_fft/2 packed complex values per lane and power_out
+    // receives n_fft/2 + 1 bins per lane. tw_* and bitrev are that function's tables.
+    void (*rfft_power_lanes)(double* re, double* im, const double* tw_re, const double* tw_im, const int* bitrev, int n_fft, double* power_out);
+
+    // out[l] = sum of a[i * CT_LANES + l] * b[i] for i in [0, n), accumulated like dot
+    void (*dot_lanes)(const double* a, const double* b, int n, double* out);
+} CtKernels;
+
+// Highest kernel level supported by this CPU and build
+int ct_kernels_detect_level(void);
+
+// Force a kernel level (clamped to what the CPU supports). Returns the level in effect.
+int ct_kernels_set_level(int level);
+
+// Kernel set currently in effect (detected on first use)
+const CtKernels* ct_kernels_get(void);
+
+#endif // CT_KERNELS_H
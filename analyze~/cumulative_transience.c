@@ -1,10 +1,20 @@
 #define _USE_MATH_DEFINES
 #include "cumulative_transience.h"
+#include "ct_kernels.h"
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 #include <float.h>
+#include <limits.h>
 #include <stdio.h>
+#include <time.h>
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -13,43 +23,71 @@
 #define N_FFT 2048
 #define N_MELS 128
 #define CACHE_SIZE 15201
+#define FLUX_STRIDE (2 * CACHE_SIZE)  // Band stride of the mirrored flux cache
 
-static void fft(double* real, double* imag, int n) {
-    int j = 0;
-    for (int i = 0; i < n - 1; i++) {
-        if (i < j) {
-            double tr = real[i]; real[i] = real[j]; real[j] = tr;
-            double ti = imag[i]; imag[i] = imag[j]; imag[j] = ti;
-        }
-        int k = n >> 1;
-        while (k <= j) {
-            j -= k;
+#define N_BINS (N_FFT / 2 + 1)
+
+// Twiddles exp(-2*pi*i*k/N_FFT) for k in [0, N_FFT/2] and the bit-reversal permutation of the
+// N_FFT/2-point complex transform used by the real-input STFT.
+static void rfft_init_tables(double* tw_re, double* tw_im, int* bitrev) {
+    for (int k = 0; k < N_BINS; k++) {
+        tw_re[k] = cos(2.0 * M_PI * k / (double)N_FFT);
+        tw_im[k] = -sin(2.0 * M_PI * k / (double)N_FFT);
+    }
+    int m = N_FFT / 2, j = 0;
+    for (int i = 0; i < m; i++) {
+        bitrev[i] = j;
+        int k = m >> 1;
+        while (k >= 1 && (j & k)) {
+            j ^= k;
             k >>= 1;
         }
-        j += k;
-    }
-    for (int len = 2; len <= n; len <<= 1) {
-        double ang = 2.0 * M_PI / len;
-        double wlen_r = cos(ang), wlen_i = -sin(ang);
-        for (int i = 0; i < n; i += len) {
-            double w_r = 1.0, w_i = 0.0;
-            for (int k = 0; k < len / 2; k++) {
-                double u_r = real[i + k], u_i = imag[i + k];
-                double v_r = real[i + k + len / 2] * w_r - imag[i + k + len / 2] * w_i;
-                double v_i = real[i + k + len / 2] * w_i + imag[i + k + len / 2] * w_r;
-                real[i + k] = u_r + v_r; imag[i + k] = u_i + v_i;
-                real[i + k + len / 2] = u_r - v_r; imag[i + k + len / 2] = u_i - v_i;
-                double tmp_r = w_r * wlen_r - w_i * wlen_i;
-                w_i = w_r * wlen_i + w_i * wlen_r; w_r = tmp_r;
+        j |= k;
+    }
+}
+
+// Real-input FFT of an N_FFT-point frame packed as N_FFT/2 complex values (even samples in re,
+// odd samples in im). Writes |X[k]|^2 / N_FFT^2 for k in [0, N_FFT/2] to power_out.
+static void rfft_power(double* re, double* im, const double* tw_re, const double* tw_im, const int* bitrev, double* power_out) {
+    const int m = N_FFT / 2;
+    for (int i = 0; i < m; i++) {
+        int j = bitrev[i];
+        if (i < j) {
+            double tr = re[i]; re[i] = re[j]; re[j] = tr;
+            double ti = im[i]; im[i] = im[j]; im[j] = ti;
+        }
+    }
+    for (int len = 2; len <= m; len <<= 1) {
+        int half = len >> 1, step = N_FFT / len;
+        for (int i = 0; i < m; i += len) {
+            for (int k = 0; k < half; k++) {
+                double w_r = tw_re[k * step], w_i = tw_im[k * step];
+                double x_r = re[i + k + half], x_i = im[i + k + half];
+                double v_r = x_r * w_r - x_i * w_i;
+                double v_i = x_r * w_i + x_i * w_r;
+                double u_r = re[i + k], u_i = im[i + k];
+                re[i + k] = u_r + v_r; im[i + k] = u_i + v_i;
+                re[i + k + half] = u_r - v_r; im[i + k + half] = u_i - v_i;
             }
         }
     }
+    // Split the half-length spectrum Z into the spectrum X of the real frame:
+    // X[k] = (Z[k] + conj(Z[m-k])) / 2 + W^k * (Z[k] - conj(Z[m-k])) / 2i
+    const double norm = 1.0 / ((double)N_FFT * (double)N_FFT);
+    for (int k = 0; k <= m; k++) {
+        int a = (k == m) ? 0 : k, b = (k == 0) ? 0 : m - k;
+        double zr = re[a], zi = im[a], cr = re[b], ci = -im[b];
+        double e_r = 0.5 * (zr + cr), e_i = 0.5 * (zi + ci);
+        double o_r = 0.5 * (zi - ci), o_i = -0.5 * (zr - cr);
+        double x_r = e_r + tw_re[k] * o_r - tw_im[k] * o_i;
+        double x_i = e_i + tw_re[k] * o_i + tw_im[k] * o_r;
+        power_out[k] = (x_r * x_r + x_i * x_i) * norm;
+    }
 }
 
-typedef struct { int p_idx; int band_idx; } PeakRef;
 static int compare_peaks(const void* a, const void* b) { return ((PeakRef*)a)->p_idx - ((PeakRef*)b)->p_idx; }
 
-static float calculate_half_max(float* values, int n) {
+static float calculate_half_max(const float* values, int n) {
     if (n <= 0) return 0;
     float max_v = values[0];
     for (int i = 1; i < n; i++) {
@@ -58,6 +96,161 @@ static float calculate_half_max(float* values, int n) {
     return max_v / 2.0f;
 }
 
+// Range index over a band-major cache ring (MAX_BANDS x CACHE_SIZE): per band, a max and a min
+// segment tree whose leaves summarize RANGE_BLOCK consecutive slots. Queries scan at most two partial
+// blocks and descend the trees for the rest.
+#define RANGE_BLOCK 8
+#define RANGE_LEAVES 2048                   // Power of two covering CACHE_SIZE / RANGE_BLOCK
+#define RANGE_INDEX_FLOATS (MAX_BANDS * 4 * RANGE_LEAVES)
+
+static float* range_max_tree(float* index, int band) { return index + band * 4 * RANGE_LEAVES; }
+static float* range_min_tree(float* index, int band) { return index + band * 4 * RANGE_LEAVES + 2 * RANGE_LEAVES; }
+
+static void range_index_set_block(float* mx, float* mn, const float* values, int blk) {
+    int lo = blk * RANGE_BLOCK, hi = lo + RANGE_BLOCK;
+    if (hi > CACHE_SIZE) hi = CACHE_SIZE;
+    float a = values[lo], c = values[lo];
+    for (int i = lo + 1; i < hi; i++) {
+        if (values[i] > a) a = values[i];
+        if (values[i] < c) c = values[i];
+    }
+    mx[RANGE_LEAVES + blk] = a;
+    mn[RANGE_LEAVES + blk] = c;
+}
+
+static void range_index_build(float* index, const float* cache) {
+    for (int b = 0; b < MAX_BANDS; b++) {
+        float *mx = range_max_tree(index, b), *mn = range_min_tree(index, b);
+        const float* values = cache + b * CACHE_SIZE;
+        for (int blk = 0; blk < RANGE_LEAVES; blk++) {
+            if (blk * RANGE_BLOCK < CACHE_SIZE) {
+                range_index_set_block(mx, mn, values, blk);
+            } else {
+                mx[RANGE_LEAVES + blk] = -FLT_MAX;
+                mn[RANGE_LEAVES + blk] = FLT_MAX;
+            }
+        }
+        for (int i = RANGE_LEAVES - 1; i >= 1; i--) {
+            mx[i] = (mx[2 * i] > mx[2 * i + 1]) ? mx[2 * i] : mx[2 * i + 1];
+            mn[i] = (mn[2 * i] < mn[2 * i + 1]) ? mn[2 * i] : mn[2 * i + 1];
+        }
+    }
+}
+
+// Refresh the index after cache[band * CACHE_SIZE + slot] changed
+static void range_index_update(float* index, const float* cache, int band, int slot) {
+    float *mx = range_max_tree(index, band), *mn = range_min_tree(index, band);
+    int i = RANGE_LEAVES + slot / RANGE_BLOCK;
+    range_index_set_block(mx, mn, cache + band * CACHE_SIZE, slot / RANGE_BLOCK);
+    for (i >>= 1; i >= 1; i >>= 1) {
+        mx[i] = (mx[2 * i] > mx[2 * i + 1]) ? mx[2 * i] : mx[2 * i + 1];
+        mn[i] = (mn[2 * i] < mn[2 * i + 1]) ? mn[2 * i] : mn[2 * i + 1];
+    }
+}
+
+static float range_tree_max(const float* mx, int lo, int hi) {
+    float m = -FLT_MAX;
+    for (lo += RANGE_LEAVES, hi += RANGE_LEAVES; lo < hi; lo >>= 1, hi >>= 1) {
+        if (lo & 1) { if (mx[lo] > m) m = mx[lo]; lo++; }
+        if (hi & 1) { hi--; if (mx[hi] > m) m = mx[hi]; }
+    }
+    return m;
+}
+
+static float range_tree_min(const float* mn, int lo, int hi) {
+    float m = FLT_MAX;
+    for (lo += RANGE_LEAVES, hi += RANGE_LEAVES; lo < hi; lo >>= 1, hi >>= 1) {
+        if (lo & 1) { if (mn[lo] < m) m = mn[lo]; lo++; }
+        if (hi & 1) { hi--; if (mn[hi] < m) m = mn[hi]; }
+    }
+    return m;
+}
+
+// First / last leaf in [ql, qr) of the subtree node (covering [nl, nr)) whose max exceeds val, or -1
+static int range_tree_first_greater(const float* mx, int node, int nl, int nr, int ql, int qr, float val) {
+    if (qr <= nl || nr <= ql || !(mx[node] > val)) return -1;
+    if (nr - nl == 1) return nl;
+    int mid = (nl + nr) / 2;
+    int r = range_tree_first_greater(mx, 2 * node, nl, mid, ql, qr, val);
+    return (r >= 0) ? r : range_tree_first_greater(mx, 2 * node + 1, mid, nr, ql, qr, val);
+}
+
+static int range_tree_last_greater(const float* mx, int node, int nl, int nr, int ql, int qr, float val) {
+    if (qr <= nl || nr <= ql || !(mx[node] > val)) return -1;
+    if (nr - nl == 1) return nl;
+    int mid = (nl + nr) / 2;
+    int r = range_tree_last_greater(mx, 2 * node + 1, mid, nr, ql, qr, val);
+    return (r >= 0) ? r : range_tree_last_greater(mx, 2 * node, nl, mid, ql, qr, val);
+}
+
+// Max of values[lo, hi)
+static float range_index_max(float* index, int band, const float* values, int lo, int hi) {
+    float m = -FLT_MAX;
+    int bl = (lo + RANGE_BLOCK - 1) / RANGE_BLOCK, bh = hi / RANGE_BLOCK;
+    if (bl >= bh) {
+        for (int i = lo; i < hi; i++) if (values[i] > m) m = values[i];
+        return m;
+    }
+    for (int i = lo; i < bl * RANGE_BLOCK; i++) if (values[i] > m) m = values[i];
+    float t = range_tree_max(range_max_tree(index, band), bl, bh);
+    if (t > m) m = t;
+    for (int i = bh * RANGE_BLOCK; i < hi; i++) if (values[i] > m) m = values[i];
+    return m;
+}
+
+// Walk values from hi - 1 down to lo and return the first index holding a value above val, or -1.
+// *min_io is lowered to the minimum of the values walked past before stopping.
+static int range_index_prev_greater(float* index, int band, const float* values, int lo, int hi, float val, float* min_io) {
+    float m = *min_io;
+    int i = hi - 1;
+    int bl = (lo + RANGE_BLOCK - 1) / RANGE_BLOCK, bh = hi / RANGE_BLOCK;
+    if (bl < bh) {
+        for (; i >= bh * RANGE_BLOCK; i--) {
+            if (values[i] > val) { *min_io = m; return i; }
+            if (values[i] < m) m = values[i];
+        }
+        int blk = range_tree_last_greater(range_max_tree(index, band), 1, 0, RANGE_LEAVES, bl, bh, val);
+        int skip_from = (blk >= 0) ? blk + 1 : bl;
+        if (skip_from < bh) {
+            float t = range_tree_min(range_min_tree(index, band), skip_from, bh);
+            if (t < m) m = t;
+        }
+        i = (blk >= 0) ? (blk + 1) * RANGE_BLOCK - 1 : bl * RANGE_BLOCK - 1;
+    }
+    for (; i >= lo; i--) {
+        if (values[i] > val) { *min_io = m; return i; }
+        if (values[i] < m) m = values[i];
+    }
+    *min_io = m;
+    return -1;
+}
+
+// Walk values from lo up to hi - 1; otherwise as range_index_prev_greater
+static int range_index_next_greater(float* index, int band, const float* values, int lo, int hi, float val, float* min_io) {
+    float m = *min_io;
+    int i = lo;
+    int bl = (lo + RANGE_BLOCK - 1) / RANGE_BLOCK, bh = hi / RANGE_BLOCK;
+    if (bl < bh) {
+        for (; i < bl * RANGE_BLOCK; i++) {
+            if (values[i] > val) { *min_io = m; return i; }
+            if (values[i] < m) m = values[i];
+        }
+        int blk = range_tree_first_greater(range_max_tree(index, band), 1, 0, RANGE_LEAVES, bl, bh, val);
+        int skip_to = (blk >= 0) ? blk : bh;
+        if (bl < skip_to) {
+            float t = range_tree_min(range_min_tree(index, band), bl, skip_to);
+            if (t < m) m = t;
+        }
+        i = skip_to * RANGE_BLOCK;
+    }
+    for (; i < hi; i++) {
+        if (values[i] > val) { *min_io = m; return i; }
+        if (values[i] < m) m = values[i];
+    }
+    *min_io = m;
+    return -1;
+}
+
 static float calculate_prominence_global(TransientAnalyzer* self, int band_idx, int cache_idx, float* lmin_out, float* rmin_out) {
     int nf = self->cache_count;
     if (nf <= 0) {
@@ -73,23 +266,28 @@ static float calculate_prominence_global(TransientAnalyzer* self, int band_idx,
     int latest_idx = (self->cache_write_ptr - 1 + CACHE_SIZE) % CACHE_SIZE;
     int steps_forward = (latest_idx - cache_idx + CACHE_SIZE) % CACHE_SIZE;
 
-    float val = self->dynamic_smoothings[band_idx * CACHE_SIZE + cache_idx];
+    const float* values = self->dynamic_smoothings + band_idx * CACHE_SIZE;
+    float* index = self->smoothing_index;
+    float val = values[cache_idx];
     float lmin = val;
-    // Search backwards in the global circular buffer until rptr (oldest valid frame)
-    for (int k = 1; k <= steps_back; k++) {
-        int idx = (cache_idx - k + CACHE_SIZE) % CACHE_SIZE;
-        float v = self->dynamic_smoothings[band_idx * CACHE_SIZE + idx];
-        if (v > val) break;
-        if (v < lmin) lmin = v;
+    // Search backwards in the global circular buffer until rptr (oldest valid frame), stopping at
+    // the first higher value. The ring is split into at most two linear spans.
+    if (steps_back > 0) {
+        if (cache_idx - steps_back >= 0) {
+            range_index_prev_greater(index, band_idx, values, cache_idx - steps_back, cache_idx, val, &lmin);
+        } else if (range_index_prev_greater(index, band_idx, values, 0, cache_idx, val, &lmin) < 0) {
+            range_index_prev_greater(index, band_idx, values, cache_idx - steps_back + CACHE_SIZE, CACHE_SIZE, val, &lmin);
+        }
     }
 
     float rmin = val;
     // Search forwards in the global circular buffer until latest_idx (newest valid frame)
-    for (int k = 1; k <= steps_forward; k++) {
-        int idx = (cache_idx + k) % CACHE_SIZE;
-        float v = self->dynamic_smoothings[band_idx * CACHE_SIZE + idx];
-        if (v > val) break;
-        if (v < rmin) rmin = v;
+    if (steps_forward > 0) {
+        if (cache_idx + steps_forward < CACHE_SIZE) {
+            range_index_next_greater(index, band_idx, values, cache_idx + 1, cache_idx + 1 + steps_forward, val, &rmin);
+        } else if (range_index_next_greater(index, band_idx, values, cache_idx + 1, CACHE_SIZE, val, &rmin) < 0) {
+            range_index_next_greater(index, band_idx, values, 0, cache_idx + steps_forward - CACHE_SIZE + 1, val, &rmin);
+        }
     }
 
     if (lmin_out) *lmin_out = lmin;
@@ -97,7 +295,584 @@ static float calculate_prominence_global(TransientAnalyzer* self, int band_idx,
     return val - (lmin > rmin ? lmin : rmin);
 }
 
+// Exclude the last 99ms to avoid self-referential bias from the peak at zero.
+#define METRICS_LEN (BUFFER_LEN - 99)
+
+static AccumulatorStats* acc_stats(TransientAnalyzer* self) {
+    return self->shared_buffer ? &self->shared_buffer->stats : &self->private_stats;
+}
+
+// Recompute st from acc_buf[from, to), continuing the index-order scan begun at 0
+static void acc_stats_scan(AccumulatorStats* st, const double* acc_buf, int from, int to) {
+    if (from == 0) { st->sum = 0.0; st->sum_sq = 0.0; st->max = acc_buf[0]; st->min = acc_buf[0]; st->max_idx = 0; }
+    double sum = st->sum, sum_sq = st->sum_sq, max_v = st->max, min_v = st->min;
+    int max_idx = st->max_idx;
+    for (int i = from; i < to; i++) {
+        double v = acc_buf[i];
+        sum += v; sum_sq += v * v;
+        if (v > max_v) { max_v = v; max_idx = i; }
+        if (v < min_v) min_v = v;
+    }
+    st->sum = sum; st->sum_sq = sum_sq; st->max = max_v; st->min = min_v; st->max_idx = max_idx;
+}
+
+// Refresh the block maxima for blocks [from, to)
+static void acc_blocks_scan(AccumulatorStats* st, const double* acc_buf, int from, int to) {
+    for (int blk = from; blk < to; blk++) {
+        int lo = blk * ACC_BLOCK, hi = (lo + ACC_BLOCK < BUFFER_LEN) ? lo + ACC_BLOCK : BUFFER_LEN;
+        double m = acc_buf[lo];
+        int off = 0;
+        for (int i = lo + 1; i < hi; i++) if (acc_buf[i] > m) { m = acc_buf[i]; off = i - lo; }
+        st->block_max[blk] = m;
+        st->block_max_off[blk] = (unsigned char)off;
+    }
+}
+
+// First index of the maximum of acc_buf[lo, hi]
+static int acc_range_argmax(const double* acc_buf, const AccumulatorStats* st, int lo, int hi) {
+    int end = hi + 1, best = lo, i = lo + 1;
+    double best_v = acc_buf[lo];
+    int bl = (i + ACC_BLOCK - 1) / ACC_BLOCK, bh = end / ACC_BLOCK;
+    if (bl < bh) {
+        for (; i < bl * ACC_BLOCK; i++) if (acc_buf[i] > best_v) { best_v = acc_buf[i]; best = i; }
+        for (int blk = bl; blk < bh; blk++) {
+            if (st->block_max[blk] > best_v) { best_v = st->block_max[blk]; best = blk * ACC_BLOCK + st->block_max_off[blk]; }
+        }
+        i = bh * ACC_BLOCK;
+    }
+    for (; i < end; i++) if (acc_buf[i] > best_v) { best_v = acc_buf[i]; best = i; }
+    return best;
+}
+
+// Snapshot value i of a peak whose window starts at env[start], zero outside env[from, to)
+static inline double snapshot_value(const float* env, int start, int from, int to, double norm, int i) {
+    return (i >= from && i < to) ? (double)env[start + i] * norm : 0.0;
+}
+
+// acc_buf += the snapshot built from env, refreshing st in the same pass. Only [from, to) is written
+// and only the blocks covering it are rescanned; the rest of the metrics range is just read for st.
+static void acc_add_snapshot(double* acc_buf, const float* env, int start, int from, int to, double norm, AccumulatorStats* st) {
+    int m_from = from < METRICS_LEN ? from : METRICS_LEN, m_to = to < METRICS_LEN ? to : METRICS_LEN;
+    double sum = 0.0, sum_sq = 0.0, max_v = acc_buf[0] + snapshot_value(env, start, from, to, norm, 0), min_v = max_v;
+    int max_idx = 0;
+    for (int i = 0; i < m_from; i++) {
+        double v = acc_buf[i];
+        sum += v; sum_sq += v * v;
+        if (v > max_v) { max_v = v; max_idx = i; }
+        if (v < min_v) min_v = v;
+    }
+    for (int i = m_from; i < m_to; i++) {
+        double v = acc_buf[i] + (double)env[start + i] * norm;
+        acc_buf[i] = v;
+        sum += v; sum_sq += v * v;
+        if (v > max_v) { max_v = v; max_idx = i; }
+        if (v < min_v) min_v = v;
+    }
+    for (int i = (m_to > m_from ? m_to : m_from); i < METRICS_LEN; i++) {
+        double v = acc_buf[i];
+        sum += v; sum_sq += v * v;
+        if (v > max_v) { max_v = v; max_idx = i; }
+        if (v < min_v) min_v = v;
+    }
+    for (int i = (from > METRICS_LEN ? from : METRICS_LEN); i < to; i++) acc_buf[i] += (double)env[start + i] * norm;
+    st->sum = sum; st->sum_sq = sum_sq; st->max = max_v; st->min = min_v; st->max_idx = max_idx;
+    if (from < to) acc_blocks_scan(st, acc_buf, from / ACC_BLOCK, (to + ACC_BLOCK - 1) / ACC_BLOCK);
+}
+
+#define SNAPSHOT_HISTORY_LEN (BUFFER_LEN + 15000 + 2000)
+#define SNAPSHOT_QUEUE_INIT 128
+#define SNAPSHOT_TILE 512
+#define SNAPSHOT_BATCH 32
+
+static int snapshot_queue_push(SnapshotQueue* q, SnapshotDescriptor d) {
+    if (q->count == q->cap) {
+        int ncap = q->cap > 0 ? q->cap * 2 : SNAPSHOT_QUEUE_INIT;
+        SnapshotDescriptor* ni = (SnapshotDescriptor*)malloc(sizeof(SnapshotDescriptor) * ncap);
+        if (!ni) return 0;
+        for (int i = 0; i < q->count; i++) ni[i] = q->items[(q->head + i) % q->cap];
+        free(q->items);
+        q->items = ni; q->cap = ncap; q->head = 0;
+    }
+    q->items[(q->head + q->count) % q->cap] = d;
+    q->count++;
+    return 1;
+}
+
+static SnapshotDescriptor* snapshot_queue_at(SnapshotQueue* q, int i) {
+    return &q->items[(q->head + i) % q->cap];
+}
+
+static void snapshot_queue_pop(SnapshotQueue* q) {
+    q->head = (q->head + 1) % q->cap;
+    q->count--;
+}
+
+// Subtract n snapshots from acc_buf, rebuilding each one from the envelope history. The buffer is
+// walked tile by tile so it is streamed once per call rather than once per snapshot; every element
+// still sees the subtractions in the same order as subtracting the snapshots one after another.
+static void snapshot_subtract(const TransientAnalyzer* self, double* acc_buf, AccumulatorStats* st, const int* bands, const SnapshotDescriptor* descs, int n) {
+    const int cap = self->snapshot_history_cap;
+    int lo = BUFFER_LEN;
+    for (int k = 0; k < n; k++) if (descs[k].src_offset < lo) lo = descs[k].src_offset;
+    for (int t0 = 0; t0 < BUFFER_LEN; t0 += SNAPSHOT_TILE) {
+        int t1 = (t0 + SNAPSHOT_TILE < BUFFER_LEN) ? t0 + SNAPSHOT_TILE : BUFFER_LEN;
+        // Tiles below every snapshot's first index are unchanged and only need folding into st
+        if (t1 <= lo) {
+            if (t0 < METRICS_LEN) acc_stats_scan(st, acc_buf, t0, (t1 < METRICS_LEN) ? t1 : METRICS_LEN);
+            continue;
+        }
+        for (int k = 0; k < n; k++) {
+            const float* hist = self->snapshot_history + bands[k] * cap;
+            double norm = descs[k].norm;
+            int j = (t0 > descs[k].src_offset) ? t0 : descs[k].src_offset;
+            int h = (int)(((long long)descs[k].p_idx - 5000 + j) % cap);
+            for (; j < t1; j++) {
+                acc_buf[j] -= (double)hist[h] * norm;
+                if (++h == cap) h = 0;
+            }
+        }
+        // The tile is final and still in cache: fold it into the running statistics
+        if (t0 < METRICS_LEN) acc_stats_scan(st, acc_buf, t0, (t1 < METRICS_LEN) ? t1 : METRICS_LEN);
+        acc_blocks_scan(st, acc_buf, t0 / ACC_BLOCK, (t1 + ACC_BLOCK - 1) / ACC_BLOCK);
+    }
+}
+
+// Pop and subtract every snapshot with p_idx <= cleanup (all of them when drain_all is set).
+// Must be called with the buffer lock held.
+static bool snapshot_expire(TransientAnalyzer* self, double* acc_buf, int cleanup, bool drain_all) {
+    int bands[SNAPSHOT_BATCH];
+    SnapshotDescriptor descs[SNAPSHOT_BATCH];
+    AccumulatorStats* st = acc_stats(self);
+    int n = 0;
+    bool updated = false;
+    for (int b = 0; b < MAX_BANDS; b++) {
+        SnapshotQueue* q = &self->snapshot_queues[b];
+        while (q->count > 0 && (drain_all || snapshot_queue_at(q, 0)->p_idx <= cleanup)) {
+            bands[n] = b; descs[n] = *snapshot_queue_at(q, 0); n++;
+            snapshot_queue_pop(q);
+            updated = true;
+            if (n == SNAPSHOT_BATCH) { snapshot_subtract(self, acc_buf, st, bands, descs, n); n = 0; }
+        }
+    }
+    if (n > 0) snapshot_subtract(self, acc_buf, st, bands, descs, n);
+    return updated;
+}
+
+// Pop every snapshot with p_idx <= cleanup into the analyzer's pending list without touching the
+// accumulated buffer; snapshot_flush_expired subtracts them later in the same order.
+static void snapshot_defer_expired(TransientAnalyzer* self, int cleanup) {
+    ChunkPending* pc = &self->pending;
+    for (int b = 0; b < MAX_BANDS; b++) {
+        SnapshotQueue* q = &self->snapshot_queues[b];
+        while (q->count > 0 && snapshot_queue_at(q, 0)->p_idx <= cleanup) {
+            if (pc->expired_count == pc->expired_cap) {
+                int ncap = pc->expired_cap > 0 ? pc->expired_cap * 2 : SNAPSHOT_QUEUE_INIT;
+                SnapshotDescriptor* nd = (SnapshotDescriptor*)realloc(pc->expired, sizeof(SnapshotDescriptor) * ncap);
+                if (nd) pc->expired = nd;
+                int* nb = (int*)realloc(pc->expired_bands, sizeof(int) * ncap);
+                if (nb) pc->expired_bands = nb;
+                // Out of memory: leave the rest queued, the next cleanup picks them up
+                if (!nd || !nb) return;
+                pc->expired_cap = ncap;
+            }
+            pc->expired_bands[pc->expired_count] = b;
+            pc->expired[pc->expired_count] = *snapshot_queue_at(q, 0);
+            pc->expired_count++;
+            snapshot_queue_pop(q);
+        }
+    }
+}
+
+// Subtract the snapshots deferred by snapshot_defer_expired. Must be called with the buffer lock held.
+static bool snapshot_flush_expired(TransientAnalyzer* self, double* acc_buf) {
+    ChunkPending* pc = &self->pending;
+    if (pc->expired_count == 0) return false;
+    AccumulatorStats* st = acc_stats(self);
+    for (int k = 0; k < pc->expired_count; k += SNAPSHOT_BATCH) {
+        int n = (pc->expired_count - k < SNAPSHOT_BATCH) ? pc->expired_count - k : SNAPSHOT_BATCH;
+        snapshot_subtract(self, acc_buf, st, pc->expired_bands + k, pc->expired + k, n);
+    }
+    pc->expired_count = 0;
+    return true;
+}
+
+// Free the arrays of a prepared chunk. Deferred snapshots are kept until they are subtracted.
+static void chunk_pending_release(ChunkPending* pc) {
+    for (int b = 0; b < MAX_BANDS; b++) {
+        pc->envs[b] = NULL;
+        pc->peak_counts[b] = 0;
+    }
+    pc->total_peaks = 0;
+    pc->prepared = 0;
+}
+
+// Oldest global frame any live or deferred snapshot still needs from the envelope history, or -1 if none.
+static long long snapshot_oldest_source(TransientAnalyzer* self) {
+    long long oldest = -1;
+    for (int b = 0; b < MAX_BANDS; b++) {
+        SnapshotQueue* q = &self->snapshot_queues[b];
+        if (q->count == 0) continue;
+        SnapshotDescriptor* d = snapshot_queue_at(q, 0);
+        long long src = (long long)d->p_idx - 5000 + d->src_offset;
+        if (oldest < 0 || src < oldest) oldest = src;
+    }
+    for (int k = 0; k < self->pending.expired_count; k++) {
+        SnapshotDescriptor* d = &self->pending.expired[k];
+        long long src = (long long)d->p_idx - 5000 + d->src_offset;
+        if (oldest < 0 || src < oldest) oldest = src;
+    }
+    return oldest;
+}
+
+// Make room to write global frame `frame` into the envelope history without overwriting data a
+// live snapshot still references. Normally a no-op; grows the ring if cleanup has fallen behind.
+static void snapshot_history_reserve(TransientAnalyzer* self, long long frame) {
+    long long oldest = snapshot_oldest_source(self);
+    if (oldest < 0 || frame - oldest < self->snapshot_history_cap) return;
+
+    int cap = self->snapshot_history_cap;
+    int ncap = cap * 2;
+    float* nh = (float*)malloc(sizeof(float) * MAX_BANDS * ncap);
+    if (nh) {
+        for (int b = 0; b < MAX_BANDS; b++) {
+            for (long long f = oldest; f < frame; f++) nh[b * ncap + f % ncap] = self->snapshot_history[b * cap + f % cap];
+        }
+        free(self->snapshot_history);
+        self->snapshot_history = nh;
+        self->snapshot_history_cap = ncap;
+        return;
+    }
+
+    // Out of memory: retire the snapshots whose source is about to be overwritten while it is still intact
+    if (self->lock_func) self->lock_func(self->lock_obj);
+    double* acc_buf = self->shared_buffer ? self->shared_buffer->accumulated_buffer : self->private_accumulated_buffer;
+    snapshot_flush_expired(self, acc_buf);
+    snapshot_expire(self, acc_buf, (int)(frame - cap + 5000), false);
+    if (self->unlock_func) self->unlock_func(self->lock_obj);
+}
+
+void bar_histogram_clear(BarLengthHistogram* h) {
+    memset(h->counts, 0, sizeof(h->counts));
+    h->total = 0.0;
+    h->distinct = 0;
+    h->best_weighted = -1;
+    h->best_count = -1;
+}
+
+static double bar_histogram_score(const BarLengthHistogram* h, int bar_length, int weighted) {
+    double count = (double)h->counts[bar_length];
+    return weighted ? count * ((double)bar_length / 5000.0) : count;
+}
+
+// Only bar_length's score grew, so it either overtakes the best bin or leaves it in place. Ties go
+// to the shorter length, as a first-to-last scan for the maximum would pick.
+static int bar_histogram_rebest(const BarLengthHistogram* h, int best, int bar_length, int weighted) {
+    if (best < 0 || best == bar_length) return bar_length;
+    double s = bar_histogram_score(h, bar_length, weighted), s_best = bar_histogram_score(h, best, weighted);
+    return (s > s_best || (s == s_best && bar_length < best)) ? bar_length : best;
+}
+
+void bar_histogram_add(BarLengthHistogram* h, int bar_length, int n) {
+    if (bar_length < 0 || bar_length > 5000 || n <= 0) return;
+    if (h->counts[bar_length] == 0) h->distinct++;
+    h->counts[bar_length] += n;
+    h->total += (double)n;
+    h->best_weighted = bar_histogram_rebest(h, h->best_weighted, bar_length, 1);
+    h->best_count = bar_histogram_rebest(h, h->best_count, bar_length, 0);
+}
+
+int bar_histogram_best(const BarLengthHistogram* h, int weighted) {
+    int best = weighted ? h->best_weighted : h->best_count;
+    return (best >= 0) ? best : 0;
+}
+
+double bar_histogram_stability(const BarLengthHistogram* h) {
+    return (h->distinct > 0) ? (h->total / (double)h->distinct) : 0.0;
+}
+
+// Recompute the running window sums from the caches, newest frame first like the full scan, so any
+// drift accumulated since the last resync is discarded.
+static void metrics_window_resync(TransientAnalyzer* self) {
+    int win = (self->window_target < self->cache_count) ? self->window_target : self->cache_count;
+    if (win < 0) win = 0;
+    int wptr = self->cache_write_ptr;
+    for (int b = 0; b < MAX_BANDS; b++) {
+        double psum = 0, ssum = 0, fsum = 0;
+        for (int j = 0; j < win; j++) {
+            int idx = (wptr - 1 - j + CACHE_SIZE) % CACHE_SIZE;
+            psum += (double)self->prominence_envelopes[b * CACHE_SIZE + idx];
+            ssum += (double)self->dynamic_smoothings[b * CACHE_SIZE + idx];
+            fsum += (double)self->flux_envelopes[b * FLUX_STRIDE + idx];
+        }
+        self->window_prom_sums[b] = psum;
+        self->window_smooth_sums[b] = ssum;
+        self->window_flux_sums[b] = fsum;
+    }
+    self->window_len = win;
+    self->window_resync = (self->window_target > 0) ? self->window_target : CACHE_SIZE;
+}
+
+// Drop the oldest frame once the window is full. Called before the frame at cache_write_ptr is
+// overwritten, which is the oldest one when the window spans the whole cache.
+static void metrics_window_retire(TransientAnalyzer* self) {
+    int span = (self->window_target < CACHE_SIZE) ? self->window_target : CACHE_SIZE;
+    if (self->window_len < span || self->window_len <= 0) return;
+    int idx = (self->cache_write_ptr - self->window_len + CACHE_SIZE) % CACHE_SIZE;
+    for (int b = 0; b < MAX_BANDS; b++) {
+        self->window_prom_sums[b] -= (double)self->prominence_envelopes[b * CACHE_SIZE + idx];
+        self->window_smooth_sums[b] -= (double)self->dynamic_smoothings[b * CACHE_SIZE + idx];
+        self->window_flux_sums[b] -= (double)self->flux_envelopes[b * FLUX_STRIDE + idx];
+    }
+    self->window_len--;
+}
+
+// Take in the newest frame (cache_write_ptr - 1) after it has been written
+static void metrics_window_admit(TransientAnalyzer* self) {
+    int idx = (self->cache_write_ptr - 1 + CACHE_SIZE) % CACHE_SIZE;
+    for (int b = 0; b < MAX_BANDS; b++) {
+        self->window_prom_sums[b] += (double)self->prominence_envelopes[b * CACHE_SIZE + idx];
+        self->window_smooth_sums[b] += (double)self->dynamic_smoothings[b * CACHE_SIZE + idx];
+        self->window_flux_sums[b] += (double)self->flux_envelopes[b * FLUX_STRIDE + idx];
+    }
+    self->window_len++;
+    if (--self->window_resync <= 0) metrics_window_resync(self);
+}
+
+static void metrics_set_prominence(TransientAnalyzer* self, int band, int cache_idx, float prom) {
+    float* slot = &self->prominence_envelopes[band * CACHE_SIZE + cache_idx];
+    if (!self->prominence_index) { *slot = prom; return; }
+    int age = (self->cache_write_ptr - 1 - cache_idx + CACHE_SIZE) % CACHE_SIZE;
+    if (age < self->window_len) self->window_prom_sums[band] += (double)prom - (double)*slot;
+    *slot = prom;
+    range_index_update(self->prominence_index, self->prominence_envelopes, band, cache_idx);
+}
+
+// 15 s window sums and prominence max per band by rescanning the caches. Returns the window length.
+static int metrics_window_scan(TransientAnalyzer* self, double* psum, double* ssum, double* fsum, float* pmax) {
+    int nf = self->cache_count;
+    int win = (int)(15000.0 / self->frame_duration_ms);
+    if (win > nf) win = nf;
+    if (win <= 0) win = 1;
+
+    int wptr = self->cache_write_ptr;
+    for (int b = 0; b < MAX_BANDS; b++) {
+        psum[b] = 0; ssum[b] = 0; fsum[b] = 0; pmax[b] = 0;
+        for (int j = 0; j < win; j++) {
+            int idx = (wptr - 1 - j + CACHE_SIZE) % CACHE_SIZE;
+            float pv = self->prominence_envelopes[b * CACHE_SIZE + idx];
+            psum[b] += (double)pv;
+            if (pv > pmax[b]) pmax[b] = pv;
+            ssum[b] += (double)self->dynamic_smoothings[b * CACHE_SIZE + idx];
+            fsum[b] += (double)self->flux_envelopes[b * FLUX_STRIDE + idx];
+        }
+    }
+    return win;
+}
+
+// Same quantities from the running sums and the prominence max tree
+static int metrics_window_running(TransientAnalyzer* self, double* psum, double* ssum, double* fsum, float* pmax) {
+    int win = self->window_len;
+    int lo = (self->cache_write_ptr - win + CACHE_SIZE) % CACHE_SIZE;
+    for (int b = 0; b < MAX_BANDS; b++) {
+        psum[b] = self->window_prom_sums[b];
+        ssum[b] = self->window_smooth_sums[b];
+        fsum[b] = self->window_flux_sums[b];
+        float m = -FLT_MAX;
+        if (win > 0) {
+            const float* values = self->prominence_envelopes + b * CACHE_SIZE;
+            if (lo + win <= CACHE_SIZE) {
+                m = range_index_max(self->prominence_index, b, values, lo, lo + win);
+            } else {
+                float m1 = range_index_max(self->prominence_index, b, values, lo, CACHE_SIZE);
+                float m2 = range_index_max(self->prominence_index, b, values, 0, lo + win - CACHE_SIZE);
+                m = (m1 > m2) ? m1 : m2;
+            }
+        }
+        pmax[b] = (m > 0) ? m : 0;
+    }
+    return (win > 0) ? win : 1;
+}
+
+static double metrics_deviation(double value, double reference) {
+    double scale = fabs(reference) > 1.0 ? fabs(reference) : 1.0;
+    return fabs(value - reference) / scale;
+}
+
 static double* create_mel_filterbank(int sr, int n_fft, int n_mels);
+static void compute_mel_filter_ranges(const double* filters, int n_fft, int n_mels, int* starts, int* ends);
+
+// Window, FFT and mel tables depend only on the sample rate (N_FFT and N_MELS are fixed), so one
+// refcounted copy per rate is shared read-only by every analyzer in the process. The list is only
+// touched under a spinlock; tables are built outside it.
+typedef struct CtSpectralTables {
+    int sample_rate;
+    int refs;
+    double* fft_window;
+    double* fft_twiddle_re;
+    double* fft_twiddle_im;
+    int* fft_bitrev;
+    double* mel_filters;
+    int* mel_filter_starts;
+    int* mel_filter_ends;
+    struct CtSpectralTables* next;
+} CtSpectralTables;
+
+static CtSpectralTables* spectral_tables_list = NULL;
+#if defined(_MSC_VER)
+#include <intrin.h>
+static volatile long spectral_tables_lock = 0;
+#define SPECTRAL_TABLES_LOCK() while (_InterlockedExchange(&spectral_tables_lock, 1)) {}
+#define SPECTRAL_TABLES_UNLOCK() _InterlockedExchange(&spectral_tables_lock, 0)
+#else
+static volatile int spectral_tables_lock = 0;
+#define SPECTRAL_TABLES_LOCK() while (__atomic_exchange_n(&spectral_tables_lock, 1, __ATOMIC_ACQUIRE)) {}
+#define SPECTRAL_TABLES_UNLOCK() __atomic_store_n(&spectral_tables_lock, 0, __ATOMIC_RELEASE)
+#endif
+
+static void spectral_tables_free(CtSpectralTables* t) {
+    if (!t) return;
+    free(t->fft_window); free(t->fft_twiddle_re); free(t->fft_twiddle_im); free(t->fft_bitrev);
+    free(t->mel_filters); free(t->mel_filter_starts); free(t->mel_filter_ends); free(t);
+}
+
+static CtSpectralTables* spectral_tables_build(int sr) {
+    CtSpectralTables* t = (CtSpectralTables*)calloc(1, sizeof(CtSpectralTables));
+    if (!t) return NULL;
+    t->sample_rate = sr;
+    t->fft_window = (double*)malloc(sizeof(double) * N_FFT);
+    t->fft_twiddle_re = (double*)malloc(sizeof(double) * N_BINS);
+    t->fft_twiddle_im = (double*)malloc(sizeof(double) * N_BINS);
+    t->fft_bitrev = (int*)malloc(sizeof(int) * N_FFT / 2);
+    t->mel_filters = create_mel_filterbank(sr, N_FFT, N_MELS);
+    t->mel_filter_starts = (int*)malloc(sizeof(int) * N_MELS);
+    t->mel_filter_ends = (int*)malloc(sizeof(int) * N_MELS);
+    if (!t->fft_window || !t->fft_twiddle_re || !t->fft_twiddle_im || !t->fft_bitrev || !t->mel_filters || !t->mel_filter_starts || !t->mel_filter_ends) {
+        spectral_tables_free(t); return NULL;
+    }
+    for (int i = 0; i < N_FFT; i++) t->fft_window[i] = 0.5 * (1.0 - cos(2.0 * M_PI * i / (double)N_FFT));
+    rfft_init_tables(t->fft_twiddle_re, t->fft_twiddle_im, t->fft_bitrev);
+    compute_mel_filter_ranges(t->mel_filters, N_FFT, N_MELS, t->mel_filter_starts, t->mel_filter_ends);
+    return t;
+}
+
+static CtSpectralTables* spectral_tables_find(int sr) {
+    for (CtSpectralTables* t = spectral_tables_list; t; t = t->next) {
+        if (t->sample_rate == sr) { t->refs++; return t; }
+    }
+    return NULL;
+}
+
+static CtSpectralTables* spectral_tables_acquire(int sr) {
+    SPECTRAL_TABLES_LOCK();
+    CtSpectralTables* t = spectral_tables_find(sr);
+    SPECTRAL_TABLES_UNLOCK();
+    if (t) return t;
+
+    CtSpectralTables* built = spectral_tables_build(sr);
+    if (!built) return NULL;
+    SPECTRAL_TABLES_LOCK();
+    t = spectral_tables_find(sr);   // Another analyzer may have built the same rate meanwhile
+    if (!t) {
+        built->refs = 1;
+        built->next = spectral_tables_list;
+        spectral_tables_list = built;
+        t = built;
+        built = NULL;
+    }
+    SPECTRAL_TABLES_UNLOCK();
+    spectral_tables_free(built);
+    return t;
+}
+
+static void spectral_tables_release(CtSpectralTables* t) {
+    if (!t) return;
+    int last = 0;
+    SPECTRAL_TABLES_LOCK();
+    if (--t->refs == 0) {
+        CtSpectralTables** link = &spectral_tables_list;
+        while (*link != t) link = &(*link)->next;
+        *link = t->next;
+        last = 1;
+    }
+    SPECTRAL_TABLES_UNLOCK();
+    if (last) spectral_tables_free(t);
+}
+
+static void analyzer_use_tables(TransientAnalyzer* self, CtSpectralTables* t) {
+    self->tables = t;
+    self->fft_window = t->fft_window;
+    self->fft_twiddle_re = t->fft_twiddle_re;
+    self->fft_twiddle_im = t->fft_twiddle_im;
+    self->fft_bitrev = t->fft_bitrev;
+    self->mel_filters = t->mel_filters;
+    self->mel_filter_starts = t->mel_filter_starts;
+    self->mel_filter_ends = t->mel_filter_ends;
+}
+
+double analyzer_profile_clock(void) {
+#if defined(_WIN32)
+    LARGE_INTEGER freq, count;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&count);
+    return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+void latency_histogram_add(LatencyHistogram* h, double seconds) {
+    double us = seconds * 1e6;
+    int b = 0;
+    if (us >= 1.0) {
+        frexp(us, &b);  // us lies in [2^(b-1), 2^b)
+        if (b >= CT_LATENCY_BUCKETS) b = CT_LATENCY_BUCKETS - 1;
+    }
+    h->counts[b]++;
+    h->total++;
+    if (seconds > h->max_seconds) h->max_seconds = seconds;
+}
+
+void latency_histogram_merge(LatencyHistogram* dst, const LatencyHistogram* src) {
+    for (int b = 0; b < CT_LATENCY_BUCKETS; b++) dst->counts[b] += src->counts[b];
+    dst->total += src->total;
+    if (src->max_seconds > dst->max_seconds) dst->max_seconds = src->max_seconds;
+}
+
+double latency_histogram_quantile(const LatencyHistogram* h, double q) {
+    if (h->total <= 0) return 0.0;
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    double rank = q * (double)h->total;
+    long long seen = 0;
+    for (int b = 0; b < CT_LATENCY_BUCKETS; b++) {
+        if (h->counts[b] == 0) continue;
+        if ((double)(seen + h->counts[b]) >= rank) {
+            double lo = b ? ldexp(1.0, b - 1) * 1e-6 : 0.0;
+            double hi = (b < CT_LATENCY_BUCKETS - 1) ? ldexp(1.0, b) * 1e-6 : h->max_seconds;
+            double v = lo + (hi - lo) * (rank - (double)seen) / (double)h->counts[b];
+            return v < h->max_seconds ? v : h->max_seconds;
+        }
+        seen += h->counts[b];
+    }
+    return h->max_seconds;
+}
+
+// Mark the start of a timed section (0 when profiling is off)
+static inline double profile_start(const TransientAnalyzer* self) {
+    return self->profiling ? analyzer_profile_clock() : 0.0;
+}
+
+// Charge the time since t0 to a stage and return the new mark, so consecutive stages chain
+static inline double profile_mark(TransientAnalyzer* self, int stage, double t0) {
+    if (!self->profiling) return 0.0;
+    double t = analyzer_profile_clock();
+    self->profile.seconds[stage] += t - t0;
+    self->profile.calls[stage]++;
+    latency_histogram_add(&self->profile.latency[stage], t - t0);
+    return t;
+}
 
 TransientAnalyzer* analyzer_create(double max_peak_value, SharedTransientBuffer* shared_buffer, void* lock_obj, ct_lock_func lock_func, ct_lock_func unlock_func) {
     TransientAnalyzer* self = (TransientAnalyzer*)calloc(1, sizeof(TransientAnalyzer));
@@ -117,7 +892,8 @@ TransientAnalyzer* analyzer_create(double max_peak_value, SharedTransientBuffer*
 
     self->highest_peak_ms = -999.0;
     self->tolerance = 29.0;
-    memset(self->bar_length_counts, 0, sizeof(self->bar_length_counts));
+    bar_histogram_clear(&self->bar_lengths);
+    self->last_bar_length = -1;
     for (int b = 0; b < MAX_BANDS; b++) {
         self->midpoint_lookback[b] = 15000.0;
         self->lookback_avg_delta[b] = 0.0;
@@ -126,20 +902,32 @@ TransientAnalyzer* analyzer_create(double max_peak_value, SharedTransientBuffer*
     }
     for (int i = 0; i < BUFFER_LEN; i++) self->buffer_times[i] = -5000.0 + i;
     self->frame_duration_ms = 1.0;
-    self->mel_spectrogram = (double*)calloc(N_MELS * CACHE_SIZE, sizeof(double));
-    self->flux_envelopes = (float*)calloc(MAX_BANDS * CACHE_SIZE, sizeof(float));
+    self->frame_stride = 1;
+    self->window_target = 15000;
+    self->mel_frames = (double*)calloc(2 * N_MELS, sizeof(double));
+    self->flux_envelopes = (float*)calloc(MAX_BANDS * FLUX_STRIDE, sizeof(float));
     self->dynamic_smoothings = (float*)calloc(MAX_BANDS * CACHE_SIZE, sizeof(float));
     self->prominence_envelopes = (float*)calloc(MAX_BANDS * CACHE_SIZE, sizeof(float));
-    self->fft_window = (double*)malloc(sizeof(double) * N_FFT);
-    if (self->fft_window) for (int i = 0; i < N_FFT; i++) self->fft_window[i] = 0.5 * (1.0 - cos(2.0 * M_PI * i / (double)N_FFT));
+    self->smoothing_index = (float*)malloc(sizeof(float) * RANGE_INDEX_FLOATS);
     self->sample_rate = 44100;
-    self->mel_filters = create_mel_filterbank(self->sample_rate, N_FFT, N_MELS);
+    CtSpectralTables* tables = spectral_tables_acquire(self->sample_rate);
+    if (tables) analyzer_use_tables(self, tables);
     self->overlap_buffer = (float*)calloc(N_FFT * 4, sizeof(float));
-    self->fft_real = (double*)malloc(sizeof(double) * N_FFT);
-    self->fft_imag = (double*)malloc(sizeof(double) * N_FFT);
-    if (!self->mel_spectrogram || !self->flux_envelopes || !self->dynamic_smoothings || !self->prominence_envelopes || !self->fft_window || !self->mel_filters || !self->overlap_buffer || !self->fft_real || !self->fft_imag) {
+    self->fft_real = (double*)malloc(sizeof(double) * N_FFT / 2);
+    self->fft_imag = (double*)malloc(sizeof(double) * N_FFT / 2);
+    self->power_spectrum = (double*)malloc(sizeof(double) * N_BINS);
+    self->snapshot_history_cap = SNAPSHOT_HISTORY_LEN;
+    self->snapshot_history = (float*)calloc(MAX_BANDS * SNAPSHOT_HISTORY_LEN, sizeof(float));
+    bool queues_ok = true;
+    for (int b = 0; b < MAX_BANDS; b++) {
+        self->snapshot_queues[b].items = (SnapshotDescriptor*)malloc(sizeof(SnapshotDescriptor) * SNAPSHOT_QUEUE_INIT);
+        self->snapshot_queues[b].cap = self->snapshot_queues[b].items ? SNAPSHOT_QUEUE_INIT : 0;
+        if (!self->snapshot_queues[b].items) queues_ok = false;
+    }
+    if (!self->mel_frames || !self->flux_envelopes || !self->dynamic_smoothings || !self->prominence_envelopes || !self->smoothing_index || !self->tables || !self->overlap_buffer || !self->fft_real || !self->fft_imag || !self->power_spectrum || !self->snapshot_history || !queues_ok) {
         analyzer_destroy(self); return NULL;
     }
+    range_index_build(self->smoothing_index, self->dynamic_smoothings);
     return self;
 }
 
@@ -149,26 +937,19 @@ void analyzer_destroy(TransientAnalyzer* self) {
     // Fix Ghost Peak Bug: Subtract all remaining active snapshots from shared/private buffer before destruction
     if (self->lock_func) self->lock_func(self->lock_obj);
     double* acc_buf = self->shared_buffer ? self->shared_buffer->accumulated_buffer : self->private_accumulated_buffer;
-    for (int b = 0; b < MAX_BANDS; b++) {
-        SnapshotEntry* curr = self->snapshot_heads[b];
-        while (curr) {
-            for (int j = 0; j < BUFFER_LEN; j++) {
-                acc_buf[j] -= curr->snapshot[j];
-            }
-            curr = curr->next;
-        }
-    }
-
-    for (int b = 0; b < MAX_BANDS; b++) {
-        SnapshotEntry* curr = self->snapshot_heads[b];
-        while (curr) { SnapshotEntry* next = curr->next; free(curr); curr = next; }
-        self->snapshot_heads[b] = NULL;
-        self->snapshot_tails[b] = NULL;
+    if (self->snapshot_history) {
+        snapshot_flush_expired(self, acc_buf);
+        snapshot_expire(self, acc_buf, 0, true);
     }
     if (self->unlock_func) self->unlock_func(self->lock_obj);
 
-    free(self->overlap_buffer); free(self->combined_scratch); free(self->fft_real); free(self->fft_imag);
-    free(self->mel_spectrogram); free(self->flux_envelopes); free(self->dynamic_smoothings); free(self->prominence_envelopes); free(self->fft_window); free(self->mel_filters); free(self);
+    free(self->pending.expired); free(self->pending.expired_bands);
+    for (int b = 0; b < MAX_BANDS; b++) free(self->snapshot_queues[b].items);
+    free(self->snapshot_history); free(self->prominence_index); free(self->smoothing_index);
+    free(self->overlap_buffer); free(self->combined_scratch); free(self->lane_scratch); free(self->fft_real); free(self->fft_imag);
+    free(self->power_spectrum);
+    free(self->mel_frames); free(self->mel_spectrogram); free(self->flux_envelopes); free(self->dynamic_smoothings); free(self->prominence_envelopes);
+    spectral_tables_release(self->tables); free(self);
 }
 
 void analyzer_clear(TransientAnalyzer* self) {
@@ -178,6 +959,7 @@ void analyzer_clear(TransientAnalyzer* self) {
 
     if (self->shared_buffer) {
         memset(self->shared_buffer->accumulated_buffer, 0, sizeof(double) * BUFFER_LEN);
+        memset(&self->shared_buffer->stats, 0, sizeof(AccumulatorStats));
         self->shared_buffer->max_peak = 1.0;
         self->shared_buffer->min_score_seen = DBL_MAX;
         self->shared_buffer->max_score_seen = -DBL_MAX;
@@ -186,21 +968,18 @@ void analyzer_clear(TransientAnalyzer* self) {
     }
 
     memset(self->private_accumulated_buffer, 0, sizeof(double) * BUFFER_LEN);
+    memset(&self->private_stats, 0, sizeof(AccumulatorStats));
     self->private_max_peak = 1.0;
     self->private_min_score_seen = DBL_MAX;
     self->private_max_score_seen = -DBL_MAX;
     self->private_total_score_sum = 0;
     self->private_score_count = 0;
 
+    chunk_pending_release(&self->pending);
+    self->pending.expired_count = 0;
     for (int b = 0; b < MAX_BANDS; b++) {
-        SnapshotEntry* curr = self->snapshot_heads[b];
-        while (curr) {
-            SnapshotEntry* next = curr->next;
-            free(curr);
-            curr = next;
-        }
-        self->snapshot_heads[b] = NULL;
-        self->snapshot_tails[b] = NULL;
+        self->snapshot_queues[b].head = 0;
+        self->snapshot_queues[b].count = 0;
 
         self->midpoint_lookback[b] = 15000.0;
         self->lookback_avg_delta[b] = 0.0;
@@ -211,16 +990,25 @@ void analyzer_clear(TransientAnalyzer* self) {
     }
 
     self->highest_peak_ms = -999.0;
-    memset(self->bar_length_counts, 0, sizeof(self->bar_length_counts));
+    bar_histogram_clear(&self->bar_lengths);
+    self->last_bar_length = -1;
 
+    if (self->mel_frames) memset(self->mel_frames, 0, sizeof(double) * 2 * N_MELS);
+    self->mel_frame_cur = 0;
     if (self->mel_spectrogram) memset(self->mel_spectrogram, 0, sizeof(double) * N_MELS * CACHE_SIZE);
-    if (self->flux_envelopes) memset(self->flux_envelopes, 0, sizeof(float) * MAX_BANDS * CACHE_SIZE);
+    if (self->flux_envelopes) memset(self->flux_envelopes, 0, sizeof(float) * MAX_BANDS * FLUX_STRIDE);
     if (self->dynamic_smoothings) memset(self->dynamic_smoothings, 0, sizeof(float) * MAX_BANDS * CACHE_SIZE);
+    if (self->dynamic_smoothings && self->smoothing_index) range_index_build(self->smoothing_index, self->dynamic_smoothings);
     if (self->prominence_envelopes) memset(self->prominence_envelopes, 0, sizeof(float) * MAX_BANDS * CACHE_SIZE);
+    if (self->snapshot_history) memset(self->snapshot_history, 0, sizeof(float) * MAX_BANDS * self->snapshot_history_cap);
 
     self->cache_write_ptr = 0;
     self->cache_count = 0;
     self->max_mel_db = 0.0;
+    if (self->prominence_index) {
+        range_index_build(self->prominence_index, self->prominence_envelopes);
+        metrics_window_resync(self);
+    }
 
     if (self->overlap_buffer) memset(self->overlap_buffer, 0, sizeof(float) * N_FFT * 4);
     self->overlap_len = 0;
@@ -233,11 +1021,114 @@ void analyzer_clear(TransientAnalyzer* self) {
 
 void analyzer_set_sample_rate(TransientAnalyzer* self, int sr) {
     if (self->sample_rate != sr) {
-        self->sample_rate = sr; free(self->mel_filters);
-        self->mel_filters = create_mel_filterbank(sr, N_FFT, N_MELS);
+        // Keep the old tables if the new ones cannot be built, rather than leave the analyzer without any
+        CtSpectralTables* tables = spectral_tables_acquire(sr);
+        if (tables) {
+            spectral_tables_release(self->tables);
+            analyzer_use_tables(self, tables);
+        }
+        self->sample_rate = sr;
     }
     int hop = (int)(sr * 0.001); self->frame_duration_ms = 1000.0 * (double)hop / (double)sr;
     for (int i = 0; i < BUFFER_LEN; i++) self->buffer_times[i] = (double)(i - 5000) * self->frame_duration_ms;
+    self->window_target = (self->frame_duration_ms > 0) ? (int)(15000.0 / self->frame_duration_ms) : CACHE_SIZE;
+    if (self->prominence_index) metrics_window_resync(self);
+}
+
+int analyzer_set_mel_history(TransientAnalyzer* self, int enabled) {
+    if (enabled && !self->mel_spectrogram) {
+        self->mel_spectrogram = (double*)calloc(N_MELS * CACHE_SIZE, sizeof(double));
+        if (!self->mel_spectrogram) return 0;
+    } else if (!enabled && self->mel_spectrogram) {
+        free(self->mel_spectrogram);
+        self->mel_spectrogram = NULL;
+    }
+    return 1;
+}
+
+int analyzer_set_metrics_mode(TransientAnalyzer* self, int mode) {
+    if (mode == CT_METRICS_FULL) {
+        free(self->prominence_index);
+        self->prominence_index = NULL;
+    } else if (!self->prominence_index) {
+        self->prominence_index = (float*)malloc(sizeof(float) * RANGE_INDEX_FLOATS);
+        if (!self->prominence_index) return 0;
+        range_index_build(self->prominence_index, self->prominence_envelopes);
+        metrics_window_resync(self);
+    }
+    if (mode == CT_METRICS_VALIDATE && self->metrics_mode != CT_METRICS_VALIDATE) self->metrics_max_deviation = 0.0;
+    self->metrics_mode = mode;
+    return 1;
+}
+
+size_t analyzer_memory_usage(const TransientAnalyzer* self) {
+    if (!self) return 0;
+    size_t bytes = sizeof(TransientAnalyzer);
+    if (self->mel_frames) bytes += sizeof(double) * 2 * N_MELS;
+    if (self->mel_spectrogram) bytes += sizeof(double) * N_MELS * CACHE_SIZE;
+    if (self->flux_envelopes) bytes += sizeof(float) * MAX_BANDS * FLUX_STRIDE;
+    if (self->dynamic_smoothings) bytes += sizeof(float) * MAX_BANDS * CACHE_SIZE;
+    if (self->prominence_envelopes) bytes += sizeof(float) * MAX_BANDS * CACHE_SIZE;
+    if (self->smoothing_index) bytes += sizeof(float) * RANGE_INDEX_FLOATS;
+    if (self->prominence_index) bytes += sizeof(float) * RANGE_INDEX_FLOATS;
+    if (self->snapshot_history) bytes += sizeof(float) * MAX_BANDS * (size_t)self->snapshot_history_cap;
+    for (int b = 0; b < MAX_BANDS; b++) bytes += sizeof(SnapshotDescriptor) * (size_t)self->snapshot_queues[b].cap;
+    bytes += (sizeof(SnapshotDescriptor) + sizeof(int)) * (size_t)self->pending.expired_cap;
+    if (self->overlap_buffer) bytes += sizeof(float) * N_FFT * 4;
+    bytes += sizeof(float) * (size_t)self->combined_scratch_cap;
+    if (self->lane_scratch) bytes += sizeof(double) * CT_LANES * (N_FFT + N_BINS);
+    if (self->fft_real) bytes += sizeof(double) * N_FFT / 2;
+    if (self->fft_imag) bytes += sizeof(double) * N_FFT / 2;
+    if (self->power_spectrum) bytes += sizeof(double) * N_BINS;
+    return bytes;
+}
+
+size_t analyzer_shared_tables_usage(void) {
+    size_t per_rate = sizeof(CtSpectralTables) + sizeof(double) * (N_FFT + 2 * N_BINS + N_MELS * N_BINS) + sizeof(int) * (N_FFT / 2 + 2 * N_MELS);
+    size_t bytes = 0;
+    SPECTRAL_TABLES_LOCK();
+    for (CtSpectralTables* t = spectral_tables_list; t; t = t->next) bytes += per_rate;
+    SPECTRAL_TABLES_UNLOCK();
+    return bytes;
+}
+
+void analyzer_set_profiling(TransientAnalyzer* self, int enabled) {
+    self->profiling = enabled ? 1 : 0;
+}
+
+void analyzer_get_profile(const TransientAnalyzer* self, AnalyzerProfile* out) {
+    *out = self->profile;
+}
+
+void analyzer_reset_profile(TransientAnalyzer* self) {
+    memset(&self->profile, 0, sizeof(AnalyzerProfile));
+}
+
+void analyzer_profile_merge(AnalyzerProfile* dst, const AnalyzerProfile* src) {
+    for (int k = 0; k < CT_NUM_STAGES; k++) {
+        dst->seconds[k] += src->seconds[k];
+        dst->calls[k] += src->calls[k];
+        latency_histogram_merge(&dst->latency[k], &src->latency[k]);
+    }
+}
+
+const char* analyzer_stage_name(int stage) {
+    static const char* const names[CT_NUM_STAGES] = { "fft", "mel", "flux", "peaks", "accumulator", "metrics" };
+    return (stage >= 0 && stage < CT_NUM_STAGES) ? names[stage] : "unknown";
+}
+
+void analyzer_set_frame_stride(TransientAnalyzer* self, int stride) {
+    if (stride < 1) stride = 1;
+    if (stride > CT_MAX_FRAME_STRIDE) stride = CT_MAX_FRAME_STRIDE;
+    self->frame_stride = stride;
+}
+
+void analyzer_set_snapshot_floor(TransientAnalyzer* self, double floor) {
+    self->snapshot_floor = floor > 0.0 ? floor : 0.0;
+}
+
+int analyzer_get_bar_length(TransientAnalyzer* self, int weighted) {
+    return bar_histogram_best(&self->bar_lengths, weighted);
 }
 
 double analyzer_get_max_peak(TransientAnalyzer* self) {
@@ -245,39 +1136,31 @@ double analyzer_get_max_peak(TransientAnalyzer* self) {
     return self->private_max_peak;
 }
 
-int analyzer_process_peak(TransientAnalyzer* self, int p_idx, int global_p_idx, int band_idx, double time, const float* env_ptr, int env_len, const int* all_valid_peak_indices, int all_valid_count, double detected_peak_val, double thresh_val, double left_min, double right_min, double prominence, PeakResult* result_out) {
+int analyzer_process_peak(TransientAnalyzer* self, int p_idx, int global_p_idx, int band_idx, double time, const float* env_ptr, int env_len, const int* all_valid_peak_indices, int all_valid_count, double detected_peak_val, double thresh_val, double left_min, double right_min, double prominence, PeakResult* result_out, Qualifier* qualifiers_out, int max_qualifiers) {
     result_out->p_idx = p_idx; result_out->band_idx = band_idx; result_out->time = time;
     result_out->peak_val = (double)env_ptr[p_idx]; result_out->total_score = 0;
     result_out->detected_peak_val = detected_peak_val; result_out->thresh_val = thresh_val;
     result_out->left_min = left_min; result_out->right_min = right_min; result_out->prominence = prominence;
     result_out->num_qualifiers = 0;
+    result_out->qualifier_start = 0;
+    if (max_qualifiers > MAX_QUALIFIERS) max_qualifiers = MAX_QUALIFIERS;
+    // The snapshot is env_ptr[start, start + BUFFER_LEN) scaled by norm, zero outside the envelope.
+    // It is added straight from the envelope and only its descriptor is kept.
     int start = p_idx - 5000;
-    for (int i = 0; i < BUFFER_LEN; i++) {
-        int idx = start + i;
-        result_out->snapshot[i] = (idx < 0 || idx >= env_len) ? 0.0 : (double)env_ptr[idx];
-    }
+    int src_from = (start < 0) ? -start : 0;
+    int src_to = (env_len - start < BUFFER_LEN) ? env_len - start : BUFFER_LEN;
 
     if (self->lock_func) self->lock_func(self->lock_obj);
+    double t = profile_start(self);
 
     double* acc_buf = self->shared_buffer ? self->shared_buffer->accumulated_buffer : self->private_accumulated_buffer;
     double max_peak = self->shared_buffer ? self->shared_buffer->max_peak : self->private_max_peak;
 
     double norm = (max_peak > 0) ? (result_out->peak_val / max_peak) : 1.0;
-    for (int i = 0; i < BUFFER_LEN; i++) result_out->snapshot[i] *= norm;
     double q_sum = 0.0; bool found = false;
-    // Exclude the last 99ms to avoid self-referential bias from the peak at zero.
-    int m_len = BUFFER_LEN - 99; double sum = 0.0, max_v = -DBL_MAX, min_v = DBL_MAX;
-    if (m_len > 0) {
-        max_v = acc_buf[0];
-        min_v = acc_buf[0];
-        for (int i = 0; i < m_len; i++) {
-            double v = acc_buf[i];
-            sum += v;
-            if (v > max_v) max_v = v;
-            if (v < min_v) min_v = v;
-        }
-    }
-    double midpoint = (m_len > 0) ? (sum / (double)m_len) : 0.0;
+    AccumulatorStats* st = acc_stats(self);
+    double max_v = st->max, min_v = st->min;
+    double midpoint = st->sum / (double)METRICS_LEN;
     int tol_idx = (int)round(self->tolerance / self->frame_duration_ms);
     if (tol_idx < 0) tol_idx = 0;
 
@@ -293,14 +1176,9 @@ int analyzer_process_peak(TransientAnalyzer* self, int p_idx, int global_p_idx,
             int end_k = sp_idx + tol_idx;
             if (end_k >= BUFFER_LEN) end_k = BUFFER_LEN - 1;
 
-            int snap_idx = sp_idx;
-            double max_snap_val = acc_buf[sp_idx];
-            for (int k = start_k; k <= end_k; k++) {
-                if (acc_buf[k] > max_snap_val) {
-                    max_snap_val = acc_buf[k];
-                    snap_idx = k;
-                }
-            }
+            // Keep the original position unless something in range is strictly higher
+            int snap_idx = acc_range_argmax(acc_buf, st, start_k, end_k);
+            if (!(acc_buf[snap_idx] > acc_buf[sp_idx])) snap_idx = sp_idx;
 
             double val = acc_buf[snap_idx];
             double q = 0.0;
@@ -313,10 +1191,10 @@ int analyzer_process_peak(TransientAnalyzer* self, int p_idx, int global_p_idx,
                     q = (val - midpoint) / (midpoint - min_v);
                 }
             }
-            if (result_out->num_qualifiers < MAX_QUALIFIERS) {
-                result_out->qualifiers[result_out->num_qualifiers].ms = self->buffer_times[snap_idx];
-                result_out->qualifiers[result_out->num_qualifiers].orig_ms = self->buffer_times[sp_idx];
-                result_out->qualifiers[result_out->num_qualifiers].val = q;
+            if (result_out->num_qualifiers < max_qualifiers) {
+                qualifiers_out[result_out->num_qualifiers].ms = self->buffer_times[snap_idx];
+                qualifiers_out[result_out->num_qualifiers].orig_ms = self->buffer_times[sp_idx];
+                qualifiers_out[result_out->num_qualifiers].val = q;
                 result_out->num_qualifiers++;
             }
             q_sum += q;
@@ -335,36 +1213,61 @@ int analyzer_process_peak(TransientAnalyzer* self, int p_idx, int global_p_idx,
         self->private_total_score_sum += result_out->total_score; self->private_score_count++;
     }
 
-    for (int i = 0; i < BUFFER_LEN; i++) acc_buf[i] += result_out->snapshot[i];
+    t = profile_mark(self, CT_STAGE_PEAKS, t);
+    bool keep = true;
+    if (self->snapshot_floor > 0.0) {
+        double loudest = 0.0;
+        for (int b = 0; b < MAX_BANDS; b++) if (self->smoothing_avgs[b] > loudest) loudest = self->smoothing_avgs[b];
+        keep = !(self->smoothing_avgs[band_idx] < self->snapshot_floor * loudest);
+    }
 
-    SnapshotEntry* entry = (SnapshotEntry*)malloc(sizeof(SnapshotEntry));
-    if (entry) {
-        entry->p_idx = global_p_idx;
-        memcpy(entry->snapshot, result_out->snapshot, sizeof(double) * BUFFER_LEN);
-        entry->next = NULL;
-        if (self->snapshot_tails[band_idx]) { self->snapshot_tails[band_idx]->next = entry; self->snapshot_tails[band_idx] = entry; }
-        else { self->snapshot_heads[band_idx] = entry; self->snapshot_tails[band_idx] = entry; }
+    SnapshotDescriptor desc;
+    desc.p_idx = global_p_idx;
+    desc.src_offset = src_from;
+    desc.norm = keep ? norm : 0.0;
+    // A snapshot that cannot be queued could never be subtracted again, so it is not accumulated
+    if (keep) {
+        if (snapshot_queue_push(&self->snapshot_queues[band_idx], desc)) acc_add_snapshot(acc_buf, env_ptr, start, src_from, src_to, norm, st);
+        else desc.norm = 0.0;
     }
+    result_out->snapshot = desc;
+    profile_mark(self, CT_STAGE_ACCUMULATOR, t);
 
     if (self->unlock_func) self->unlock_func(self->lock_obj);
 
     return 1;
 }
 
-bool analyzer_cleanup_snapshots(TransientAnalyzer* self, int frame) {
-    int cleanup = frame - 15000; bool updated = false;
-
+int analyzer_peak_snapshot(const TransientAnalyzer* self, const PeakResult* peak, double* out) {
+    const SnapshotDescriptor* d = &peak->snapshot;
+    const int cap = self->snapshot_history_cap;
+    long long first = (long long)d->p_idx - 5000 + d->src_offset;
+    if (!self->snapshot_history || d->p_idx >= self->total_frames_pushed || first < self->total_frames_pushed - cap) return 0;
+    const float* hist = self->snapshot_history + peak->band_idx * cap;
+    for (int i = 0; i < BUFFER_LEN; i++) {
+        out[i] = (i < d->src_offset) ? 0.0 : (double)hist[((long long)d->p_idx - 5000 + i) % cap] * d->norm;
+    }
+    return 1;
+}
+
+void peak_snapshot_from_envelope(const PeakResult* peak, const float* envelope, int envelope_len, double* out) {
+    const SnapshotDescriptor* d = &peak->snapshot;
+    for (int i = 0; i < BUFFER_LEN; i++) {
+        long long idx = (long long)d->p_idx - 5000 + i;
+        out[i] = (i < d->src_offset || idx >= envelope_len) ? 0.0 : (double)envelope[idx] * d->norm;
+    }
+}
+
+bool analyzer_cleanup_snapshots(TransientAnalyzer* self, int frame) {
+    int cleanup = frame - 15000; bool updated = false;
+
     if (self->lock_func) self->lock_func(self->lock_obj);
     double* acc_buf = self->shared_buffer ? self->shared_buffer->accumulated_buffer : self->private_accumulated_buffer;
 
-    for (int b = 0; b < MAX_BANDS; b++) {
-        while (self->snapshot_heads[b] && self->snapshot_heads[b]->p_idx <= cleanup) {
-            SnapshotEntry* e = self->snapshot_heads[b];
-            for (int j = 0; j < BUFFER_LEN; j++) acc_buf[j] -= e->snapshot[j];
-            self->snapshot_heads[b] = e->next; if (!self->snapshot_heads[b]) self->snapshot_tails[b] = NULL;
-            free(e); updated = true;
-        }
-    }
+    double t = profile_start(self);
+    updated = snapshot_flush_expired(self, acc_buf);
+    if (snapshot_expire(self, acc_buf, cleanup, false)) updated = true;
+    profile_mark(self, CT_STAGE_ACCUMULATOR, t);
 
     if (self->unlock_func) self->unlock_func(self->lock_obj);
 
@@ -373,20 +1276,25 @@ bool analyzer_cleanup_snapshots(TransientAnalyzer* self, int frame) {
 
 void analyzer_update_metrics(TransientAnalyzer* self, int frame, AnalyzerMetrics* metrics_out) {
     bool updated = analyzer_cleanup_snapshots(self, frame);
+    double t = profile_start(self);
 
     if (self->lock_func) self->lock_func(self->lock_obj);
     double* acc_buf = self->shared_buffer ? self->shared_buffer->accumulated_buffer : self->private_accumulated_buffer;
 
-    // Exclude the last 99ms to avoid self-referential bias from the peak at zero.
-    int m_len = BUFFER_LEN - 99; double sum = 0.0, sum_sq = 0.0, max_v = -DBL_MAX;
-    if (m_len > 0) {
-        max_v = acc_buf[0];
-        for (int i = 0; i < m_len; i++) {
-            double v = acc_buf[i]; sum += v; sum_sq += v * v; if (v > max_v) max_v = v;
-        }
+    AccumulatorStats st = *acc_stats(self);
+    if (self->metrics_mode == CT_METRICS_VALIDATE) {
+        AccumulatorStats ref;
+        acc_stats_scan(&ref, acc_buf, 0, METRICS_LEN);
+        double dev = metrics_deviation(st.sum, ref.sum);
+        double d = metrics_deviation(st.sum_sq, ref.sum_sq); if (d > dev) dev = d;
+        d = metrics_deviation(st.max, ref.max); if (d > dev) dev = d;
+        if (st.max_idx != ref.max_idx) dev = 1.0;
+        if (dev > self->metrics_max_deviation) self->metrics_max_deviation = dev;
+        st = ref;
     }
-    double mean = (m_len > 0) ? (sum / (double)m_len) : 0.0;
-    double var = (m_len > 0) ? (sum_sq / (double)m_len - mean * mean) : 0.0; if (var < 0) var = 0;
+    double max_v = st.max;
+    double mean = st.sum / (double)METRICS_LEN;
+    double var = st.sum_sq / (double)METRICS_LEN - mean * mean; if (var < 0) var = 0;
     metrics_out->std_dev = sqrt(var); metrics_out->mean = mean; metrics_out->contrast = (mean > 0) ? (max_v / mean) : 0;
     metrics_out->demarcation_line = mean;
 
@@ -401,62 +1309,54 @@ void analyzer_update_metrics(TransientAnalyzer* self, int frame, AnalyzerMetrics
     }
 
     metrics_out->buffer_updated = updated; metrics_out->highest_peak_valid = false;
-    if (max_v > 0.1) {
-        int hi_idx = -1; double hi_val = -DBL_MAX;
-        for (int i = 0; i < m_len; i++) {
-            double v = acc_buf[i]; if (v > mean && v > hi_val) { hi_val = v; hi_idx = i; }
-        }
-        if (hi_idx != -1) {
-            metrics_out->highest_peak_ms = self->buffer_times[hi_idx]; metrics_out->highest_peak_valid = true;
-            self->highest_peak_ms = metrics_out->highest_peak_ms;
-        }
+    // The highest value above the mean is the first occurrence of the maximum, if it exceeds the mean
+    if (max_v > 0.1 && max_v > mean) {
+        metrics_out->highest_peak_ms = self->buffer_times[st.max_idx]; metrics_out->highest_peak_valid = true;
+        self->highest_peak_ms = metrics_out->highest_peak_ms;
     }
 
     if (self->unlock_func) self->unlock_func(self->lock_obj);
 
+    self->last_bar_length = -1;
     if (metrics_out->highest_peak_valid) {
         int bar_length = (int)round(fabs(metrics_out->highest_peak_ms));
         if (bar_length >= 0 && bar_length <= 5000) {
-            self->bar_length_counts[bar_length]++;
+            bar_histogram_add(&self->bar_lengths, bar_length, 1);
+            self->last_bar_length = bar_length;
         }
     }
+    metrics_out->stability_score = bar_histogram_stability(&self->bar_lengths);
 
-    double stability_sum = 0;
-    int stability_count = 0;
-    for (int i = 0; i <= 5000; i++) {
-        if (self->bar_length_counts[i] > 0) {
-            stability_sum += (double)self->bar_length_counts[i];
-            stability_count++;
+    // Calculate prominence averages over 15 seconds
+    double psum[MAX_BANDS], ssum[MAX_BANDS], fsum[MAX_BANDS];
+    float pmax[MAX_BANDS];
+    int win;
+    if (self->metrics_mode == CT_METRICS_INCREMENTAL && self->prominence_index) {
+        win = metrics_window_running(self, psum, ssum, fsum, pmax);
+    } else {
+        win = metrics_window_scan(self, psum, ssum, fsum, pmax);
+        if (self->metrics_mode == CT_METRICS_VALIDATE && self->prominence_index) {
+            double rpsum[MAX_BANDS], rssum[MAX_BANDS], rfsum[MAX_BANDS];
+            float rpmax[MAX_BANDS];
+            int rwin = metrics_window_running(self, rpsum, rssum, rfsum, rpmax);
+            double dev = (rwin != win) ? 1.0 : 0.0;
+            for (int b = 0; b < MAX_BANDS; b++) {
+                double d = metrics_deviation(rpsum[b] / (double)rwin, psum[b] / (double)win); if (d > dev) dev = d;
+                d = metrics_deviation(rssum[b] / (double)rwin, ssum[b] / (double)win); if (d > dev) dev = d;
+                d = metrics_deviation(rfsum[b] / (double)rwin, fsum[b] / (double)win); if (d > dev) dev = d;
+                d = metrics_deviation((double)rpmax[b], (double)pmax[b]); if (d > dev) dev = d;
+            }
+            if (dev > self->metrics_max_deviation) self->metrics_max_deviation = dev;
         }
     }
-    metrics_out->stability_score = (stability_count > 0) ? (stability_sum / (double)stability_count) : 0.0;
 
-    // Calculate prominence averages over 15 seconds
-    int nf = self->cache_count;
-    int win = (int)(15000.0 / self->frame_duration_ms);
-    if (win > nf) win = nf;
-    if (win <= 0) win = 1;
-
-    int wptr = self->cache_write_ptr;
     double g_fsum = 0;
     for (int b = 0; b < MAX_BANDS; b++) {
-        double psum = 0;
-        double ssum = 0;
-        double fsum = 0;
-        float pmax = 0;
-        for (int j = 0; j < win; j++) {
-            int idx = (wptr - 1 - j + CACHE_SIZE) % CACHE_SIZE;
-            float pv = self->prominence_envelopes[b * CACHE_SIZE + idx];
-            psum += (double)pv;
-            if (pv > pmax) pmax = pv;
-            ssum += (double)self->dynamic_smoothings[b * CACHE_SIZE + idx];
-            fsum += (double)self->flux_envelopes[b * CACHE_SIZE + idx];
-        }
-        metrics_out->band_prominence_avgs[b] = psum / (double)win;
-        metrics_out->band_prominence_half_maxes[b] = (double)pmax / 2.0;
-        metrics_out->band_smoothing_avgs[b] = ssum / (double)win;
+        metrics_out->band_prominence_avgs[b] = psum[b] / (double)win;
+        metrics_out->band_prominence_half_maxes[b] = (double)pmax[b] / 2.0;
+        metrics_out->band_smoothing_avgs[b] = ssum[b] / (double)win;
         self->smoothing_avgs[b] = metrics_out->band_smoothing_avgs[b];
-        metrics_out->band_flux_avgs[b] = fsum / (double)win;
+        metrics_out->band_flux_avgs[b] = fsum[b] / (double)win;
         g_fsum += metrics_out->band_flux_avgs[b];
     }
     metrics_out->global_flux_avg = g_fsum / (double)MAX_BANDS;
@@ -464,6 +1364,7 @@ void analyzer_update_metrics(TransientAnalyzer* self, int frame, AnalyzerMetrics
     double g_ssum = 0;
     for (int b = 0; b < MAX_BANDS; b++) g_ssum += metrics_out->band_smoothing_avgs[b];
     metrics_out->global_smoothing_avg = g_ssum / (double)MAX_BANDS;
+    profile_mark(self, CT_STAGE_METRICS, t);
 }
 
 double* analyzer_get_buffer(TransientAnalyzer* self) {
@@ -471,119 +1372,361 @@ double* analyzer_get_buffer(TransientAnalyzer* self) {
     return self->private_accumulated_buffer;
 }
 
-void analyzer_push_audio(TransientAnalyzer* self, const float* y, int len, int sr) {
+// Append y to the samples carried over from the last push. Returns the global index of
+// combined_scratch[0], or -1 if the scratch could not grow.
+static long long push_stage_audio(TransientAnalyzer* self, const float* y, int len, int sr) {
     if (self->sample_rate != sr) {
         analyzer_set_sample_rate(self, sr);
         self->overlap_len = 0;
         self->total_samples_received = 0;
     }
-    int hop = (int)(sr * 0.001);
     int combined_len = self->overlap_len + len;
     if (combined_len > self->combined_scratch_cap) {
         int ncap = combined_len + N_FFT * 2;
         float* ns = (float*)realloc(self->combined_scratch, sizeof(float) * ncap);
-        if (ns) { self->combined_scratch = ns; self->combined_scratch_cap = ncap; } else return;
+        if (ns) { self->combined_scratch = ns; self->combined_scratch_cap = ncap; } else return -1;
     }
     if (self->overlap_len > 0) memcpy(self->combined_scratch, self->overlap_buffer, sizeof(float) * self->overlap_len);
     if (len > 0) memcpy(self->combined_scratch + self->overlap_len, y, sizeof(float) * len);
+    return self->total_samples_received - self->overlap_len;
+}
 
-    long long current_scratch_start = self->total_samples_received - self->overlap_len;
-    long long current_total_samples = self->total_samples_received + len;
+// Keep the samples the next frame still needs once all complete frames have been pushed
+static void push_keep_overlap(TransientAnalyzer* self, long long scratch_start, long long total_samples, int hop) {
+    self->total_samples_received = total_samples;
+    long long next_window_start_global = (long long)self->total_frames_pushed * hop - N_FFT / 2;
+    if (next_window_start_global < 0) next_window_start_global = 0;
+
+    if (next_window_start_global < self->total_samples_received) {
+        int rem = (int)(self->total_samples_received - next_window_start_global);
+        if (rem > N_FFT * 4) rem = N_FFT * 4;
+        int offset = (int)(next_window_start_global - scratch_start);
+        memcpy(self->overlap_buffer, self->combined_scratch + offset, sizeof(float) * rem);
+        self->overlap_len = rem;
+    } else {
+        self->overlap_len = 0;
+    }
+}
+
+// Window the frame starting at global sample frame_start into re/im (even/odd samples),
+// zero-padding whatever lies outside the received audio. The view ends at sample total_samples.
+static void window_frame(const CtKernels* kern, const double* window, double* re, double* im, long long frame_start_global, const AudioView* view, long long view_start, long long total_samples) {
+    long long off = frame_start_global - view_start;
+    int len0 = view->span_len[0];
+    if (off >= 0 && frame_start_global + N_FFT <= total_samples) {
+        if (off + N_FFT <= len0) {
+            kern->window_deinterleave(view->span[0] + off, window, re, im, N_FFT);
+            return;
+        }
+        if (off >= len0) {
+            kern->window_deinterleave(view->span[1] + (off - len0), window, re, im, N_FFT);
+            return;
+        }
+    }
+    // Stream edges and the rare frame that straddles the two spans
+    for (int i = 0; i < N_FFT; i++) {
+        long long g_idx = frame_start_global + i;
+        double v = 0.0;
+        if (g_idx >= 0 && g_idx >= view_start && g_idx < total_samples) {
+            long long l_idx = g_idx - view_start;
+            float sample = l_idx < len0 ? view->span[0][l_idx] : view->span[1][l_idx - len0];
+            v = (double)sample * window[i];
+        }
+        if (i & 1) im[i >> 1] = v;
+        else re[i >> 1] = v;
+    }
+}
+
+static void push_window_frame(TransientAnalyzer* self, const CtKernels* kern, long long frame_start_global, const AudioView* view, long long view_start, long long total_samples) {
+    window_frame(kern, self->fft_window, self->fft_real, self->fft_imag, frame_start_global, view, view_start, total_samples);
+}
+
+// Mel energies in dB (unclamped) of a frame's power spectrum, using self's tables only.
+// Returns the frame's maximum.
+static double mel_power_db(const TransientAnalyzer* self, const CtKernels* kern, const double* power, double* mel_out) {
+    double frame_max = -DBL_MAX;
+    for (int m = 0; m < N_MELS; m++) {
+        int lo = self->mel_filter_starts[m];
+        double mel = kern->dot(power + lo, self->mel_filters + m * N_BINS + lo, self->mel_filter_ends[m] - lo);
+        if (mel < 1e-10) mel = 1e-10;
+        double db = 10.0 * log10(mel);
+        mel_out[m] = db;
+        if (db > frame_max) frame_max = db;
+    }
+    return frame_max;
+}
+
+// Frame bookkeeping that has to happen before frame next_f is written
+static void push_frame_begin(TransientAnalyzer* self, long long next_f) {
+    snapshot_history_reserve(self, next_f);
+    if (self->prominence_index) metrics_window_retire(self);
+}
+
+// Write frame next_f's band flux and mel frame into the caches, advance the smoothing and move on
+// to the next frame
+static void push_frame_store(TransientAnalyzer* self, long long next_f, const float* band_flux, const double* mel) {
+    int f_idx = self->cache_write_ptr;
+    int h_idx = (int)(next_f % self->snapshot_history_cap);
+
+    if (self->mel_spectrogram) {
+        for (int m = 0; m < N_MELS; m++) self->mel_spectrogram[m * CACHE_SIZE + f_idx] = mel[m];
+    }
+    for (int b = 0; b < MAX_BANDS; b++) {
+        float flux = band_flux[b];
+        self->flux_envelopes[b * FLUX_STRIDE + f_idx] = flux;
+        self->flux_envelopes[b * FLUX_STRIDE + CACHE_SIZE + f_idx] = flux;
+        self->snapshot_history[b * self->snapshot_history_cap + h_idx] = flux;
+
+        float prev_smooth = self->smoothing_states[b];
+        if (flux > prev_smooth) {
+            self->smoothing_states[b] = flux;
+        } else {
+            // Decay by 1/200th of the distance to the flux per 1ms frame
+            self->smoothing_states[b] = prev_smooth - (prev_smooth - flux) / 200.0f;
+        }
+        self->dynamic_smoothings[b * CACHE_SIZE + f_idx] = self->smoothing_states[b];
+        range_index_update(self->smoothing_index, self->dynamic_smoothings, b, f_idx);
+    }
+    self->cache_write_ptr = (self->cache_write_ptr + 1) % CACHE_SIZE;
+    if (self->cache_count < CACHE_SIZE) self->cache_count++;
+    self->total_frames_pushed++;
+    if (self->prominence_index) metrics_window_admit(self);
+}
+
+// Finish a frame whose mel energies (dB, unclamped) are in the current mel frame: clamp, derive
+// the band flux and smoothing, and advance the caches.
+static void push_frame_finish(TransientAnalyzer* self, const CtKernels* kern, long long next_f, double frame_max) {
+    double* mel_cur = self->mel_frames + self->mel_frame_cur * N_MELS;
+    double* mel_prev = self->mel_frames + (1 - self->mel_frame_cur) * N_MELS;
+    float flux[MAX_BANDS];
+
+    if (frame_max > self->max_mel_db) self->max_mel_db = frame_max;
+    kern->clamp_floor(mel_cur, N_MELS, self->max_mel_db - 80.0);
+    for (int b = 0; b < MAX_BANDS; b++) {
+        double fsum = kern->positive_diff_sum(mel_cur + b * 32, mel_prev + b * 32, 32);
+        flux[b] = (float)(fsum / 32.0);
+    }
+    push_frame_store(self, next_f, flux, mel_cur);
+    self->mel_frame_cur = 1 - self->mel_frame_cur;
+}
+
+// Finish frames next_f..key_f from the spectrum of key_f alone (see analyzer_set_frame_stride).
+// The key frame's flux is its change from the last computed frame spread over the gap, and the
+// frames before it are interpolated from the last frame written, so peaks stay strict maxima.
+static void push_frames_strided(TransientAnalyzer* self, const CtKernels* kern, long long next_f, long long key_f, double frame_max) {
+    double* mel_cur = self->mel_frames + self->mel_frame_cur * N_MELS;
+    double* mel_prev = self->mel_frames + (1 - self->mel_frame_cur) * N_MELS;
+    int gap = (int)(key_f - next_f + 1);
+    int last_idx = (self->cache_write_ptr - 1 + CACHE_SIZE) % CACHE_SIZE;
+    float key_flux[MAX_BANDS], last_flux[MAX_BANDS];
+
+    if (frame_max > self->max_mel_db) self->max_mel_db = frame_max;
+    kern->clamp_floor(mel_cur, N_MELS, self->max_mel_db - 80.0);
+    for (int b = 0; b < MAX_BANDS; b++) {
+        double fsum = kern->positive_diff_sum(mel_cur + b * 32, mel_prev + b * 32, 32);
+        key_flux[b] = (float)(fsum / (32.0 * gap));
+        last_flux[b] = self->cache_count > 0 ? self->flux_envelopes[b * FLUX_STRIDE + last_idx] : key_flux[b];
+    }
+    for (long long f = next_f; f <= key_f; f++) {
+        float flux[MAX_BANDS];
+        double w = (double)(f - next_f + 1) / gap;
+        for (int b = 0; b < MAX_BANDS; b++) {
+            flux[b] = (f == key_f) ? key_flux[b] : (float)(last_flux[b] + (key_flux[b] - last_flux[b]) * w);
+        }
+        push_frame_begin(self, f);
+        push_frame_store(self, f, flux, mel_cur);
+    }
+    self->mel_frame_cur = 1 - self->mel_frame_cur;
+}
+
+// Push every complete frame of a view that ends at sample total_samples
+static void push_frames(TransientAnalyzer* self, const AudioView* view, long long view_start, long long total_samples, int hop) {
+    const CtKernels* kern = ct_kernels_get();
 
     while (1) {
         long long next_f = self->total_frames_pushed;
-        long long center_sample_global = next_f * hop;
+        // With a frame stride only its multiples are computed and the frames up to one wait for it
+        long long key_f = next_f;
+        if (self->frame_stride > 1) key_f = (next_f + self->frame_stride - 1) / self->frame_stride * self->frame_stride;
+        long long center_sample_global = key_f * hop;
         long long end_sample_needed_global = center_sample_global + N_FFT / 2;
 
-        if (end_sample_needed_global > current_total_samples) break;
+        if (end_sample_needed_global > total_samples) break;
 
-        int f_idx = self->cache_write_ptr;
-        double frame_max = -DBL_MAX;
+        double t = profile_start(self);
+        if (key_f == next_f) push_frame_begin(self, next_f);
+        push_window_frame(self, kern, center_sample_global - N_FFT / 2, view, view_start, total_samples);
+        rfft_power(self->fft_real, self->fft_imag, self->fft_twiddle_re, self->fft_twiddle_im, self->fft_bitrev, self->power_spectrum);
+        t = profile_mark(self, CT_STAGE_FFT, t);
 
-        for (int i = 0; i < N_FFT; i++) {
-            long long g_idx = center_sample_global - N_FFT / 2 + i;
-            if (g_idx < 0) {
-                self->fft_real[i] = 0.0;
-            } else if (g_idx >= current_total_samples) {
-                self->fft_real[i] = 0.0;
-            } else {
-                int l_idx = (int)(g_idx - current_scratch_start);
-                self->fft_real[i] = (double)self->combined_scratch[l_idx] * self->fft_window[i];
-            }
-            self->fft_imag[i] = 0.0;
+        // Frame-major scratch: the current and previous mel frames are each N_MELS contiguous values
+        double* mel_cur = self->mel_frames + self->mel_frame_cur * N_MELS;
+        double frame_max = mel_power_db(self, kern, self->power_spectrum, mel_cur);
+        t = profile_mark(self, CT_STAGE_MEL, t);
+        if (key_f == next_f) {
+            push_frame_finish(self, kern, next_f, frame_max);
+        } else {
+            push_frames_strided(self, kern, next_f, key_f, frame_max);
         }
-        fft(self->fft_real, self->fft_imag, N_FFT);
+        profile_mark(self, CT_STAGE_FLUX, t);
+    }
+}
 
-        for (int m = 0; m < N_MELS; m++) {
-            double mel = 0;
-            for (int i = 0; i < (N_FFT / 2 + 1); i++) {
-                double p = (self->fft_real[i] * self->fft_real[i] + self->fft_imag[i] * self->fft_imag[i]) / ((double)N_FFT * (double)N_FFT);
-                mel += p * self->mel_filters[m * (N_FFT / 2 + 1) + i];
-            }
-            if (mel < 1e-10) mel = 1e-10;
-            double db = 10.0 * log10(mel);
-            self->mel_spectrogram[m * CACHE_SIZE + f_idx] = db;
-            if (db > frame_max) frame_max = db;
+void analyzer_push_audio(TransientAnalyzer* self, const float* y, int len, int sr) {
+    long long current_scratch_start = push_stage_audio(self, y, len, sr);
+    if (current_scratch_start < 0) return;
+    int hop = (int)(sr * 0.001);
+    long long current_total_samples = self->total_samples_received + len;
+    AudioView staged = { { self->combined_scratch, NULL }, { (int)(current_total_samples - current_scratch_start), 0 } };
+
+    push_frames(self, &staged, current_scratch_start, current_total_samples, hop);
+    push_keep_overlap(self, current_scratch_start, current_total_samples, hop);
+}
+
+int analyzer_view_history(const TransientAnalyzer* self) {
+    int hop = (int)(self->sample_rate * 0.001);
+    long long next_window_start_global = (long long)self->total_frames_pushed * hop - N_FFT / 2;
+    if (next_window_start_global < 0) next_window_start_global = 0;
+    long long history = self->total_samples_received - next_window_start_global;
+    return history > 0 ? (int)history : 0;
+}
+
+void audio_view_from_ring(AudioView* view, const float* ring, int ring_size, int start, int count) {
+    int first = ring_size - start;
+    if (first > count) first = count;
+    view->span[0] = ring + start;
+    view->span_len[0] = first;
+    view->span[1] = ring;
+    view->span_len[1] = count - first;
+}
+
+// Where the view starts in the stream once its newest len samples are counted as received
+static long long push_view_begin(TransientAnalyzer* self, const AudioView* view, int len, int sr) {
+    if (self->sample_rate != sr) {
+        analyzer_set_sample_rate(self, sr);
+        self->total_samples_received = 0;
+    }
+    self->overlap_len = 0;
+    return self->total_samples_received + len - (view->span_len[0] + view->span_len[1]);
+}
+
+void analyzer_push_audio_view(TransientAnalyzer* self, const AudioView* view, int len, int sr) {
+    long long view_start = push_view_begin(self, view, len, sr);
+    long long current_total_samples = self->total_samples_received + len;
+
+    push_frames(self, view, view_start, current_total_samples, (int)(sr * 0.001));
+    self->total_samples_received = current_total_samples;
+}
+
+// Lane groups only share the FFT and mel work when every analyzer is at the same point of the
+// same stream, which is always the case for the channels of one mc.analyze~, and computing every frame.
+static bool push_lanes_aligned(TransientAnalyzer** analyzers, int count, int sr) {
+    TransientAnalyzer* lead = analyzers[0];
+    if (lead->sample_rate != sr || lead->frame_stride > 1) return false;
+    for (int l = 1; l < count; l++) {
+        TransientAnalyzer* a = analyzers[l];
+        if (a->sample_rate != sr || a->frame_stride > 1 || a->total_samples_received != lead->total_samples_received ||
+            a->total_frames_pushed != lead->total_frames_pushed || a->overlap_len != lead->overlap_len) return false;
+    }
+    return true;
+}
+
+void analyzer_push_audio_lanes(TransientAnalyzer** analyzers, const AudioView* views, int count, int len, int sr) {
+    if (count <= 0) return;
+    TransientAnalyzer* lead = analyzers[0];
+    const CtKernels* kern = ct_kernels_get();
+    if (count == 1 || count > CT_LANES || !kern->rfft_power_lanes || !push_lanes_aligned(analyzers, count, sr)) {
+        for (int l = 0; l < count; l++) analyzer_push_audio_view(analyzers[l], &views[l], len, sr);
+        return;
+    }
+    if (!lead->lane_scratch) {
+        lead->lane_scratch = (double*)malloc(sizeof(double) * CT_LANES * (N_FFT + N_BINS));
+        if (!lead->lane_scratch) {
+            for (int l = 0; l < count; l++) analyzer_push_audio_view(analyzers[l], &views[l], len, sr);
+            return;
         }
+    }
 
-        if (frame_max > self->max_mel_db) self->max_mel_db = frame_max;
-        double floor = self->max_mel_db - 80.0;
-        for (int m = 0; m < N_MELS; m++) if (self->mel_spectrogram[m * CACHE_SIZE + f_idx] < floor) self->mel_spectrogram[m * CACHE_SIZE + f_idx] = floor;
-        int prev = (f_idx - 1 + CACHE_SIZE) % CACHE_SIZE;
-        for (int b = 0; b < MAX_BANDS; b++) {
-            double fsum = 0;
-            for (int m = b * 32; m < (b + 1) * 32; m++) {
-                double d = self->mel_spectrogram[m * CACHE_SIZE + f_idx] - self->mel_spectrogram[m * CACHE_SIZE + prev];
-                if (d > 0) fsum += d;
+    long long view_start[CT_LANES];
+    for (int l = 0; l < count; l++) view_start[l] = push_view_begin(analyzers[l], &views[l], len, sr);
+
+    int hop = (int)(sr * 0.001);
+    long long current_total_samples = lead->total_samples_received + len;
+    double* re = lead->lane_scratch;
+    double* im = re + CT_LANES * N_FFT / 2;
+    double* power = im + CT_LANES * N_FFT / 2;
+
+    while (1) {
+        long long next_f = lead->total_frames_pushed;
+        long long center_sample_global = next_f * hop;
+        long long end_sample_needed_global = center_sample_global + N_FFT / 2;
+
+        if (end_sample_needed_global > current_total_samples) break;
+
+        // Window each channel, then interleave so one register holds the same sample of every
+        // lane. Unused lanes repeat the last channel and are discarded.
+        double t = profile_start(lead);
+        for (int l = 0; l < CT_LANES; l++) {
+            TransientAnalyzer* a = analyzers[l < count ? l : count - 1];
+            if (l < count) {
+                push_frame_begin(a, next_f);
+                push_window_frame(a, kern, center_sample_global - N_FFT / 2, &views[l], view_start[l], current_total_samples);
             }
-            float flux = (float)(fsum / 32.0);
-            self->flux_envelopes[b * CACHE_SIZE + f_idx] = flux;
+            for (int i = 0; i < N_FFT / 2; i++) {
+                re[i * CT_LANES + l] = a->fft_real[i];
+                im[i * CT_LANES + l] = a->fft_imag[i];
+            }
+        }
+        kern->rfft_power_lanes(re, im, lead->fft_twiddle_re, lead->fft_twiddle_im, lead->fft_bitrev, N_FFT, power);
+        t = profile_mark(lead, CT_STAGE_FFT, t);
 
-            float prev_smooth = self->smoothing_states[b];
-            if (flux > prev_smooth) {
-                self->smoothing_states[b] = flux;
-            } else {
-                // Decay by 1/200th of the distance to the flux per 1ms frame
-                self->smoothing_states[b] = prev_smooth - (prev_smooth - flux) / 200.0f;
+        double frame_max[CT_LANES];
+        for (int l = 0; l < count; l++) frame_max[l] = -DBL_MAX;
+        for (int m = 0; m < N_MELS; m++) {
+            int lo = lead->mel_filter_starts[m];
+            double mel[CT_LANES];
+            kern->dot_lanes(power + lo * CT_LANES, lead->mel_filters + m * N_BINS + lo, lead->mel_filter_ends[m] - lo, mel);
+            for (int l = 0; l < count; l++) {
+                double v = mel[l];
+                if (v < 1e-10) v = 1e-10;
+                double db = 10.0 * log10(v);
+                analyzers[l]->mel_frames[analyzers[l]->mel_frame_cur * N_MELS + m] = db;
+                if (db > frame_max[l]) frame_max[l] = db;
             }
-            self->dynamic_smoothings[b * CACHE_SIZE + f_idx] = self->smoothing_states[b];
         }
-        self->cache_write_ptr = (self->cache_write_ptr + 1) % CACHE_SIZE;
-        if (self->cache_count < CACHE_SIZE) self->cache_count++;
-        self->total_frames_pushed++;
+        t = profile_mark(lead, CT_STAGE_MEL, t);
+        for (int l = 0; l < count; l++) {
+            double tl = profile_start(analyzers[l]);
+            push_frame_finish(analyzers[l], kern, next_f, frame_max[l]);
+            profile_mark(analyzers[l], CT_STAGE_FLUX, tl);
+        }
     }
 
-    self->total_samples_received = current_total_samples;
-    long long next_window_start_global = (long long)self->total_frames_pushed * hop - N_FFT / 2;
-    if (next_window_start_global < 0) next_window_start_global = 0;
-
-    if (next_window_start_global < self->total_samples_received) {
-        int rem = (int)(self->total_samples_received - next_window_start_global);
-        if (rem > N_FFT * 4) rem = N_FFT * 4;
-        int offset = (int)(next_window_start_global - current_scratch_start);
-        memcpy(self->overlap_buffer, self->combined_scratch + offset, sizeof(float) * rem);
-        self->overlap_len = rem;
-    } else {
-        self->overlap_len = 0;
-    }
+    for (int l = 0; l < count; l++) analyzers[l]->total_samples_received = current_total_samples;
 }
 
-int analyzer_analyze_chunk(TransientAnalyzer* self, const float* y, int len, int sr, int buffer_start_frame, int active_start_frame, ChunkAnalysisResult* result_out) {
-    analyzer_cleanup_snapshots(self, active_start_frame);
+int analyzer_chunk_prepare(TransientAnalyzer* self, const float* y, int len, int sr, int active_start_frame) {
     analyzer_push_audio(self, y, len, sr);
+    return analyzer_chunk_prepare_pushed(self, active_start_frame);
+}
+
+int analyzer_chunk_prepare_pushed(TransientAnalyzer* self, int active_start_frame) {
+    ChunkPending* pc = &self->pending;
+    chunk_pending_release(pc);
+    self->last_bar_length = -1;
+    double t = profile_start(self);
+    snapshot_defer_expired(self, active_start_frame - 15000);
+    t = profile_mark(self, CT_STAGE_ACCUMULATOR, t);
     int nf = self->cache_count, rptr = (self->cache_write_ptr - nf + CACHE_SIZE) % CACHE_SIZE;
-    float *envs[MAX_BANDS] = {0}, *sm_envs[MAX_BANDS] = {0}, *thrs[MAX_BANDS] = {0};
-    float half_maxes[MAX_BANDS];
+    const float** envs = pc->envs;
+    float* half_maxes = pc->half_maxes;
+    pc->nf = nf;
+    pc->gstart = self->total_frames_pushed - self->cache_count;
+    pc->active_start_frame = active_start_frame;
 
     for (int b = 0; b < MAX_BANDS; b++) {
-        envs[b] = (float*)malloc(sizeof(float) * nf);
-        sm_envs[b] = (float*)malloc(sizeof(float) * nf);
-        thrs[b] = (float*)malloc(sizeof(float) * nf);
-        if (!envs[b] || !sm_envs[b] || !thrs[b]) { for(int k=0; k<=b; k++) { free(envs[k]); free(sm_envs[k]); free(thrs[k]); } return 0; }
-        for (int j = 0; j < nf; j++) {
-            envs[b][j] = self->flux_envelopes[b * CACHE_SIZE + (rptr + j) % CACHE_SIZE];
-            sm_envs[b][j] = self->dynamic_smoothings[b * CACHE_SIZE + (rptr + j) % CACHE_SIZE];
-        }
+        // The mirrored cache holds the window oldest-first without wrapping, so nothing is copied
+        envs[b] = self->flux_envelopes + b * FLUX_STRIDE + rptr;
 
         // Use current lookback parameters for this chunk
         int n_dyn_b = (int)(self->midpoint_lookback[b] / self->frame_duration_ms);
@@ -595,15 +1738,13 @@ int analyzer_analyze_chunk(TransientAnalyzer* self, const float* y, int len, int
         }
 
         half_maxes[b] = calculate_half_max(envs[b] + nf - n_dyn_b, n_dyn_b);
-        for (int j = 0; j < nf; j++) {
-            thrs[b][j] = (float)self->smoothing_avgs[b];
-        }
+        pc->thresholds[b] = (float)self->smoothing_avgs[b];
 
         // Report the parameters that derived the lookback used for this chunk
-        result_out->metrics.band_lookbacks[b] = self->midpoint_lookback[b];
-        result_out->metrics.band_avg_deltas[b] = self->lookback_avg_delta[b];
-        result_out->metrics.band_total_deltas[b] = self->lookback_total_delta[b];
-        result_out->metrics.band_p_counts[b] = self->lookback_p_count[b];
+        pc->band_lookbacks[b] = self->midpoint_lookback[b];
+        pc->band_avg_deltas[b] = self->lookback_avg_delta[b];
+        pc->band_total_deltas[b] = self->lookback_total_delta[b];
+        pc->band_p_counts[b] = self->lookback_p_count[b];
 
         // Calculate and store parameters for the NEXT analysis chunk based on current peak density
         double avg_delta_ms = 0;
@@ -613,12 +1754,11 @@ int analyzer_analyze_chunk(TransientAnalyzer* self, const float* y, int len, int
         int cutoff = active_start_frame - lookback_frames;
 
         if (self->lock_func) self->lock_func(self->lock_obj);
-        SnapshotEntry* curr = self->snapshot_heads[b];
-        while (curr) {
-            if (curr->p_idx >= cutoff) {
+        SnapshotQueue* q = &self->snapshot_queues[b];
+        for (int i = 0; i < q->count; i++) {
+            if (snapshot_queue_at(q, i)->p_idx >= cutoff) {
                 p_count++;
             }
-            curr = curr->next;
         }
         if (self->unlock_func) self->unlock_func(self->lock_obj);
 
@@ -642,42 +1782,93 @@ int analyzer_analyze_chunk(TransientAnalyzer* self, const float* y, int len, int
             self->midpoint_lookback[b] = 15000.0;
         }
     }
-    int *bpeaks[MAX_BANDS] = {0}, bpeak_counts[MAX_BANDS] = {0}; float *bth[MAX_BANDS] = {0}, *bl[MAX_BANDS] = {0}, *br[MAX_BANDS] = {0}, *bp[MAX_BANDS] = {0};
     for (int b = 0; b < MAX_BANDS; b++) {
-        float *env = envs[b], *thr = thrs[b]; int *tp = (int*)malloc(sizeof(int) * nf);
-        float *tt = (float*)malloc(sizeof(float) * nf), *tl = (float*)malloc(sizeof(float) * nf), *tr = (float*)malloc(sizeof(float) * nf), *tm = (float*)malloc(sizeof(float) * nf);
-        int pc = 0;
-        if (tp && tt && tl && tr && tm) {
-            for (int f = 1; f < nf - 1; f++) {
-                if (env[f] > env[f-1] && env[f] > env[f+1] && env[f] > thr[f] && env[f] >= 0.0f) {
-                    bool replaced = false, too_close = false;
-                    if (pc > 0 && f - tp[pc-1] < 200) { too_close = true; if (env[f] > env[tp[pc-1]]) replaced = true; }
-                    if (!too_close || replaced) {
-                        float lmin_s, rmin_s;
-                        int cache_idx_f = (rptr + f) % CACHE_SIZE;
-                        float prom_s = calculate_prominence_global(self, b, cache_idx_f, &lmin_s, &rmin_s);
-
-                        if (prom_s > self->smoothing_avgs[b]) {
-                            if (replaced) { tp[pc-1] = f; tt[pc-1] = thr[f]; tl[pc-1] = lmin_s; tr[pc-1] = rmin_s; tm[pc-1] = prom_s; }
-                            else { tp[pc] = f; tt[pc] = thr[f]; tl[pc] = lmin_s; tr[pc] = rmin_s; tm[pc] = prom_s; pc++; }
-                        }
+        const float* env = envs[b];
+        float thr = pc->thresholds[b];
+        int *tp = pc->peaks[b];
+        float *tt = pc->peak_thresholds[b], *tl = pc->peak_left_mins[b], *tr = pc->peak_right_mins[b], *tm = pc->peak_prominences[b];
+        int pc_n = 0;
+        for (int f = 1; f < nf - 1; f++) {
+            if (env[f] > env[f-1] && env[f] > env[f+1] && env[f] > thr && env[f] >= 0.0f) {
+                bool replaced = false, too_close = false;
+                if (pc_n > 0 && f - tp[pc_n-1] < PEAK_MIN_SPACING) { too_close = true; if (env[f] > env[tp[pc_n-1]]) replaced = true; }
+                if (!too_close || replaced) {
+                    float lmin_s, rmin_s;
+                    int cache_idx_f = (rptr + f) % CACHE_SIZE;
+                    float prom_s = calculate_prominence_global(self, b, cache_idx_f, &lmin_s, &rmin_s);
+
+                    if (prom_s > self->smoothing_avgs[b]) {
+                        if (replaced) { tp[pc_n-1] = f; tt[pc_n-1] = thr; tl[pc_n-1] = lmin_s; tr[pc_n-1] = rmin_s; tm[pc_n-1] = prom_s; }
+                        else { tp[pc_n] = f; tt[pc_n] = thr; tl[pc_n] = lmin_s; tr[pc_n] = rmin_s; tm[pc_n] = prom_s; pc_n++; }
                     }
                 }
             }
-            bpeaks[b] = (int*)malloc(sizeof(int) * pc);
-            bth[b] = (float*)malloc(sizeof(float) * pc);
-            bl[b] = (float*)malloc(sizeof(float) * pc);
-            br[b] = (float*)malloc(sizeof(float) * pc);
-            bp[b] = (float*)malloc(sizeof(float) * pc);
-            bpeak_counts[b] = pc;
-            if (bpeaks[b]) memcpy(bpeaks[b], tp, sizeof(int) * pc);
-            if (bth[b]) memcpy(bth[b], tt, sizeof(float) * pc);
-            if (bl[b]) memcpy(bl[b], tl, sizeof(float) * pc);
-            if (br[b]) memcpy(br[b], tr, sizeof(float) * pc);
-            if (bp[b]) memcpy(bp[b], tm, sizeof(float) * pc);
-        }
-        free(tp); free(tt); free(tl); free(tr); free(tm);
+        }
+        pc->peak_counts[b] = pc_n;
+    }
+    int tot = 0; for (int b = 0; b < MAX_BANDS; b++) tot += pc->peak_counts[b];
+    PeakRef* pref = pc->sorted_peaks; int* aind = pc->all_peaks;
+    pc->total_peaks = tot;
+    int curr = 0; for (int b = 0; b < MAX_BANDS; b++) for (int i = 0; i < pc->peak_counts[b]; i++) { pref[curr].p_idx = pc->peaks[b][i]; pref[curr].band_idx = b; aind[curr] = pc->peaks[b][i]; curr++; }
+    qsort(pref, tot, sizeof(PeakRef), compare_peaks);
+    long long gstart = pc->gstart;
+    for (int b = 0; b < MAX_BANDS; b++) for (int i = 0; i < 100; i++) {
+        long long gf = (long long)active_start_frame + i, lf = gf - gstart;
+        pc->last_flux[b][i] = (lf >= 0 && lf < nf) ? envs[b][lf] : 0;
+        
+        float smooth = 0;
+        float prom = 0;
+        if (lf >= 0 && lf < nf) {
+            int cache_idx = (rptr + (int)lf) % CACHE_SIZE;
+            smooth = self->dynamic_smoothings[b * CACHE_SIZE + cache_idx];
+            prom = calculate_prominence_global(self, b, cache_idx, NULL, NULL);
+            
+            // Store calculated prominence in the persistent cache
+            metrics_set_prominence(self, b, cache_idx, prom);
+        }
+        pc->last_dynamic_smoothing[b][i] = smooth;
+        pc->last_prominence[b][i] = prom;
+    }
+    profile_mark(self, CT_STAGE_PEAKS, t);
+    pc->prepared = 1;
+    return 1;
+}
+
+void analyzer_chunk_prepare_push(TransientAnalyzer* self, const float* y, int len, int sr, int active_start_frame) {
+    analyzer_push_audio(self, y, len, sr);
+    analyzer_chunk_skip(self, active_start_frame);
+}
+
+void analyzer_chunk_skip(TransientAnalyzer* self, int active_start_frame) {
+    chunk_pending_release(&self->pending);
+    snapshot_defer_expired(self, active_start_frame - 15000);
+}
+
+int analyzer_chunk_commit(TransientAnalyzer* self, ChunkAnalysisResult* result_out) {
+    ChunkPending* pc = &self->pending;
+
+    if (pc->expired_count > 0) {
+        if (self->lock_func) self->lock_func(self->lock_obj);
+        double* acc_buf = self->shared_buffer ? self->shared_buffer->accumulated_buffer : self->private_accumulated_buffer;
+        double t = profile_start(self);
+        snapshot_flush_expired(self, acc_buf);
+        profile_mark(self, CT_STAGE_ACCUMULATOR, t);
+        if (self->unlock_func) self->unlock_func(self->lock_obj);
     }
+    if (!pc->prepared) return 0;
+
+    int nf = pc->nf, active_start_frame = pc->active_start_frame;
+    const float** envs = pc->envs;
+    int (*bpeaks)[CHUNK_BAND_PEAKS] = pc->peaks, *bpeak_counts = pc->peak_counts;
+    float (*bth)[CHUNK_BAND_PEAKS] = pc->peak_thresholds, (*bl)[CHUNK_BAND_PEAKS] = pc->peak_left_mins;
+    float (*br)[CHUNK_BAND_PEAKS] = pc->peak_right_mins, (*bp)[CHUNK_BAND_PEAKS] = pc->peak_prominences;
+    for (int b = 0; b < MAX_BANDS; b++) {
+        result_out->metrics.band_lookbacks[b] = pc->band_lookbacks[b];
+        result_out->metrics.band_avg_deltas[b] = pc->band_avg_deltas[b];
+        result_out->metrics.band_total_deltas[b] = pc->band_total_deltas[b];
+        result_out->metrics.band_p_counts[b] = pc->band_p_counts[b];
+    }
+
     float gmax = 0; bool any = false;
     for (int b = 0; b < MAX_BANDS; b++) for (int i = 0; i < bpeak_counts[b]; i++) { float v = envs[b][bpeaks[b][i]]; if (!any || v > gmax) { gmax = v; any = true; } }
     if (any) {
@@ -689,51 +1880,43 @@ int analyzer_analyze_chunk(TransientAnalyzer* self, const float* y, int len, int
         }
         if (self->unlock_func) self->unlock_func(self->lock_obj);
     }
-    int tot = 0; for (int b = 0; b < MAX_BANDS; b++) tot += bpeak_counts[b];
-    PeakRef* pref = (PeakRef*)malloc(sizeof(PeakRef) * (tot + 1)); int* aind = (int*)malloc(sizeof(int) * (tot + 1));
-    if (pref && aind) {
-        int curr = 0; for (int b = 0; b < MAX_BANDS; b++) for (int i = 0; i < bpeak_counts[b]; i++) { pref[curr].p_idx = bpeaks[b][i]; pref[curr].band_idx = b; aind[curr] = bpeaks[b][i]; curr++; }
-        qsort(pref, tot, sizeof(PeakRef), compare_peaks);
-        result_out->peak_list.num_peaks = 0;
-        long long gstart = self->total_frames_pushed - self->cache_count;
-        for (int b = 0; b < MAX_BANDS; b++) for (int i = 0; i < 100; i++) {
-            long long gf = (long long)active_start_frame + i, lf = gf - gstart;
-            result_out->last_flux[b][i] = (lf >= 0 && lf < nf) ? envs[b][lf] : 0;
-            
-            float smooth = 0;
-            float prom = 0;
-            if (lf >= 0 && lf < nf) {
-                int cache_idx = (rptr + (int)lf) % CACHE_SIZE;
-                smooth = self->dynamic_smoothings[b * CACHE_SIZE + cache_idx];
-                prom = calculate_prominence_global(self, b, cache_idx, NULL, NULL);
-                
-                // Store calculated prominence in the persistent cache
-                self->prominence_envelopes[b * CACHE_SIZE + cache_idx] = prom;
-            }
-            result_out->last_dynamic_smoothing[b][i] = smooth;
-            result_out->last_prominence[b][i] = prom;
-        }
-        for (int i = 0; i < tot; i++) {
-            int p_idx = pref[i].p_idx, b = pref[i].band_idx; long long gp = gstart + p_idx;
-            if (gp >= (long long)active_start_frame && gp < (long long)active_start_frame + 100) {
-                double pv = 0, tv = 0, lv = 0, rv = 0, prv = 0;
-                for (int k = 0; k < bpeak_counts[b]; k++) if (bpeaks[b][k] == p_idx) { pv = envs[b][p_idx]; tv = bth[b][k]; lv = bl[b][k]; rv = br[b][k]; prv = bp[b][k]; break; }
-                PeakResult pr; double time = (double)gp * self->frame_duration_ms / 1000.0;
-                if (analyzer_process_peak(self, p_idx, (int)gp, b, time, envs[b], nf, aind, tot, pv, tv, lv, rv, prv, &pr)) {
-                    if (result_out->peak_list.num_peaks < MAX_PEAKS_PER_CHUNK) {
-                        pr.p_idx = (int)gp;
-                        result_out->peak_list.peaks[result_out->peak_list.num_peaks++] = pr;
-                    }
+    int tot = pc->total_peaks;
+    PeakRef* pref = pc->sorted_peaks; int* aind = pc->all_peaks;
+    result_out->peak_list.num_peaks = 0;
+    result_out->peak_list.num_qualifiers = 0;
+    long long gstart = pc->gstart;
+    memcpy(result_out->last_flux, pc->last_flux, sizeof(pc->last_flux));
+    memcpy(result_out->last_dynamic_smoothing, pc->last_dynamic_smoothing, sizeof(pc->last_dynamic_smoothing));
+    memcpy(result_out->last_prominence, pc->last_prominence, sizeof(pc->last_prominence));
+    for (int i = 0; i < tot; i++) {
+        int p_idx = pref[i].p_idx, b = pref[i].band_idx; long long gp = gstart + p_idx;
+        if (gp >= (long long)active_start_frame && gp < (long long)active_start_frame + 100) {
+            double pv = 0, tv = 0, lv = 0, rv = 0, prv = 0;
+            for (int k = 0; k < bpeak_counts[b]; k++) if (bpeaks[b][k] == p_idx) { pv = envs[b][p_idx]; tv = bth[b][k]; lv = bl[b][k]; rv = br[b][k]; prv = bp[b][k]; break; }
+            PeakResultList* list = &result_out->peak_list;
+            PeakResult pr; double time = (double)gp * self->frame_duration_ms / 1000.0;
+            if (analyzer_process_peak(self, p_idx, (int)gp, b, time, envs[b], nf, aind, tot, pv, tv, lv, rv, prv, &pr,
+                                      list->qualifiers + list->num_qualifiers, MAX_CHUNK_QUALIFIERS - list->num_qualifiers)) {
+                if (list->num_peaks < MAX_PEAKS_PER_CHUNK) {
+                    pr.p_idx = (int)gp;
+                    pr.qualifier_start = list->num_qualifiers;
+                    list->num_qualifiers += pr.num_qualifiers;
+                    list->peaks[list->num_peaks++] = pr;
                 }
             }
         }
-        analyzer_update_metrics(self, active_start_frame + 100, &result_out->metrics);
-        for (int b = 0; b < MAX_BANDS; b++) result_out->metrics.band_midpoints[b] = (double)half_maxes[b];
-    }
-    for (int b = 0; b < MAX_BANDS; b++) {
-        free(envs[b]); free(sm_envs[b]); free(thrs[b]); if (bpeak_counts[b] > 0) { free(bpeaks[b]); free(bth[b]); free(bl[b]); free(br[b]); free(bp[b]); }
     }
-    free(pref); free(aind); return 1;
+    analyzer_update_metrics(self, active_start_frame + 100, &result_out->metrics);
+    for (int b = 0; b < MAX_BANDS; b++) result_out->metrics.band_midpoints[b] = (double)pc->half_maxes[b];
+    chunk_pending_release(pc);
+    return 1;
+}
+
+int analyzer_analyze_chunk(TransientAnalyzer* self, const float* y, int len, int sr, int buffer_start_frame, int active_start_frame, ChunkAnalysisResult* result_out) {
+    // Kept for API compatibility (the Python binding passes it); the analyzer tracks its own window
+    (void)buffer_start_frame;
+    analyzer_chunk_prepare(self, y, len, sr, active_start_frame);
+    return analyzer_chunk_commit(self, result_out);
 }
 
 static double* create_mel_filterbank(int sr, int n_fft, int n_mels) {
@@ -759,7 +1942,486 @@ static double* create_mel_filterbank(int sr, int n_fft, int n_mels) {
     free(mp); return f;
 }
 
+static void compute_mel_filter_ranges(const double* filters, int n_fft, int n_mels, int* starts, int* ends) {
+    int n_bins = n_fft / 2 + 1;
+    for (int j = 0; j < n_mels; j++) {
+        const double* row = filters + j * n_bins;
+        int lo = 0, hi = n_bins;
+        while (lo < n_bins && row[lo] == 0.0) lo++;
+        while (hi > lo && row[hi - 1] == 0.0) hi--;
+        starts[j] = lo; ends[j] = hi;
+    }
+}
+
+// Offline front end. The STFT and mel stage of a frame only depends on the audio around it, so
+// the analysis stream computes it a block of frames ahead on worker threads while the caller
+// runs the sequential clamp/flux/peak/accumulator stage over the block before.
+#define BATCH_BLOCK_FRAMES 2048
+#define BATCH_SLICE_FRAMES 64
+#define BATCH_MAX_THREADS 64
+#define STREAM_CHUNK_FRAMES 100    // Frames per 100 ms chunk
+
+typedef struct {
+    const TransientAnalyzer* tables; // Analyzer whose shared (read-only) tables the front end uses
+    const CtKernels* kern;
+    AudioView view;             // Audio starting at global sample view_start
+    long long view_start;
+    long long total_samples;    // End of the pushed audio; frames past it read zeros
+    int hop;
+    long long first_frame;      // First frame of the block
+    int count;                  // Frames in the block
+    double* mel;                // count x N_MELS unclamped mel dB, frame-major
+    double* frame_max;          // Per-frame maximum of mel
+    int profiling;              // Time the frames into the workers' profiles
+    volatile int next_slice;    // Next BATCH_SLICE_FRAMES slice to hand out
+} BatchBlock;
+
+typedef struct {
+    BatchBlock* block;
+    double* scratch;            // N_FFT + N_BINS doubles: re, im and the power spectrum
+    AnalyzerProfile profile;    // This worker's front end time while the block is profiled
+} BatchWorker;
+
+#if defined(_MSC_VER)
+#define BATCH_NEXT_SLICE(b) (_InterlockedExchangeAdd((volatile long*)&(b)->next_slice, 1))
+#else
+#define BATCH_NEXT_SLICE(b) (__atomic_fetch_add(&(b)->next_slice, 1, __ATOMIC_RELAXED))
+#endif
+
+static void batch_block_run(BatchBlock* blk, BatchWorker* w) {
+    double* re = w->scratch;
+    double* im = re + N_FFT / 2;
+    double* power = im + N_FFT / 2;
+    int slices = (blk->count + BATCH_SLICE_FRAMES - 1) / BATCH_SLICE_FRAMES;
+    for (int slice = BATCH_NEXT_SLICE(blk); slice < slices; slice = BATCH_NEXT_SLICE(blk)) {
+        int end = (slice + 1) * BATCH_SLICE_FRAMES;
+        if (end > blk->count) end = blk->count;
+        const TransientAnalyzer* tables = blk->tables;
+        for (int i = slice * BATCH_SLICE_FRAMES; i < end; i++) {
+            long long center = (blk->first_frame + i) * blk->hop;
+            double t0 = blk->profiling ? analyzer_profile_clock() : 0.0;
+            window_frame(blk->kern, tables->fft_window, re, im, center - N_FFT / 2, &blk->view, blk->view_start, blk->total_samples);
+            rfft_power(re, im, tables->fft_twiddle_re, tables->fft_twiddle_im, tables->fft_bitrev, power);
+            double t1 = blk->profiling ? analyzer_profile_clock() : 0.0;
+            blk->frame_max[i] = mel_power_db(tables, blk->kern, power, blk->mel + (size_t)i * N_MELS);
+            if (blk->profiling) {
+                double t2 = analyzer_profile_clock();
+                w->profile.seconds[CT_STAGE_FFT] += t1 - t0;
+                w->profile.seconds[CT_STAGE_MEL] += t2 - t1;
+                w->profile.calls[CT_STAGE_FFT]++;
+                w->profile.calls[CT_STAGE_MEL]++;
+                latency_histogram_add(&w->profile.latency[CT_STAGE_FFT], t1 - t0);
+                latency_histogram_add(&w->profile.latency[CT_STAGE_MEL], t2 - t1);
+            }
+        }
+    }
+}
+
+#if defined(_WIN32)
+typedef HANDLE batch_thread;
+static DWORD WINAPI batch_thread_main(LPVOID arg) {
+    BatchWorker* w = (BatchWorker*)arg;
+    batch_block_run(w->block, w);
+    return 0;
+}
+static int batch_thread_start(batch_thread* t, BatchWorker* w) {
+    *t = CreateThread(NULL, 0, batch_thread_main, w, 0, NULL);
+    return *t != NULL;
+}
+static void batch_thread_join(batch_thread t) { WaitForSingleObject(t, INFINITE); CloseHandle(t); }
+#else
+typedef pthread_t batch_thread;
+static void* batch_thread_main(void* arg) {
+    BatchWorker* w = (BatchWorker*)arg;
+    batch_block_run(w->block, w);
+    return NULL;
+}
+static int batch_thread_start(batch_thread* t, BatchWorker* w) { return pthread_create(t, NULL, batch_thread_main, w) == 0; }
+static void batch_thread_join(batch_thread t) { pthread_join(t, NULL); }
+#endif
+
+// Start computing blk on the worker threads (workers[1..]); workers[0] is the caller's scratch.
+// Returns the number of threads started, which may be fewer than asked if creation fails.
+static int batch_block_launch(BatchBlock* blk, long long first_frame, long long total_frames, BatchWorker* workers, batch_thread* threads, int num_threads) {
+    blk->first_frame = first_frame;
+    blk->count = (int)((total_frames - first_frame < BATCH_BLOCK_FRAMES) ? total_frames - first_frame : BATCH_BLOCK_FRAMES);
+    blk->next_slice = 0;
+    int started = 0;
+    for (int t = 1; t < num_threads; t++) {
+        workers[t].block = blk;
+        if (!batch_thread_start(&threads[started], &workers[t])) break;
+        started++;
+    }
+    return started;
+}
+
+// Help finish blk on the caller and wait for the workers
+static void batch_block_join(BatchBlock* blk, BatchWorker* workers, batch_thread* threads, int started) {
+    batch_block_run(blk, &workers[0]);
+    for (int t = 0; t < started; t++) batch_thread_join(threads[t]);
+}
+
+// Frames whose window lies inside the first total_samples samples
+static long long batch_frames_ready(long long total_samples, int hop) {
+    long long t = total_samples - N_FFT / 2;
+    return t < 0 ? 0 : t / hop + 1;
+}
+
+// Analysis of a stream pushed in pieces, one 100 ms chunk at a time as in the live objects. The
+// front end works a block ahead of the chunks; a chunk's frames reach the sink once the next chunk
+// can no longer overwrite them (the first two chunks' windows overlap by a frame).
+struct AnalysisStream {
+    TransientAnalyzer* a;
+    AnalysisSink sink;
+    const CtKernels* kern;
+    int sr;
+    int hop;
+    int step;                   // Samples per chunk
+    int threads;
+    int finished;
+
+    // Audio the front end may still read: global samples [audio_start, audio_start + audio_len)
+    float* audio;
+    long long audio_start;
+    int audio_len;
+    int audio_cap;
+    long long samples_in;
+
+    long long next_chunk;       // Start sample of the next chunk
+    long long next_block_frame; // First frame not yet given to a block
+    BatchBlock blocks[2];       // blocks[cur] is being consumed, blocks[1 - cur] is the block ahead
+    int cur;
+    int ahead;                  // Set while blocks[1 - cur] holds or is computing the next frames
+    int started;                // Worker threads running on the block ahead
+    BatchWorker workers[BATCH_MAX_THREADS];
+    batch_thread thread_ids[BATCH_MAX_THREADS];
+    double* mel_blocks;
+    double* scratch;
+
+    ChunkAnalysisResult* res;
+    AnalysisFrame* batch;       // Final frames not yet handed to the sink
+    int batch_count;
+    AnalysisFrame* chunk_frames; // The last chunk's frames, which the next chunk may still overwrite
+    long long chunk_first;
+    int chunk_count;
+    long long frame_limit;      // Frames past the end of the input are dropped once it is known
+};
+
+// Frames the stream can compute now: those whose window lies inside the pushed audio or, once
+// finished, every frame up to the end of the last (zero-padded) chunk
+static long long stream_frames_available(const AnalysisStream* s) {
+    if (!s->finished) return batch_frames_ready(s->samples_in, s->hop);
+    long long chunks = (s->samples_in + (int)(s->sr * 0.3) + s->step - 1) / s->step;
+    return batch_frames_ready(chunks * s->step, s->hop);
+}
+
+static void stream_launch(AnalysisStream* s, BatchBlock* blk, long long first_frame, long long available) {
+    blk->view.span[0] = s->audio;
+    blk->view.span_len[0] = s->audio_len;
+    blk->view_start = s->audio_start;
+    blk->total_samples = s->samples_in;
+    s->started = batch_block_launch(blk, first_frame, available, s->workers, s->thread_ids, s->threads);
+    s->next_block_frame = first_frame + blk->count;
+}
+
+// Finish blk and fold the workers' front end time into the analyzer's profile
+static void stream_join(AnalysisStream* s, BatchBlock* blk) {
+    batch_block_join(blk, s->workers, s->thread_ids, s->started);
+    s->started = 0;
+    if (!blk->profiling) return;
+    for (int t = 0; t < s->threads; t++) {
+        AnalyzerProfile* p = &s->workers[t].profile;
+        analyzer_profile_merge(&s->a->profile, p);
+        memset(p, 0, sizeof(AnalyzerProfile));
+    }
+}
+
+// The block holding frame f, the next frame to consume. Computes it if it is not ahead already
+// and queues the following block when a whole one (or the rest of a finished stream) is available.
+static BatchBlock* stream_block_for(AnalysisStream* s, long long f) {
+    BatchBlock* blk = &s->blocks[s->cur];
+    if (f >= blk->first_frame && f < blk->first_frame + blk->count) return blk;
+
+    long long available = stream_frames_available(s);
+    if (s->ahead) {
+        s->cur = 1 - s->cur;
+        s->ahead = 0;
+        blk = &s->blocks[s->cur];
+    } else {
+        stream_launch(s, blk, f, available);
+    }
+    stream_join(s, blk);
+
+    long long next = s->next_block_frame;
+    if (available - next >= BATCH_BLOCK_FRAMES || (s->finished && available > next)) {
+        stream_launch(s, &s->blocks[1 - s->cur], next, available);
+        s->ahead = 1;
+    }
+    return blk;
+}
+
+static void stream_flush_frames(AnalysisStream* s) {
+    if (s->batch_count > 0 && s->sink.frames) s->sink.frames(s->sink.ctx, s->batch, s->batch_count);
+    s->batch_count = 0;
+}
+
+// Hand the last chunk's frames before `upto` to the sink; the rest are overwritten by the next chunk
+static void stream_settle(AnalysisStream* s, long long upto) {
+    if (upto > s->frame_limit) upto = s->frame_limit;
+    for (int i = 0; i < s->chunk_count; i++) {
+        long long f = s->chunk_first + i;
+        if (f < 0 || f >= upto) continue;
+        s->batch[s->batch_count++] = s->chunk_frames[i];
+        if (s->batch_count == ANALYSIS_FRAME_BATCH) stream_flush_frames(s);
+    }
+    s->chunk_count = 0;
+}
+
+static void stream_chunk(AnalysisStream* s, long long last_t) {
+    TransientAnalyzer* a = s->a;
+    int hop = s->hop;
+    long long act_s = last_t - (int)(s->sr * 0.2);
+
+    long long ready = batch_frames_ready(last_t + s->step, hop);
+    for (long long f = a->total_frames_pushed; f < ready; f++) {
+        BatchBlock* blk = stream_block_for(s, f);
+        int i = (int)(f - blk->first_frame);
+        double t = profile_start(a);
+        push_frame_begin(a, f);
+        memcpy(a->mel_frames + a->mel_frame_cur * N_MELS, blk->mel + (size_t)i * N_MELS, sizeof(double) * N_MELS);
+        push_frame_finish(a, s->kern, f, blk->frame_max[i]);
+        profile_mark(a, CT_STAGE_FLUX, t);
+    }
+    a->total_samples_received = last_t + s->step;
+    analyzer_chunk_prepare_pushed(a, (int)(act_s / hop));
+    analyzer_chunk_commit(a, s->res);
+
+    const ChunkAnalysisResult* res = s->res;
+    const AnalyzerMetrics* m = &res->metrics;
+    stream_settle(s, act_s / hop);
+    s->chunk_first = act_s / hop;
+    s->chunk_count = STREAM_CHUNK_FRAMES;
+    for (int i = 0; i < STREAM_CHUNK_FRAMES; i++) {
+        AnalysisFrame* fr = &s->chunk_frames[i];
+        long long f = s->chunk_first + i;
+        fr->frame = (int)f;
+        fr->time = (float)f * (float)hop / (float)s->sr;
+        for (int b = 0; b < MAX_BANDS; b++) {
+            fr->envelope[b] = res->last_flux[b][i];
+            fr->dynamic_smoothing[b] = res->last_dynamic_smoothing[b][i];
+            fr->prominence[b] = res->last_prominence[b][i];
+            fr->prominence_avg[b] = (float)m->band_prominence_avgs[b];
+            fr->prominence_half_max[b] = (float)m->band_prominence_half_maxes[b];
+            fr->smoothing_avg[b] = (float)m->band_smoothing_avgs[b];
+            fr->flux_avg[b] = (float)m->band_flux_avgs[b];
+            fr->threshold[b] = (float)m->band_midpoints[b];
+            fr->lookback[b] = (float)m->band_lookbacks[b];
+            fr->avg_delta[b] = (float)m->band_avg_deltas[b];
+            fr->total_delta[b] = (float)m->band_total_deltas[b];
+            fr->p_count[b] = m->band_p_counts[b];
+        }
+        fr->rating = m->rating;
+        fr->std_dev = m->std_dev;
+        fr->mean = m->mean;
+        fr->contrast = m->contrast;
+        fr->stability_score = m->stability_score;
+        fr->highest_peak_ms = m->highest_peak_valid ? m->highest_peak_ms : -999.0;
+        fr->demarcation_line = m->demarcation_line;
+        fr->global_flux_avg = (float)m->global_flux_avg;
+        fr->global_smoothing_avg = (float)m->global_smoothing_avg;
+    }
+    if (res->peak_list.num_peaks > 0 && s->sink.peaks) s->sink.peaks(s->sink.ctx, res->peak_list.peaks, res->peak_list.num_peaks, res->peak_list.qualifiers);
+}
+
+// Run every chunk the pushed audio allows, then drop the audio no later frame reads
+static void stream_advance(AnalysisStream* s) {
+    long long end = s->finished ? s->samples_in + (int)(s->sr * 0.3) : s->samples_in - s->step + 1;
+    for (; s->next_chunk < end; s->next_chunk += s->step) stream_chunk(s, s->next_chunk);
+
+    // The block ahead reads the audio, so it has to be finished before the buffer moves
+    if (s->ahead && s->started) stream_join(s, &s->blocks[1 - s->cur]);
+    long long keep = s->next_block_frame * s->hop - N_FFT / 2;
+    if (keep > s->audio_start) {
+        long long drop = keep - s->audio_start;
+        if (drop > s->audio_len) drop = s->audio_len;
+        memmove(s->audio, s->audio + drop, sizeof(float) * (s->audio_len - drop));
+        s->audio_len -= (int)drop;
+        s->audio_start += drop;
+    }
+}
+
+AnalysisStream* analyzer_stream_create(int sr, int threads, const AnalysisSink* sink) {
+    if (threads < 1) threads = 1;
+    if (threads > BATCH_MAX_THREADS) threads = BATCH_MAX_THREADS;
+    AnalysisStream* s = (AnalysisStream*)calloc(1, sizeof(AnalysisStream));
+    if (!s) return NULL;
+    if (sink) s->sink = *sink;
+    s->kern = ct_kernels_get();
+    s->sr = sr;
+    s->hop = (int)(sr * 0.001);
+    s->step = s->hop * STREAM_CHUNK_FRAMES;
+    s->threads = threads;
+    s->frame_limit = LLONG_MAX;
+    s->a = analyzer_create(1.0, NULL, NULL, NULL, NULL);
+    s->mel_blocks = (double*)malloc(sizeof(double) * 2 * BATCH_BLOCK_FRAMES * (N_MELS + 1));
+    s->scratch = (double*)malloc(sizeof(double) * threads * (N_FFT + N_BINS));
+    s->res = (ChunkAnalysisResult*)malloc(sizeof(ChunkAnalysisResult));
+    s->batch = (AnalysisFrame*)malloc(sizeof(AnalysisFrame) * ANALYSIS_FRAME_BATCH);
+    s->chunk_frames = (AnalysisFrame*)malloc(sizeof(AnalysisFrame) * STREAM_CHUNK_FRAMES);
+    if (!s->a || !s->mel_blocks || !s->scratch || !s->res || !s->batch || !s->chunk_frames) {
+        analyzer_stream_destroy(s); return NULL;
+    }
+    analyzer_set_sample_rate(s->a, sr);
+    for (int k = 0; k < 2; k++) {
+        BatchBlock* blk = &s->blocks[k];
+        blk->tables = s->a;
+        blk->kern = s->kern;
+        blk->hop = s->hop;
+        blk->mel = s->mel_blocks + (size_t)k * BATCH_BLOCK_FRAMES * (N_MELS + 1);
+        blk->frame_max = blk->mel + (size_t)BATCH_BLOCK_FRAMES * N_MELS;
+    }
+    for (int t = 0; t < threads; t++) s->workers[t].scratch = s->scratch + (size_t)t * (N_FFT + N_BINS);
+    return s;
+}
+
+void analyzer_stream_set_profiling(AnalysisStream* s, int enabled) {
+    analyzer_set_profiling(s->a, enabled);
+    s->blocks[0].profiling = s->blocks[1].profiling = s->a->profiling;
+}
+
+void analyzer_stream_get_profile(const AnalysisStream* s, AnalyzerProfile* out) {
+    analyzer_get_profile(s->a, out);
+}
+
+int analyzer_stream_push(AnalysisStream* s, const float* y, int len) {
+    if (s->finished) return 0;
+    // Feed a block's worth at a time so the buffer stays a few blocks long whatever len is
+    int piece_max = BATCH_BLOCK_FRAMES * s->hop;
+    while (len > 0) {
+        int piece = len < piece_max ? len : piece_max;
+        if (s->audio_len + piece > s->audio_cap) {
+            int ncap = s->audio_len + piece + N_FFT;
+            float* na = (float*)realloc(s->audio, sizeof(float) * ncap);
+            if (!na) return 0;
+            s->audio = na;
+            s->audio_cap = ncap;
+        }
+        memcpy(s->audio + s->audio_len, y, sizeof(float) * piece);
+        s->audio_len += piece;
+        s->samples_in += piece;
+        y += piece;
+        len -= piece;
+        stream_advance(s);
+    }
+    return 1;
+}
+
+int analyzer_stream_finish(AnalysisStream* s) {
+    if (s->finished) return 0;
+    s->finished = 1;
+    s->frame_limit = (s->samples_in + s->hop - 1) / s->hop;
+    stream_advance(s);
+    stream_settle(s, s->frame_limit);
+    stream_flush_frames(s);
+    if (s->sink.finish) {
+        AnalysisSummary summary;
+        summary.num_frames = (int)s->frame_limit;
+        summary.max_peak_value = (float)analyzer_get_max_peak(s->a);
+        summary.min_score_seen = s->a->private_min_score_seen;
+        summary.max_score_seen = s->a->private_max_score_seen;
+        summary.tolerance = s->a->tolerance;
+        s->sink.finish(s->sink.ctx, &summary);
+    }
+    return 1;
+}
+
+void analyzer_stream_destroy(AnalysisStream* s) {
+    if (!s) return;
+    if (s->ahead && s->started) batch_block_join(&s->blocks[1 - s->cur], s->workers, s->thread_ids, s->started);
+    analyzer_destroy(s->a);
+    free(s->audio);
+    free(s->mel_blocks);
+    free(s->scratch);
+    free(s->res);
+    free(s->batch);
+    free(s->chunk_frames);
+    free(s);
+}
+
+// Sink that fills a FullAnalysisResult allocated for the whole signal
+typedef struct {
+    FullAnalysisResult* out;
+    PeakResult* pband[MAX_BANDS];
+    int pcap[MAX_BANDS];
+    Qualifier* qband[MAX_BANDS];
+    int qcap[MAX_BANDS];
+} FullResultSink;
+
+static void full_result_frames(void* ctx, const AnalysisFrame* frames, int count) {
+    FullAnalysisResult* r = ((FullResultSink*)ctx)->out;
+    for (int k = 0; k < count; k++) {
+        const AnalysisFrame* fr = &frames[k];
+        int f = fr->frame;
+        for (int b = 0; b < MAX_BANDS; b++) {
+            BandAnalysis* band = &r->bands[b];
+            band->envelope[f] = fr->envelope[b];
+            band->rolling_dynamic_smoothing[f] = fr->dynamic_smoothing[b];
+            band->rolling_prominence[f] = fr->prominence[b];
+            band->rolling_prominence_avg[f] = fr->prominence_avg[b];
+            band->rolling_prominence_half_max[f] = fr->prominence_half_max[b];
+            band->rolling_smoothing_avg[f] = fr->smoothing_avg[b];
+            band->rolling_flux_avg[f] = fr->flux_avg[b];
+            band->rolling_threshold[f] = fr->threshold[b];
+            band->rolling_lookback[f] = fr->lookback[b];
+            band->rolling_avg_delta[f] = fr->avg_delta[b];
+            band->rolling_total_delta[f] = fr->total_delta[b];
+            band->rolling_p_count[f] = fr->p_count[b];
+        }
+        r->ratings[f] = fr->rating;
+        r->std_devs[f] = fr->std_dev;
+        r->means[f] = fr->mean;
+        r->contrasts[f] = fr->contrast;
+        r->stability_scores[f] = fr->stability_score;
+        r->highest_peaks_ms[f] = fr->highest_peak_ms;
+        r->demarcation_lines[f] = fr->demarcation_line;
+        r->rolling_global_flux_avg[f] = fr->global_flux_avg;
+        r->rolling_global_smoothing_avg[f] = fr->global_smoothing_avg;
+    }
+}
+
+static void full_result_peaks(void* ctx, const PeakResult* peaks, int count, const Qualifier* qualifiers) {
+    FullResultSink* fs = (FullResultSink*)ctx;
+    for (int i = 0; i < count; i++) {
+        PeakResult pr = peaks[i]; int b = pr.band_idx;
+        BandAnalysis* band = &fs->out->bands[b];
+        if (band->num_peaks >= fs->pcap[b]) { int nc = fs->pcap[b] * 2; PeakResult* np = realloc(fs->pband[b], sizeof(PeakResult) * nc); if(np) { fs->pband[b] = np; fs->pcap[b] = nc; } else continue; }
+        if (band->num_qualifiers + pr.num_qualifiers > fs->qcap[b]) { int nc = fs->qcap[b] * 2 + pr.num_qualifiers; Qualifier* nq = realloc(fs->qband[b], sizeof(Qualifier) * nc); if(nq) { fs->qband[b] = nq; fs->qcap[b] = nc; } else pr.num_qualifiers = 0; }
+        // Move the peak's qualifiers from the chunk pool into the band's pool
+        memcpy(&fs->qband[b][band->num_qualifiers], &qualifiers[pr.qualifier_start], sizeof(Qualifier) * pr.num_qualifiers);
+        pr.qualifier_start = band->num_qualifiers;
+        fs->pband[b][band->num_peaks++] = pr;
+        band->num_qualifiers += pr.num_qualifiers;
+    }
+}
+
+static void full_result_finish(void* ctx, const AnalysisSummary* summary) {
+    FullAnalysisResult* r = ((FullResultSink*)ctx)->out;
+    r->max_peak_value = summary->max_peak_value;
+    r->min_score_seen = summary->min_score_seen;
+    r->max_score_seen = summary->max_score_seen;
+    r->tolerance = summary->tolerance;
+}
+
 int analyzer_batch_analyze(const float* y, int len, int sr, FullAnalysisResult* result_out) {
+    return analyzer_batch_analyze_threads(y, len, sr, 1, result_out);
+}
+
+int analyzer_batch_analyze_threads(const float* y, int len, int sr, int threads, FullAnalysisResult* result_out) {
+    return analyzer_batch_analyze_profiled(y, len, sr, threads, result_out, NULL);
+}
+
+int analyzer_batch_analyze_profiled(const float* y, int len, int sr, int threads, FullAnalysisResult* result_out, AnalyzerProfile* profile_out) {
+    if (profile_out) memset(profile_out, 0, sizeof(AnalyzerProfile));
     int hop = (int)(sr * 0.001), num_f = (len + hop - 1) / hop;
     result_out->num_frames = num_f; result_out->times = (float*)malloc(sizeof(float) * num_f); if(!result_out->times) return 0;
     for (int i = 0; i < num_f; i++) result_out->times[i] = (float)i * (float)hop / (float)sr;
@@ -787,60 +2449,28 @@ int analyzer_batch_analyze(const float* y, int len, int sr, FullAnalysisResult*
         result_out->bands[b].rolling_p_count = (int*)calloc(num_f, sizeof(int));
         result_out->bands[b].peaks = NULL;
         result_out->bands[b].num_peaks = 0;
+        result_out->bands[b].qualifiers = NULL;
+        result_out->bands[b].num_qualifiers = 0;
     }
-    TransientAnalyzer* a = analyzer_create(1.0, NULL, NULL, NULL, NULL); if(!a) return 0;
-    analyzer_set_sample_rate(a, sr); int step = hop * 100;
-    PeakResult* pband[MAX_BANDS]; int pcap[MAX_BANDS];
-    for(int b=0; b<MAX_BANDS; b++) { pcap[b] = 1024; pband[b] = (PeakResult*)malloc(sizeof(PeakResult) * pcap[b]); }
-    int flush_samples = (int)(sr * 0.3);
-    for (int last_t = 0; last_t < len + flush_samples; last_t += step) {
-        int act_s = last_t - (int)(sr * 0.2), win_s = act_s - (int)(sr * 15.0); if (win_s < 0) win_s = 0;
-        ChunkAnalysisResult* res = (ChunkAnalysisResult*)malloc(sizeof(ChunkAnalysisResult));
-        if (!res) { analyzer_destroy(a); return 0; }
-        float* push_ptr = (float*)calloc(step, sizeof(float));
-        if (last_t < len) {
-            int rem = len - last_t;
-            memcpy(push_ptr, y + last_t, sizeof(float) * (rem < step ? rem : step));
-        }
-        analyzer_analyze_chunk(a, push_ptr, step, sr, win_s / hop, act_s / hop, res);
-        free(push_ptr);
-        for (int b = 0; b < MAX_BANDS; b++) {
-            for (int i = 0; i < 100; i++) {
-                int f = act_s / hop + i;
-                if (f >= 0 && f < num_f) {
-                    result_out->bands[b].envelope[f] = res->last_flux[b][i];
-                    result_out->bands[b].rolling_dynamic_smoothing[f] = res->last_dynamic_smoothing[b][i];
-                    result_out->bands[b].rolling_prominence[f] = res->last_prominence[b][i];
-                    result_out->bands[b].rolling_prominence_avg[f] = (float)res->metrics.band_prominence_avgs[b];
-                    result_out->bands[b].rolling_prominence_half_max[f] = (float)res->metrics.band_prominence_half_maxes[b];
-                    result_out->bands[b].rolling_smoothing_avg[f] = (float)res->metrics.band_smoothing_avgs[b];
-                    result_out->bands[b].rolling_flux_avg[f] = (float)res->metrics.band_flux_avgs[b];
-                    result_out->bands[b].rolling_threshold[f] = (float)res->metrics.band_midpoints[b];
-                    result_out->bands[b].rolling_lookback[f] = (float)res->metrics.band_lookbacks[b];
-                    result_out->bands[b].rolling_avg_delta[f] = (float)res->metrics.band_avg_deltas[b];
-                    result_out->bands[b].rolling_total_delta[f] = (float)res->metrics.band_total_deltas[b];
-                    result_out->bands[b].rolling_p_count[f] = res->metrics.band_p_counts[b];
-                }
-            }
-        }
-        for (int i = 0; i < 100; i++) { int f = act_s / hop + i; if (f >= 0 && f < num_f) { result_out->ratings[f] = res->metrics.rating; result_out->std_devs[f] = res->metrics.std_dev; result_out->means[f] = res->metrics.mean; result_out->contrasts[f] = res->metrics.contrast; result_out->stability_scores[f] = res->metrics.stability_score; result_out->highest_peaks_ms[f] = res->metrics.highest_peak_valid ? res->metrics.highest_peak_ms : -999.0; result_out->demarcation_lines[f] = res->metrics.demarcation_line; result_out->rolling_global_flux_avg[f] = (float)res->metrics.global_flux_avg; result_out->rolling_global_smoothing_avg[f] = (float)res->metrics.global_smoothing_avg; } }
-        for (int i = 0; i < res->peak_list.num_peaks; i++) {
-            PeakResult* pr = &res->peak_list.peaks[i]; int b = pr->band_idx;
-            if (result_out->bands[b].num_peaks >= pcap[b]) { pcap[b] *= 2; PeakResult* np = realloc(pband[b], sizeof(PeakResult) * pcap[b]); if(np) pband[b] = np; }
-            memcpy(&pband[b][result_out->bands[b].num_peaks++], pr, sizeof(PeakResult));
-        }
-        free(res);
-    }
-    result_out->max_peak_value = (float)analyzer_get_max_peak(a);
-    result_out->min_score_seen = a->private_min_score_seen;
-    result_out->max_score_seen = a->private_max_score_seen;
-    result_out->tolerance = a->tolerance;
+    FullResultSink fs;
+    fs.out = result_out;
+    for(int b=0; b<MAX_BANDS; b++) { fs.pcap[b] = 1024; fs.pband[b] = (PeakResult*)malloc(sizeof(PeakResult) * fs.pcap[b]); }
+    for(int b=0; b<MAX_BANDS; b++) { fs.qcap[b] = 4096; fs.qband[b] = (Qualifier*)malloc(sizeof(Qualifier) * fs.qcap[b]); }
+    AnalysisSink sink = { &fs, full_result_frames, full_result_peaks, full_result_finish };
+    AnalysisStream* stream = analyzer_stream_create(sr, threads, &sink);
+    if (stream && profile_out) analyzer_stream_set_profiling(stream, 1);
+    int ok = stream && analyzer_stream_push(stream, y, len) && analyzer_stream_finish(stream);
+    if (stream && profile_out) analyzer_stream_get_profile(stream, profile_out);
+    analyzer_stream_destroy(stream);
     for(int b=0; b<MAX_BANDS; b++) {
         int n = result_out->bands[b].num_peaks; result_out->bands[b].peaks = (PeakResult*)malloc(sizeof(PeakResult) * n);
-        if(result_out->bands[b].peaks) memcpy(result_out->bands[b].peaks, pband[b], sizeof(PeakResult) * n);
-        free(pband[b]);
+        if(result_out->bands[b].peaks) memcpy(result_out->bands[b].peaks, fs.pband[b], sizeof(PeakResult) * n);
+        free(fs.pband[b]);
+        int nq = result_out->bands[b].num_qualifiers; result_out->bands[b].qualifiers = (Qualifier*)malloc(sizeof(Qualifier) * (nq > 0 ? nq : 1));
+        if(result_out->bands[b].qualifiers) memcpy(result_out->bands[b].qualifiers, fs.qband[b], sizeof(Qualifier) * nq);
+        free(fs.qband[b]);
     }
-    analyzer_destroy(a); return 1;
+    return ok;
 }
 
 void analyzer_free_analysis(FullAnalysisResult* result) {
@@ -863,6 +2493,7 @@ void analyzer_free_analysis(FullAnalysisResult* result) {
         free(result->bands[i].rolling_total_delta);
         free(result->bands[i].rolling_p_count);
         free(result->bands[i].peaks);
+        free(result->bands[i].qualifiers);
     }
     free(result->ratings);
     free(result->std_devs);
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #define BUFFER_LEN 5001
 #define MAX_BANDS 4
@@ -14,6 +15,15 @@ typedef struct {
     double orig_ms;
 } Qualifier;
 
+// Compact record of a snapshot that was added to the accumulated buffer. The snapshot itself is
+// not stored: snapshot[i] == norm * envelope[p_idx - 5000 + i] for i >= src_offset (0 before that),
+// so it is rebuilt from the analyzer's envelope history when it has to be subtracted again.
+typedef struct {
+    int p_idx;          // Global frame of the peak
+    int src_offset;     // First snapshot index that was backed by envelope data
+    double norm;        // Scale applied to the envelope when it was accumulated
+} SnapshotDescriptor;
+
 typedef struct {
     int p_idx;
     int band_idx;
@@ -26,15 +36,16 @@ typedef struct {
     double right_min;
     double prominence;
     int num_qualifiers;
-    Qualifier qualifiers[MAX_QUALIFIERS];
-    double snapshot[BUFFER_LEN];
+    int qualifier_start;        // Index of the first qualifier in the owning list's pool
+    SnapshotDescriptor snapshot; // Materialize with analyzer_peak_snapshot or peak_snapshot_from_envelope (norm 0 if skipped)
 } PeakResult;
 
-typedef struct SnapshotEntry {
-    int p_idx;
-    double snapshot[BUFFER_LEN];
-    struct SnapshotEntry* next;
-} SnapshotEntry;
+typedef struct {
+    SnapshotDescriptor* items;  // Ring of descriptors ordered by p_idx
+    int head;
+    int count;
+    int cap;
+} SnapshotQueue;
 
 typedef struct {
     double std_dev;
@@ -63,8 +74,131 @@ typedef struct {
 
 #define MAX_PEAKS_PER_CHUNK 64
 
+#define ACC_BLOCK 16
+#define ACC_BLOCKS ((BUFFER_LEN + ACC_BLOCK - 1) / ACC_BLOCK)
+
+// Running statistics of accumulated_buffer[0, BUFFER_LEN - 99) plus per-block maxima of the whole
+// buffer for range-max queries. Every pass that adds or subtracts a snapshot refreshes them in index
+// order, so they equal a fresh scan and readers never rescan the buffer. All zeros is the state of a
+// zeroed buffer.
+typedef struct {
+    double sum;
+    double sum_sq;
+    double max;
+    double min;
+    int max_idx;        // First index holding max
+    double block_max[ACC_BLOCKS];
+    unsigned char block_max_off[ACC_BLOCKS];  // Offset of the first block_max within its block
+} AccumulatorStats;
+
+// Histogram of detected bar lengths (ms). Counts only grow between clears, so the best bins and the
+// stability score are maintained as each length is added.
+typedef struct {
+    int counts[BUFFER_LEN];
+    double total;       // Sum of all counts
+    int distinct;       // Number of bar lengths seen at least once
+    int best_weighted;  // Bar length maximising count * length / 5000 (-1 when empty)
+    int best_count;     // Bar length with the highest count (-1 when empty)
+} BarLengthHistogram;
+
+void bar_histogram_clear(BarLengthHistogram* h);
+// Add n occurrences of bar_length (0-5000)
+void bar_histogram_add(BarLengthHistogram* h, int bar_length, int n);
+// Best bar length by weighted or plain count, 0 when the histogram is empty
+int bar_histogram_best(const BarLengthHistogram* h, int weighted);
+// Average count per distinct bar length
+double bar_histogram_stability(const BarLengthHistogram* h);
+
+// How analyzer_update_metrics derives the 15 s band averages
+#define CT_METRICS_FULL 0           // Rescan the caches on every update (reference path)
+#define CT_METRICS_INCREMENTAL 1    // Windowed running sums and a max tree, resynchronised once per window
+#define CT_METRICS_VALIDATE 2       // Compute both, report the full scan and record the largest deviation
+
 typedef void (*ct_lock_func)(void* lock_obj);
 
+// Hot-path stages timed while profiling is enabled (analyzer_set_profiling)
+typedef enum {
+    CT_STAGE_FFT,           // Windowing and the real FFT
+    CT_STAGE_MEL,           // Mel filterbank and dB conversion
+    CT_STAGE_FLUX,          // Band flux, smoothing and cache updates
+    CT_STAGE_PEAKS,         // Peak picking, prominence and qualifiers
+    CT_STAGE_ACCUMULATOR,   // Adding and expiring snapshots in the accumulated buffer
+    CT_STAGE_METRICS,       // analyzer_update_metrics without the snapshot expiry
+    CT_NUM_STAGES
+} AnalyzerStage;
+
+// Log2 latency histogram: bucket 0 counts sections under 1 us, bucket b (b >= 1) sections of
+// [2^(b-1), 2^b) us, and the last bucket everything from about a second up
+#define CT_LATENCY_BUCKETS 22
+
+typedef struct {
+    long long counts[CT_LATENCY_BUCKETS];
+    long long total;
+    double max_seconds;
+} LatencyHistogram;
+
+void latency_histogram_add(LatencyHistogram* h, double seconds);
+void latency_histogram_merge(LatencyHistogram* dst, const LatencyHistogram* src);
+// Latency in seconds below which a fraction q (0..1) of the sections fell, interpolated within the
+// bucket and capped at the largest one seen. 0 for an empty histogram.
+double latency_histogram_quantile(const LatencyHistogram* h, double q);
+
+typedef struct {
+    double seconds[CT_NUM_STAGES];  // Wall time spent in each stage
+    long long calls[CT_NUM_STAGES]; // Timed sections per stage (per frame for the front end stages)
+    LatencyHistogram latency[CT_NUM_STAGES]; // Duration of each of those sections
+} AnalyzerProfile;
+
+typedef struct { int p_idx; int band_idx; } PeakRef;
+
+// Detected peaks are at least PEAK_MIN_SPACING frames apart, so one band of the 15201 frame cache
+// never holds more than 77 of them
+#define PEAK_MIN_SPACING 200
+#define CHUNK_BAND_PEAKS 78
+
+// Audio owned by the caller as up to two contiguous spans, oldest first. A capture ring that wraps
+// is viewed as its tail followed by its head.
+typedef struct {
+    const float* span[2];
+    int span_len[2];
+} AudioView;
+
+// Work carried from analyzer_chunk_prepare to analyzer_chunk_commit. Prepare only touches the
+// analyzer's own state, so several analyzers sharing a buffer can prepare concurrently; everything
+// that reads or writes the shared buffer waits for commit.
+typedef struct {
+    int prepared;               // A prepared chunk is waiting for commit
+    int active_start_frame;
+    int nf;                     // Frames in the cache views
+    long long gstart;           // Global frame of envs[b][0]
+    const float* envs[MAX_BANDS]; // Contiguous views into the mirrored flux cache
+    float thresholds[MAX_BANDS];
+    float half_maxes[MAX_BANDS];
+    int peaks[MAX_BANDS][CHUNK_BAND_PEAKS];
+    int peak_counts[MAX_BANDS];
+    float peak_thresholds[MAX_BANDS][CHUNK_BAND_PEAKS];
+    float peak_left_mins[MAX_BANDS][CHUNK_BAND_PEAKS];
+    float peak_right_mins[MAX_BANDS][CHUNK_BAND_PEAKS];
+    float peak_prominences[MAX_BANDS][CHUNK_BAND_PEAKS];
+    PeakRef sorted_peaks[MAX_BANDS * CHUNK_BAND_PEAKS]; // All peaks ordered by frame
+    int all_peaks[MAX_BANDS * CHUNK_BAND_PEAKS];        // All peak frames in band order
+    int total_peaks;
+    double band_lookbacks[MAX_BANDS];
+    double band_avg_deltas[MAX_BANDS];
+    double band_total_deltas[MAX_BANDS];
+    int band_p_counts[MAX_BANDS];
+    float last_flux[MAX_BANDS][100];
+    float last_dynamic_smoothing[MAX_BANDS][100];
+    float last_prominence[MAX_BANDS][100];
+
+    // Snapshots already popped from the queues whose subtraction from the accumulated buffer is
+    // still due. Their envelope history stays protected until they are subtracted.
+    SnapshotDescriptor* expired;
+    int* expired_bands;
+    int expired_count;
+    int expired_cap;
+} ChunkPending;
+
 typedef struct {
     double accumulated_buffer[BUFFER_LEN];
     double max_peak;
@@ -72,11 +206,18 @@ typedef struct {
     double max_score_seen;
     double total_score_sum;
     int score_count;
+    AccumulatorStats stats;
 } SharedTransientBuffer;
 
+// A chunk's 100 ms active window holds at most one peak per band, each with at most about a
+// hundred qualifiers, so the shared pool never fills in practice
+#define MAX_CHUNK_QUALIFIERS (MAX_BANDS * MAX_QUALIFIERS)
+
 typedef struct {
     PeakResult peaks[MAX_PEAKS_PER_CHUNK];
     int num_peaks;
+    Qualifier qualifiers[MAX_CHUNK_QUALIFIERS]; // Pool for the peaks' qualifiers
+    int num_qualifiers;
 } PeakResultList;
 
 typedef struct {
@@ -94,6 +235,7 @@ typedef struct {
     ct_lock_func unlock_func;
 
     double private_accumulated_buffer[BUFFER_LEN];
+    AccumulatorStats private_stats;
     double buffer_times[BUFFER_LEN];
     double private_max_peak;
 
@@ -109,25 +251,45 @@ typedef struct {
     int lookback_p_count[MAX_BANDS];
 
     // Bar Length History for Stability
-    int bar_length_counts[5001];
+    BarLengthHistogram bar_lengths;
+    int last_bar_length;        // Bar length recorded by the last analyzer_update_metrics, -1 if none
 
-    // Snapshots tracking (queue per band)
-    SnapshotEntry* snapshot_heads[MAX_BANDS];
-    SnapshotEntry* snapshot_tails[MAX_BANDS];
+    // Snapshots tracking (queue per band) and the envelope history they are rebuilt from
+    SnapshotQueue snapshot_queues[MAX_BANDS];
+    float* snapshot_history;    // MAX_BANDS x snapshot_history_cap ring indexed by global frame
+    int snapshot_history_cap;
 
     double frame_duration_ms;
 
     // Incremental Cache State
-    double* mel_spectrogram;    // Mel bands cache
-    float* flux_envelopes;      // Flux cache per band
+    double* mel_frames;         // Current and previous mel frames (2 x N_MELS, frame-major)
+    int mel_frame_cur;          // Which half of mel_frames holds the current frame
+    double* mel_spectrogram;    // Optional mel bands history (N_MELS x CACHE_SIZE), see analyzer_set_mel_history
+    float* flux_envelopes;      // Flux cache per band, stored twice over so any window is contiguous
     float* dynamic_smoothings;  // Dynamic smoothing cache per band
     float* prominence_envelopes; // Prominence cache per band
+    float* smoothing_index;     // Range max/min index over dynamic_smoothings for the prominence search
     float smoothing_states[MAX_BANDS];
     double smoothing_avgs[MAX_BANDS];
-    double* mel_filters;        // Pre-calculated filters
-    double* fft_window;         // Pre-calculated window
+    struct CtSpectralTables* tables; // Shared read-only tables for the current sample rate
+    const double* mel_filters;  // The tables' filters
+    const int* mel_filter_starts; // First nonzero bin of each mel filter
+    const int* mel_filter_ends; // One past the last nonzero bin of each mel filter
+    const double* fft_window;   // The tables' window
     int cache_write_ptr;
     int cache_count;
+
+    // 15 s band average window (see analyzer_set_metrics_mode)
+    int metrics_mode;
+    int window_target;          // 15 s in frames
+    int window_len;             // Newest frames currently inside the window
+    int window_resync;          // Frames left until the running sums are recomputed from the caches
+    double window_prom_sums[MAX_BANDS];
+    double window_smooth_sums[MAX_BANDS];
+    double window_flux_sums[MAX_BANDS];
+    float* prominence_index;    // Range index over prominence_envelopes (non-full modes only)
+    double metrics_max_deviation; // Largest relative difference seen in CT_METRICS_VALIDATE
+
     int sample_rate;
     double max_mel_db;          // Rolling max mel energy for clamping
 
@@ -135,12 +297,26 @@ typedef struct {
     int overlap_len;
     float* combined_scratch;    // Reuse to avoid realloc
     int combined_scratch_cap;
+    double* lane_scratch;       // Interleaved FFT buffers when this analyzer leads analyzer_push_audio_lanes
     double* fft_real;           // Reuse to avoid realloc
     double* fft_imag;
+    const double* fft_twiddle_re; // Real-input FFT twiddles, from the shared tables
+    const double* fft_twiddle_im;
+    const int* fft_bitrev;      // Bit-reversal permutation for the half-length complex FFT
+    double* power_spectrum;     // Power spectrum of the current frame
 
     long long total_frames_pushed; // To track global frame index alignment
     long long total_samples_received;
     double tolerance;
+
+    int profiling;
+    AnalyzerProfile profile;
+
+    // Degraded operation, see analyzer_set_frame_stride and analyzer_set_snapshot_floor
+    int frame_stride;
+    double snapshot_floor;
+
+    ChunkPending pending;
 } TransientAnalyzer;
 
 TransientAnalyzer* analyzer_create(double max_peak_value, SharedTransientBuffer* shared_buffer, void* lock_obj, ct_lock_func lock_func, ct_lock_func unlock_func);
@@ -148,7 +324,41 @@ void analyzer_destroy(TransientAnalyzer* self);
 void analyzer_clear(TransientAnalyzer* self);
 void analyzer_set_sample_rate(TransientAnalyzer* self, int sr);
 double analyzer_get_max_peak(TransientAnalyzer* self);
-
+// Keep (1) or drop (0) the full mel spectrogram history. Flux only needs the previous frame, so
+// the history is off by default and only written when a consumer asks for it. Returns 0 on allocation failure.
+int analyzer_set_mel_history(TransientAnalyzer* self, int enabled);
+// Select CT_METRICS_FULL, CT_METRICS_INCREMENTAL or CT_METRICS_VALIDATE. Returns 0 on allocation failure.
+int analyzer_set_metrics_mode(TransientAnalyzer* self, int mode);
+// Heap bytes held by this analyzer, the struct included. The shared spectral tables are not counted here.
+size_t analyzer_memory_usage(const TransientAnalyzer* self);
+// Heap bytes of every spectral table set alive in the process, each counted once however many analyzers share it
+size_t analyzer_shared_tables_usage(void);
+// Time the hot-path stages into the analyzer's profile. Off by default; the cost when off is a branch per stage.
+// In a lane group the shared FFT and mel work is charged to the first analyzer.
+void analyzer_set_profiling(TransientAnalyzer* self, int enabled);
+void analyzer_get_profile(const TransientAnalyzer* self, AnalyzerProfile* out);
+void analyzer_reset_profile(TransientAnalyzer* self);
+// Add src's times, counts and histograms into dst, e.g. to total the analyzers of several channels
+void analyzer_profile_merge(AnalyzerProfile* dst, const AnalyzerProfile* src);
+// The monotonic clock the profile is kept in, in seconds, for hosts timing their own sections
+double analyzer_profile_clock(void);
+// Short lowercase name of an AnalyzerStage ("fft", "mel", ...)
+const char* analyzer_stage_name(int stage);
+// Degraded operation for hosts that fall behind the audio. With a stride above 1 (at most
+// CT_MAX_FRAME_STRIDE) the live push paths only compute the spectrum of every stride-th frame and
+// interpolate the band flux of the frames in between, so up to stride - 1 frames wait for the next
+// push. 1, the default, computes every frame. Lane groups fall back to one analyzer at a time.
+#define CT_MAX_FRAME_STRIDE 16
+void analyzer_set_frame_stride(TransientAnalyzer* self, int stride);
+// Skip the accumulated buffer snapshot of peaks on bands whose 15 s smoothing average is below
+// floor times the loudest band's. Those peaks are still scored and reported, with a snapshot norm
+// of 0. 0, the default, keeps every snapshot.
+void analyzer_set_snapshot_floor(TransientAnalyzer* self, double floor);
+// Bar length to report from this analyzer's histogram
+int analyzer_get_bar_length(TransientAnalyzer* self, int weighted);
+
+// env_ptr must be the band's linearized envelope cache (env_ptr[p_idx] is global frame global_p_idx),
+// as analyzer_analyze_chunk passes it: the snapshot is later rebuilt from the same frames on expiry.
 int analyzer_process_peak(TransientAnalyzer* self,
                           int p_idx,
                           int global_p_idx,
@@ -163,7 +373,14 @@ int analyzer_process_peak(TransientAnalyzer* self,
                           double left_min,
                           double right_min,
                           double prominence,
-                          PeakResult* result_out);
+                          PeakResult* result_out,
+                          Qualifier* qualifiers_out,
+                          int max_qualifiers);
+// Rebuild a peak's snapshot (BUFFER_LEN values) from the analyzer's envelope history. Returns 0 once
+// the history no longer reaches back to it, which is safe to assume until its snapshot expires.
+int analyzer_peak_snapshot(const TransientAnalyzer* self, const PeakResult* peak, double* out);
+// The same from a full band envelope indexed by global frame, such as BandAnalysis.envelope
+void peak_snapshot_from_envelope(const PeakResult* peak, const float* envelope, int envelope_len, double* out);
 
 bool analyzer_cleanup_snapshots(TransientAnalyzer* self, int frame);
 void analyzer_update_metrics(TransientAnalyzer* self, int frame, AnalyzerMetrics* metrics_out);
@@ -178,6 +395,35 @@ int analyzer_analyze_chunk(TransientAnalyzer* self,
                            ChunkAnalysisResult* result_out);
 
 void analyzer_push_audio(TransientAnalyzer* self, const float* y, int len, int sr);
+// Push the newest len samples of a view without copying them. The view must also hold the
+// analyzer_view_history samples before them, which frames straddling the previous push still read.
+// An analyzer fed through views keeps no overlap of its own, so feed it through one entry point only.
+void analyzer_push_audio_view(TransientAnalyzer* self, const AudioView* view, int len, int sr);
+int analyzer_view_history(const TransientAnalyzer* self);
+// View count samples of a ring buffer starting at index start, splitting where the ring wraps
+void audio_view_from_ring(AudioView* view, const float* ring, int ring_size, int start, int count);
+// analyzer_push_audio_view for up to CT_LANES analyzers at once (views[l] goes to analyzers[l]).
+// When they share a sample rate and stream position, the FFT and mel filterbank run once for all of
+// them with one channel per SIMD lane; the results are identical to pushing each analyzer on its own.
+void analyzer_push_audio_lanes(TransientAnalyzer** analyzers, const AudioView* views, int count, int len, int sr);
+
+// analyzer_analyze_chunk split in two: prepare does the per-channel work (expiry bookkeeping, audio
+// push, peak detection and the per-frame prominence) and commit applies it to the shared buffer
+// (snapshot subtraction, peak scoring and metrics). Preparing several analyzers in parallel and then
+// committing them in channel order gives the same results as analyzing them one after another.
+int analyzer_chunk_prepare(TransientAnalyzer* self,
+                           const float* y,
+                           int len,
+                           int sr,
+                           int active_start_frame);
+// analyzer_chunk_prepare for an analyzer whose hop was already pushed (see analyzer_push_audio_lanes)
+int analyzer_chunk_prepare_pushed(TransientAnalyzer* self, int active_start_frame);
+// Expiry bookkeeping and audio push only, for channels that are paused
+void analyzer_chunk_prepare_push(TransientAnalyzer* self, const float* y, int len, int sr, int active_start_frame);
+// analyzer_chunk_prepare_push without the push
+void analyzer_chunk_skip(TransientAnalyzer* self, int active_start_frame);
+// Returns 0 (after still applying expired snapshots) when there is no prepared chunk
+int analyzer_chunk_commit(TransientAnalyzer* self, ChunkAnalysisResult* result_out);
 
 // Full analysis structures
 typedef struct {
@@ -195,6 +441,8 @@ typedef struct {
     int* rolling_p_count;
     PeakResult* peaks;
     int num_peaks;
+    Qualifier* qualifiers;      // Pool indexed by PeakResult.qualifier_start
+    int num_qualifiers;
 } BandAnalysis;
 
 typedef struct {
@@ -220,6 +468,77 @@ typedef struct {
 } FullAnalysisResult;
 
 int analyzer_batch_analyze(const float* y, int len, int sr, FullAnalysisResult* result_out);
+// analyzer_batch_analyze with the STFT and mel front end spread over `threads` threads (1 runs
+// everything on the caller). The result is identical for any thread count.
+int analyzer_batch_analyze_threads(const float* y, int len, int sr, int threads, FullAnalysisResult* result_out);
+// analyzer_batch_analyze_threads with per-stage profiling on, summed into profile_out (NULL leaves it
+// off). Profiling only adds timer reads; the result is the same.
+int analyzer_batch_analyze_profiled(const float* y, int len, int sr, int threads, FullAnalysisResult* result_out, AnalyzerProfile* profile_out);
+
+// Streaming offline analysis. Audio is pushed in pieces of any length and results are handed to a
+// sink as they become final, so memory stays constant however long the input is. A stream fed a
+// whole signal produces exactly what analyzer_batch_analyze does.
+#define ANALYSIS_FRAME_BATCH 1024
+
+// One frame of the per-frame output: the row form of FullAnalysisResult's arrays
+typedef struct {
+    int frame;
+    float time;
+    float envelope[MAX_BANDS];
+    float dynamic_smoothing[MAX_BANDS];
+    float prominence[MAX_BANDS];
+    float prominence_avg[MAX_BANDS];
+    float prominence_half_max[MAX_BANDS];
+    float smoothing_avg[MAX_BANDS];
+    float flux_avg[MAX_BANDS];
+    float threshold[MAX_BANDS];
+    float lookback[MAX_BANDS];
+    float avg_delta[MAX_BANDS];
+    float total_delta[MAX_BANDS];
+    int p_count[MAX_BANDS];
+    double rating;
+    double std_dev;
+    double mean;
+    double contrast;
+    double stability_score;
+    double highest_peak_ms;     // -999 when there is none
+    double demarcation_line;
+    float global_flux_avg;
+    float global_smoothing_avg;
+} AnalysisFrame;
+
+typedef struct {
+    int num_frames;
+    float max_peak_value;
+    double min_score_seen;
+    double max_score_seen;
+    double tolerance;
+} AnalysisSummary;
+
+// Receives a stream's output on the pushing thread. Callbacks may be NULL.
+typedef struct {
+    void* ctx;
+    // Frames in order, at most ANALYSIS_FRAME_BATCH per call
+    void (*frames)(void* ctx, const AnalysisFrame* frames, int count);
+    // The peaks of one 100 ms chunk; a peak's qualifiers start at qualifiers[peak.qualifier_start]
+    void (*peaks)(void* ctx, const PeakResult* peaks, int count, const Qualifier* qualifiers);
+    // Once, from analyzer_stream_finish, after the last frames
+    void (*finish)(void* ctx, const AnalysisSummary* summary);
+} AnalysisSink;
+
+typedef struct AnalysisStream AnalysisStream;
+
+// threads is as for analyzer_batch_analyze_threads. The sink is copied.
+AnalysisStream* analyzer_stream_create(int sr, int threads, const AnalysisSink* sink);
+// Returns 0 on allocation failure or after analyzer_stream_finish
+int analyzer_stream_push(AnalysisStream* stream, const float* y, int len);
+// Ends the input: analyzes the tail and delivers the remaining frames and the summary
+int analyzer_stream_finish(AnalysisStream* stream);
+void analyzer_stream_destroy(AnalysisStream* stream);
+// Profile the stream's analyzer and its front end threads; enable before the first push. Front end
+// time is summed over threads, so it can exceed the wall time of the analysis.
+void analyzer_stream_set_profiling(AnalysisStream* stream, int enabled);
+void analyzer_stream_get_profile(const AnalysisStream* stream, AnalyzerProfile* out);
 void analyzer_free_analysis(FullAnalysisResult* result);
 
 #endif
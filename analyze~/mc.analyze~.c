@@ -4,7 +4,9 @@
 #include "ext_path.h"
 #include "z_dsp.h"
 #include "cumulative_transience.h"
+#include "ct_kernels.h"
 #include "../shared/async_worker.h"
+#include "../shared/thread_pool.h"
 #include "../shared/visualize.h"
 #include <windows.h>
 #include <stdarg.h>
@@ -16,7 +18,19 @@
 
 #define MAX_AUDIO_SECONDS 60
 #define ANALYSIS_HOP_MS 100
+// @lowmem capture ring: the 15 s analysis window, the 200 ms active region and one hop, plus the
+// FFT overlap the analyzers read back before each hop
+#define LOWMEM_AUDIO_SECONDS (15.0 + 0.2 + ANALYSIS_HOP_MS / 1000.0)
+#define LOWMEM_OVERLAP_SAMPLES 2048
 #define MAX_ANALYZE_CHANNELS 1024
+// Degradation governor (@governor): tiers climbed as the worker's backlog reaches @governor_tiers
+#define GOVERNOR_TIERS 3
+#define GOVERNOR_TIER_NO_VISUALIZE 1    // Skip the visualizer packets
+#define GOVERNOR_TIER_STRIDE 2          // Also compute the spectrum of every GOVERNOR_FRAME_STRIDE-th frame only
+#define GOVERNOR_TIER_SNAPSHOTS 3       // Also skip the snapshots of peaks on low-energy bands
+#define GOVERNOR_FRAME_STRIDE 4
+#define GOVERNOR_SNAPSHOT_FLOOR 0.25    // Bands under a quarter of the loudest band's average
+#define MAX_ANALYZE_THREADS 64
 
 typedef struct _analyze_shared_buffer {
     t_object ob;
@@ -63,6 +77,34 @@ void* analyze_shared_buffer_new(t_symbol* s, long argc, t_atom* argv) {
     return x;
 }
 
+// Sections of the worker's hop loop, timed on every hop for the stats message. The per-channel
+// sections are summed over the channels of the hop.
+enum {
+    HOP_STAGE_PUSH,         // Pushing every channel's hop through the STFT and preparing its chunk
+    HOP_STAGE_ANALYZE,      // Committing the chunks to the shared buffer
+    HOP_STAGE_PEAKS,        // Emitting the chunks' peaks
+    HOP_STAGE_METRICS,      // Metrics update, bar length and metrics output
+    HOP_STAGE_VISUALIZE,    // Building and sending the visualizer packets
+    HOP_STAGE_TOTAL,        // The whole hop
+    NUM_HOP_STAGES
+};
+
+static const char* const hop_stage_names[NUM_HOP_STAGES] = { "push", "analyze", "peaks", "metrics", "visualize", "hop" };
+
+typedef struct _mc_analyze_stats {
+    double seconds[NUM_HOP_STAGES];
+    LatencyHistogram stages[NUM_HOP_STAGES];
+    LatencyHistogram lag;           // current_sample_count - last_analysis_frame at the start of each hop
+    long long hops;
+    long long late_hops;            // Hops that took longer than ANALYSIS_HOP_MS to analyze
+    long long wakeups;              // Worker tasks that found at least one hop waiting
+    long long backlog_sum;          // Hops waiting at those wakeups
+    long long backlog_max;
+    long long tier_hops[GOVERNOR_TIERS + 1]; // Hops analyzed at each governor tier
+    long channels;                  // Channels analyzed in the last hop
+    AnalyzerProfile analyzer;       // The analyzers' own stages summed over the channels, while @profile is on
+} t_mc_analyze_stats;
+
 typedef struct _mc_analyze {
     t_pxobject obj;
 
@@ -81,7 +123,15 @@ typedef struct _mc_analyze {
     t_symbol* group_name;
     long weighted_bar;
     double tolerance;
+    long metrics_mode;
+    long threads;
+    long lowmem;
     long visualize_enabled;
+    long profile;
+    long stats_interval;
+    long governor;
+    long governor_tiers[GOVERNOR_TIERS];
+    int governor_tier;          // Tier in force, only changed by the worker
 
     // Multi-channel Channel Count
     long num_audio_chans;
@@ -119,6 +169,8 @@ typedef struct _mc_analyze {
 
     // Async Worker
     t_async_worker* worker;
+    t_async_trigger* trigger;   // Preallocated analysis task, armed from perform64
+    t_thread_pool* pool;        // Prepares channel chunks in parallel when @threads > 1
     t_critical lock;
     int invalidated;
     int pending_analysis;
@@ -126,16 +178,45 @@ typedef struct _mc_analyze {
 
     char paused_channels[MAX_ANALYZE_CHANNELS + 1];
 
+    // Bar length histogram summed over the unpaused channels. New lengths are added as each channel
+    // records them; it is only rebuilt from the analyzers when the set of channels changes.
+    BarLengthHistogram* combined_bar_lengths;
+    char combined_paused_mask[MAX_ANALYZE_CHANNELS + 1];
+    long combined_chans;
+    int combined_dirty;
+
     ChunkAnalysisResult* result_buffer;
 
+    // Worker instrumentation, written by the worker under lock
+    t_mc_analyze_stats stats;
+    int stats_reset;            // Set by stats reset; the worker clears the analyzers' profiles at its next task
+
 } t_mc_analyze;
 
+// Per-hop parameters shared by the channel jobs run on the thread pool
+typedef struct _mc_analyze_hop {
+    t_mc_analyze* x;
+    long long cur_samples;
+    int cur_write_ptr;
+    long long hop_start_samples;
+    int hop_samples;
+    int active_start_frame;
+    const char* paused;         // Pause flags captured at the start of the hop, indexed by channel + 1
+    long n_chans;
+    long lanes;                 // Channels per job, pushed through the STFT together
+} t_mc_analyze_hop;
+
 void* mc_analyze_new(t_symbol* s, long argc, t_atom* argv);
 void mc_analyze_free(t_mc_analyze* x);
 void mc_analyze_clear(t_mc_analyze* x);
 void mc_analyze_pause(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv);
+void mc_analyze_memory(t_mc_analyze* x);
+void mc_analyze_stats(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv);
+void mc_analyze_output_stats(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv);
+void mc_analyze_output_governor(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv);
 void mc_analyze_group_settor(t_mc_analyze* x, void* attr, long argc, t_atom* argv);
 void mc_analyze_worker_task(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv);
+void mc_analyze_prepare_block(void* ctx, long block);
 void mc_analyze_output_metrics(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv);
 void mc_analyze_output_peak(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv);
 void mc_analyze_output_log(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv);
@@ -368,6 +449,42 @@ void ext_main(void* r) {
     CLASS_ATTR_LABEL(c, "tolerance", 0, "Tolerance (ms)");
     CLASS_ATTR_DEFAULT(c, "tolerance", 0, "29.0");
 
+    CLASS_ATTR_LONG(c, "metrics", 0, t_mc_analyze, metrics_mode);
+    CLASS_ATTR_FILTER_CLIP(c, "metrics", 0, 2);
+    CLASS_ATTR_ENUMINDEX(c, "metrics", 0, "Full Incremental Validate");
+    CLASS_ATTR_LABEL(c, "metrics", 0, "Metrics Computation");
+    CLASS_ATTR_DEFAULT(c, "metrics", 0, "0");
+
+    CLASS_ATTR_LONG(c, "threads", 0, t_mc_analyze, threads);
+    CLASS_ATTR_FILTER_CLIP(c, "threads", 1, MAX_ANALYZE_THREADS);
+    CLASS_ATTR_LABEL(c, "threads", 0, "Analysis Threads");
+    CLASS_ATTR_DEFAULT(c, "threads", 0, "1");
+
+    CLASS_ATTR_LONG(c, "lowmem", 0, t_mc_analyze, lowmem);
+    CLASS_ATTR_FILTER_CLIP(c, "lowmem", 0, 1);
+    CLASS_ATTR_STYLE_LABEL(c, "lowmem", 0, "checkbox", "Low Memory Capture Buffers");
+    CLASS_ATTR_DEFAULT(c, "lowmem", 0, "0");
+
+    CLASS_ATTR_LONG(c, "profile", 0, t_mc_analyze, profile);
+    CLASS_ATTR_FILTER_CLIP(c, "profile", 0, 1);
+    CLASS_ATTR_STYLE_LABEL(c, "profile", 0, "checkbox", "Profile Analyzer Stages");
+    CLASS_ATTR_DEFAULT(c, "profile", 0, "0");
+
+    CLASS_ATTR_LONG(c, "stats_interval", 0, t_mc_analyze, stats_interval);
+    CLASS_ATTR_FILTER_MIN(c, "stats_interval", 0);
+    CLASS_ATTR_LABEL(c, "stats_interval", 0, "Stream Stats Every N Hops");
+    CLASS_ATTR_DEFAULT(c, "stats_interval", 0, "0");
+
+    CLASS_ATTR_LONG(c, "governor", 0, t_mc_analyze, governor);
+    CLASS_ATTR_FILTER_CLIP(c, "governor", 0, 1);
+    CLASS_ATTR_STYLE_LABEL(c, "governor", 0, "checkbox", "Degrade When Behind");
+    CLASS_ATTR_DEFAULT(c, "governor", 0, "0");
+
+    CLASS_ATTR_LONG_ARRAY(c, "governor_tiers", 0, t_mc_analyze, governor_tiers, GOVERNOR_TIERS);
+    CLASS_ATTR_FILTER_MIN(c, "governor_tiers", 0);
+    CLASS_ATTR_LABEL(c, "governor_tiers", 0, "Governor Tier Backlogs (hops)");
+    CLASS_ATTR_DEFAULT(c, "governor_tiers", 0, "2 4 8");
+
     CLASS_ATTR_LONG(c, "visualize", 0, t_mc_analyze, visualize_enabled);
     CLASS_ATTR_FILTER_CLIP(c, "visualize", 0, 1);
     CLASS_ATTR_LABEL(c, "visualize", 0, "Enable Real-Time Visualization");
@@ -378,6 +495,8 @@ void ext_main(void* r) {
     class_addmethod(c, (method)mc_analyze_assist, "assist", A_CANT, 0);
     class_addmethod(c, (method)mc_analyze_clear, "clear", 0);
     class_addmethod(c, (method)mc_analyze_pause, "pause", A_GIMME, 0);
+    class_addmethod(c, (method)mc_analyze_memory, "memory", 0);
+    class_addmethod(c, (method)mc_analyze_stats, "stats", A_GIMME, 0);
     class_addmethod(c, (method)mc_analyze_inputchanged, "inputchanged", A_CANT, 0);
 
     class_dspinit(c);
@@ -412,6 +531,8 @@ void* mc_analyze_new(t_symbol* s, long argc, t_atom* argv) {
         x->viz_ports = NULL;
         x->allocated_viz_ports = 0;
         x->worker = async_worker_create();
+        x->trigger = async_worker_trigger_new(x->worker, x, (method)mc_analyze_worker_task, gensym("analyze"));
+        x->pool = NULL;
 
         x->audio_buffers = NULL;
         x->allocated_audio_chans = 0;
@@ -433,6 +554,18 @@ void* mc_analyze_new(t_symbol* s, long argc, t_atom* argv) {
         x->log_enabled = 0;
         x->weighted_bar = 1;
         x->tolerance = 29.0;
+        x->metrics_mode = CT_METRICS_FULL;
+        x->threads = 1;
+        x->lowmem = 0;
+        x->profile = 0;
+        x->stats_interval = 0;
+        x->governor = 0;
+        x->governor_tiers[0] = 2;
+        x->governor_tiers[1] = 4;
+        x->governor_tiers[2] = 8;
+        x->governor_tier = 0;
+        memset(&x->stats, 0, sizeof(x->stats));
+        x->stats_reset = 0;
         x->sample_rate = 44100.0;
         x->active = 1;
         x->visualize_enabled = 0;
@@ -440,6 +573,10 @@ void* mc_analyze_new(t_symbol* s, long argc, t_atom* argv) {
         x->initialized = 0;
         x->instance_id = (int)(rand() % 900000 + 100000);
         memset(x->paused_channels, 0, sizeof(x->paused_channels));
+        x->combined_bar_lengths = (BarLengthHistogram*)malloc(sizeof(BarLengthHistogram));
+        if (x->combined_bar_lengths) bar_histogram_clear(x->combined_bar_lengths);
+        x->combined_chans = 0;
+        x->combined_dirty = 1;
         x->result_buffer = (ChunkAnalysisResult*)malloc(sizeof(ChunkAnalysisResult));
 
         attr_args_process(x, argc, argv);
@@ -466,8 +603,10 @@ void mc_analyze_free(t_mc_analyze* x) {
     critical_exit(x->lock);
 
     if (x->worker) {
+        async_worker_trigger_free(x->trigger);
         async_worker_release(x->worker);
     }
+    thread_pool_free(x->pool);
 
     if (x->analyzers) {
         for (long i = 0; i < x->analyzers_count; i++) {
@@ -494,6 +633,7 @@ void mc_analyze_free(t_mc_analyze* x) {
     }
 
     if (x->result_buffer) free(x->result_buffer);
+    if (x->combined_bar_lengths) free(x->combined_bar_lengths);
 
     if (x->audio_buffers) {
         for (long i = 0; i < x->allocated_audio_chans; i++) {
@@ -544,6 +684,7 @@ void mc_analyze_clear(t_mc_analyze* x) {
     x->current_sample_count = 0;
     x->last_analysis_frame = 0;
     x->pending_analysis = 0;
+    x->combined_dirty = 1;
     for (int i = 0; i < MAX_BANDS; i++) {
         x->last_peak_frame[i] = -1;
     }
@@ -638,10 +779,175 @@ void mc_analyze_pause(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv) {
     mc_analyze_log(x, "updated pause state");
 }
 
+// Reports heap usage out of the log outlet as: memory <capture rings> <analyzers> <results> <shared tables> <total>
+void mc_analyze_memory(t_mc_analyze* x) {
+    critical_enter(x->lock);
+    t_atom_long ring = (t_atom_long)x->audio_buffer_size * (x->allocated_audio_chans * sizeof(float) + sizeof(double));
+    t_atom_long analysis = 0;
+    for (long i = 0; i < x->analyzers_count; i++) {
+        analysis += (t_atom_long)analyzer_memory_usage(x->analyzers[i]);
+    }
+    critical_exit(x->lock);
+    t_atom_long results = x->result_buffer ? (t_atom_long)sizeof(ChunkAnalysisResult) : 0;
+    t_atom_long tables = (t_atom_long)analyzer_shared_tables_usage();
+
+    t_atom av[5];
+    atom_setlong(av, ring);
+    atom_setlong(av + 1, analysis);
+    atom_setlong(av + 2, results);
+    atom_setlong(av + 3, tables);
+    atom_setlong(av + 4, ring + analysis + results + tables);
+    if (x->outlet_log) outlet_anything(x->outlet_log, gensym("memory"), 5, av);
+}
+
+// One stats line per timed section: stats <kind> <name> <count> <mean ms> <p50 ms> <p99 ms> <max ms>
+static void mc_analyze_stats_stage(t_mc_analyze* x, t_symbol* kind, const char* name, long long count, double seconds, const LatencyHistogram* h) {
+    t_atom av[7];
+    atom_setsym(av, kind);
+    atom_setsym(av + 1, gensym(name));
+    atom_setlong(av + 2, (t_atom_long)count);
+    atom_setfloat(av + 3, count > 0 ? seconds * 1000.0 / (double)count : 0.0);
+    atom_setfloat(av + 4, latency_histogram_quantile(h, 0.5) * 1000.0);
+    atom_setfloat(av + 5, latency_histogram_quantile(h, 0.99) * 1000.0);
+    atom_setfloat(av + 6, h->max_seconds * 1000.0);
+    outlet_anything(x->outlet_log, gensym("stats"), 7, av);
+}
+
+// Add a channel's share of a section to the hop's times, which start out negative (not run)
+static void mc_analyze_hop_time(double* times, int stage, double seconds) {
+    times[stage] = (times[stage] < 0.0 ? 0.0 : times[stage]) + seconds;
+}
+
+// Fold one hop's section times (negative for sections that did not run) into the stats. Called
+// with x->lock held.
+static void mc_analyze_stats_hop(t_mc_analyze* x, const double* times, long long lag_samples, long n_chans) {
+    t_mc_analyze_stats* st = &x->stats;
+    for (int k = 0; k < NUM_HOP_STAGES; k++) {
+        if (times[k] < 0.0) continue;
+        st->seconds[k] += times[k];
+        latency_histogram_add(&st->stages[k], times[k]);
+    }
+    latency_histogram_add(&st->lag, (double)lag_samples / x->sample_rate);
+    st->hops++;
+    st->tier_hops[x->governor_tier]++;
+    if (times[HOP_STAGE_TOTAL] * 1000.0 > ANALYSIS_HOP_MS) st->late_hops++;
+    st->channels = n_chans;
+    if (x->profile && !x->stats_reset) {
+        memset(&st->analyzer, 0, sizeof(AnalyzerProfile));
+        for (long ch = 0; ch < n_chans && ch < x->analyzers_count; ch++) {
+            if (x->analyzers[ch]) analyzer_profile_merge(&st->analyzer, &x->analyzers[ch]->profile);
+        }
+    }
+    if (x->stats_interval > 0 && st->hops % x->stats_interval == 0) {
+        defer(x, (method)mc_analyze_output_stats, NULL, 0, NULL);
+    }
+}
+
+// Pick the governor tier for the next hop from the backlog in hops: drop back to full analysis once
+// caught up, climb to the highest tier whose backlog is reached and otherwise hold the tier in force.
+// Called by the worker only.
+static void mc_analyze_governor_update(t_mc_analyze* x, long long backlog, long n_chans) {
+    int tier = x->governor_tier;
+    if (!x->governor || backlog <= 1) tier = 0;
+    if (x->governor) {
+        int reached = 0;
+        for (int i = 0; i < GOVERNOR_TIERS; i++) {
+            if (x->governor_tiers[i] > 0 && backlog >= x->governor_tiers[i]) reached = i + 1;
+        }
+        if (reached > tier) tier = reached;
+    }
+    // Applied on every hop so channels added since the last change follow the tier too
+    for (long ch = 0; ch < n_chans && ch < x->analyzers_count; ch++) {
+        if (!x->analyzers[ch]) continue;
+        analyzer_set_frame_stride(x->analyzers[ch], tier >= GOVERNOR_TIER_STRIDE ? GOVERNOR_FRAME_STRIDE : 1);
+        analyzer_set_snapshot_floor(x->analyzers[ch], tier >= GOVERNOR_TIER_SNAPSHOTS ? GOVERNOR_SNAPSHOT_FLOOR : 0.0);
+    }
+    if (tier != x->governor_tier) {
+        x->governor_tier = tier;
+        t_atom a;
+        atom_setlong(&a, tier);
+        defer(x, (method)mc_analyze_output_governor, NULL, 1, &a);
+    }
+}
+
+// stats reports the worker's timing out of the log outlet; stats reset clears it. The report is
+//   stats hops <hops> <late hops> <load>
+//   stats channels <channels in the last hop>
+//   stats backlog <hops waiting now> <mean at wakeup> <max at wakeup>
+//   stats lag <now ms> <p50 ms> <p99 ms> <max ms>
+//   stats governor <tier in force> <hops analyzed at tier 0> <tier 1> <tier 2> <tier 3>
+//   stats stage <push|analyze|peaks|metrics|visualize|hop> <count> <mean ms> <p50 ms> <p99 ms> <max ms>
+// followed with @profile on by the same per-call line for each analyzer stage, summed over the
+// channels, as stats analyzer.
+void mc_analyze_stats(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv) {
+    if (argc > 0 && atom_gettype(argv) == A_SYM && atom_getsym(argv) == gensym("reset")) {
+        critical_enter(x->lock);
+        memset(&x->stats, 0, sizeof(x->stats));
+        x->stats_reset = 1;
+        critical_exit(x->lock);
+        return;
+    }
+    mc_analyze_output_stats(x, NULL, 0, NULL);
+}
+
+void mc_analyze_output_stats(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv) {
+    if (x->invalidated || !x->outlet_log) return;
+
+    t_mc_analyze_stats* st = (t_mc_analyze_stats*)malloc(sizeof(t_mc_analyze_stats));
+    if (!st) return;
+    critical_enter(x->lock);
+    *st = x->stats;
+    long long lag_samples = x->current_sample_count - x->last_analysis_frame;
+    critical_exit(x->lock);
+
+    double hop_seconds = ANALYSIS_HOP_MS / 1000.0;
+    int hop_samples = (int)(x->sample_rate * hop_seconds);
+    t_atom av[5];
+
+    atom_setsym(av, gensym("hops"));
+    atom_setlong(av + 1, (t_atom_long)st->hops);
+    atom_setlong(av + 2, (t_atom_long)st->late_hops);
+    atom_setfloat(av + 3, st->hops > 0 ? st->seconds[HOP_STAGE_TOTAL] / (st->hops * hop_seconds) : 0.0);
+    outlet_anything(x->outlet_log, gensym("stats"), 4, av);
+
+    atom_setsym(av, gensym("channels"));
+    atom_setlong(av + 1, st->channels);
+    outlet_anything(x->outlet_log, gensym("stats"), 2, av);
+
+    atom_setsym(av, gensym("backlog"));
+    atom_setlong(av + 1, hop_samples > 0 ? (t_atom_long)(lag_samples / hop_samples) : 0);
+    atom_setfloat(av + 2, st->wakeups > 0 ? (double)st->backlog_sum / (double)st->wakeups : 0.0);
+    atom_setlong(av + 3, (t_atom_long)st->backlog_max);
+    outlet_anything(x->outlet_log, gensym("stats"), 4, av);
+
+    atom_setsym(av, gensym("lag"));
+    atom_setfloat(av + 1, lag_samples * 1000.0 / x->sample_rate);
+    atom_setfloat(av + 2, latency_histogram_quantile(&st->lag, 0.5) * 1000.0);
+    atom_setfloat(av + 3, latency_histogram_quantile(&st->lag, 0.99) * 1000.0);
+    atom_setfloat(av + 4, st->lag.max_seconds * 1000.0);
+    outlet_anything(x->outlet_log, gensym("stats"), 5, av);
+
+    t_atom gv[GOVERNOR_TIERS + 3];
+    atom_setsym(gv, gensym("governor"));
+    atom_setlong(gv + 1, x->governor_tier);
+    for (int i = 0; i <= GOVERNOR_TIERS; i++) atom_setlong(gv + 2 + i, (t_atom_long)st->tier_hops[i]);
+    outlet_anything(x->outlet_log, gensym("stats"), GOVERNOR_TIERS + 3, gv);
+
+    for (int k = 0; k < NUM_HOP_STAGES; k++) {
+        mc_analyze_stats_stage(x, gensym("stage"), hop_stage_names[k], st->stages[k].total, st->seconds[k], &st->stages[k]);
+    }
+    if (x->profile) {
+        for (int k = 0; k < CT_NUM_STAGES; k++) {
+            mc_analyze_stats_stage(x, gensym("analyzer"), analyzer_stage_name(k), st->analyzer.calls[k], st->analyzer.seconds[k], &st->analyzer.latency[k]);
+        }
+    }
+    free(st);
+}
+
 void mc_analyze_assist(t_mc_analyze* x, void* b, long m, long a, char* s) {
     if (m == ASSIST_INLET) {
         switch (a) {
-            case 0: sprintf(s, "(signal/multichannelsignal) Audio Input, (messages) clear, pause"); break;
+            case 0: sprintf(s, "(signal/multichannelsignal) Audio Input, (messages) clear, pause, memory, stats"); break;
             case 1: sprintf(s, "(signal) Transport Clock Input"); break;
         }
     } else {
@@ -652,7 +958,7 @@ void mc_analyze_assist(t_mc_analyze* x, void* b, long m, long a, char* s) {
             case 3: sprintf(s, "(float) Standard Deviation"); break;
             case 4: sprintf(s, "(float) Contrast Score"); break;
             case 5: sprintf(s, "(float) Bar Length Stability"); break;
-            case 6: sprintf(s, "(symbol) Log Diagnostics"); break;
+            case 6: sprintf(s, "(symbol) Log Diagnostics, Memory Report, Stats"); break;
         }
     }
 }
@@ -691,7 +997,7 @@ void mc_analyze_dsp64(t_mc_analyze* x, t_object* dsp64, short* count, double sam
     x->num_clock_chans = num_clock_chans;
     x->clock_connected = (num_clock_chans > 0 && count[num_audio_chans]);
 
-    int new_size = (int)(samplerate * MAX_AUDIO_SECONDS);
+    int new_size = (int)(samplerate * (x->lowmem ? LOWMEM_AUDIO_SECONDS : MAX_AUDIO_SECONDS)) + (x->lowmem ? LOWMEM_OVERLAP_SAMPLES : 0);
 
     critical_enter(x->lock);
 
@@ -768,6 +1074,7 @@ void mc_analyze_dsp64(t_mc_analyze* x, t_object* dsp64, short* count, double sam
             x->analyzers[i] = analyzer_create(1.0, shared_buf, shared_lock, (ct_lock_func)critical_enter, (ct_lock_func)critical_exit);
         }
         x->analyzers_count = num_audio_chans;
+        x->combined_dirty = 1;
     }
 
     for (long i = 0; i < x->analyzers_count; i++) {
@@ -806,8 +1113,7 @@ void mc_analyze_perform64(t_mc_analyze* x, t_object* dsp64, double** ins, long n
     if (x->current_sample_count >= x->last_analysis_frame + hop_samples) {
         if (!x->pending_analysis) {
             x->pending_analysis = 1;
-            mc_analyze_log(x, "triggering worker task, current_sample_count: %lld, last_analysis_frame: %lld", x->current_sample_count, x->last_analysis_frame);
-            async_worker_enqueue(x->worker, x, (method)mc_analyze_worker_task, gensym("analyze"), 0, NULL);
+            async_worker_trigger(x->trigger);
         }
     }
 }
@@ -822,17 +1128,46 @@ void mc_analyze_worker_task(t_mc_analyze* x, t_symbol* s, long argc, t_atom* arg
 
     critical_enter(x->lock);
     long start_seq = x->clear_sequence;
+    mc_analyze_log(x, "worker task triggered, current_sample_count: %lld, last_analysis_frame: %lld", x->current_sample_count, x->last_analysis_frame);
     long n_chans = x->num_audio_chans;
     for (long ch = 0; ch < n_chans; ch++) {
         if (x->analyzers[ch]) {
             x->analyzers[ch]->tolerance = x->tolerance;
+            if (x->analyzers[ch]->metrics_mode != x->metrics_mode && !analyzer_set_metrics_mode(x->analyzers[ch], (int)x->metrics_mode)) {
+                mc_analyze_log(x, "could not allocate incremental metrics state for channel %ld, using full scans", ch);
+            }
+            if (x->analyzers[ch]->profiling != (x->profile != 0)) {
+                analyzer_set_profiling(x->analyzers[ch], (int)x->profile);
+            }
+            if (x->stats_reset) {
+                analyzer_reset_profile(x->analyzers[ch]);
+            }
         }
     }
+    x->stats_reset = 0;
+    long threads = x->threads;
     critical_exit(x->lock);
 
+    if (thread_pool_size(x->pool) != threads) {
+        thread_pool_free(x->pool);
+        x->pool = (threads > 1) ? thread_pool_create(threads) : NULL;
+        if (threads > 1 && thread_pool_size(x->pool) != threads) {
+            mc_analyze_log(x, "could only start %ld of %ld analysis threads", thread_pool_size(x->pool), threads);
+        }
+    }
+
     int hop_samples = (int)(x->sample_rate * 0.1);
     int ms_samples = (int)(x->sample_rate * 0.001);
 
+    critical_enter(x->lock);
+    long long backlog = hop_samples > 0 ? (x->current_sample_count - x->last_analysis_frame) / hop_samples : 0;
+    if (backlog > 0) {
+        x->stats.wakeups++;
+        x->stats.backlog_sum += backlog;
+        if (backlog > x->stats.backlog_max) x->stats.backlog_max = backlog;
+    }
+    critical_exit(x->lock);
+
     int hops_processed = 0;
     while (1) {
         critical_enter(x->lock);
@@ -844,19 +1179,45 @@ void mc_analyze_worker_task(t_mc_analyze* x, t_symbol* s, long argc, t_atom* arg
         int cur_write_ptr = x->audio_buffer_write_ptr;
         n_chans = x->num_audio_chans;
         long long target_analysis_frame = x->last_analysis_frame + hop_samples;
+        long long lag_samples = cur_samples - x->last_analysis_frame;
         critical_exit(x->lock);
 
+        mc_analyze_governor_update(x, hop_samples > 0 ? lag_samples / hop_samples : 0, n_chans);
+
+        double hop_times[NUM_HOP_STAGES];
+        for (int k = 0; k < NUM_HOP_STAGES; k++) hop_times[k] = -1.0;
+        double hop_start_time = analyzer_profile_clock();
+
         long long hop_start_samples = target_analysis_frame - hop_samples;
 
         int active_start_samples = (int)(target_analysis_frame - hop_samples - (int)(x->sample_rate * 0.2));
         int active_start_frame = active_start_samples / ms_samples;
 
-        int window_start_samples = active_start_samples - (int)(x->sample_rate * 15.0);
-        if (window_start_samples < 0) window_start_samples = 0;
-        int buffer_start_frame = window_start_samples / ms_samples;
-
         hops_processed++;
 
+        // Phase 1: prepare every channel's chunk, in blocks that share one lane-batched STFT and in
+        // parallel when a pool is running. This only touches each channel's own analyzer, so the
+        // order the blocks finish in does not matter.
+        char paused[MAX_ANALYZE_CHANNELS + 1];
+        critical_enter(x->lock);
+        memcpy(paused, x->paused_channels, sizeof(paused));
+        critical_exit(x->lock);
+
+        t_mc_analyze_hop hop;
+        hop.x = x;
+        hop.cur_samples = cur_samples;
+        hop.cur_write_ptr = cur_write_ptr;
+        hop.hop_start_samples = hop_start_samples;
+        hop.hop_samples = hop_samples;
+        hop.active_start_frame = active_start_frame;
+        hop.paused = paused;
+        hop.n_chans = n_chans;
+        hop.lanes = ct_kernels_get()->rfft_power_lanes ? CT_LANES : 1;
+        thread_pool_run(x->pool, mc_analyze_prepare_block, &hop, (n_chans + hop.lanes - 1) / hop.lanes);
+        double t = analyzer_profile_clock();
+        hop_times[HOP_STAGE_PUSH] = t - hop_start_time;
+
+        // Phase 2: apply the chunks to the shared buffer and emit their results in channel order
         for (long ch = 0; ch < n_chans; ch++) {
             critical_enter(x->lock);
             if (x->invalidated || x->clear_sequence != start_seq) {
@@ -865,37 +1226,26 @@ void mc_analyze_worker_task(t_mc_analyze* x, t_symbol* s, long argc, t_atom* arg
             }
             critical_exit(x->lock);
 
-            float* hop_audio = (float*)malloc(sizeof(float) * hop_samples);
-            if (!hop_audio) continue;
-
-            long long samples_ago = cur_samples - hop_start_samples;
-            if (samples_ago < 0) samples_ago = 0;
-            if (x->audio_buffer_size > 0 && samples_ago >= x->audio_buffer_size) samples_ago = x->audio_buffer_size - 1;
-
-            int read_ptr = (int)((cur_write_ptr - samples_ago + x->audio_buffer_size) % x->audio_buffer_size);
-
-            for (int i = 0; i < hop_samples; i++) {
-                hop_audio[i] = x->audio_buffers[ch][read_ptr];
-                read_ptr = (read_ptr + 1) % x->audio_buffer_size;
-            }
-
             int is_paused = 0;
-            critical_enter(x->lock);
             if ((ch + 1) <= MAX_ANALYZE_CHANNELS) {
-                is_paused = x->paused_channels[ch + 1];
+                is_paused = paused[ch + 1];
             }
-            critical_exit(x->lock);
 
             if (is_paused) {
                 if (x->analyzers[ch]) {
-                    analyzer_cleanup_snapshots(x->analyzers[ch], active_start_frame);
-                    analyzer_push_audio(x->analyzers[ch], hop_audio, hop_samples, (int)x->sample_rate);
+                    analyzer_chunk_commit(x->analyzers[ch], x->result_buffer);
                 }
-                free(hop_audio);
                 continue;
             }
 
-            if (x->result_buffer && analyzer_analyze_chunk(x->analyzers[ch], hop_audio, hop_samples, (int)x->sample_rate, buffer_start_frame, active_start_frame, x->result_buffer)) {
+            int analyzed = x->result_buffer && x->analyzers[ch] && analyzer_chunk_commit(x->analyzers[ch], x->result_buffer);
+            double t_commit = analyzer_profile_clock();
+            mc_analyze_hop_time(hop_times, HOP_STAGE_ANALYZE, t_commit - t);
+            t = t_commit;
+            if (analyzed) {
+                if (x->combined_bar_lengths && x->analyzers[ch]->last_bar_length >= 0) {
+                    bar_histogram_add(x->combined_bar_lengths, x->analyzers[ch]->last_bar_length, 1);
+                }
                 for (int i = 0; i < x->result_buffer->peak_list.num_peaks; i++) {
                     PeakResult* pr = &x->result_buffer->peak_list.peaks[i];
 
@@ -919,8 +1269,11 @@ void mc_analyze_worker_task(t_mc_analyze* x, t_symbol* s, long argc, t_atom* arg
                         defer(x, (method)mc_analyze_output_peak, NULL, 2, out_args);
                     }
                 }
+                double t_peaks = analyzer_profile_clock();
+                mc_analyze_hop_time(hop_times, HOP_STAGE_PEAKS, t_peaks - t);
+                t = t_peaks;
 
-                if (x->visualize_enabled && ch < x->allocated_viz_ports && x->viz_ports[ch] > 0) {
+                if (x->visualize_enabled && ch < x->allocated_viz_ports && x->viz_ports[ch] > 0 && x->governor_tier < GOVERNOR_TIER_NO_VISUALIZE) {
                     char *json_buf = (char *)malloc(131072);
                     if (json_buf) {
                         char *ptr = json_buf;
@@ -1025,12 +1378,13 @@ void mc_analyze_worker_task(t_mc_analyze* x, t_symbol* s, long argc, t_atom* arg
                         if (n > 0 && n < remaining) { ptr += n; remaining -= n; }
                         for (int i = 0; i < x->result_buffer->peak_list.num_peaks; i++) {
                             PeakResult *p_res = &x->result_buffer->peak_list.peaks[i];
+                            Qualifier *p_quals = &x->result_buffer->peak_list.qualifiers[p_res->qualifier_start];
                             n = snprintf(ptr, remaining, "{\"time\":%.4f,\"peak_val\":%.4f,\"total_score\":%.4f,\"band_idx\":%d,\"p_idx\":%d,\"qualifiers\":[",
                                          p_res->time, p_res->peak_val, p_res->total_score, p_res->band_idx, p_res->p_idx);
                             if (n > 0 && n < remaining) { ptr += n; remaining -= n; }
                             for (int q = 0; q < p_res->num_qualifiers; q++) {
                                 n = snprintf(ptr, remaining, "{\"ms\":%.4f,\"val\":%.4f,\"orig_ms\":%.4f}%s",
-                                             p_res->qualifiers[q].ms, p_res->qualifiers[q].val, p_res->qualifiers[q].orig_ms,
+                                             p_quals[q].ms, p_quals[q].val, p_quals[q].orig_ms,
                                              (q == p_res->num_qualifiers - 1) ? "" : ",");
                                 if (n > 0 && n < remaining) { ptr += n; remaining -= n; }
                             }
@@ -1044,10 +1398,11 @@ void mc_analyze_worker_task(t_mc_analyze* x, t_symbol* s, long argc, t_atom* arg
                         visualize_to_port(x, x->viz_ports[ch], "mc_analyze", json_buf);
                         free(json_buf);
                     }
+                    double t_viz = analyzer_profile_clock();
+                    mc_analyze_hop_time(hop_times, HOP_STAGE_VISUALIZE, t_viz - t);
+                    t = t_viz;
                 }
             }
-
-            free(hop_audio);
         }
 
         critical_enter(x->lock);
@@ -1072,7 +1427,11 @@ void mc_analyze_worker_task(t_mc_analyze* x, t_symbol* s, long argc, t_atom* arg
         }
 
         if (n_chans > 0 && active_ch >= 0 && x->analyzers[active_ch] && x->result_buffer) {
+            t = analyzer_profile_clock();
             analyzer_update_metrics(x->analyzers[active_ch], active_start_frame + 100, &x->result_buffer->metrics);
+            if (x->combined_bar_lengths && x->analyzers[active_ch]->last_bar_length >= 0) {
+                bar_histogram_add(x->combined_bar_lengths, x->analyzers[active_ch]->last_bar_length, 1);
+            }
 
             t_atom out_args[5];
             atom_setfloat(out_args, x->result_buffer->metrics.rating);
@@ -1080,47 +1439,44 @@ void mc_analyze_worker_task(t_mc_analyze* x, t_symbol* s, long argc, t_atom* arg
             atom_setfloat(out_args + 2, x->result_buffer->metrics.contrast);
             atom_setfloat(out_args + 3, x->result_buffer->metrics.stability_score);
 
-            double max_score = -1.0;
             int best_bar_length = 0;
-
-            int combined_bar_length_counts[5001] = {0};
             critical_enter(x->lock);
-            for (long ch = 0; ch < n_chans; ch++) {
-                int is_paused = 0;
-                if ((ch + 1) <= MAX_ANALYZE_CHANNELS) {
-                    is_paused = x->paused_channels[ch + 1];
-                }
-                if (!is_paused && x->analyzers[ch]) {
-                    for (int i = 0; i <= 5000; i++) {
-                        combined_bar_length_counts[i] += x->analyzers[ch]->bar_length_counts[i];
+            if (x->combined_bar_lengths) {
+                if (x->combined_dirty || x->combined_chans != n_chans || memcmp(x->combined_paused_mask, x->paused_channels, sizeof(x->paused_channels)) != 0) {
+                    bar_histogram_clear(x->combined_bar_lengths);
+                    for (long ch = 0; ch < n_chans; ch++) {
+                        int is_paused = 0;
+                        if ((ch + 1) <= MAX_ANALYZE_CHANNELS) {
+                            is_paused = x->paused_channels[ch + 1];
+                        }
+                        if (!is_paused && x->analyzers[ch]) {
+                            for (int i = 0; i <= 5000; i++) {
+                                bar_histogram_add(x->combined_bar_lengths, i, x->analyzers[ch]->bar_lengths.counts[i]);
+                            }
+                        }
                     }
+                    memcpy(x->combined_paused_mask, x->paused_channels, sizeof(x->paused_channels));
+                    x->combined_chans = n_chans;
+                    x->combined_dirty = 0;
                 }
+                best_bar_length = bar_histogram_best(x->combined_bar_lengths, (int)x->weighted_bar);
             }
-            critical_exit(x->lock);
-
-            for (int i = 0; i <= 5000; i++) {
-                if (combined_bar_length_counts[i] > 0) {
-                    double score = 0.0;
-                    if (x->weighted_bar) {
-                        score = (double)combined_bar_length_counts[i] * ((double)i / 5000.0);
-                    } else {
-                        score = (double)combined_bar_length_counts[i];
-                    }
-                    if (score > max_score) {
-                        max_score = score;
-                        best_bar_length = i;
-                    }
-                }
+            if (x->analyzers[active_ch]->metrics_mode == CT_METRICS_VALIDATE) {
+                mc_analyze_log(x, "metrics validation: max relative deviation %g", x->analyzers[active_ch]->metrics_max_deviation);
             }
+            critical_exit(x->lock);
 
             float barlen = (float)best_bar_length;
             atom_setfloat(out_args + 4, barlen);
             defer(x, (method)mc_analyze_output_metrics, NULL, 5, out_args);
+            hop_times[HOP_STAGE_METRICS] = analyzer_profile_clock() - t;
         }
+        hop_times[HOP_STAGE_TOTAL] = analyzer_profile_clock() - hop_start_time;
 
         critical_enter(x->lock);
         if (x->clear_sequence == start_seq) {
             x->last_analysis_frame = target_analysis_frame;
+            mc_analyze_stats_hop(x, hop_times, lag_samples, n_chans);
         } else {
             critical_exit(x->lock);
             break;
@@ -1139,6 +1495,60 @@ void mc_analyze_worker_task(t_mc_analyze* x, t_symbol* s, long argc, t_atom* arg
     critical_exit(x->lock);
 }
 
+// Push a block of channels' hop straight out of their ring buffers through the STFT together and
+// prepare each channel's chunk. Runs on the pool threads.
+void mc_analyze_prepare_block(void* ctx, long block) {
+    t_mc_analyze_hop* hop = (t_mc_analyze_hop*)ctx;
+    t_mc_analyze* x = hop->x;
+    TransientAnalyzer* analyzers[CT_LANES];
+    AudioView views[CT_LANES];
+    long channels[CT_LANES];
+    int count = 0;
+
+    long ch_end = (block + 1) * hop->lanes;
+    if (ch_end > hop->n_chans) ch_end = hop->n_chans;
+    for (long ch = block * hop->lanes; ch < ch_end; ch++) {
+        int is_paused = 0;
+        if ((ch + 1) <= MAX_ANALYZE_CHANNELS) {
+            is_paused = hop->paused[ch + 1];
+        }
+        if (!x->analyzers[ch] || (!is_paused && !x->result_buffer)) continue;
+
+        long long samples_ago = hop->cur_samples - hop->hop_start_samples;
+        if (samples_ago < 0) samples_ago = 0;
+        if (x->audio_buffer_size > 0 && samples_ago >= x->audio_buffer_size) samples_ago = x->audio_buffer_size - 1;
+
+        // The view reaches back over the samples the analyzer's next frames still need
+        long long history = analyzer_view_history(x->analyzers[ch]);
+        if (samples_ago + history > x->audio_buffer_size) history = x->audio_buffer_size - samples_ago;
+
+        int read_ptr = (int)((hop->cur_write_ptr - samples_ago - history + 2LL * x->audio_buffer_size) % x->audio_buffer_size);
+        audio_view_from_ring(&views[count], x->audio_buffers[ch], x->audio_buffer_size, read_ptr, (int)history + hop->hop_samples);
+
+        analyzers[count] = x->analyzers[ch];
+        channels[count] = ch;
+        count++;
+    }
+
+    analyzer_push_audio_lanes(analyzers, views, count, hop->hop_samples, (int)x->sample_rate);
+
+    for (int l = 0; l < count; l++) {
+        long ch = channels[l];
+        if ((ch + 1) <= MAX_ANALYZE_CHANNELS && hop->paused[ch + 1]) {
+            analyzer_chunk_skip(analyzers[l], hop->active_start_frame);
+        } else {
+            analyzer_chunk_prepare_pushed(analyzers[l], hop->active_start_frame);
+        }
+    }
+}
+
+// Reports a change of governor tier out of the log outlet as: governor <tier>
+void mc_analyze_output_governor(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv) {
+    if (!x->invalidated && x->outlet_log) {
+        outlet_anything(x->outlet_log, gensym("governor"), argc, argv);
+    }
+}
+
 void mc_analyze_output_peak(t_mc_analyze* x, t_symbol* s, long argc, t_atom* argv) {
     outlet_list(x->outlet_list, NULL, argc, argv);
 }
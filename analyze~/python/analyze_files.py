@@ -596,25 +596,38 @@ def generate_video_matplotlib(audio_path, data):
         else: print("Error: ffmpeg not found."); return None
     except Exception as e: traceback.print_exc(); return None
 
-def analyze_audio(file_path):
+def analyze_audio(file_path, threads=None):
     ensure_initialized()
     if cumulative_transience is None: raise ImportError("The 'cumulative_transience' extension module could not be loaded.")
     print(f"Analyzing {file_path}...")
-    y, sr = librosa.load(file_path, sr=44100, mono=True); res = cumulative_transience.analyze_audio(y, sr); return res
+    if threads is None: threads = os.cpu_count() or 1
+    y, sr = librosa.load(file_path, sr=44100, mono=True); res = cumulative_transience.analyze_audio(y, sr, threads); return res
+
+def load_audio(file_path, sr=44100):
+    print(f"Analyzing {file_path}...")
+    return librosa.load(file_path, sr=sr, mono=True)
+
+def analyze_many(file_paths, jobs=None):
+    """Analyzes files concurrently, one per thread (the extension releases the GIL), yielding results in order."""
+    ensure_initialized()
+    if cumulative_transience is None: raise ImportError("The 'cumulative_transience' extension module could not be loaded.")
+    return cumulative_transience.analyze_many(file_paths, sr=44100, threads=jobs, loader=load_audio)
 
 def main():
     ensure_initialized()
     parser = argparse.ArgumentParser(description="Standalone transient analysis and video generation.")
     parser.add_argument("files", nargs="*", help="Optional list of audio files to process.")
+    parser.add_argument("--threads", type=int, default=None, help="Threads for the spectral front end (default: all cores).")
+    parser.add_argument("--jobs", type=int, default=None, help="Files analyzed concurrently when no --threads is given (default: all cores).")
     args = parser.parse_args(); extensions = ('.wav', '.mp3', '.m4a', '.flac', '.ogg', '.aiff'); audio_files = []
     sources = args.files if args.files else [os.getcwd()]
     for source in sources:
         if os.path.isdir(source): audio_files.extend([os.path.join(source, f) for f in os.listdir(source) if f.lower().endswith(extensions)])
         elif os.path.isfile(source) and source.lower().endswith(extensions): audio_files.append(source)
-    audio_files.sort()
-    for f in audio_files:
-        if not os.path.exists(f): continue
-        result = analyze_audio(f)
+    audio_files = sorted(f for f in audio_files if os.path.exists(f))
+    if len(audio_files) > 1 and args.threads is None: results = analyze_many(audio_files, args.jobs)
+    else: results = (analyze_audio(f, args.threads) for f in audio_files)
+    for f, result in zip(audio_files, results):
         if result: generate_video(f, result)
 
 if __name__ == "__main__":
@@ -1,7 +1,9 @@
+import os
 import numpy as np
 cimport numpy as cnp
 from libc.string cimport memcpy
 from libc.stdlib cimport malloc, free
+from cpython.ref cimport Py_INCREF
 
 cnp.import_array()
 
@@ -21,6 +23,11 @@ cdef extern from "cumulative_transience.h":
         double val
         double orig_ms
 
+    ctypedef struct SnapshotDescriptor:
+        int p_idx
+        int src_offset
+        double norm
+
     ctypedef struct PeakResult:
         int p_idx
         int band_idx
@@ -33,8 +40,8 @@ cdef extern from "cumulative_transience.h":
         double right_min
         double prominence
         int num_qualifiers
-        Qualifier qualifiers[256]
-        double snapshot[5001]
+        int qualifier_start
+        SnapshotDescriptor snapshot
 
     ctypedef struct AnalyzerMetrics:
         double std_dev
@@ -63,6 +70,8 @@ cdef extern from "cumulative_transience.h":
     ctypedef struct PeakResultList:
         PeakResult peaks[64]
         int num_peaks
+        Qualifier qualifiers[1024]
+        int num_qualifiers
 
     ctypedef struct ChunkAnalysisResult:
         PeakResultList peak_list
@@ -92,7 +101,11 @@ cdef extern from "cumulative_transience.h":
                               double left_min,
                               double right_min,
                               double prominence,
-                              PeakResult* result_out)
+                              PeakResult* result_out,
+                              Qualifier* qualifiers_out,
+                              int max_qualifiers)
+    int analyzer_peak_snapshot(const TransientAnalyzer_c* self, const PeakResult* peak, double* out)
+    void peak_snapshot_from_envelope(const PeakResult* peak, const float* envelope, int envelope_len, double* out)
     void analyzer_update_metrics(TransientAnalyzer_c* self, int frame, AnalyzerMetrics* metrics_out)
     double* analyzer_get_buffer(TransientAnalyzer_c* self)
 
@@ -121,6 +134,8 @@ cdef extern from "cumulative_transience.h":
         int* rolling_p_count
         PeakResult* peaks
         int num_peaks
+        Qualifier* qualifiers
+        int num_qualifiers
 
     ctypedef struct FullAnalysisResult:
         float* times
@@ -141,8 +156,27 @@ cdef extern from "cumulative_transience.h":
         double tolerance
 
     int analyzer_batch_analyze(const float* y, int len, int sr, FullAnalysisResult* result_out)
+    int analyzer_batch_analyze_threads(const float* y, int len, int sr, int threads, FullAnalysisResult* result_out) nogil
+
+    ctypedef struct AnalysisSink:
+        void* ctx
+
+    ctypedef struct AnalysisStream:
+        pass
+
+    AnalysisStream* analyzer_stream_create(int sr, int threads, const AnalysisSink* sink)
+    int analyzer_stream_push(AnalysisStream* stream, const float* y, int len)
+    int analyzer_stream_finish(AnalysisStream* stream)
+    void analyzer_stream_destroy(AnalysisStream* stream)
     void analyzer_free_analysis(FullAnalysisResult* result)
 
+cdef extern from "ct_analysis_file.h":
+    ctypedef struct AnalysisFileWriter:
+        pass
+
+    AnalysisFileWriter* analysis_file_open(const char* path, int sr, AnalysisSink* sink_out)
+    int analysis_file_close(AnalysisFileWriter* writer)
+
 cdef void dummy_lock(void* lock_obj) noexcept:
     pass
 
@@ -196,6 +230,7 @@ cdef class TransientAnalyzer:
 
         cdef list peaks = []
         cdef PeakResult pr
+        cdef Qualifier q
         for i in range(res.peak_list.num_peaks):
             pr = res.peak_list.peaks[i]
             peak_data = {
@@ -213,13 +248,14 @@ cdef class TransientAnalyzer:
                 'snapshot': np.zeros(5001, dtype=np.float64)
             }
             for j in range(pr.num_qualifiers):
+                q = res.peak_list.qualifiers[pr.qualifier_start + j]
                 peak_data['qualifiers'].append({
-                    'ms': pr.qualifiers[j].ms,
-                    'orig_ms': pr.qualifiers[j].orig_ms,
-                    'val': pr.qualifiers[j].val
+                    'ms': q.ms,
+                    'orig_ms': q.orig_ms,
+                    'val': q.val
                 })
 
-            memcpy(cnp.PyArray_DATA(peak_data['snapshot']), pr.snapshot, 5001 * sizeof(double))
+            analyzer_peak_snapshot(self._c_analyzer, &res.peak_list.peaks[i], <double*>cnp.PyArray_DATA(peak_data['snapshot']))
             peaks.append(peak_data)
 
         m = res.metrics
@@ -308,98 +344,77 @@ cdef class TransientAnalyzer:
             'global_smoothing_avg': m.global_smoothing_avg
         }
 
-def analyze_audio(cnp.ndarray[float, ndim=1] y, int sr):
+cdef class _AnalysisOwner:
+    """Owns the C arrays of a FullAnalysisResult; the numpy views returned by analyze_audio keep it alive."""
     cdef FullAnalysisResult res
-    cdef int ret = analyzer_batch_analyze(<float*>y.data, len(y), sr, &res)
+    cdef bint valid
+
+    def __dealloc__(self):
+        if self.valid:
+            analyzer_free_analysis(&self.res)
+
+cdef object _owned_view(_AnalysisOwner owner, void* data, int n, int typenum):
+    cdef cnp.npy_intp dims = n
+    if data == NULL or n == 0:
+        return cnp.PyArray_ZEROS(1, &dims, typenum, 0)
+    cdef cnp.ndarray arr = cnp.PyArray_SimpleNewFromData(1, &dims, typenum, data)
+    Py_INCREF(owner)
+    cnp.PyArray_SetBaseObject(arr, owner)
+    return arr
+
+def analyze_audio(y, int sr, int threads=1):
+    """Runs the full batch analysis. The per-frame arrays are views over the C result, which is
+    freed when the last of them is released. The GIL is released while the analysis runs."""
+    cdef cnp.ndarray[float, ndim=1, mode="c"] buf = np.ascontiguousarray(y, dtype=np.float32)
+    cdef _AnalysisOwner owner = _AnalysisOwner()
+    cdef const float* data = <const float*>buf.data
+    cdef int length = buf.shape[0]
+    cdef int ret
+    with nogil:
+        ret = analyzer_batch_analyze_threads(data, length, sr, threads, &owner.res)
 
     if not ret:
         return None
+    owner.valid = True
 
+    cdef FullAnalysisResult* res = &owner.res
     cdef int num_frames = res.num_frames
-    cdef cnp.ndarray[float, ndim=1] times = np.zeros(num_frames, dtype=np.float32)
-    memcpy(times.data, res.times, num_frames * sizeof(float))
-
-    cdef list onset_envs = []
-    cdef list rolling_dynamic_smoothings = []
-    cdef list rolling_prominences = []
-    cdef list rolling_prominence_avgs = []
-    cdef list rolling_prominence_half_maxes = []
-    cdef list rolling_smoothing_avgs = []
-    cdef list rolling_flux_avgs = []
-    cdef list rolling_thresholds = []
-    cdef list rolling_lookbacks = []
-    cdef list rolling_avg_deltas = []
-    cdef list rolling_total_deltas = []
-    cdef list rolling_p_counts = []
-    cdef list full_peaks_list = []
-
-    cdef cnp.ndarray[float, ndim=1] env
-    cdef cnp.ndarray[float, ndim=1] smooth
-    cdef cnp.ndarray[float, ndim=1] prom
-    cdef cnp.ndarray[float, ndim=1] prom_avg
-    cdef cnp.ndarray[float, ndim=1] prom_hm
-    cdef cnp.ndarray[float, ndim=1] smooth_avg
-    cdef cnp.ndarray[float, ndim=1] flux_avg
-    cdef cnp.ndarray[float, ndim=1] thresh
-    cdef cnp.ndarray[float, ndim=1] lookback
-    cdef cnp.ndarray[float, ndim=1] avg_delta
-    cdef cnp.ndarray[float, ndim=1] total_delta
-    cdef cnp.ndarray[int, ndim=1] p_count
-    cdef PeakResult pr
+    cdef BandAnalysis* band
+    cdef PeakResult* pr
+    cdef Qualifier* q
+    cdef cnp.ndarray snapshot
 
-    for i in range(4):
-        env = np.zeros(num_frames, dtype=np.float32)
-        memcpy(env.data, res.bands[i].envelope, num_frames * sizeof(float))
-        onset_envs.append(env)
+    keys = ("onset_envs", "rolling_dynamic_smoothings", "rolling_prominences", "rolling_prominence_avgs",
+            "rolling_prominence_half_maxes", "rolling_smoothing_avgs", "rolling_flux_avgs", "rolling_thresholds",
+            "rolling_lookbacks", "rolling_avg_deltas", "rolling_total_deltas", "rolling_p_counts")
+    result = {key: [] for key in keys}
+    full_peaks_list = []
 
-        smooth = np.zeros(num_frames, dtype=np.float32)
-        memcpy(smooth.data, res.bands[i].rolling_dynamic_smoothing, num_frames * sizeof(float))
-        rolling_dynamic_smoothings.append(smooth)
-
-        prom = np.zeros(num_frames, dtype=np.float32)
-        memcpy(prom.data, res.bands[i].rolling_prominence, num_frames * sizeof(float))
-        rolling_prominences.append(prom)
-
-        prom_avg = np.zeros(num_frames, dtype=np.float32)
-        memcpy(prom_avg.data, res.bands[i].rolling_prominence_avg, num_frames * sizeof(float))
-        rolling_prominence_avgs.append(prom_avg)
-
-        prom_hm = np.zeros(num_frames, dtype=np.float32)
-        memcpy(prom_hm.data, res.bands[i].rolling_prominence_half_max, num_frames * sizeof(float))
-        rolling_prominence_half_maxes.append(prom_hm)
-
-        smooth_avg = np.zeros(num_frames, dtype=np.float32)
-        memcpy(smooth_avg.data, res.bands[i].rolling_smoothing_avg, num_frames * sizeof(float))
-        rolling_smoothing_avgs.append(smooth_avg)
-
-        flux_avg = np.zeros(num_frames, dtype=np.float32)
-        memcpy(flux_avg.data, res.bands[i].rolling_flux_avg, num_frames * sizeof(float))
-        rolling_flux_avgs.append(flux_avg)
-
-        thresh = np.zeros(num_frames, dtype=np.float32)
-        memcpy(thresh.data, res.bands[i].rolling_threshold, num_frames * sizeof(float))
-        rolling_thresholds.append(thresh)
-
-        lookback = np.zeros(num_frames, dtype=np.float32)
-        memcpy(lookback.data, res.bands[i].rolling_lookback, num_frames * sizeof(float))
-        rolling_lookbacks.append(lookback)
-
-        avg_delta = np.zeros(num_frames, dtype=np.float32)
-        memcpy(avg_delta.data, res.bands[i].rolling_avg_delta, num_frames * sizeof(float))
-        rolling_avg_deltas.append(avg_delta)
-
-        total_delta = np.zeros(num_frames, dtype=np.float32)
-        memcpy(total_delta.data, res.bands[i].rolling_total_delta, num_frames * sizeof(float))
-        rolling_total_deltas.append(total_delta)
-
-        p_count = np.zeros(num_frames, dtype=np.int32)
-        memcpy(p_count.data, res.bands[i].rolling_p_count, num_frames * sizeof(int))
-        rolling_p_counts.append(p_count)
+    for i in range(4):
+        band = &res.bands[i]
+        result["onset_envs"].append(_owned_view(owner, band.envelope, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_dynamic_smoothings"].append(_owned_view(owner, band.rolling_dynamic_smoothing, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_prominences"].append(_owned_view(owner, band.rolling_prominence, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_prominence_avgs"].append(_owned_view(owner, band.rolling_prominence_avg, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_prominence_half_maxes"].append(_owned_view(owner, band.rolling_prominence_half_max, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_smoothing_avgs"].append(_owned_view(owner, band.rolling_smoothing_avg, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_flux_avgs"].append(_owned_view(owner, band.rolling_flux_avg, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_thresholds"].append(_owned_view(owner, band.rolling_threshold, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_lookbacks"].append(_owned_view(owner, band.rolling_lookback, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_avg_deltas"].append(_owned_view(owner, band.rolling_avg_delta, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_total_deltas"].append(_owned_view(owner, band.rolling_total_delta, num_frames, cnp.NPY_FLOAT32))
+        result["rolling_p_counts"].append(_owned_view(owner, band.rolling_p_count, num_frames, cnp.NPY_INT32))
 
         band_peaks = []
-        for k in range(res.bands[i].num_peaks):
-            pr = res.bands[i].peaks[k]
-            peak_data = {
+        for k in range(band.num_peaks):
+            pr = &band.peaks[k]
+            snapshot = np.zeros(5001, dtype=np.float64)
+            peak_snapshot_from_envelope(pr, band.envelope, num_frames, <double*>snapshot.data)
+            qualifiers = []
+            for j in range(pr.num_qualifiers):
+                q = &band.qualifiers[pr.qualifier_start + j]
+                qualifiers.append({'ms': q.ms, 'orig_ms': q.orig_ms, 'val': q.val})
+            band_peaks.append({
                 'p_idx': pr.p_idx,
                 'band_idx': pr.band_idx,
                 'time': pr.time,
@@ -410,80 +425,205 @@ def analyze_audio(cnp.ndarray[float, ndim=1] y, int sr):
                 'left_min': pr.left_min,
                 'right_min': pr.right_min,
                 'prominence': pr.prominence,
-                'qualifiers': [],
-                'snapshot': np.zeros(5001, dtype=np.float64)
-            }
-            for j in range(pr.num_qualifiers):
-                peak_data['qualifiers'].append({
-                    'ms': pr.qualifiers[j].ms,
-                    'orig_ms': pr.qualifiers[j].orig_ms,
-                    'val': pr.qualifiers[j].val
-                })
-            memcpy(cnp.PyArray_DATA(peak_data['snapshot']), pr.snapshot, 5001 * sizeof(double))
-            band_peaks.append(peak_data)
+                'qualifiers': qualifiers,
+                'snapshot': snapshot
+            })
         full_peaks_list.append(band_peaks)
 
-    cdef cnp.ndarray[double, ndim=1] ratings = np.zeros(num_frames, dtype=np.float64)
-    memcpy(ratings.data, res.ratings, num_frames * sizeof(double))
-
-    cdef cnp.ndarray[double, ndim=1] std_devs = np.zeros(num_frames, dtype=np.float64)
-    memcpy(std_devs.data, res.std_devs, num_frames * sizeof(double))
-
-    cdef cnp.ndarray[double, ndim=1] means = np.zeros(num_frames, dtype=np.float64)
-    memcpy(means.data, res.means, num_frames * sizeof(double))
-
-    cdef cnp.ndarray[double, ndim=1] contrasts = np.zeros(num_frames, dtype=np.float64)
-    memcpy(contrasts.data, res.contrasts, num_frames * sizeof(double))
-
-    cdef cnp.ndarray[double, ndim=1] stability_scores = np.zeros(num_frames, dtype=np.float64)
-    memcpy(stability_scores.data, res.stability_scores, num_frames * sizeof(double))
-
-    cdef cnp.ndarray[double, ndim=1] highest_peaks_ms = np.zeros(num_frames, dtype=np.float64)
-    memcpy(highest_peaks_ms.data, res.highest_peaks_ms, num_frames * sizeof(double))
-
-    cdef cnp.ndarray[double, ndim=1] demarcation_lines = np.zeros(num_frames, dtype=np.float64)
-    memcpy(demarcation_lines.data, res.demarcation_lines, num_frames * sizeof(double))
-
-    cdef cnp.ndarray[float, ndim=1] rolling_global_flux_avgs = np.zeros(num_frames, dtype=np.float32)
-    memcpy(rolling_global_flux_avgs.data, res.rolling_global_flux_avg, num_frames * sizeof(float))
-
-    cdef cnp.ndarray[float, ndim=1] rolling_global_smoothing_avgs = np.zeros(num_frames, dtype=np.float32)
-    memcpy(rolling_global_smoothing_avgs.data, res.rolling_global_smoothing_avg, num_frames * sizeof(float))
-
-    cdef float max_peak_value = res.max_peak_value
-    cdef double min_score_seen = res.min_score_seen
-    cdef double max_score_seen = res.max_score_seen
-    cdef double tolerance = res.tolerance
-
-    analyzer_free_analysis(&res)
-
-    return {
-        "times": times,
+    result.update({
+        "times": _owned_view(owner, res.times, num_frames, cnp.NPY_FLOAT32),
         "sample_rate": int(sr),
-        "max_peak_value": float(max_peak_value),
-        "min_score_seen": float(min_score_seen),
-        "max_score_seen": float(max_score_seen),
-        "tolerance": float(tolerance),
-        "onset_envs": onset_envs,
-        "rolling_dynamic_smoothings": rolling_dynamic_smoothings,
-        "rolling_prominences": rolling_prominences,
-        "rolling_prominence_avgs": rolling_prominence_avgs,
-        "rolling_prominence_half_maxes": rolling_prominence_half_maxes,
-        "rolling_smoothing_avgs": rolling_smoothing_avgs,
-        "rolling_flux_avgs": rolling_flux_avgs,
-        "rolling_global_flux_avgs": rolling_global_flux_avgs,
-        "rolling_global_smoothing_avgs": rolling_global_smoothing_avgs,
-        "rolling_thresholds": rolling_thresholds,
-        "rolling_lookbacks": rolling_lookbacks,
-        "rolling_avg_deltas": rolling_avg_deltas,
-        "rolling_total_deltas": rolling_total_deltas,
-        "rolling_p_counts": rolling_p_counts,
+        "max_peak_value": float(res.max_peak_value),
+        "min_score_seen": float(res.min_score_seen),
+        "max_score_seen": float(res.max_score_seen),
+        "tolerance": float(res.tolerance),
+        "rolling_global_flux_avgs": _owned_view(owner, res.rolling_global_flux_avg, num_frames, cnp.NPY_FLOAT32),
+        "rolling_global_smoothing_avgs": _owned_view(owner, res.rolling_global_smoothing_avg, num_frames, cnp.NPY_FLOAT32),
         "peaks": full_peaks_list,
-        "ratings": ratings,
-        "std_devs": std_devs,
-        "means": means,
-        "contrasts": contrasts,
-        "stability_scores": stability_scores,
-        "highest_peaks_ms": highest_peaks_ms,
-        "demarcation_lines": demarcation_lines
-    }
+        "ratings": _owned_view(owner, res.ratings, num_frames, cnp.NPY_FLOAT64),
+        "std_devs": _owned_view(owner, res.std_devs, num_frames, cnp.NPY_FLOAT64),
+        "means": _owned_view(owner, res.means, num_frames, cnp.NPY_FLOAT64),
+        "contrasts": _owned_view(owner, res.contrasts, num_frames, cnp.NPY_FLOAT64),
+        "stability_scores": _owned_view(owner, res.stability_scores, num_frames, cnp.NPY_FLOAT64),
+        "highest_peaks_ms": _owned_view(owner, res.highest_peaks_ms, num_frames, cnp.NPY_FLOAT64),
+        "demarcation_lines": _owned_view(owner, res.demarcation_lines, num_frames, cnp.NPY_FLOAT64)
+    })
+    return result
+
+def _load_audio(path, sr):
+    import librosa
+    y, sr = librosa.load(path, sr=sr, mono=True)
+    return y, sr
+
+def analyze_many(inputs, int sr=44100, threads=None, loader=None):
+    """Analyzes several inputs concurrently on a thread pool, yielding results in input order.
+
+    Each input is a file path, a float array at sr, or a (array, sample_rate) pair. Paths are
+    decoded with loader(path, sr) -> (y, sr), librosa by default. At most threads + 1 results
+    are held ahead of the consumer."""
+    from collections import deque
+    from concurrent.futures import ThreadPoolExecutor
+    if threads is None:
+        threads = os.cpu_count() or 1
+    if loader is None:
+        loader = _load_audio
+
+    def run(item):
+        if isinstance(item, (str, bytes, os.PathLike)):
+            y, item_sr = loader(item, sr)
+        elif isinstance(item, tuple):
+            y, item_sr = item
+        else:
+            y, item_sr = item, sr
+        return analyze_audio(y, item_sr)
+
+    with ThreadPoolExecutor(max_workers=threads) as pool:
+        pending = deque()
+        for item in inputs:
+            pending.append(pool.submit(run, item))
+            if len(pending) > threads:
+                yield pending.popleft().result()
+        while pending:
+            yield pending.popleft().result()
+
+cdef class AnalysisFileStream:
+    """Analyzes audio pushed in pieces straight into a columnar file (see ct_analysis_file.h), in
+    constant memory. Load the result with read_analysis_file."""
+    cdef AnalysisStream* stream
+    cdef AnalysisFileWriter* writer
+
+    def __cinit__(self, path, int sr, int threads=1):
+        cdef AnalysisSink sink
+        cdef bytes path_bytes = os.fsencode(path)
+        self.writer = analysis_file_open(path_bytes, sr, &sink)
+        if self.writer == NULL:
+            raise IOError(f"Could not open {path} for writing")
+        self.stream = analyzer_stream_create(sr, threads, &sink)
+        if self.stream == NULL:
+            analysis_file_close(self.writer)
+            self.writer = NULL
+            raise MemoryError()
+
+    def __dealloc__(self):
+        if self.stream != NULL:
+            analyzer_stream_destroy(self.stream)
+        if self.writer != NULL:
+            analysis_file_close(self.writer)
+
+    def push(self, cnp.ndarray[float, ndim=1, mode="c"] y):
+        if self.stream == NULL or not analyzer_stream_push(self.stream, <float*>y.data, len(y)):
+            raise RuntimeError("Analysis stream is closed or out of memory")
+
+    def close(self):
+        """Analyzes the tail of the input and closes the file. Returns False if a write failed."""
+        if self.stream == NULL:
+            return False
+        analyzer_stream_finish(self.stream)
+        analyzer_stream_destroy(self.stream)
+        self.stream = NULL
+        cdef int ok = analysis_file_close(self.writer)
+        self.writer = NULL
+        return bool(ok)
+
+
+# Column layout of the FRMS and PEAK records: (key, dtype, one column per band)
+_FRAME_COLUMNS = [
+    ("frames", "<i4", False), ("times", "<f4", False),
+    ("onset_envs", "<f4", True), ("rolling_dynamic_smoothings", "<f4", True),
+    ("rolling_prominences", "<f4", True), ("rolling_prominence_avgs", "<f4", True),
+    ("rolling_prominence_half_maxes", "<f4", True), ("rolling_smoothing_avgs", "<f4", True),
+    ("rolling_flux_avgs", "<f4", True), ("rolling_thresholds", "<f4", True),
+    ("rolling_lookbacks", "<f4", True), ("rolling_avg_deltas", "<f4", True),
+    ("rolling_total_deltas", "<f4", True), ("rolling_p_counts", "<i4", True),
+    ("ratings", "<f8", False), ("std_devs", "<f8", False), ("means", "<f8", False),
+    ("contrasts", "<f8", False), ("stability_scores", "<f8", False),
+    ("highest_peaks_ms", "<f8", False), ("demarcation_lines", "<f8", False),
+    ("rolling_global_flux_avgs", "<f4", False), ("rolling_global_smoothing_avgs", "<f4", False),
+]
+_PEAK_COLUMNS = [
+    ("p_idx", "<i4"), ("band_idx", "<i4"), ("time", "<f8"), ("peak_val", "<f8"),
+    ("total_score", "<f8"), ("detected_peak_val", "<f8"), ("thresh_val", "<f8"),
+    ("left_min", "<f8"), ("right_min", "<f8"), ("prominence", "<f8"), ("num_qualifiers", "<i4"),
+    ("snapshot_p_idx", "<i4"), ("snapshot_src_offset", "<i4"), ("snapshot_norm", "<f8"),
+]
+
+def read_analysis_file(path):
+    """Loads a file written by AnalysisFileStream into the dictionary analyze_audio returns."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"CTAF":
+        raise ValueError(f"{path} is not a transience analysis file")
+    version, sr, _ = np.frombuffer(data, "<i4", 3, 4)
+    if version != 1:
+        raise ValueError(f"Unsupported analysis file version {version}")
+
+    pos = 16
+    def take(dtype, n):
+        nonlocal pos
+        a = np.frombuffer(data, dtype, n, pos)
+        pos += a.nbytes
+        return a
+
+    columns = {key: [] for key, _, _ in _FRAME_COLUMNS}
+    peak_columns = {key: [] for key, _ in _PEAK_COLUMNS}
+    qualifier_columns = {"ms": [], "val": [], "orig_ms": []}
+    summary = None
+    while pos < len(data):
+        tag = data[pos:pos + 4]
+        n = int(np.frombuffer(data, "<i4", 1, pos + 4)[0])
+        pos += 8
+        if tag == b"FRMS":
+            for key, dtype, per_band in _FRAME_COLUMNS:
+                columns[key].append([take(dtype, n) for _ in range(4)] if per_band else take(dtype, n))
+        elif tag == b"PEAK":
+            for key, dtype in _PEAK_COLUMNS:
+                peak_columns[key].append(take(dtype, n))
+            nq = int(take("<i4", 1)[0])
+            for key in ("ms", "val", "orig_ms"):
+                qualifier_columns[key].append(take("<f8", nq))
+        elif tag == b"SUMM":
+            summary = (int(take("<i4", 1)[0]), float(take("<f4", 1)[0]), float(take("<f8", 1)[0]),
+                       float(take("<f8", 1)[0]), float(take("<f8", 1)[0]))
+        else:
+            raise ValueError(f"Unknown record {tag!r} in {path}")
+    if summary is None:
+        raise ValueError(f"{path} is incomplete (the stream was not closed)")
+
+    num_frames = summary[0]
+    index = np.concatenate(columns.pop("frames")) if columns["times"] else np.zeros(0, dtype=np.int32)
+    result = {"sample_rate": int(sr), "max_peak_value": summary[1], "min_score_seen": summary[2],
+              "max_score_seen": summary[3], "tolerance": summary[4]}
+    for key, dtype, per_band in _FRAME_COLUMNS[1:]:
+        if per_band:
+            result[key] = []
+            for b in range(4):
+                arr = np.zeros(num_frames, dtype=np.dtype(dtype).newbyteorder("="))
+                arr[index] = np.concatenate([chunk[b] for chunk in columns[key]]) if columns[key] else []
+                result[key].append(arr)
+        else:
+            arr = np.zeros(num_frames, dtype=np.dtype(dtype).newbyteorder("="))
+            arr[index] = np.concatenate(columns[key]) if columns[key] else []
+            result[key] = arr
+
+    peaks = {key: (np.concatenate(v) if v else np.zeros(0)) for key, v in peak_columns.items()}
+    qualifiers = {key: (np.concatenate(v) if v else np.zeros(0)) for key, v in qualifier_columns.items()}
+    result["peaks"] = [[] for _ in range(4)]
+    q_at = 0
+    for k in range(len(peaks["p_idx"])):
+        b = int(peaks["band_idx"][k])
+        nq = int(peaks["num_qualifiers"][k])
+        peak_data = {key: peaks[key][k].item() for key, _ in _PEAK_COLUMNS[:10]}
+        peak_data["qualifiers"] = [{"ms": float(qualifiers["ms"][q]), "orig_ms": float(qualifiers["orig_ms"][q]),
+                                    "val": float(qualifiers["val"][q])} for q in range(q_at, q_at + nq)]
+        q_at += nq
+        # Rebuild the snapshot from the envelope, as peak_snapshot_from_envelope does
+        env = result["onset_envs"][b]
+        snapshot = np.zeros(5001, dtype=np.float64)
+        start = int(peaks["snapshot_p_idx"][k]) - 5000
+        lo = max(int(peaks["snapshot_src_offset"][k]), -start)
+        hi = min(5001, num_frames - start)
+        if hi > lo:
+            snapshot[lo:hi] = peaks["snapshot_norm"][k] * env[start + lo:start + hi].astype(np.float64)
+        peak_data["snapshot"] = snapshot
+        result["peaks"][b].append(peak_data)
+    return result
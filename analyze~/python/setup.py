@@ -6,9 +6,10 @@ import os
 extensions = [
     Extension(
         "cumulative_transience",
-        sources=["ct_extension.pyx", "../cumulative_transience.c"],
+        sources=["ct_extension.pyx", "../cumulative_transience.c", "../ct_kernels.c", "../ct_analysis_file.c"],
         include_dirs=[np.get_include(), ".", ".."],
-        extra_compile_args=["-O3"] if os.name != "nt" else ["/O2"],
+        extra_compile_args=["-O3", "-pthread"] if os.name != "nt" else ["/O2"],
+        extra_link_args=["-pthread"] if os.name != "nt" else [],
     )
 ]
 
@@ -0,0 +1,548 @@
+// Golden-output regression suite for the transient analyzer. Runs fixed synthetic inputs through
+// the analyzer in 100 ms chunks, as analyze~ does, and compares every chunk's peaks, qualifiers,
+// AnalyzerMetrics and per-frame envelopes against golden files recorded on the reference path
+// (scalar kernels, full metric scans, analyzer_analyze_chunk), within the per-field tolerances
+// below. Each fast path is checked against the same goldens. Build and run with `make test`.
+#include "cumulative_transience.h"
+#include "ct_kernels.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define GOLDEN_MAGIC "CTGD"
+#define GOLDEN_VERSION 1
+#define CHUNK_FRAMES 100
+#define GOLDEN_MAX_METRICS 64   // Room for the AnalyzerMetrics values below
+
+// A field's values match when |got - expected| <= abs + rel * |expected|
+typedef struct {
+    const char* name;
+    double abs;
+    double rel;
+} Tolerance;
+
+enum {
+    TOL_ENVELOPE, TOL_SMOOTHING, TOL_PROMINENCE,
+    TOL_ACCUMULATOR, TOL_SCORE, TOL_STABILITY, TOL_HIGHEST_PEAK, TOL_EXACT, TOL_BAND_AVG, TOL_MIDPOINT,
+    TOL_PEAK_VALUE, TOL_QUALIFIER_MS, TOL_QUALIFIER_VAL, TOL_NORM,
+    NUM_TOLERANCES
+};
+
+static const Tolerance tolerances[NUM_TOLERANCES] = {
+    [TOL_ENVELOPE]      = { "envelope",          1e-6, 1e-5 },
+    [TOL_SMOOTHING]     = { "dynamic_smoothing", 1e-6, 1e-5 },
+    [TOL_PROMINENCE]    = { "prominence",        1e-6, 1e-5 },
+    [TOL_ACCUMULATOR]   = { "accumulator stats", 1e-9, 1e-6 },  // std_dev, mean, contrast, demarcation
+    [TOL_SCORE]         = { "scores",            1e-9, 1e-6 },  // rating, min/max score seen
+    [TOL_STABILITY]     = { "stability",         1e-9, 1e-9 },
+    [TOL_HIGHEST_PEAK]  = { "highest_peak_ms",   1.0,  0.0 },   // One frame
+    [TOL_EXACT]         = { "counts and flags",  0.0,  0.0 },
+    [TOL_BAND_AVG]      = { "15 s band averages", 1e-7, 1e-5 },
+    [TOL_MIDPOINT]      = { "band midpoints",    1e-6, 1e-5 },
+    [TOL_PEAK_VALUE]    = { "peak values",       1e-7, 1e-5 },
+    [TOL_QUALIFIER_MS]  = { "qualifier ms",      1.0,  0.0 },   // Snapping may move by one frame
+    [TOL_QUALIFIER_VAL] = { "qualifier val",     1e-6, 1e-4 },
+    [TOL_NORM]          = { "snapshot norm",     1e-9, 1e-6 },
+};
+
+// AnalyzerMetrics fields in file order, with their tolerance
+typedef struct {
+    const char* name;
+    size_t offset;
+    int is_int;
+    int count;
+    int tol;
+} MetricField;
+
+#define METRIC(f, n, t) { #f, offsetof(AnalyzerMetrics, f), 0, n, t }
+#define METRIC_INT(f, n, t) { #f, offsetof(AnalyzerMetrics, f), 1, n, t }
+static const MetricField metric_fields[] = {
+    METRIC(std_dev, 1, TOL_ACCUMULATOR),
+    METRIC(mean, 1, TOL_ACCUMULATOR),
+    METRIC(contrast, 1, TOL_ACCUMULATOR),
+    METRIC(stability_score, 1, TOL_STABILITY),
+    METRIC(rating, 1, TOL_SCORE),
+    METRIC(highest_peak_ms, 1, TOL_HIGHEST_PEAK),
+    METRIC_INT(highest_peak_valid, 1, TOL_EXACT),
+    METRIC(min_score_seen, 1, TOL_SCORE),
+    METRIC(max_score_seen, 1, TOL_SCORE),
+    METRIC(demarcation_line, 1, TOL_ACCUMULATOR),
+    METRIC(band_midpoints, MAX_BANDS, TOL_MIDPOINT),
+    METRIC(band_lookbacks, MAX_BANDS, TOL_EXACT),
+    METRIC(band_avg_deltas, MAX_BANDS, TOL_EXACT),
+    METRIC(band_total_deltas, MAX_BANDS, TOL_EXACT),
+    METRIC_INT(band_p_counts, MAX_BANDS, TOL_EXACT),
+    METRIC(band_prominence_avgs, MAX_BANDS, TOL_BAND_AVG),
+    METRIC(band_prominence_half_maxes, MAX_BANDS, TOL_BAND_AVG),
+    METRIC(band_smoothing_avgs, MAX_BANDS, TOL_BAND_AVG),
+    METRIC(band_flux_avgs, MAX_BANDS, TOL_BAND_AVG),
+    METRIC(global_flux_avg, 1, TOL_BAND_AVG),
+    METRIC(global_smoothing_avg, 1, TOL_BAND_AVG),
+};
+#define NUM_METRIC_FIELDS ((int)(sizeof(metric_fields) / sizeof(metric_fields[0])))
+
+// ---------------------------------------------------------------------------------------------
+// Inputs. Generated rather than stored; integer noise keeps them identical on every platform up to
+// the last bits of expf/sin, which the tolerances absorb.
+
+typedef struct {
+    const char* name;
+    int sr;
+    double seconds;
+    void (*make)(float* y, int len, int sr);
+} GoldenCase;
+
+static unsigned int noise_state;
+static float noise(void) {
+    noise_state = noise_state * 1103515245u + 12345u;
+    return (float)((noise_state >> 8) & 0xffff) / 32768.0f - 1.0f;
+}
+
+static void add_burst(float* y, int len, int sr, int s, float amp, double freq) {
+    for (int j = 0; j < sr / 20 && s + j < len; j++) {
+        float env = amp * expf(-(float)j / (float)(sr / 400));
+        y[s + j] += (freq > 0) ? env * (float)sin(2.0 * M_PI * freq * j / sr) : env * noise();
+    }
+}
+
+// 120 BPM noise clicks with accents; long enough for the first snapshots to expire
+static void make_clicks(float* y, int len, int sr) {
+    for (int i = 0; i < len; i++) y[i] = 0.005f * noise();
+    for (int k = 0, s = sr / 10; s < len; k++, s += sr / 2) add_burst(y, len, sr, s, (k % 4) ? 0.5f : 0.9f, 0.0);
+}
+
+// Pitched hits cycling through the four bands while the tempo rises from 60 to 240 BPM
+static void make_sweep(float* y, int len, int sr) {
+    static const double freqs[4] = { 80.0, 600.0, 3000.0, 9000.0 };
+    double seconds = (double)len / sr;
+    for (int i = 0; i < len; i++) y[i] = 0.005f * noise();
+    double t = 0.1;
+    for (int k = 0; t < seconds; k++) {
+        add_burst(y, len, sr, (int)(t * sr), 0.4f + 0.1f * (k % 5), freqs[k % 4]);
+        t += 60.0 / (60.0 + 180.0 * t / seconds);
+    }
+}
+
+// 3 against 4 at 48 kHz with a silent gap and a noise swell
+static void make_mixed(float* y, int len, int sr) {
+    for (int i = 0; i < len; i++) {
+        double t = (double)i / sr;
+        float swell = (t > 4.0 && t < 5.0) ? (float)(0.2 * (t - 4.0)) : 0.0f;
+        y[i] = (t > 2.0 && t < 2.5) ? 0.0f : (0.004f + swell) * noise();
+    }
+    for (int s = sr / 20; s < len; s += sr / 3) add_burst(y, len, sr, s, 0.6f, 0.0);
+    for (int s = sr / 20; s < len; s += sr / 4) add_burst(y, len, sr, s, 0.5f, 1500.0);
+}
+
+static const GoldenCase cases[] = {
+    { "clicks_44k", 44100, 16.5, make_clicks },
+    { "sweep_44k", 44100, 16.5, make_sweep },
+    { "sweep_22k", 22050, 16.5, make_sweep },   // Where the real-input STFT rounds differently from the old complex FFT
+    { "mixed_48k", 48000, 6.0, make_mixed },
+};
+#define NUM_CASES ((int)(sizeof(cases) / sizeof(cases[0])))
+
+// ---------------------------------------------------------------------------------------------
+// Paths. Every configuration feeds the same 100 ms chunks with the frame ranges analyze~ uses.
+
+enum { PATH_CHUNK, PATH_LIVE, PATH_LANES };
+
+typedef struct {
+    const char* name;
+    int simd;           // CT_SIMD_* level, or -1 for the best the CPU has
+    int metrics_mode;
+    int path;           // PATH_CHUNK: analyzer_analyze_chunk; PATH_LIVE: pushes from a capture ring
+                        // as analyze~ does; PATH_LANES: two channels through analyzer_push_audio_lanes
+} GoldenConfig;
+
+static const GoldenConfig configs[] = {
+    { "reference", CT_SIMD_SCALAR, CT_METRICS_FULL, PATH_CHUNK },
+    { "simd", -1, CT_METRICS_FULL, PATH_CHUNK },
+    { "live", -1, CT_METRICS_INCREMENTAL, PATH_LIVE },
+    { "lanes", -1, CT_METRICS_INCREMENTAL, PATH_LANES },
+};
+#define NUM_CONFIGS ((int)(sizeof(configs) / sizeof(configs[0])))
+
+// What one chunk produced
+typedef struct {
+    int active_start_frame;
+    double metrics[GOLDEN_MAX_METRICS];
+    float frames[3][MAX_BANDS][CHUNK_FRAMES];  // envelope, dynamic smoothing, prominence
+    int num_peaks;
+    PeakResult peaks[MAX_PEAKS_PER_CHUNK];
+    Qualifier qualifiers[MAX_CHUNK_QUALIFIERS];
+} ChunkRecord;
+
+static void record_chunk(ChunkRecord* rec, int active_start_frame, const ChunkAnalysisResult* res) {
+    rec->active_start_frame = active_start_frame;
+    int k = 0;
+    for (int f = 0; f < NUM_METRIC_FIELDS; f++) {
+        const char* base = (const char*)&res->metrics + metric_fields[f].offset;
+        for (int i = 0; i < metric_fields[f].count; i++) {
+            rec->metrics[k++] = metric_fields[f].is_int ? (double)((const int*)base)[i] : ((const double*)base)[i];
+        }
+    }
+    memcpy(rec->frames[0], res->last_flux, sizeof(rec->frames[0]));
+    memcpy(rec->frames[1], res->last_dynamic_smoothing, sizeof(rec->frames[1]));
+    memcpy(rec->frames[2], res->last_prominence, sizeof(rec->frames[2]));
+    rec->num_peaks = res->peak_list.num_peaks;
+    memcpy(rec->peaks, res->peak_list.peaks, sizeof(PeakResult) * rec->num_peaks);
+    memcpy(rec->qualifiers, res->peak_list.qualifiers, sizeof(Qualifier) * res->peak_list.num_qualifiers);
+}
+
+static int metric_values(void) {
+    int n = 0;
+    for (int f = 0; f < NUM_METRIC_FIELDS; f++) n += metric_fields[f].count;
+    return n;
+}
+
+// Analyze a case on a configuration; returns the number of chunks written to recs
+static int run_case(const GoldenCase* gc, const GoldenConfig* cfg, const float* y, int len, ChunkRecord* recs) {
+    int sr = gc->sr, hop = (int)(sr * 0.1), ms = (int)(sr * 0.001);
+    int lanes = (cfg->path == PATH_LANES) ? 2 : 1;
+    TransientAnalyzer* a[2];
+    for (int l = 0; l < lanes; l++) {
+        a[l] = analyzer_create(1.0, NULL, NULL, NULL, NULL);
+        analyzer_set_sample_rate(a[l], sr);
+        analyzer_set_metrics_mode(a[l], cfg->metrics_mode);
+    }
+    ChunkAnalysisResult* res = (ChunkAnalysisResult*)calloc(1, sizeof(ChunkAnalysisResult));
+
+    // A one second capture ring, so the live path reads frames across the wrap
+    int ring_size = sr;
+    float* ring = (float*)calloc((size_t)ring_size, sizeof(float));
+    long long written = 0;
+
+    int n = 0;
+    for (long long target = hop; target <= len; target += hop) {
+        int active_start_samples = (int)(target - hop - (int)(sr * 0.2));
+        int window_start_samples = active_start_samples - (int)(sr * 15.0);
+        if (window_start_samples < 0) window_start_samples = 0;
+        int active_start_frame = active_start_samples / ms, buffer_start_frame = window_start_samples / ms;
+
+        if (cfg->path == PATH_CHUNK) {
+            analyzer_analyze_chunk(a[0], y + target - hop, hop, sr, buffer_start_frame, active_start_frame, res);
+        } else {
+            for (; written < target; written++) ring[written % ring_size] = y[written];
+            int history = analyzer_view_history(a[0]);
+            if (history + hop > ring_size) history = ring_size - hop;
+            AudioView views[2];
+            int start = (int)((target - hop - history) % ring_size);
+            for (int l = 0; l < lanes; l++) audio_view_from_ring(&views[l], ring, ring_size, start, history + hop);
+            if (cfg->path == PATH_LANES) analyzer_push_audio_lanes(a, views, lanes, hop, sr);
+            else analyzer_push_audio_view(a[0], &views[0], hop, sr);
+            // Lane 0 is committed last so res holds its chunk; the lanes do not share a buffer
+            for (int l = lanes - 1; l >= 0; l--) {
+                analyzer_chunk_prepare_pushed(a[l], active_start_frame);
+                analyzer_chunk_commit(a[l], res);
+            }
+        }
+        record_chunk(&recs[n++], active_start_frame, res);
+    }
+
+    free(ring);
+    free(res);
+    for (int l = 0; l < lanes; l++) analyzer_destroy(a[l]);
+    return n;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Golden files: little-endian, as written on x86.
+//   "CTGD" int32 version, sr, samples, chunks, metric values per chunk
+//   per chunk: int32 active_start_frame, double metrics[], float frames[3][4][100], int32 num_peaks,
+//   per peak: int32 p_idx, band_idx, num_qualifiers, snapshot src_offset; double peak_val, total_score,
+//   detected_peak_val, thresh_val, left_min, right_min, prominence, snapshot norm; then per qualifier
+//   double ms, val, orig_ms
+
+typedef struct {
+    FILE* f;
+    int ok;
+} GoldenIO;
+
+static void io_write(GoldenIO* io, const void* p, size_t n) {
+    if (io->ok && fwrite(p, 1, n, io->f) != n) io->ok = 0;
+}
+
+static void io_read(GoldenIO* io, void* p, size_t n) {
+    if (io->ok && fread(p, 1, n, io->f) != n) io->ok = 0;
+    if (!io->ok) memset(p, 0, n);
+}
+
+static void golden_path(char* out, size_t size, const char* dir, const GoldenCase* gc) {
+    snprintf(out, size, "%s/%s.golden", dir, gc->name);
+}
+
+static int golden_write(const char* path, const GoldenCase* gc, int len, const ChunkRecord* recs, int n) {
+    GoldenIO io = { fopen(path, "wb"), 1 };
+    if (!io.f) return 0;
+    int nm = metric_values();
+    int header[5] = { GOLDEN_VERSION, gc->sr, len, n, nm };
+    io_write(&io, GOLDEN_MAGIC, 4);
+    io_write(&io, header, sizeof(header));
+    for (int c = 0; c < n; c++) {
+        const ChunkRecord* r = &recs[c];
+        io_write(&io, &r->active_start_frame, sizeof(int));
+        io_write(&io, r->metrics, sizeof(double) * nm);
+        io_write(&io, r->frames, sizeof(r->frames));
+        io_write(&io, &r->num_peaks, sizeof(int));
+        for (int i = 0; i < r->num_peaks; i++) {
+            const PeakResult* p = &r->peaks[i];
+            int ints[4] = { p->p_idx, p->band_idx, p->num_qualifiers, p->snapshot.src_offset };
+            double vals[8] = { p->peak_val, p->total_score, p->detected_peak_val, p->thresh_val, p->left_min, p->right_min, p->prominence, p->snapshot.norm };
+            io_write(&io, ints, sizeof(ints));
+            io_write(&io, vals, sizeof(vals));
+            for (int q = 0; q < p->num_qualifiers; q++) {
+                const Qualifier* qu = &r->qualifiers[p->qualifier_start + q];
+                double qv[3] = { qu->ms, qu->val, qu->orig_ms };
+                io_write(&io, qv, sizeof(qv));
+            }
+        }
+    }
+    if (fclose(io.f) != 0) io.ok = 0;
+    return io.ok;
+}
+
+// Returns the chunk count, or -1 if the file is missing, malformed or for another input
+static int golden_read(const char* path, const GoldenCase* gc, int len, ChunkRecord* recs, int max_chunks) {
+    GoldenIO io = { fopen(path, "rb"), 1 };
+    if (!io.f) return -1;
+    char magic[4];
+    int header[5];
+    io_read(&io, magic, 4);
+    io_read(&io, header, sizeof(header));
+    int n = header[3];
+    if (!io.ok || memcmp(magic, GOLDEN_MAGIC, 4) || header[0] != GOLDEN_VERSION || header[1] != gc->sr ||
+        header[2] != len || header[4] != metric_values() || n < 0 || n > max_chunks) {
+        fclose(io.f);
+        return -1;
+    }
+    for (int c = 0; c < n && io.ok; c++) {
+        ChunkRecord* r = &recs[c];
+        io_read(&io, &r->active_start_frame, sizeof(int));
+        io_read(&io, r->metrics, sizeof(double) * header[4]);
+        io_read(&io, r->frames, sizeof(r->frames));
+        io_read(&io, &r->num_peaks, sizeof(int));
+        if (r->num_peaks < 0 || r->num_peaks > MAX_PEAKS_PER_CHUNK) io.ok = 0;
+        int nq = 0;
+        for (int i = 0; i < r->num_peaks && io.ok; i++) {
+            PeakResult* p = &r->peaks[i];
+            int ints[4];
+            double vals[8];
+            io_read(&io, ints, sizeof(ints));
+            io_read(&io, vals, sizeof(vals));
+            p->p_idx = ints[0]; p->band_idx = ints[1]; p->num_qualifiers = ints[2]; p->snapshot.src_offset = ints[3];
+            p->peak_val = vals[0]; p->total_score = vals[1]; p->detected_peak_val = vals[2]; p->thresh_val = vals[3];
+            p->left_min = vals[4]; p->right_min = vals[5]; p->prominence = vals[6]; p->snapshot.norm = vals[7];
+            p->qualifier_start = nq;
+            if (p->num_qualifiers < 0 || nq + p->num_qualifiers > MAX_CHUNK_QUALIFIERS) { io.ok = 0; break; }
+            for (int q = 0; q < p->num_qualifiers; q++, nq++) {
+                double qv[3];
+                io_read(&io, qv, sizeof(qv));
+                r->qualifiers[nq].ms = qv[0]; r->qualifiers[nq].val = qv[1]; r->qualifiers[nq].orig_ms = qv[2];
+            }
+        }
+    }
+    fclose(io.f);
+    return io.ok ? n : -1;
+}
+
+// ---------------------------------------------------------------------------------------------
+// Comparison
+
+typedef struct {
+    long long count;            // Values out of tolerance
+    double max_err;             // Largest absolute error, in or out of tolerance
+} FieldStats;
+
+typedef struct {
+    long long first_frame;      // Earliest frame with a divergence (LLONG_MAX if none)
+    char first[256];
+    long long divergences;
+    FieldStats per_tol[NUM_TOLERANCES];
+} Comparison;
+
+static void compare_value(Comparison* cmp, int tol, const char* what, long long frame, double expected, double got) {
+    const Tolerance* t = &tolerances[tol];
+    FieldStats* fs = &cmp->per_tol[tol];
+    double err = fabs(got - expected);
+    if (isnan(expected) && isnan(got)) return;
+    if (err > fs->max_err || isnan(err)) fs->max_err = err;
+    if (err <= t->abs + t->rel * fabs(expected)) return;
+    cmp->divergences++;
+    fs->count++;
+    if (frame < cmp->first_frame) {
+        cmp->first_frame = frame;
+        snprintf(cmp->first, sizeof(cmp->first), "%s expected %.10g got %.10g (tolerance %g + %g*|expected|)", what, expected, got, t->abs, t->rel);
+    }
+}
+
+static void compare_chunk(Comparison* cmp, const ChunkRecord* exp, const ChunkRecord* got) {
+    static const char* const frame_names[3] = { "envelope", "dynamic_smoothing", "prominence" };
+    static const int frame_tols[3] = { TOL_ENVELOPE, TOL_SMOOTHING, TOL_PROMINENCE };
+    char what[160];
+    long long end_frame = exp->active_start_frame + CHUNK_FRAMES;
+
+    compare_value(cmp, TOL_EXACT, "active_start_frame", exp->active_start_frame, exp->active_start_frame, got->active_start_frame);
+    for (int k = 0; k < 3; k++) for (int b = 0; b < MAX_BANDS; b++) for (int i = 0; i < CHUNK_FRAMES; i++) {
+        snprintf(what, sizeof(what), "%s[band %d]", frame_names[k], b);
+        compare_value(cmp, frame_tols[k], what, exp->active_start_frame + i, exp->frames[k][b][i], got->frames[k][b][i]);
+    }
+
+    // Metrics describe the state at the end of the chunk
+    int m = 0;
+    for (int f = 0; f < NUM_METRIC_FIELDS; f++) {
+        for (int i = 0; i < metric_fields[f].count; i++, m++) {
+            if (metric_fields[f].count > 1) snprintf(what, sizeof(what), "metrics.%s[%d]", metric_fields[f].name, i);
+            else snprintf(what, sizeof(what), "metrics.%s", metric_fields[f].name);
+            compare_value(cmp, metric_fields[f].tol, what, end_frame, exp->metrics[m], got->metrics[m]);
+        }
+    }
+
+    // Peaks are matched by frame and band; a missing or extra peak diverges at its frame
+    for (int i = 0; i < exp->num_peaks; i++) {
+        const PeakResult* e = &exp->peaks[i];
+        const PeakResult* g = NULL;
+        for (int j = 0; j < got->num_peaks; j++) {
+            if (got->peaks[j].p_idx == e->p_idx && got->peaks[j].band_idx == e->band_idx) { g = &got->peaks[j]; break; }
+        }
+        if (!g) {
+            snprintf(what, sizeof(what), "peak presence (band %d frame %d)", e->band_idx, e->p_idx);
+            compare_value(cmp, TOL_EXACT, what, e->p_idx, 1, 0);
+            continue;
+        }
+        snprintf(what, sizeof(what), "peak[band %d].peak_val", e->band_idx);
+        compare_value(cmp, TOL_PEAK_VALUE, what, e->p_idx, e->peak_val, g->peak_val);
+        snprintf(what, sizeof(what), "peak[band %d].detected_peak_val", e->band_idx);
+        compare_value(cmp, TOL_PEAK_VALUE, what, e->p_idx, e->detected_peak_val, g->detected_peak_val);
+        snprintf(what, sizeof(what), "peak[band %d].thresh_val", e->band_idx);
+        compare_value(cmp, TOL_PEAK_VALUE, what, e->p_idx, e->thresh_val, g->thresh_val);
+        snprintf(what, sizeof(what), "peak[band %d].left_min", e->band_idx);
+        compare_value(cmp, TOL_PEAK_VALUE, what, e->p_idx, e->left_min, g->left_min);
+        snprintf(what, sizeof(what), "peak[band %d].right_min", e->band_idx);
+        compare_value(cmp, TOL_PEAK_VALUE, what, e->p_idx, e->right_min, g->right_min);
+        snprintf(what, sizeof(what), "peak[band %d].prominence", e->band_idx);
+        compare_value(cmp, TOL_PEAK_VALUE, what, e->p_idx, e->prominence, g->prominence);
+        snprintf(what, sizeof(what), "peak[band %d].total_score", e->band_idx);
+        compare_value(cmp, TOL_SCORE, what, e->p_idx, e->total_score, g->total_score);
+        snprintf(what, sizeof(what), "peak[band %d].snapshot.src_offset", e->band_idx);
+        compare_value(cmp, TOL_EXACT, what, e->p_idx, e->snapshot.src_offset, g->snapshot.src_offset);
+        snprintf(what, sizeof(what), "peak[band %d].snapshot.norm", e->band_idx);
+        compare_value(cmp, TOL_NORM, what, e->p_idx, e->snapshot.norm, g->snapshot.norm);
+        snprintf(what, sizeof(what), "peak[band %d].num_qualifiers", e->band_idx);
+        compare_value(cmp, TOL_EXACT, what, e->p_idx, e->num_qualifiers, g->num_qualifiers);
+        int nq = e->num_qualifiers < g->num_qualifiers ? e->num_qualifiers : g->num_qualifiers;
+        for (int q = 0; q < nq; q++) {
+            const Qualifier* eq = &exp->qualifiers[e->qualifier_start + q];
+            const Qualifier* gq = &got->qualifiers[g->qualifier_start + q];
+            snprintf(what, sizeof(what), "peak[band %d].qualifier[%d].orig_ms", e->band_idx, q);
+            compare_value(cmp, TOL_EXACT, what, e->p_idx, eq->orig_ms, gq->orig_ms);
+            snprintf(what, sizeof(what), "peak[band %d].qualifier[%d].ms", e->band_idx, q);
+            compare_value(cmp, TOL_QUALIFIER_MS, what, e->p_idx, eq->ms, gq->ms);
+            snprintf(what, sizeof(what), "peak[band %d].qualifier[%d].val", e->band_idx, q);
+            compare_value(cmp, TOL_QUALIFIER_VAL, what, e->p_idx, eq->val, gq->val);
+        }
+    }
+    for (int j = 0; j < got->num_peaks; j++) {
+        const PeakResult* g = &got->peaks[j];
+        int found = 0;
+        for (int i = 0; i < exp->num_peaks && !found; i++) found = exp->peaks[i].p_idx == g->p_idx && exp->peaks[i].band_idx == g->band_idx;
+        if (!found) {
+            snprintf(what, sizeof(what), "peak presence (band %d frame %d)", g->band_idx, g->p_idx);
+            compare_value(cmp, TOL_EXACT, what, g->p_idx, 0, 1);
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: ct_golden [--update] [--dir DIR] [--config NAME] [--case NAME] [--verbose]\n"
+            "  --update    record the goldens on the reference path instead of checking\n"
+            "  --dir DIR   golden file directory (default: golden)\n"
+            "  --config    only check one of: reference, simd, live, lanes\n"
+            "  --case      only run one input\n"
+            "  --verbose   list every tolerance class, not only the failing ones\n");
+}
+
+int main(int argc, char** argv) {
+    const char* dir = "golden";
+    const char* only_config = NULL;
+    const char* only_case = NULL;
+    int update = 0, verbose = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--update")) update = 1;
+        else if (!strcmp(argv[i], "--verbose")) verbose = 1;
+        else if (!strcmp(argv[i], "--dir") && i + 1 < argc) dir = argv[++i];
+        else if (!strcmp(argv[i], "--config") && i + 1 < argc) only_config = argv[++i];
+        else if (!strcmp(argv[i], "--case") && i + 1 < argc) only_case = argv[++i];
+        else { usage(); return 2; }
+    }
+
+    if (metric_values() > GOLDEN_MAX_METRICS) { fprintf(stderr, "raise GOLDEN_MAX_METRICS\n"); return 1; }
+    int failures = 0, runs = 0;
+    for (int c = 0; c < NUM_CASES; c++) {
+        const GoldenCase* gc = &cases[c];
+        if (only_case && strcmp(only_case, gc->name)) continue;
+        int len = (int)(gc->seconds * gc->sr);
+        int max_chunks = len / (int)(gc->sr * 0.1) + 1;
+        float* y = (float*)calloc((size_t)len, sizeof(float));
+        ChunkRecord* golden = (ChunkRecord*)malloc(sizeof(ChunkRecord) * max_chunks);
+        ChunkRecord* got = (ChunkRecord*)malloc(sizeof(ChunkRecord) * max_chunks);
+        if (!y || !golden || !got) { fprintf(stderr, "out of memory\n"); return 1; }
+        noise_state = 12345;
+        gc->make(y, len, gc->sr);
+
+        char path[1024];
+        golden_path(path, sizeof(path), dir, gc);
+        if (update) {
+            ct_kernels_set_level(configs[0].simd);
+            int n = run_case(gc, &configs[0], y, len, got);
+            int ok = golden_write(path, gc, len, got, n);
+            printf("%-12s %s (%d chunks)\n", gc->name, ok ? "recorded" : "WRITE FAILED", n);
+            if (!ok) failures++;
+        } else {
+            int n = golden_read(path, gc, len, golden, max_chunks);
+            if (n < 0) {
+                printf("%-12s missing or stale golden %s (run with --update)\n", gc->name, path);
+                failures++;
+            }
+            for (int k = 0; k < NUM_CONFIGS && n >= 0; k++) {
+                const GoldenConfig* cfg = &configs[k];
+                if (only_config && strcmp(only_config, cfg->name)) continue;
+                ct_kernels_set_level(cfg->simd < 0 ? ct_kernels_detect_level() : cfg->simd);
+                int got_n = run_case(gc, cfg, y, len, got);
+                Comparison cmp;
+                memset(&cmp, 0, sizeof(cmp));
+                cmp.first_frame = LLONG_MAX;
+                compare_value(&cmp, TOL_EXACT, "chunk count", 0, n, got_n);
+                for (int i = 0; i < n && i < got_n; i++) compare_chunk(&cmp, &golden[i], &got[i]);
+                runs++;
+                if (cmp.divergences == 0) {
+                    printf("%-12s %-10s %-6s ok\n", gc->name, cfg->name, ct_kernels_get()->name);
+                } else {
+                    failures++;
+                    printf("%-12s %-10s %-6s FAILED: %lld values out of tolerance\n", gc->name, cfg->name, ct_kernels_get()->name, cmp.divergences);
+                    printf("    first diverging frame %lld (%.3f s): %s\n", cmp.first_frame,
+                           (double)cmp.first_frame * (int)(gc->sr * 0.001) / gc->sr, cmp.first);
+                }
+                for (int t = 0; t < NUM_TOLERANCES; t++) {
+                    if (cmp.per_tol[t].count || verbose) {
+                        printf("    %-20s %lld out of tolerance, max error %g\n", tolerances[t].name, cmp.per_tol[t].count, cmp.per_tol[t].max_err);
+                    }
+                }
+            }
+        }
+        free(y);
+        free(golden);
+        free(got);
+    }
+    if (!update) printf("%d of %d runs passed\n", runs - failures, runs);
+    return failures ? 1 : 0;
+}
@@ -20,110 +20,7 @@
 #endif
 #include <time.h>
 
-// Helper function to generate a hierarchical key symbol
-t_symbol* generate_hierarchical_key(t_symbol *palette, t_symbol *track, t_symbol *bar, t_symbol *key) {
-    char key_str[512];
-    snprintf(key_str, 512, "%s::%s::%s::%s", palette->s_name, track->s_name, bar->s_name, key->s_name);
-    return gensym(key_str);
-}
-
-// Helper function to parse a hierarchical key symbol.
-// Returns 1 on success, 0 on failure.
-// Pointers passed for palette, track, bar, and key will be set to newly allocated char buffers.
-// The caller is responsible for freeing these buffers.
-int parse_hierarchical_key(t_symbol *hierarchical_key, char **palette, char **track, char **bar, char **key) {
-    const char *key_str = hierarchical_key->s_name;
-    const char *first_delim = strstr(key_str, "::");
-    if (!first_delim) return 0;
-
-    const char *second_delim = strstr(first_delim + 2, "::");
-    if (!second_delim) return 0;
-
-    const char *third_delim = strstr(second_delim + 2, "::");
-    if (!third_delim) return 0;
-
-    size_t pal_len = first_delim - key_str;
-    *palette = (char *)sysmem_newptr(pal_len + 1);
-    strncpy(*palette, key_str, pal_len);
-    (*palette)[pal_len] = '\0';
-
-    size_t track_len = second_delim - (first_delim + 2);
-    *track = (char *)sysmem_newptr(track_len + 1);
-    strncpy(*track, first_delim + 2, track_len);
-    (*track)[track_len] = '\0';
-
-    size_t bar_len = third_delim - (second_delim + 2);
-    *bar = (char *)sysmem_newptr(bar_len + 1);
-    strncpy(*bar, second_delim + 2, bar_len);
-    (*bar)[bar_len] = '\0';
-
-    *key = (char *)sysmem_newptr(strlen(third_delim + 2) + 1);
-    strcpy(*key, third_delim + 2);
 
-    return 1;
-}
-
-
-// Helper function to convert an atomarray to a string for buildspans_loging
-char* atomarray_to_string(t_atomarray *arr) {
-    if (!arr) return NULL;
-
-    long count = atomarray_getsize(arr);
-    if (count == 0) {
-        char *empty_str = (char *)sysmem_newptr(3);
-        strcpy(empty_str, "[]");
-        return empty_str;
-    }
-
-    long buffer_size = 256; // Initial size
-    char *buffer = (char *)sysmem_newptr(buffer_size);
-    long offset = 0;
-
-    offset += snprintf(buffer + offset, buffer_size - offset, "[");
-
-    for (long i = 0; i < count; i++) {
-        t_atom a;
-        atomarray_getindex(arr, i, &a);
-
-        char temp_str[64];
-        if (atom_gettype(&a) == A_FLOAT) {
-            snprintf(temp_str, 64, "%.2f", atom_getfloat(&a));
-        } else if (atom_gettype(&a) == A_LONG) {
-            snprintf(temp_str, 64, "%ld", atom_getlong(&a));
-        } else {
-            snprintf(temp_str, 64, "?");
-        }
-
-        if (buffer_size - offset < strlen(temp_str) + 4) { // +4 for ", ]\0"
-            buffer_size *= 2;
-            buffer = (char *)sysmem_resizeptr(buffer, buffer_size);
-            if (!buffer) return NULL;
-        }
-
-        offset += snprintf(buffer + offset, buffer_size - offset, "%s", temp_str);
-        if (i < count - 1) {
-            offset += snprintf(buffer + offset, buffer_size - offset, ", ");
-        }
-    }
-
-    snprintf(buffer + offset, buffer_size - offset, "]");
-    return buffer;
-}
-
-
-// Helper function to create a deep copy of a t_atomarray
-t_atomarray* atomarray_deep_copy(t_atomarray *src) {
-    if (!src) {
-        return NULL;
-    }
-    long count;
-    t_atom *atoms;
-    atomarray_getatoms(src, &count, &atoms);
-
-    // atomarray_new with arguments creates a new array and copies the atoms from the source.
-    t_atomarray *dest = atomarray_new(count, atoms);
-    return dest;
-}
 
 
 // Comparison function for qsort
@@ -162,6 +59,220 @@ int compare_manifest_items(const void *a, const void *b) {
 }
 
 
+// Grow *buf to hold at least needed elements. Capacity doubles so repeated growth is amortized, new
+// elements are zeroed, and the buffer is never shrunk. Returns 0 if the allocation failed.
+int span_reserve(void **buf, long *capacity, long needed, size_t elem_size) {
+    if (needed <= *capacity) return 1;
+    long new_capacity = (*capacity > 0) ? *capacity : 8;
+    while (new_capacity < needed) new_capacity *= 2;
+    char *p = *buf ? (char *)sysmem_resizeptr(*buf, new_capacity * elem_size) : (char *)sysmem_newptr(new_capacity * elem_size);
+    if (!p) return 0;
+    memset(p + *capacity * elem_size, 0, (new_capacity - *capacity) * elem_size);
+    *buf = p;
+    *capacity = new_capacity;
+    return 1;
+}
+
+void span_index_init(t_span_index *idx) {
+    memset(idx, 0, sizeof(t_span_index));
+}
+
+void span_track_free(t_span_track *trk) {
+    for (long i = 0; i < trk->bar_capacity; i++) {
+        if (trk->bars[i].absolutes) sysmem_freeptr(trk->bars[i].absolutes);
+        if (trk->bars[i].scores) sysmem_freeptr(trk->bars[i].scores);
+    }
+    if (trk->bars) sysmem_freeptr(trk->bars);
+    sysmem_freeptr(trk);
+}
+
+void span_index_free(t_span_index *idx) {
+    for (long p = 0; p < idx->palette_count; p++) {
+        t_span_palette *pal = idx->palettes[p];
+        for (long t = 0; t < pal->track_count; t++) span_track_free(pal->tracks[t]);
+        if (pal->tracks) sysmem_freeptr(pal->tracks);
+        sysmem_freeptr(pal);
+    }
+    for (long t = 0; t < idx->spare_count; t++) span_track_free(idx->spare_tracks[t]);
+    if (idx->palettes) sysmem_freeptr(idx->palettes);
+    if (idx->spare_tracks) sysmem_freeptr(idx->spare_tracks);
+    if (idx->ended) sysmem_freeptr(idx->ended);
+    if (idx->candidates) sysmem_freeptr(idx->candidates);
+    if (idx->atoms) sysmem_freeptr(idx->atoms);
+    if (idx->handoff) sysmem_freeptr(idx->handoff);
+    span_index_init(idx);
+}
+
+// Retire a track to the spare list, keeping its bar and note buffers for the next span.
+void span_index_recycle_track(t_span_index *idx, t_span_track *trk) {
+    trk->bar_count = 0;
+    if (span_reserve((void **)&idx->spare_tracks, &idx->spare_capacity, idx->spare_count + 1, sizeof(t_span_track *))) {
+        idx->spare_tracks[idx->spare_count++] = trk;
+    } else {
+        span_track_free(trk);
+    }
+}
+
+void span_index_clear(t_span_index *idx) {
+    for (long p = 0; p < idx->palette_count; p++) {
+        t_span_palette *pal = idx->palettes[p];
+        for (long t = 0; t < pal->track_count; t++) span_index_recycle_track(idx, pal->tracks[t]);
+        pal->track_count = 0;
+    }
+    idx->ended_count = 0;
+}
+
+// Palettes are few, so a linear scan on the interned symbol is cheaper than any map.
+t_span_palette *span_index_palette(t_span_index *idx, t_symbol *palette, int create) {
+    for (long p = 0; p < idx->palette_count; p++) {
+        if (idx->palettes[p]->palette == palette) return idx->palettes[p];
+    }
+    if (!create) return NULL;
+    if (!span_reserve((void **)&idx->palettes, &idx->palette_capacity, idx->palette_count + 1, sizeof(t_span_palette *))) return NULL;
+    t_span_palette *pal = (t_span_palette *)sysmem_newptrclear(sizeof(t_span_palette));
+    if (!pal) return NULL;
+    pal->palette = palette;
+    idx->palettes[idx->palette_count++] = pal;
+    return pal;
+}
+
+t_span_track *span_index_track(t_span_index *idx, t_span_palette *pal, long track, long rounded_offset, int create) {
+    if (!pal) return NULL;
+    for (long t = 0; t < pal->track_count; t++) {
+        t_span_track *trk = pal->tracks[t];
+        if (trk->track == track && trk->rounded_offset == rounded_offset) return trk;
+    }
+    if (!create) return NULL;
+    if (!span_reserve((void **)&pal->tracks, &pal->track_capacity, pal->track_count + 1, sizeof(t_span_track *))) return NULL;
+    t_span_track *trk = (idx->spare_count > 0) ? idx->spare_tracks[--idx->spare_count] : (t_span_track *)sysmem_newptrclear(sizeof(t_span_track));
+    if (!trk) return NULL;
+    trk->track = track;
+    trk->rounded_offset = rounded_offset;
+    snprintf(trk->track_name, sizeof(trk->track_name), "%ld-%ld", track, rounded_offset);
+    trk->bar_count = 0;
+    trk->lowest_mean = 0.0;
+    trk->rating = 0.0;
+    pal->tracks[pal->track_count++] = trk;
+    return trk;
+}
+
+// Remove a track from its palette, preserving the order of the others. The pointer is invalid afterwards.
+void span_index_remove_track(t_span_index *idx, t_span_palette *pal, t_span_track *trk) {
+    for (long t = 0; t < pal->track_count; t++) {
+        if (pal->tracks[t] == trk) {
+            memmove(pal->tracks + t, pal->tracks + t + 1, (pal->track_count - t - 1) * sizeof(t_span_track *));
+            pal->track_count--;
+            span_index_recycle_track(idx, trk);
+            return;
+        }
+    }
+}
+
+// Queue a track for the cleanup check at the end of the current event (once per track).
+void span_index_mark_ended(t_span_index *idx, t_span_palette *pal, long track, long rounded_offset) {
+    for (long i = 0; i < idx->ended_count; i++) {
+        if (idx->ended[i].palette == pal && idx->ended[i].track == track && idx->ended[i].rounded_offset == rounded_offset) return;
+    }
+    if (!span_reserve((void **)&idx->ended, &idx->ended_capacity, idx->ended_count + 1, sizeof(t_span_ended))) return;
+    idx->ended[idx->ended_count].palette = pal;
+    idx->ended[idx->ended_count].track = track;
+    idx->ended[idx->ended_count].rounded_offset = rounded_offset;
+    idx->ended_count++;
+}
+
+t_atom *span_index_atoms(t_span_index *idx, long count) {
+    if (!span_reserve((void **)&idx->atoms, &idx->atom_capacity, count, sizeof(t_atom))) return NULL;
+    return idx->atoms;
+}
+
+// Binary search for a bar. Returns its index, or the index it should be inserted at if not found.
+long span_track_find_bar(t_span_track *trk, long timestamp, int *found) {
+    long lo = 0, hi = trk->bar_count;
+    while (lo < hi) {
+        long mid = (lo + hi) / 2;
+        if (trk->bars[mid].timestamp < timestamp) lo = mid + 1;
+        else hi = mid;
+    }
+    *found = (lo < trk->bar_count && trk->bars[lo].timestamp == timestamp);
+    return lo;
+}
+
+// Insert an empty bar at pos. The spare slot past bar_count is rotated in so its buffers are reused.
+t_span_bar *span_track_insert_bar(t_span_track *trk, long pos, long timestamp) {
+    if (!span_reserve((void **)&trk->bars, &trk->bar_capacity, trk->bar_count + 1, sizeof(t_span_bar))) return NULL;
+    t_span_bar spare = trk->bars[trk->bar_count];
+    memmove(trk->bars + pos + 1, trk->bars + pos, (trk->bar_count - pos) * sizeof(t_span_bar));
+    spare.timestamp = timestamp;
+    spare.offset = 0.0;
+    spare.note_count = 0;
+    spare.score_sum = 0.0;
+    spare.mean = 0.0;
+    trk->bars[pos] = spare;
+    trk->bar_count++;
+    return &trk->bars[pos];
+}
+
+// Remove count bars starting at start, parking their slots past bar_count for reuse.
+void span_track_remove_bars(t_span_track *trk, long start, long count) {
+    for (long i = 0; i < count; i++) {
+        t_span_bar removed = trk->bars[start];
+        memmove(trk->bars + start, trk->bars + start + 1, (trk->bar_count - start - 1) * sizeof(t_span_bar));
+        trk->bars[--trk->bar_count] = removed;
+    }
+}
+
+int span_bar_add_note(t_span_bar *bar, double absolute, double score) {
+    if (bar->note_count >= bar->note_capacity) {
+        long capacity = bar->note_capacity;
+        if (!span_reserve((void **)&bar->absolutes, &capacity, bar->note_count + 1, sizeof(double))) return 0;
+        capacity = bar->note_capacity;
+        if (!span_reserve((void **)&bar->scores, &capacity, bar->note_count + 1, sizeof(double))) return 0;
+        bar->note_capacity = capacity;
+    }
+    bar->absolutes[bar->note_count] = absolute;
+    bar->scores[bar->note_count] = score;
+    bar->note_count++;
+    bar->score_sum += score;
+    bar->mean = bar->score_sum / bar->note_count;
+    return 1;
+}
+
+double span_track_lowest_mean(t_span_track *trk, long count) {
+    double lowest = trk->bars[0].mean;
+    for (long i = 1; i < count; i++) {
+        if (trk->bars[i].mean < lowest) lowest = trk->bars[i].mean;
+    }
+    return lowest;
+}
+
+// Refresh the rating after one bar's mean changed. Only a rise in the current lowest bar needs a rescan.
+void span_track_update_rating(t_span_track *trk, double new_mean, double old_mean, int bar_existed) {
+    if (trk->bar_count == 1 || new_mean <= trk->lowest_mean) {
+        trk->lowest_mean = new_mean;
+    } else if (bar_existed && old_mean <= trk->lowest_mean) {
+        trk->lowest_mean = span_track_lowest_mean(trk, trk->bar_count);
+    }
+    trk->rating = trk->lowest_mean * trk->bar_count;
+}
+
+// Helper functions to format lists for buildspans_log without allocating. Long lists are truncated.
+void format_double_list(char *dst, size_t size, const double *values, long count) {
+    size_t used = snprintf(dst, size, "[");
+    for (long i = 0; i < count && used < size; i++) {
+        used += snprintf(dst + used, size - used, (i < count - 1) ? "%.2f, " : "%.2f", values[i]);
+    }
+    if (used < size) snprintf(dst + used, size - used, "]");
+}
+
+void format_span_list(char *dst, size_t size, t_span_track *trk, long count) {
+    size_t used = snprintf(dst, size, "[");
+    for (long i = 0; i < count && used < size; i++) {
+        used += snprintf(dst + used, size - used, (i < count - 1) ? "%ld, " : "%ld", trk->bars[i].timestamp);
+    }
+    if (used < size) snprintf(dst + used, size - used, "]");
+}
+
+
 // Function prototypes
 void *buildspans_new(t_symbol *s, long argc, t_atom *argv);
 void buildspans_free(t_buildspans *x);
@@ -169,6 +280,9 @@ void buildspans_clear(t_buildspans *x);
 void buildspans_do_clear(t_buildspans *x, t_symbol *s, long argc, t_atom *argv);
 void buildspans_list(t_buildspans *x, t_symbol *s, long argc, t_atom *argv);
 void buildspans_do_list(t_buildspans *x, t_symbol *s, long argc, t_atom *argv);
+void buildspans_notes(t_buildspans *x, t_symbol *s, long argc, t_atom *argv);
+void buildspans_do_notes(t_buildspans *x, t_symbol *s, long argc, t_atom *argv);
+void buildspans_ingest_note(t_buildspans *x, t_span_palette *pal, double calc_timestamp, double store_timestamp, double score, long bar_length);
 void buildspans_float(t_buildspans *x, double f);
 void buildspans_offset(t_buildspans *x, double f);
 void buildspans_do_offset(t_buildspans *x, double f, double loop_start);
@@ -181,22 +295,24 @@ void buildspans_anything_deferred(t_buildspans *x, t_symbol *s, long argc, t_ato
 void buildspans_assist(t_buildspans *x, void *b, long m, long a, char *s);
 void buildspans_bang(t_buildspans *x);
 void buildspans_do_bang(t_buildspans *x, t_symbol *s, long argc, t_atom *argv);
-void buildspans_flush(t_buildspans *x, t_symbol *palette_sym);
+void buildspans_flush(t_buildspans *x, t_span_palette *pal, long bar_length);
 void buildspans_flush_track(t_buildspans *x, long track_num);
 void buildspans_run_cleanup(t_buildspans *x);
-void buildspans_end_track_span(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym);
-void buildspans_prune_span(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, long bar_to_keep);
+void buildspans_end_track_span(t_buildspans *x, t_span_palette *pal, t_span_track *trk);
+void buildspans_prune_span(t_buildspans *x, t_span_palette *pal, t_span_track *trk);
 void buildspans_visualize_memory(t_buildspans *x);
+void buildspans_building(t_buildspans *x);
 void buildspans_log(t_buildspans *x, const char *fmt, ...);
-void buildspans_reset_bar_to_standalone(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, t_symbol *bar_sym);
-void buildspans_finalize_and_log_span(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, t_atomarray *span_array);
-int buildspans_deferred_rating_check(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, long last_bar_timestamp);
-void buildspans_process_and_add_note(t_buildspans *x, double calc_timestamp, double store_timestamp, double score, double offset, long bar_length);
-void buildspans_check_discontiguity(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, double relative_comparison_val);
-void buildspans_cleanup_track_offset_if_needed(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_offset_sym);
-double find_next_offset(t_buildspans *x, t_symbol *palette_sym, long track_num_to_check, double offset_val_to_check);
-int buildspans_validate_span_before_output(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, t_atomarray *span_to_output);
-void buildspans_output_span_data(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, t_atomarray *span_atom_array);
+void buildspans_reset_bar_to_standalone(t_buildspans *x, t_span_palette *pal, t_span_track *trk);
+double buildspans_finalize_and_log_span(t_buildspans *x, t_span_palette *pal, t_span_track *trk, long span_size);
+int buildspans_deferred_rating_check(t_buildspans *x, t_span_palette *pal, t_span_track *trk);
+void buildspans_process_and_add_note(t_buildspans *x, t_span_palette *pal, double calc_timestamp, double store_timestamp, double score, double offset, long bar_length);
+void buildspans_check_discontiguity(t_buildspans *x, t_span_palette *pal, t_span_track *trk, double relative_comparison_val, long bar_length);
+void buildspans_cleanup_track_offset_if_needed(t_buildspans *x, t_span_palette *pal, long track_num_to_check, long rounded_offset);
+double find_next_offset(t_buildspans *x, t_span_palette *pal, long track_num_to_check, double offset_val_to_check);
+int buildspans_validate_span_before_output(t_buildspans *x, t_span_palette *pal, t_span_track *trk, long span_size);
+void buildspans_output_span(t_buildspans *x, t_span_palette *pal, t_span_track *trk, long span_size, double rating);
+void buildspans_output_span_data(t_buildspans *x, t_span_palette *pal, t_span_track *trk, long span_size, double rating);
 long buildspans_get_bar_length(t_buildspans *x);
 void buildspans_set_bar_buffer(t_buildspans *x, t_symbol *s);
 void buildspans_local_bar_length(t_buildspans *x, double f);
@@ -252,9 +368,7 @@ void buildspans_defer_output(t_buildspans *x, t_symbol *s, short argc, t_atom *a
     } else if (s == gensym("span")) {
         outlet_anything(x->span_outlet, s, argc, argv);
     } else if (s == gensym("bar_data")) {
-        // Here argv[0] was the selector
-        t_symbol *sel = atom_getsym(argv);
-        outlet_anything(x->out_bar_data, sel, (short)(argc - 1), argv + 1);
+        outlet_anything(x->out_bar_data, s, argc, argv);
     } else if (s == gensym("span_int")) {
         if (argc > 0) {
             outlet_int(x->span_outlet, atom_getlong(argv));
@@ -262,29 +376,140 @@ void buildspans_defer_output(t_buildspans *x, t_symbol *s, short argc, t_atom *a
     }
 }
 
-#define MAX_LOG_HISTORY_LINES 2000
-#define MAX_LOG_LINE_LEN 512
+#if defined(_MSC_VER)
+static long long trace_fetch_add(volatile long long *p, long long v) { return InterlockedExchangeAdd64(p, v); }
+static long long trace_load(volatile long long *p) { return InterlockedCompareExchange64(p, 0, 0); }
+static void trace_store(volatile long long *p, long long v) { InterlockedExchange64(p, v); }
+static void trace_fence_release(void) { MemoryBarrier(); }
+static void trace_fence_acquire(void) { MemoryBarrier(); }
+#else
+static long long trace_fetch_add(volatile long long *p, long long v) { return __atomic_fetch_add(p, v, __ATOMIC_RELAXED); }
+static long long trace_load(volatile long long *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static void trace_store(volatile long long *p, long long v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+static void trace_fence_release(void) { __atomic_thread_fence(__ATOMIC_RELEASE); }
+static void trace_fence_acquire(void) { __atomic_thread_fence(__ATOMIC_ACQUIRE); }
+#endif
 
-void record_log_message(t_buildspans *x, const char *message) {
-    critical_enter(0);
-    if (!x->log_history) {
-        x->log_history = (char **)sysmem_newptr(MAX_LOG_HISTORY_LINES * sizeof(char *));
-        for (int i = 0; i < MAX_LOG_HISTORY_LINES; i++) {
-            x->log_history[i] = (char *)sysmem_newptr(MAX_LOG_LINE_LEN);
-            x->log_history[i][0] = '\0';
+// Append one record to the flight recorder. Lock-free: each writer claims its own slot with an
+// atomic ticket, and publishes it by storing the ticket once the payload is in place. Only the
+// conversions buildspans_log uses are captured (%ld, %f-style and %s); strings are copied, since
+// many are stack buffers, and truncated to the record's string area.
+void buildspans_trace(t_buildspans *x, const char *fmt, va_list args) {
+    if (!x->trace) return;
+    long long ticket = trace_fetch_add(&x->trace_next, 1);
+    t_trace_record *rec = &x->trace[ticket & (BUILDSPANS_TRACE_CAPACITY - 1)];
+    trace_store(&rec->ticket, -1);
+    // The store above only orders what came before it; without the fence the payload writes below
+    // could become visible first, and a reader could accept a half-written record under the old ticket.
+    trace_fence_release();
+
+    rec->time_ms = (double)systime_ms();
+    rec->fmt = fmt;
+    long argc = 0;
+    long used = 0;
+    for (const char *p = fmt; *p && argc < BUILDSPANS_TRACE_MAX_ARGS; p++) {
+        if (*p != '%') continue;
+        p++;
+        if (*p == '%') continue;
+        while (*p && strchr("-+ #0123456789.", *p)) p++;
+        int is_long = 0;
+        while (*p == 'l') { is_long = 1; p++; }
+        if (*p == 'd' || *p == 'i') {
+            rec->args[argc++].l = is_long ? va_arg(args, long) : (long)va_arg(args, int);
+        } else if (*p == 'f' || *p == 'g' || *p == 'e') {
+            rec->args[argc++].d = va_arg(args, double);
+        } else if (*p == 's') {
+            const char *str = va_arg(args, const char *);
+            long room = BUILDSPANS_TRACE_STRING_BYTES - used;
+            rec->args[argc++].s = used;
+            if (room > 0) {
+                long len = str ? (long)strlen(str) : 0;
+                if (len > room - 1) len = room - 1;
+                if (len > 0) memcpy(rec->strings + used, str, len);
+                rec->strings[used + len] = '\0';
+                used += len + 1;
+            }
+        } else {
+            break;
         }
-        x->log_history_count = 0;
-        x->log_history_write_ptr = 0;
+        if (!*p) break;
     }
+    rec->arg_count = argc;
+    trace_store(&rec->ticket, ticket);
+}
 
-    strncpy(x->log_history[x->log_history_write_ptr], message, MAX_LOG_LINE_LEN - 1);
-    x->log_history[x->log_history_write_ptr][MAX_LOG_LINE_LEN - 1] = '\0';
-
-    x->log_history_write_ptr = (x->log_history_write_ptr + 1) % MAX_LOG_HISTORY_LINES;
-    if (x->log_history_count < MAX_LOG_HISTORY_LINES) {
-        x->log_history_count++;
+// Render a record back into the text buildspans_log would have produced.
+void buildspans_trace_format(const t_trace_record *rec, char *dst, size_t size) {
+    size_t out = 0;
+    long argi = 0;
+    const char *p = rec->fmt;
+    dst[0] = '\0';
+    while (*p && out + 1 < size) {
+        if (*p != '%') {
+            dst[out++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            dst[out++] = '%';
+            p += 2;
+            continue;
+        }
+        const char *spec_start = p++;
+        while (*p && strchr("-+ #0123456789.", *p)) p++;
+        size_t flags_len = (size_t)(p - spec_start);
+        while (*p == 'l') p++;
+        if (!*p || argi >= rec->arg_count) break;
+
+        // Rebuild the conversion with the width the argument was captured at.
+        char spec[32];
+        if (flags_len + 3 > sizeof(spec)) break;
+        memcpy(spec, spec_start, flags_len);
+        spec[flags_len] = '\0';
+
+        int n = 0;
+        const t_trace_arg *arg = &rec->args[argi++];
+        if (*p == 'd' || *p == 'i') {
+            strcat(spec, "ld");
+            n = snprintf(dst + out, size - out, spec, arg->l);
+        } else if (*p == 'f' || *p == 'g' || *p == 'e') {
+            spec[flags_len] = *p;
+            spec[flags_len + 1] = '\0';
+            n = snprintf(dst + out, size - out, spec, arg->d);
+        } else if (*p == 's') {
+            strcat(spec, "s");
+            n = snprintf(dst + out, size - out, spec, (arg->s < BUILDSPANS_TRACE_STRING_BYTES) ? rec->strings + arg->s : "");
+        }
+        if (n < 0) break;
+        out += (size_t)n;
+        if (out >= size) {
+            out = size - 1;
+            break;
+        }
+        p++;
     }
-    critical_exit(0);
+    dst[out] = '\0';
+}
+
+// Write every intact record still in the ring, oldest first. Slots overwritten while the dump runs
+// are skipped rather than waited for.
+long buildspans_trace_dump(t_buildspans *x, FILE *f) {
+    if (!x->trace) return 0;
+    long long end = trace_load(&x->trace_next);
+    long long start = (end > BUILDSPANS_TRACE_CAPACITY) ? end - BUILDSPANS_TRACE_CAPACITY : 0;
+    long written = 0;
+    for (long long t = start; t < end; t++) {
+        t_trace_record *slot = &x->trace[t & (BUILDSPANS_TRACE_CAPACITY - 1)];
+        if (trace_load(&slot->ticket) != t) continue;
+        t_trace_record rec = *slot;
+        trace_fence_acquire();  // Keep the copy from being reordered after the second ticket check
+        if (trace_load(&slot->ticket) != t) continue;
+
+        char line[1024];
+        buildspans_trace_format(&rec, line, sizeof(line));
+        fprintf(f, "[%.0f ms] %s\n", rec.time_ms, line);
+        written++;
+    }
+    return written;
 }
 
 void get_object_directory(char *dir_out, size_t max_len) {
@@ -326,10 +551,7 @@ void get_object_directory(char *dir_out, size_t max_len) {
     dir_out[max_len - 1] = '\0';
 }
 
-void write_multibar_negative_rating_log(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, t_atomarray *span_array, double rating) {
-    long span_size = 0;
-    t_atom *span_atoms = NULL;
-    atomarray_getatoms(span_array, &span_size, &span_atoms);
+void write_multibar_negative_rating_log(t_buildspans *x, t_span_palette *pal, t_span_track *trk, long span_size, double rating) {
     if (span_size < 3 || rating >= 0.0) {
         return; // Criteria not met
     }
@@ -396,8 +618,8 @@ void write_multibar_negative_rating_log(t_buildspans *x, t_symbol *palette_sym,
             tm_info.tm_year + 1900, tm_info.tm_mon + 1, tm_info.tm_mday,
             tm_info.tm_hour, tm_info.tm_min, tm_info.tm_sec, ms);
     fprintf(f, "Instance ID:     %ld\n", x->instance_id);
-    fprintf(f, "Palette:         %s\n", palette_sym ? palette_sym->s_name : "N/A");
-    fprintf(f, "Track Symbol:    %s\n", track_sym ? track_sym->s_name : "N/A");
+    fprintf(f, "Palette:         %s\n", pal ? pal->palette->s_name : "N/A");
+    fprintf(f, "Track Symbol:    %s\n", trk ? trk->track_name : "N/A");
     fprintf(f, "Span Rating:     %.4f\n", rating);
     fprintf(f, "Number of Bars:  %ld\n", span_size);
     fprintf(f, "Current Offset:  %.2f\n", x->current_offset);
@@ -408,68 +630,22 @@ void write_multibar_negative_rating_log(t_buildspans *x, t_symbol *palette_sym,
     fprintf(f, "SPAN STRUCTURE DETAILS:\n");
     fprintf(f, "--------------------------------------------------------------------------------\n");
     for (long i = 0; i < span_size; i++) {
-        long bar_ts = atom_getlong(&span_atoms[i]);
-        fprintf(f, "Bar %ld:\n", bar_ts);
-        char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_ts);
-        t_symbol *bar_sym = gensym(bar_str);
-
-        // Get offset
-        t_symbol *offset_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("offset"));
-        t_atom offset_atom;
-        if (dictionary_getatom(x->building, offset_key, &offset_atom) == MAX_ERR_NONE) {
-            fprintf(f, "  - Offset: %.2f\n", atom_getfloat(&offset_atom));
-        }
-
-        // Get mean
-        t_symbol *mean_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("mean"));
-        t_atom mean_atom;
-        if (dictionary_getatom(x->building, mean_key, &mean_atom) == MAX_ERR_NONE) {
-            fprintf(f, "  - Mean score: %.4f\n", atom_getfloat(&mean_atom));
-        }
-
-        // Get rating
-        t_symbol *rating_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("rating"));
-        t_atom rating_atom;
-        if (dictionary_getatom(x->building, rating_key, &rating_atom) == MAX_ERR_NONE) {
-            fprintf(f, "  - Bar-level Rating: %.4f\n", atom_getfloat(&rating_atom));
-        }
-
-        // Get absolutes (notes that went into it)
-        t_symbol *absolutes_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("absolutes"));
-        t_atomarray *abs_aa = NULL;
-        t_atom abs_atom;
-        long abs_count = 0;
-        t_atom *abs_atoms = NULL;
-        if (dictionary_getatomarray(x->building, absolutes_key, (t_object **)&abs_aa) == MAX_ERR_NONE && abs_aa) {
-            atomarray_getatoms(abs_aa, &abs_count, &abs_atoms);
-        } else if (dictionary_getatom(x->building, absolutes_key, &abs_atom) == MAX_ERR_NONE) {
-            abs_atoms = &abs_atom;
-            abs_count = 1;
-        }
-        if (abs_count > 0) {
+        t_span_bar *bar = &trk->bars[i];
+        fprintf(f, "Bar %ld:\n", bar->timestamp);
+        fprintf(f, "  - Offset: %.2f\n", bar->offset);
+        fprintf(f, "  - Mean score: %.4f\n", bar->mean);
+        fprintf(f, "  - Bar-level Rating: %.4f\n", rating);
+
+        // Absolutes (notes that went into it)
+        if (bar->note_count > 0) {
             fprintf(f, "  - Note Timestamps (Absolutes): [");
-            for (long k = 0; k < abs_count; k++) {
-                fprintf(f, "%.2f%s", atom_getfloat(abs_atoms + k), (k < abs_count - 1) ? ", " : "");
+            for (long k = 0; k < bar->note_count; k++) {
+                fprintf(f, "%.2f%s", bar->absolutes[k], (k < bar->note_count - 1) ? ", " : "");
             }
             fprintf(f, "]\n");
-        }
-
-        // Get scores
-        t_symbol *scores_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("scores"));
-        t_atomarray *scores_aa = NULL;
-        t_atom scores_atom;
-        long scores_count = 0;
-        t_atom *scores_atoms = NULL;
-        if (dictionary_getatomarray(x->building, scores_key, (t_object **)&scores_aa) == MAX_ERR_NONE && scores_aa) {
-            atomarray_getatoms(scores_aa, &scores_count, &scores_atoms);
-        } else if (dictionary_getatom(x->building, scores_key, &scores_atom) == MAX_ERR_NONE) {
-            scores_atoms = &scores_atom;
-            scores_count = 1;
-        }
-        if (scores_count > 0) {
             fprintf(f, "  - Note Scores: [");
-            for (long k = 0; k < scores_count; k++) {
-                fprintf(f, "%.4f%s", atom_getfloat(scores_atoms + k), (k < scores_count - 1) ? ", " : "");
+            for (long k = 0; k < bar->note_count; k++) {
+                fprintf(f, "%.4f%s", bar->scores[k], (k < bar->note_count - 1) ? ", " : "");
             }
             fprintf(f, "]\n");
         }
@@ -478,39 +654,26 @@ void write_multibar_negative_rating_log(t_buildspans *x, t_symbol *palette_sym,
 
     fprintf(f, "EVENT LOG HISTORY (DECISIONS, CHECKS, ETC.):\n");
     fprintf(f, "--------------------------------------------------------------------------------\n");
-    critical_enter(0);
-    if (x->log_history && x->log_history_count > 0) {
-        long start_idx = 0;
-        if (x->log_history_count == MAX_LOG_HISTORY_LINES) {
-            start_idx = x->log_history_write_ptr;
-        }
-        for (long i = 0; i < x->log_history_count; i++) {
-            long idx = (start_idx + i) % MAX_LOG_HISTORY_LINES;
-            if (x->log_history[idx] && x->log_history[idx][0] != '\0') {
-                fprintf(f, "%s\n", x->log_history[idx]);
-            }
-        }
-    } else {
+    if (buildspans_trace_dump(x, f) == 0) {
         fprintf(f, "[No log history recorded]\n");
     }
-    critical_exit(0);
 
     fclose(f);
     object_post((t_object *)x, "Created log file for multibar negative rating span: %s", file_path);
 }
 
+// Always records into the flight recorder; text is only formatted when @log is on.
 void buildspans_log(t_buildspans *x, const char *fmt, ...) {
-    char buf[4096];
     va_list args;
     va_start(args, fmt);
-    vsnprintf(buf, sizeof(buf), fmt, args);
+    if (x->log) {
+        va_list text_args;
+        va_copy(text_args, args);
+        vcommon_log(x->log_outlet, x->log, "buildspans", fmt, text_args);
+        va_end(text_args);
+    }
+    buildspans_trace(x, fmt, args);
     va_end(args);
-
-    // Record the log message in our history buffer
-    record_log_message(x, buf);
-
-    // Output using common_log
-    common_log(x->log_outlet, x->log, "buildspans", "%s", buf);
 }
 
 #ifndef REBAR_INTERNAL_BINDING
@@ -571,212 +734,74 @@ long buildspans_get_bar_length(t_buildspans *x) {
 }
 
 void buildspans_visualize_memory(t_buildspans *x) {
-    if (!x->visualize) return;
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-
-    // 1. Identify all unique palettes
-    long unique_palette_count = 0;
-    t_symbol **unique_palettes = (t_symbol **)sysmem_newptr(num_keys * sizeof(t_symbol *));
-    if (keys) {
-        for (long i = 0; i < num_keys; i++) {
-            char *pal_str, *track_str, *bar_str, *prop_str;
-            if (parse_hierarchical_key(keys[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-                int found = 0;
-                for (long j = 0; j < unique_palette_count; j++) {
-                    if (strcmp(unique_palettes[j]->s_name, pal_str) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    unique_palettes[unique_palette_count++] = gensym(pal_str);
-                }
-                sysmem_freeptr(pal_str);
-                sysmem_freeptr(track_str);
-                sysmem_freeptr(bar_str);
-                sysmem_freeptr(prop_str);
-            }
-        }
-    }
+    if (!x->visualize || x->in_batch) return;
 
-    // 2. Generate JSON
     long buffer_size = 262144;
     char *json_buffer = (char *)sysmem_newptr(buffer_size);
     long offset = 0;
     offset += snprintf(json_buffer + offset, buffer_size, "{\"palettes\":{");
 
-    for (long p = 0; p < unique_palette_count; p++) {
-        t_symbol *palette_sym = unique_palettes[p];
-        if (p > 0) offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
-
-        // Identify unique tracks for this palette
-        long unique_track_count = 0;
-        t_symbol **unique_tracks = (t_symbol **)sysmem_newptr(num_keys * sizeof(t_symbol *));
-        if (keys) {
-            for (long i = 0; i < num_keys; i++) {
-                char *pal_str, *track_str, *bar_str, *prop_str;
-                if (parse_hierarchical_key(keys[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-                    if (strcmp(pal_str, palette_sym->s_name) == 0) {
-                        int found = 0;
-                        for (long j = 0; j < unique_track_count; j++) {
-                            if (strcmp(unique_tracks[j]->s_name, track_str) == 0) {
-                                found = 1;
-                                break;
-                            }
-                        }
-                        if (!found) {
-                            unique_tracks[unique_track_count++] = gensym(track_str);
-                        }
-                    }
-                    sysmem_freeptr(pal_str);
-                    sysmem_freeptr(track_str);
-                    sysmem_freeptr(bar_str);
-                    sysmem_freeptr(prop_str);
-                }
-            }
-        }
+    int first_palette = 1;
+    for (long p = 0; p < x->spans.palette_count; p++) {
+        t_span_palette *pal = x->spans.palettes[p];
+        if (pal->track_count == 0) continue;
+        if (!first_palette) offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
+        first_palette = 0;
 
         offset += snprintf(json_buffer + offset, buffer_size - offset, "\"%s\":{\"building\":{", 
-                            palette_sym->s_name);
+                            pal->palette->s_name);
 
-        for (long i = 0; i < unique_track_count; i++) {
-            t_symbol *track_sym = unique_tracks[i];
+        for (long i = 0; i < pal->track_count; i++) {
+            t_span_track *trk = pal->tracks[i];
             if (i > 0) offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
             
-            offset += snprintf(json_buffer + offset, buffer_size - offset, "\"%s\":{\"absolutes\":[", track_sym->s_name);
-
-            // a. Find and sort bars for this track
-            long bar_count = 0;
-            long *bar_timestamps = (long *)sysmem_newptr(num_keys * sizeof(long)); // Over-allocate
-            if (keys) {
-                for (long j = 0; j < num_keys; j++) {
-                     char *pal_str, *track_str, *bar_str, *prop_str;
-                     if (parse_hierarchical_key(keys[j], &pal_str, &track_str, &bar_str, &prop_str)) {
-                         if (strcmp(pal_str, palette_sym->s_name) == 0 && strcmp(track_str, track_sym->s_name) == 0 && strcmp(prop_str, "mean") == 0) {
-                             bar_timestamps[bar_count++] = atol(bar_str);
-                         }
-                         sysmem_freeptr(pal_str);
-                         sysmem_freeptr(track_str);
-                         sysmem_freeptr(bar_str);
-                         sysmem_freeptr(prop_str);
-                     }
-                }
-            }
-            qsort(bar_timestamps, bar_count, sizeof(long), compare_longs);
+            offset += snprintf(json_buffer + offset, buffer_size - offset, "\"%s\":{\"absolutes\":[", trk->track_name);
 
-            // b. Append absolutes
+            // a. Append absolutes (bars are already sorted)
             int first_absolute = 1;
-            for (long j = 0; j < bar_count; j++) {
-                char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_timestamps[j]);
-                t_symbol* abs_key = generate_hierarchical_key(palette_sym, track_sym, gensym(bar_str), gensym("absolutes"));
-                t_atom *av;
-                long ac = 0;
-                t_atomarray *aa = NULL;
-                t_atom a;
-                if (dictionary_getatomarray(x->building, abs_key, (t_object **)&aa) == MAX_ERR_NONE && aa) {
-                    atomarray_getatoms(aa, &ac, &av);
-                } else if (dictionary_getatom(x->building, abs_key, &a) == MAX_ERR_NONE) {
-                    av = &a;
-                    ac = 1;
-                }
-                for (long k = 0; k < ac; k++) {
+            for (long j = 0; j < trk->bar_count; j++) {
+                for (long k = 0; k < trk->bars[j].note_count; k++) {
                     if (!first_absolute) offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
                     first_absolute = 0;
-                    offset += snprintf(json_buffer + offset, buffer_size - offset, "%.2f", atom_getfloat(av+k));
+                    offset += snprintf(json_buffer + offset, buffer_size - offset, "%.2f", trk->bars[j].absolutes[k]);
                 }
             }
 
-            // b2. Append scores aligned with absolutes
+            // b. Append scores aligned with absolutes
             offset += snprintf(json_buffer + offset, buffer_size - offset, "],\"scores\":[");
             int first_score = 1;
-            for (long j = 0; j < bar_count; j++) {
-                char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_timestamps[j]);
-                t_symbol* scores_key = generate_hierarchical_key(palette_sym, track_sym, gensym(bar_str), gensym("scores"));
-                t_atom *av;
-                long ac = 0;
-                t_atomarray *aa = NULL;
-                t_atom a;
-                if (dictionary_getatomarray(x->building, scores_key, (t_object **)&aa) == MAX_ERR_NONE && aa) {
-                    atomarray_getatoms(aa, &ac, &av);
-                } else if (dictionary_getatom(x->building, scores_key, &a) == MAX_ERR_NONE) {
-                    av = &a;
-                    ac = 1;
-                }
-                for (long k = 0; k < ac; k++) {
+            for (long j = 0; j < trk->bar_count; j++) {
+                for (long k = 0; k < trk->bars[j].note_count; k++) {
                     if (!first_score) offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
                     first_score = 0;
-                    offset += snprintf(json_buffer + offset, buffer_size - offset, "%.4f", atom_getfloat(av+k));
+                    offset += snprintf(json_buffer + offset, buffer_size - offset, "%.4f", trk->bars[j].scores[k]);
                 }
             }
 
-            offset += snprintf(json_buffer + offset, buffer_size - offset, "],\"offsets\":[");
-
             // c. Append offsets
-            int first_offset = 1;
-            for (long j = 0; j < bar_count; j++) {
-                char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_timestamps[j]);
-                t_symbol* offset_key = generate_hierarchical_key(palette_sym, track_sym, gensym(bar_str), gensym("offset"));
-                 if (dictionary_hasentry(x->building, offset_key)) {
-                     if (!first_offset) offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
-                     first_offset = 0;
-                     t_atom a;
-                     dictionary_getatom(x->building, offset_key, &a);
-                     offset += snprintf(json_buffer + offset, buffer_size - offset, "%.2f", atom_getfloat(&a));
-                 }
+            offset += snprintf(json_buffer + offset, buffer_size - offset, "],\"offsets\":[");
+            for (long j = 0; j < trk->bar_count; j++) {
+                if (j > 0) offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
+                offset += snprintf(json_buffer + offset, buffer_size - offset, "%.2f", trk->bars[j].offset);
             }
 
             // c2. Append ratings dictionary
             offset += snprintf(json_buffer + offset, buffer_size - offset, "],\"ratings\":{");
-            int first_rating = 1;
-            for (long j = 0; j < bar_count; j++) {
-                char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_timestamps[j]);
-                t_symbol* rating_key = generate_hierarchical_key(palette_sym, track_sym, gensym(bar_str), gensym("rating"));
-                if (dictionary_hasentry(x->building, rating_key)) {
-                    t_atom a;
-                    dictionary_getatom(x->building, rating_key, &a);
-                    if (!first_rating) offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
-                    first_rating = 0;
-                    offset += snprintf(json_buffer + offset, buffer_size - offset, "\"%ld\":%.4f", bar_timestamps[j], atom_getfloat(&a));
-                }
+            for (long j = 0; j < trk->bar_count; j++) {
+                if (j > 0) offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
+                offset += snprintf(json_buffer + offset, buffer_size - offset, "\"%ld\":%.4f", trk->bars[j].timestamp, trk->rating);
             }
 
-            offset += snprintf(json_buffer + offset, buffer_size - offset, "},\"span\":[");
-
             // d. Append span data
-            int first_span = 1;
-            // To avoid duplicates, find a representative span from the first bar
-            if (bar_count > 0) {
-                char first_bar_str[32];
-                snprintf(first_bar_str, 32, "%ld", bar_timestamps[0]);
-                t_symbol *span_key = generate_hierarchical_key(palette_sym, track_sym, gensym(first_bar_str), gensym("span"));
-
-                t_atom *span_atoms;
-                long span_count = 0;
-                t_atomarray *span_aa = NULL;
-                t_atom span_atom;
-                if (dictionary_getatomarray(x->building, span_key, (t_object **)&span_aa) == MAX_ERR_NONE && span_aa) {
-                    atomarray_getatoms(span_aa, &span_count, &span_atoms);
-                } else if (dictionary_getatom(x->building, span_key, &span_atom) == MAX_ERR_NONE) {
-                    span_atoms = &span_atom;
-                    span_count = 1;
-                }
-
-                for (long k = 0; k < span_count; k++) {
-                    if (!first_span) {
-                        offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
-                    }
-                    first_span = 0;
-                    offset += snprintf(json_buffer + offset, buffer_size - offset, "%ld", atom_getlong(span_atoms + k));
-                }
+            offset += snprintf(json_buffer + offset, buffer_size - offset, "},\"span\":[");
+            for (long j = 0; j < trk->bar_count; j++) {
+                if (j > 0) offset += snprintf(json_buffer + offset, buffer_size - offset, ",");
+                offset += snprintf(json_buffer + offset, buffer_size - offset, "%ld", trk->bars[j].timestamp);
             }
 
             offset += snprintf(json_buffer + offset, buffer_size - offset, "]}");
-            sysmem_freeptr(bar_timestamps);
         }
         offset += snprintf(json_buffer + offset, buffer_size - offset, "}}");
-        sysmem_freeptr(unique_tracks);
     }
     long bar_length = buildspans_get_bar_length(x);
     offset += snprintf(json_buffer + offset, buffer_size - offset, "},\"current_offset\":%.2f,\"bar_length\":%ld,\"loop_start\":%.2f}", x->current_offset, bar_length, x->loop_start);
@@ -784,8 +809,76 @@ void buildspans_visualize_memory(t_buildspans *x) {
     visualize((t_object *)x, json_buffer);
 
     sysmem_freeptr(json_buffer);
-    sysmem_freeptr(unique_palettes);
-    if(keys) sysmem_freeptr(keys);
+}
+
+// Materialize the span index as nested palette / track-offset / bar dictionaries and send its name out
+// the log outlet. This is a debugging view only; nothing reads it back.
+void buildspans_building(t_buildspans *x) {
+    systhread_mutex_lock(x->state_mutex);
+    if (!x->building) {
+        t_symbol *name = NULL;
+        x->building = dictobj_register(dictionary_new(), &name);
+    } else {
+        dictionary_clear(x->building);
+    }
+    if (!x->building) {
+        systhread_mutex_unlock(x->state_mutex);
+        object_error((t_object *)x, "Could not create the building dictionary.");
+        return;
+    }
+
+    // Nested palette -> track-offset -> bar -> property dictionaries, so the view interns only the
+    // palette, track-offset and bar names rather than one symbol per bar per property.
+    for (long p = 0; p < x->spans.palette_count; p++) {
+        t_span_palette *pal = x->spans.palettes[p];
+        if (pal->track_count == 0) continue;
+        t_dictionary *palette_dict = dictionary_new();
+        if (!palette_dict) continue;
+
+        for (long t = 0; t < pal->track_count; t++) {
+            t_span_track *trk = pal->tracks[t];
+            t_atom *span_atoms = span_index_atoms(&x->spans, trk->bar_count);
+            if (!span_atoms) continue;
+            for (long b = 0; b < trk->bar_count; b++) atom_setlong(span_atoms + b, trk->bars[b].timestamp);
+
+            t_dictionary *track_dict = dictionary_new();
+            if (!track_dict) continue;
+            for (long b = 0; b < trk->bar_count; b++) {
+                t_span_bar *bar = &trk->bars[b];
+                t_dictionary *bar_dict = dictionary_new();
+                if (!bar_dict) continue;
+
+                dictionary_appendfloat(bar_dict, gensym("offset"), bar->offset);
+                dictionary_appendsym(bar_dict, gensym("palette"), pal->palette);
+                dictionary_appendfloat(bar_dict, gensym("mean"), bar->mean);
+                dictionary_appendfloat(bar_dict, gensym("rating"), trk->rating);
+                dictionary_appendatoms(bar_dict, gensym("span"), trk->bar_count, span_atoms);
+
+                t_atom *note_atoms = (t_atom *)sysmem_newptr((bar->note_count + 1) * sizeof(t_atom));
+                if (note_atoms) {
+                    for (long k = 0; k < bar->note_count; k++) atom_setfloat(note_atoms + k, bar->absolutes[k]);
+                    dictionary_appendatoms(bar_dict, gensym("absolutes"), bar->note_count, note_atoms);
+                    for (long k = 0; k < bar->note_count; k++) atom_setfloat(note_atoms + k, bar->scores[k]);
+                    dictionary_appendatoms(bar_dict, gensym("scores"), bar->note_count, note_atoms);
+                    sysmem_freeptr(note_atoms);
+                }
+
+                char bar_str[32];
+                snprintf(bar_str, 32, "%ld", bar->timestamp);
+                dictionary_appenddictionary(track_dict, gensym(bar_str), (t_object *)bar_dict);
+            }
+            dictionary_appenddictionary(palette_dict, gensym(trk->track_name), (t_object *)track_dict);
+        }
+        dictionary_appenddictionary(x->building, pal->palette, (t_object *)palette_dict);
+    }
+    t_symbol *name = dictobj_namefromptr(x->building);
+    systhread_mutex_unlock(x->state_mutex);
+
+    if (name && x->log_outlet) {
+        t_atom a;
+        atom_setsym(&a, name);
+        outlet_anything(x->log_outlet, gensym("dictionary"), 1, &a);
+    }
 }
 
 
@@ -797,6 +890,7 @@ void ext_main(void *r) {
     c = class_new("buildspans", (method)buildspans_new, (method)buildspans_free, sizeof(t_buildspans), 0L, A_GIMME, 0);
     class_addmethod(c, (method)buildspans_clear, "clear", 0);
     class_addmethod(c, (method)buildspans_list, "list", A_GIMME, 0);
+    class_addmethod(c, (method)buildspans_notes, "notes", A_GIMME, 0);
     class_addmethod(c, (method)buildspans_float, "float", A_FLOAT, 0);
     class_addmethod(c, (method)buildspans_offset, "ft1", A_FLOAT, 0);
     class_addmethod(c, (method)buildspans_track, "in2", A_LONG, 0);
@@ -806,6 +900,7 @@ void ext_main(void *r) {
     class_addmethod(c, (method)buildspans_set_bar_buffer, "set_bar_buffer", A_SYM, 0);
     class_addmethod(c, (method)buildspans_local_bar_length, "ft4", A_FLOAT, 0);
     class_addmethod(c, (method)buildspans_notify, "notify", A_CANT, 0);
+    class_addmethod(c, (method)buildspans_building, "building", 0);
     
     CLASS_ATTR_SYM(c, "bind", 0, t_buildspans, bind_name);
     CLASS_ATTR_LABEL(c, "bind", 0, "Bind to Crucible Name");
@@ -837,8 +932,8 @@ void ext_main(void *r) {
 void *buildspans_new(t_symbol *s, long argc, t_atom *argv) {
     t_buildspans *x = (t_buildspans *)object_alloc(buildspans_class);
     if (x) {
-        x->building = dictionary_new();
-        x->tracks_ended_in_current_event = dictionary_new();
+        span_index_init(&x->spans);
+        x->building = NULL;
 
         systhread_mutex_new(&x->sequence_mutex, 0);
         systhread_mutex_new(&x->state_mutex, 0);
@@ -861,6 +956,7 @@ void *buildspans_new(t_symbol *s, long argc, t_atom *argv) {
         x->local_bar_length = 0;
         x->instance_id = 1000 + (rand() % 9000);
         x->bar_warn_sent = 0;
+        x->in_batch = 0;
         x->last_msg_type = gensym("none");
         x->last_note_calc = 0.0;
         x->last_note_store = 0.0;
@@ -870,9 +966,11 @@ void *buildspans_new(t_symbol *s, long argc, t_atom *argv) {
         x->bind_clock = clock_new(x, (method)buildspans_bind_clock_cb);
         x->bind_attempt_count = 0;
 
-        x->log_history = NULL;
-        x->log_history_count = 0;
-        x->log_history_write_ptr = 0;
+        x->trace_next = 0;
+        x->trace = (t_trace_record *)sysmem_newptrclear(BUILDSPANS_TRACE_CAPACITY * sizeof(t_trace_record));
+        if (x->trace) {
+            for (long i = 0; i < BUILDSPANS_TRACE_CAPACITY; i++) x->trace[i].ticket = -1;
+        }
 
         // Process attributes before creating outlets
         attr_args_process(x, argc, argv);
@@ -912,20 +1010,16 @@ void buildspans_free(t_buildspans *x) {
     if (x->bound_crucible) {
         object_detach_byptr(x, x->bound_crucible);
     }
+    span_index_free(&x->spans);
     if (x->building) {
+        dictobj_unregister(x->building);
         object_free(x->building);
     }
-    if (x->tracks_ended_in_current_event) {
-        object_free(x->tracks_ended_in_current_event);
-    }
     if (x->buffer_ref) {
         object_free(x->buffer_ref);
     }
-    if (x->log_history) {
-        for (int i = 0; i < MAX_LOG_HISTORY_LINES; i++) {
-            sysmem_freeptr(x->log_history[i]);
-        }
-        sysmem_freeptr(x->log_history);
+    if (x->trace) {
+        sysmem_freeptr(x->trace);
     }
 }
 
@@ -947,14 +1041,7 @@ void buildspans_clear(t_buildspans *x) {
 }
 
 void buildspans_do_clear(t_buildspans *x, t_symbol *s, long argc, t_atom *argv) {
-    if (x->building) {
-        object_free(x->building);
-    }
-    if (x->tracks_ended_in_current_event) {
-        object_free(x->tracks_ended_in_current_event);
-    }
-    x->building = dictionary_new();
-    x->tracks_ended_in_current_event = dictionary_new();
+    span_index_clear(&x->spans);
     x->current_track = 0;
     x->current_offset = 0.0;
     x->loop_start = 0.0;
@@ -1039,7 +1126,6 @@ void buildspans_do_offset(t_buildspans *x, double f, double loop_start) {
     }
 
     // Proceed with duplication
-    double old_offset = x->current_offset;
     x->current_offset = f;
     x->loop_start = loop_start;
     x->last_msg_type = gensym("offset");
@@ -1047,40 +1133,23 @@ void buildspans_do_offset(t_buildspans *x, double f, double loop_start) {
 
     // --- MODIFIED DISCONTIGUITY CHECK PHASE ---
     // Conduct a modified discontiguity check for every track across every palette BEFORE duplication.
-    long num_keys_check;
-    t_symbol **keys_check;
-    dictionary_getkeys(x->building, &num_keys_check, &keys_check);
-    if (keys_check) {
-        t_dictionary *unique_pal_tracks = dictionary_new();
-        for (long i = 0; i < num_keys_check; i++) {
-            char *pal_str, *track_str, *bar_str, *prop_str;
-            if (parse_hierarchical_key(keys_check[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-                char combined[512];
-                snprintf(combined, 512, "%s::%s", pal_str, track_str);
-                t_symbol *combined_sym = gensym(combined);
-                if (!dictionary_hasentry(unique_pal_tracks, combined_sym)) {
-                    dictionary_appendsym(unique_pal_tracks, combined_sym, _sym_nothing);
-                    const char *dash = strchr(track_str, '-');
-                    if (dash) {
-                        double track_offset = (double)atol(dash + 1);
-                        double relative_f = f - track_offset + x->loop_start;
-                        buildspans_check_discontiguity(x, gensym(pal_str), gensym(track_str), relative_f);
-                    }
-                }
-                sysmem_freeptr(pal_str); sysmem_freeptr(track_str); sysmem_freeptr(bar_str); sysmem_freeptr(prop_str);
-            }
+    // A check may end the track it is given, which removes it from the palette in place.
+    for (long p = 0; p < x->spans.palette_count; p++) {
+        t_span_palette *pal = x->spans.palettes[p];
+        long i = 0;
+        while (i < pal->track_count) {
+            t_span_track *trk = pal->tracks[i];
+            double relative_f = f - (double)trk->rounded_offset + x->loop_start;
+            buildspans_check_discontiguity(x, pal, trk, relative_f, bar_length);
+            if (i < pal->track_count && pal->tracks[i] == trk) i++;
         }
-        object_free(unique_pal_tracks);
-        sysmem_freeptr(keys_check);
-        buildspans_run_cleanup(x);
     }
+    buildspans_run_cleanup(x);
 
     buildspans_log(x, "Duplicating one span for each active track on palette %s.", x->current_palette->s_name);
 
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    if (!keys) {
+    t_span_palette *pal = span_index_palette(&x->spans, x->current_palette, 0);
+    if (!pal || pal->track_count == 0) {
         x->current_task_seq = -1;
         if (on_worker) {
             systhread_mutex_unlock(x->state_mutex);
@@ -1091,137 +1160,57 @@ void buildspans_do_offset(t_buildspans *x, double f, double loop_start) {
     // --- GATHER PHASE ---
     buildspans_log(x, "Gathering notes for span duplication.");
     // First, we gather all the notes that need to be duplicated into a temporary "manifest".
-    // This avoids modifying the `building` dictionary while iterating over its keys.
+    // This avoids modifying the span index while iterating over it.
     long manifest_capacity = 128;
     long manifest_count = 0;
     t_duplication_manifest_item *manifest = (t_duplication_manifest_item *)sysmem_newptr(manifest_capacity * sizeof(t_duplication_manifest_item));
 
-    // 1. Identify all unique track numbers (the integer part of the track-offset key)
-    long unique_track_num_count = 0;
-    long *unique_track_nums = (long *)sysmem_newptr(num_keys * sizeof(long)); // Over-allocate
-    for (long i = 0; i < num_keys; i++) {
-        char *pal_str, *track_str, *bar_str, *prop_str;
-        if (parse_hierarchical_key(keys[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-            if (strcmp(pal_str, x->current_palette->s_name) == 0) {
-                long current_track_num;
-                if (sscanf(track_str, "%ld-", &current_track_num) == 1) {
-                    int found = 0;
-                    for (long j = 0; j < unique_track_num_count; j++) {
-                        if (unique_track_nums[j] == current_track_num) {
-                            found = 1;
-                            break;
-                        }
-                    }
-                    if (!found) {
-                        unique_track_nums[unique_track_num_count++] = current_track_num;
-                    }
-                }
-            }
-            sysmem_freeptr(pal_str);
-            sysmem_freeptr(track_str);
-            sysmem_freeptr(bar_str);
-            sysmem_freeptr(prop_str);
-        }
-    }
-
-    // 2. For each unique track, find the source span matching old_rounded_offset and add its notes to the manifest.
-    for (long i = 0; i < unique_track_num_count; i++) {
-        long track_num_to_process = unique_track_nums[i];
-
-        // Construct the expected target track-offset identifier and check if it already exists
-        char target_track_str[64];
-        snprintf(target_track_str, 64, "%ld-%ld", track_num_to_process, new_rounded_offset);
-        t_symbol *target_track_sym = gensym(target_track_str);
-
-        int target_exists = 0;
-        for (long j = 0; j < num_keys; j++) {
-            char *p_str, *t_str, *b_str, *pr_str;
-            if (parse_hierarchical_key(keys[j], &p_str, &t_str, &b_str, &pr_str)) {
-                if (strcmp(p_str, x->current_palette->s_name) == 0 && strcmp(t_str, target_track_sym->s_name) == 0) {
-                    target_exists = 1;
-                    sysmem_freeptr(p_str);
-                    sysmem_freeptr(t_str);
-                    sysmem_freeptr(b_str);
-                    sysmem_freeptr(pr_str);
-                    break;
-                }
-                sysmem_freeptr(p_str);
-                sysmem_freeptr(t_str);
-                sysmem_freeptr(b_str);
-                sysmem_freeptr(pr_str);
+    // For each unique track number, find the source span matching old_rounded_offset and add its notes to the manifest.
+    for (long i = 0; i < pal->track_count; i++) {
+        long track_num_to_process = pal->tracks[i]->track;
+        int seen = 0;
+        for (long j = 0; j < i; j++) {
+            if (pal->tracks[j]->track == track_num_to_process) {
+                seen = 1;
+                break;
             }
         }
+        if (seen) continue;
 
-        if (target_exists) {
-            buildspans_log(x, "Target span %s already exists on palette %s. Skipping duplication for this track.", target_track_sym->s_name, x->current_palette->s_name);
+        if (span_index_track(&x->spans, pal, track_num_to_process, new_rounded_offset, 0)) {
+            buildspans_log(x, "Target span %ld-%ld already exists on palette %s. Skipping duplication for this track.", track_num_to_process, new_rounded_offset, x->current_palette->s_name);
             continue;
         }
 
-        // Construct the expected source track-offset identifier
-        char source_track_str[64];
-        snprintf(source_track_str, 64, "%ld-%ld", track_num_to_process, old_rounded_offset);
-        t_symbol *source_track_sym = gensym(source_track_str);
-
-        // Now iterate through all keys to find notes belonging to the source span
-        for (long j = 0; j < num_keys; j++) {
-            char *pal_str, *track_str, *bar_str, *prop_str;
-            if (parse_hierarchical_key(keys[j], &pal_str, &track_str, &bar_str, &prop_str)) {
-                if (strcmp(pal_str, x->current_palette->s_name) == 0 && strcmp(track_str, source_track_sym->s_name) == 0 && strcmp(prop_str, "absolutes") == 0) {
-                    t_atom *abs_atoms = NULL;
-                    long abs_count = 0;
-                    t_atomarray *abs_aa = NULL;
-                    t_atom abs_atom;
-                    if (dictionary_getatomarray(x->building, keys[j], (t_object **)&abs_aa) == MAX_ERR_NONE && abs_aa) {
-                        atomarray_getatoms(abs_aa, &abs_count, &abs_atoms);
-                    } else if (dictionary_getatom(x->building, keys[j], &abs_atom) == MAX_ERR_NONE) {
-                        abs_atoms = &abs_atom;
-                        abs_count = 1;
-                    }
-
-                    t_symbol *scores_key = generate_hierarchical_key(x->current_palette, source_track_sym, gensym(bar_str), gensym("scores"));
-                    t_atom *scores_atoms = NULL;
-                    long scores_count = 0;
-                    t_atomarray *scores_aa = NULL;
-                    t_atom scores_atom;
-                    if (dictionary_getatomarray(x->building, scores_key, (t_object **)&scores_aa) == MAX_ERR_NONE && scores_aa) {
-                        atomarray_getatoms(scores_aa, &scores_count, &scores_atoms);
-                    } else if (dictionary_getatom(x->building, scores_key, &scores_atom) == MAX_ERR_NONE) {
-                        scores_atoms = &scores_atom;
-                        scores_count = 1;
-                    }
-
-                    for (long k = 0; k < abs_count; k++) {
-                        if (manifest_count >= manifest_capacity) {
-                            manifest_capacity *= 2;
-                            manifest = (t_duplication_manifest_item *)sysmem_resizeptr(manifest, manifest_capacity * sizeof(t_duplication_manifest_item));
-                        }
-                        manifest[manifest_count].track_number = track_num_to_process;
-                        manifest[manifest_count].timestamp = atom_getfloat(abs_atoms + k);
-                        manifest[manifest_count].score = atom_getfloat(scores_atoms + k);
-                        manifest_count++;
-                    }
+        t_span_track *source = span_index_track(&x->spans, pal, track_num_to_process, old_rounded_offset, 0);
+        if (!source) continue;
+        for (long b = 0; b < source->bar_count; b++) {
+            t_span_bar *bar = &source->bars[b];
+            for (long k = 0; k < bar->note_count; k++) {
+                if (manifest_count >= manifest_capacity) {
+                    manifest_capacity *= 2;
+                    manifest = (t_duplication_manifest_item *)sysmem_resizeptr(manifest, manifest_capacity * sizeof(t_duplication_manifest_item));
                 }
-                sysmem_freeptr(pal_str);
-                sysmem_freeptr(track_str);
-                sysmem_freeptr(bar_str);
-                sysmem_freeptr(prop_str);
+                manifest[manifest_count].track_number = track_num_to_process;
+                manifest[manifest_count].timestamp = bar->absolutes[k];
+                manifest[manifest_count].score = bar->scores[k];
+                manifest_count++;
             }
         }
     }
-    sysmem_freeptr(unique_track_nums);
 
     // --- PROCESSING PHASE ---
     buildspans_log(x, "Processing %ld notes from duplication manifest.", manifest_count);
-    // Now that we have all the notes, we can safely add them to the building dictionary.
+    // Now that we have all the notes, we can safely add them to the index.
     if (manifest_count > 0) {
         qsort(manifest, manifest_count, sizeof(t_duplication_manifest_item), compare_manifest_items);
-        long bar_length = buildspans_get_bar_length(x);
         if (bar_length > 0) {
             long original_track = x->current_track;
+            t_span_palette *pal = span_index_palette(&x->spans, x->current_palette, 1);
 
             for (long k = 0; k < manifest_count; k++) {
                 x->current_track = manifest[k].track_number;
-                buildspans_process_and_add_note(x, manifest[k].timestamp, manifest[k].timestamp, manifest[k].score, f, bar_length);
+                buildspans_process_and_add_note(x, pal, manifest[k].timestamp, manifest[k].timestamp, manifest[k].score, f, bar_length);
             }
 
             x->current_track = original_track;
@@ -1231,7 +1220,6 @@ void buildspans_do_offset(t_buildspans *x, double f, double loop_start) {
     }
 
     sysmem_freeptr(manifest);
-    if (keys) sysmem_freeptr(keys);
     buildspans_visualize_memory(x);
     x->current_task_seq = -1;
     if (on_worker) {
@@ -1464,6 +1452,21 @@ void buildspans_do_list(t_buildspans *x, t_symbol *s, long argc, t_atom *argv) {
         return;
     }
 
+    t_span_palette *pal = span_index_palette(&x->spans, x->current_palette, 1);
+    if (pal) {
+        buildspans_ingest_note(x, pal, calc_timestamp, store_timestamp, score, bar_length);
+    }
+    x->last_msg_type = gensym("list");
+    buildspans_run_cleanup(x);
+    x->current_task_seq = -1;
+    if (on_worker) {
+        systhread_mutex_unlock(x->state_mutex);
+    }
+}
+
+// Add one note to every open span of the current track and palette, and to a span at the effective
+// offset. The caller has already resolved the palette and bar length and runs the cleanup afterwards.
+void buildspans_ingest_note(t_buildspans *x, t_span_palette *pal, double calc_timestamp, double store_timestamp, double score, long bar_length) {
     buildspans_log(x, "--- New Timestamp-Score Pair Received ---");
 
     // EPHEMERAL AUTO-INITIALIZATION: If no global offset has been set (current_offset == 0),
@@ -1474,124 +1477,141 @@ void buildspans_do_list(t_buildspans *x, t_symbol *s, long argc, t_atom *argv) {
     buildspans_log(x, "Palette: %s, Calc timestamp: %.2f, Score: %.2f, Store timestamp: %.2f, Effective Offset: %.2f", 
                     x->current_palette->s_name, calc_timestamp, score, store_timestamp, effective_offset);
 
-    // 1. Find all unique track symbols for the current track and CURRENT PALETTE.
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-
-    long unique_tracks_count = 0;
-    t_symbol **unique_track_syms = (t_symbol **)sysmem_newptr((num_keys + 1) * sizeof(t_symbol *));
-    char track_prefix[32];
-    snprintf(track_prefix, 32, "%ld-", x->current_track);
-
-    if (keys) {
-        for (long i = 0; i < num_keys; i++) {
-            char *pal_str, *track_str, *bar_str, *prop_str;
-            if (parse_hierarchical_key(keys[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-                if (strcmp(pal_str, x->current_palette->s_name) == 0 && strncmp(track_str, track_prefix, strlen(track_prefix)) == 0) {
-                    t_symbol *current_track_sym = gensym(track_str);
-                    int found = 0;
-                    for (long j = 0; j < unique_tracks_count; j++) {
-                        if (unique_track_syms[j] == current_track_sym) {
-                            found = 1;
-                            break;
-                        }
-                    }
-                    if (!found) {
-                        unique_track_syms[unique_tracks_count++] = current_track_sym;
-                    }
-                }
-                sysmem_freeptr(pal_str);
-                sysmem_freeptr(track_str);
-                sysmem_freeptr(bar_str);
-                sysmem_freeptr(prop_str);
-            }
+    // 1. Find the rounded offsets of all open spans for the current track and CURRENT PALETTE.
+    // They are copied out first because adding the note may end (and remove) a span.
+    long track_count = pal->track_count;
+    if (!span_reserve((void **)&x->spans.candidates, &x->spans.candidate_capacity, track_count + 1, sizeof(long))) return;
+    long *candidates = x->spans.candidates;
+    long candidate_count = 0;
+    for (long i = 0; i < track_count; i++) {
+        if (pal->tracks[i]->track == x->current_track) {
+            candidates[candidate_count++] = pal->tracks[i]->rounded_offset;
         }
     }
 
     // 2. Also consider the global current offset as a potential new span
-    char current_track_str[64];
-    snprintf(current_track_str, 64, "%ld-%ld", x->current_track, (long)round(effective_offset));
-    t_symbol *current_track_sym = gensym(current_track_str);
+    long effective_rounded = (long)round(effective_offset);
     int global_offset_found = 0;
-    for (long i = 0; i < unique_tracks_count; i++) {
-        if (unique_track_syms[i] == current_track_sym) {
+    for (long i = 0; i < candidate_count; i++) {
+        if (candidates[i] == effective_rounded) {
             global_offset_found = 1;
             break;
         }
     }
     if (!global_offset_found) {
-        unique_track_syms[unique_tracks_count++] = current_track_sym;
+        candidates[candidate_count++] = effective_rounded;
     }
 
-    // 3. Add the note to each span (identified by its unique track symbol)
+    // 3. Add the note to each span (identified by its track-offset)
     char candidates_str[1024] = "";
-    for (long i = 0; i < unique_tracks_count; i++) {
-        strncat(candidates_str, unique_track_syms[i]->s_name, 1024 - strlen(candidates_str) - 1);
-        if (i < unique_tracks_count - 1) strncat(candidates_str, ", ", 1024 - strlen(candidates_str) - 1);
+    size_t used = 0;
+    for (long i = 0; i < candidate_count && used < sizeof(candidates_str); i++) {
+        used += snprintf(candidates_str + used, sizeof(candidates_str) - used, (i < candidate_count - 1) ? "%ld-%ld, " : "%ld-%ld", x->current_track, candidates[i]);
     }
     buildspans_log(x, "Adding note to %ld span(s) on track %ld (palette %s): %s", 
-                    unique_tracks_count, x->current_track, x->current_palette->s_name, candidates_str);
-
-    for (long i = 0; i < unique_tracks_count; i++) {
-        t_symbol *target_track_sym = unique_track_syms[i];
+                    candidate_count, x->current_track, x->current_palette->s_name, candidates_str);
 
+    for (long i = 0; i < candidate_count; i++) {
         // ACTUAL OFFSET RESOLUTION HIERARCHY:
         // We need the high-precision double offset to correctly assign the note to a bar.
-        double actual_offset = 0.0;
-        int offset_found = 0;
-
-        // TIER 1: Dictionary Lookup
-        // We look at the first available bar from the target active span and use its high-precision offset.
-        // This is the authoritative source for spans that have already received data.
-        for (long j = 0; j < num_keys; j++) {
-            char *key_pal, *key_track, *key_bar, *key_prop;
-            if (parse_hierarchical_key(keys[j], &key_pal, &key_track, &key_bar, &key_prop)) {
-                if (strcmp(key_pal, x->current_palette->s_name) == 0 && strcmp(key_track, target_track_sym->s_name) == 0 && strcmp(key_prop, "offset") == 0) {
-                    t_atom *off_atoms = NULL;
-                    long off_count = 0;
-                    t_atomarray *off_aa = NULL;
-                    t_atom off_atom;
-                    if (dictionary_getatomarray(x->building, keys[j], (t_object **)&off_aa) == MAX_ERR_NONE && off_aa) {
-                        atomarray_getatoms(off_aa, &off_count, &off_atoms);
-                    } else if (dictionary_getatom(x->building, keys[j], &off_atom) == MAX_ERR_NONE) {
-                        off_atoms = &off_atom;
-                        off_count = 1;
-                    }
-                    if (off_count > 0) actual_offset = atom_getfloat(off_atoms);
-                    offset_found = 1;
-                    sysmem_freeptr(key_pal);
-                    sysmem_freeptr(key_track);
-                    sysmem_freeptr(key_bar);
-                    sysmem_freeptr(key_prop);
-                    break;
-                }
-                sysmem_freeptr(key_pal);
-                sysmem_freeptr(key_track);
-                sysmem_freeptr(key_bar);
-                sysmem_freeptr(key_prop);
-            }
-        }
-
+        // TIER 1: Index Lookup
+        // The first bar of the target span holds its high-precision offset. This is the
+        // authoritative source for spans that have already received data.
         // TIER 2: Effective Global Offset
-        // If no offset was found in the dictionary, we use the effective_offset.
+        // If the span has no bars (yet, or any longer), we use the effective_offset.
         // This handles both the manual current_offset (high precision) and 
         // the ephemeral auto-initialization (calc_timestamp).
-        if (!offset_found) {
-            actual_offset = effective_offset;
-        }
+        t_span_track *trk = span_index_track(&x->spans, pal, x->current_track, candidates[i], 0);
+        double actual_offset = (trk && trk->bar_count > 0) ? trk->bars[0].offset : effective_offset;
 
-        buildspans_process_and_add_note(x, calc_timestamp, store_timestamp, score, actual_offset, bar_length);
+        buildspans_process_and_add_note(x, pal, calc_timestamp, store_timestamp, score, actual_offset, bar_length);
     }
 
-    if (keys) sysmem_freeptr(keys);
-    sysmem_freeptr(unique_track_syms);
-
     x->last_note_calc = calc_timestamp;
     x->last_note_store = store_timestamp;
     x->last_note_score = score;
-    x->last_msg_type = gensym("list");
-    buildspans_run_cleanup(x);
+}
+
+// Handler for 'notes' batches: timestamp-score pairs ingested as one task
+void buildspans_notes(t_buildspans *x, t_symbol *s, long argc, t_atom *argv) {
+    long inlet_num = proxy_getinlet((t_object *)x);
+    if (inlet_num != 0) {
+        object_error((t_object *)x, "Message '%s' not understood in inlet %ld.", s->s_name, inlet_num);
+        return;
+    }
+
+    if (x->async && x->worker && !async_worker_is_worker_thread(x->worker)) {
+        buildspans_enqueue_task(x, (method)buildspans_do_notes, s, argc, argv);
+        return;
+    }
+
+    if (x->defer && !systhread_ismainthread()) {
+        defer(x, (method)buildspans_do_notes, s, (short)argc, argv);
+        return;
+    }
+
+    buildspans_do_notes(x, s, argc, argv);
+}
+
+void buildspans_do_notes(t_buildspans *x, t_symbol *s, long argc, t_atom *argv) {
+    long seq = buildspans_get_task_sequence(x);
+    x->current_task_seq = seq;
+    int on_worker = (x->async && x->worker && async_worker_is_worker_thread(x->worker));
+    if (on_worker) {
+        systhread_mutex_lock(x->state_mutex);
+    }
+    if (buildspans_is_task_cancelled(x, seq)) {
+        x->current_task_seq = -1;
+        if (on_worker) {
+            systhread_mutex_unlock(x->state_mutex);
+        }
+        return;
+    }
+
+    // The whole batch is rejected up front rather than ingesting a prefix of it.
+    int valid = (argc > 0 && argc % 2 == 0);
+    for (long i = 0; valid && i < argc; i++) {
+        long type = atom_gettype(argv + i);
+        valid = (type == A_FLOAT || type == A_LONG);
+    }
+    if (!valid) {
+        object_error((t_object *)x, "notes expects a list of timestamp-score pairs.");
+        x->current_task_seq = -1;
+        if (on_worker) {
+            systhread_mutex_unlock(x->state_mutex);
+        }
+        return;
+    }
+
+    // Bar length and palette are resolved once for the batch; the track cannot change within it.
+    long bar_length = buildspans_get_bar_length(x);
+    buildspans_log(x, "buildspans_notes: %ld note(s), utilizing bar_length %ld", argc / 2, bar_length);
+    t_span_palette *pal = (bar_length > 0) ? span_index_palette(&x->spans, x->current_palette, 1) : NULL;
+    if (!pal) {
+        if (bar_length <= 0) {
+            object_warn((t_object *)x, "Bar length is not positive. Ignoring input.");
+        }
+        x->current_task_seq = -1;
+        if (on_worker) {
+            systhread_mutex_unlock(x->state_mutex);
+        }
+        return;
+    }
+
+    // Each note still gets its own cleanup pass, so a batch ends exactly the spans the same notes
+    // sent as separate lists would. Only the memory visualization is held back until the end.
+    t_symbol *msg_type = gensym("notes");
+    x->in_batch = 1;
+    for (long i = 0; i < argc; i += 2) {
+        if (buildspans_is_task_cancelled(x, seq)) break;
+        double calc_timestamp = atom_getfloat(argv + i);
+        buildspans_ingest_note(x, pal, calc_timestamp, calc_timestamp, atom_getfloat(argv + i + 1), bar_length);
+        x->last_msg_type = msg_type;
+        buildspans_run_cleanup(x);
+    }
+    x->in_batch = 0;
+    buildspans_visualize_memory(x);
+
     x->current_task_seq = -1;
     if (on_worker) {
         systhread_mutex_unlock(x->state_mutex);
@@ -1601,143 +1621,45 @@ void buildspans_do_list(t_buildspans *x, t_symbol *s, long argc, t_atom *argv) {
 void buildspans_flush_track(t_buildspans *x, long track_num) {
     long bar_length = buildspans_get_bar_length(x);
     buildspans_log(x, "Decision: FLUSH track. Outcome: Flushing/ending currently open spans specifically for track %ld. Utilizing bar_length: %ld", track_num, bar_length);
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    if (!keys) return;
-
-    // 1. Identify all unique tracks for this track number across all palettes
-    long track_count = 0;
-    t_symbol **track_syms = (t_symbol **)sysmem_newptr(num_keys * sizeof(t_symbol *));
-    t_symbol **palette_syms = (t_symbol **)sysmem_newptr(num_keys * sizeof(t_symbol *));
-    char track_prefix[32];
-    snprintf(track_prefix, 32, "%ld-", track_num);
-
-    for (long i = 0; i < num_keys; i++) {
-        char *key_pal, *key_track, *key_bar, *key_prop;
-        if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-            if (strncmp(key_track, track_prefix, strlen(track_prefix)) == 0) {
-                int found = 0;
-                for(long j=0; j<track_count; ++j) {
-                    if (strcmp(track_syms[j]->s_name, key_track) == 0 && strcmp(palette_syms[j]->s_name, key_pal) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    track_syms[track_count] = gensym(key_track);
-                    palette_syms[track_count] = gensym(key_pal);
-                    track_count++;
-                }
-            }
-            sysmem_freeptr(key_pal);
-            sysmem_freeptr(key_track);
-            sysmem_freeptr(key_bar);
-            sysmem_freeptr(key_prop);
-        }
-    }
 
-    // 2. For each identified track, perform deferred rating check and end the span.
-    for (long i = 0; i < track_count; i++) {
-        t_symbol *track_sym = track_syms[i];
-        t_symbol *palette_sym = palette_syms[i];
-
-        // Find the last bar for this track.
-        long last_bar_timestamp = -1;
-        for (long j = 0; j < num_keys; j++) {
-            char *key_pal, *key_track, *key_bar, *key_prop;
-            if (parse_hierarchical_key(keys[j], &key_pal, &key_track, &key_bar, &key_prop)) {
-                if (strcmp(key_pal, palette_sym->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0) {
-                    long bar_val = atol(key_bar);
-                    if (last_bar_timestamp == -1 || bar_val > last_bar_timestamp) {
-                        last_bar_timestamp = bar_val;
-                    }
-                }
-                sysmem_freeptr(key_pal);
-                sysmem_freeptr(key_track);
-                sysmem_freeptr(key_bar);
-                sysmem_freeptr(key_prop);
+    // For every span of this track number across all palettes, perform the deferred rating check and
+    // end the span. Ending removes the span from its palette, so the index only advances past others.
+    for (long p = 0; p < x->spans.palette_count; p++) {
+        t_span_palette *pal = x->spans.palettes[p];
+        long i = 0;
+        while (i < pal->track_count) {
+            t_span_track *trk = pal->tracks[i];
+            if (trk->track != track_num) {
+                i++;
+                continue;
             }
+            if (buildspans_is_task_cancelled(x, x->current_task_seq)) return;
+            if (trk->bar_count > 0) {
+                buildspans_deferred_rating_check(x, pal, trk);
+            }
+            buildspans_end_track_span(x, pal, trk);
         }
-
-        if (last_bar_timestamp != -1) {
-            buildspans_deferred_rating_check(x, palette_sym, track_sym, last_bar_timestamp);
-        }
-
-        buildspans_end_track_span(x, palette_sym, track_sym);
     }
 
-    sysmem_freeptr(track_syms);
-    sysmem_freeptr(palette_syms);
-    sysmem_freeptr(keys);
-
     x->last_msg_type = gensym("flush");
     buildspans_run_cleanup(x);
 }
 
 
-void buildspans_check_discontiguity(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, double relative_comparison_val) {
-    long bar_length = buildspans_get_bar_length(x);
+void buildspans_check_discontiguity(t_buildspans *x, t_span_palette *pal, t_span_track *trk, double relative_comparison_val, long bar_length) {
     if (bar_length <= 0) return;
 
-    // Find the most recent bar for the current track
-    long last_bar_timestamp = -1;
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    if (keys) {
-        for (long i = 0; i < num_keys; i++) {
-            char *key_pal, *key_track, *key_bar, *key_prop;
-            if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-                if (strcmp(key_pal, palette_sym->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0) {
-                    long bar_val = atol(key_bar);
-                    if (last_bar_timestamp == -1 || bar_val > last_bar_timestamp) {
-                        last_bar_timestamp = bar_val;
-                    }
-                }
-                sysmem_freeptr(key_pal);
-                sysmem_freeptr(key_track);
-                sysmem_freeptr(key_bar);
-                sysmem_freeptr(key_prop);
-            }
-        }
-        sysmem_freeptr(keys);
-    }
-
-    if (last_bar_timestamp != -1) {
-        int was_pruned = buildspans_deferred_rating_check(x, palette_sym, track_sym, last_bar_timestamp);
-
-        // Re-find the most recent bar after potential pruning
-        long most_recent_bar_after_rating_check = last_bar_timestamp;
-        if (was_pruned) {
-            most_recent_bar_after_rating_check = -1;
-            dictionary_getkeys(x->building, &num_keys, &keys);
-            if (keys) {
-                for (long i = 0; i < num_keys; i++) {
-                    char *key_pal, *key_track, *key_bar, *key_prop;
-                    if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-                        if (strcmp(key_pal, palette_sym->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0) {
-                            long bar_val = atol(key_bar);
-                            if (most_recent_bar_after_rating_check == -1 || bar_val > most_recent_bar_after_rating_check) {
-                                most_recent_bar_after_rating_check = bar_val;
-                            }
-                        }
-                        sysmem_freeptr(key_pal);
-                        sysmem_freeptr(key_track);
-                        sysmem_freeptr(key_bar);
-                        sysmem_freeptr(key_prop);
-                    }
-                }
-                sysmem_freeptr(keys);
-            }
-        }
+    if (trk->bar_count > 0) {
+        buildspans_deferred_rating_check(x, pal, trk);
 
-        if (most_recent_bar_after_rating_check != -1) {
+        // Pruning keeps the most recent bar, so it is still the last one
+        if (trk->bar_count > 0) {
+            long most_recent_bar_after_rating_check = trk->bars[trk->bar_count - 1].timestamp;
             double gap_limit = (double)most_recent_bar_after_rating_check + 2.0 * (double)bar_length;
             int is_discontiguous = (relative_comparison_val > gap_limit);
 
             buildspans_log(x, "Discontiguity check: Assessing track %s on palette %s. Relative comparison value: %.2f, bar_length: %ld",
-                            track_sym->s_name, palette_sym->s_name, relative_comparison_val, bar_length);
+                            trk->track_name, pal->palette->s_name, relative_comparison_val, bar_length);
             buildspans_log(x, "  - Math: limit = most_recent_bar (%ld) + 2 * bar_length (%ld) = %.2f",
                             most_recent_bar_after_rating_check, bar_length, gap_limit);
             buildspans_log(x, "  - Comparison: (relative_comparison_val > limit) -> (%.2f > %.2f) ? %s",
@@ -1745,23 +1667,23 @@ void buildspans_check_discontiguity(t_buildspans *x, t_symbol *palette_sym, t_sy
 
             if (is_discontiguous) {
                 buildspans_log(x, "Decision: END span due to discontiguity. Outcome: Ending span for track %s on palette %s.",
-                                track_sym->s_name, palette_sym->s_name);
-                buildspans_end_track_span(x, palette_sym, track_sym);
+                                trk->track_name, pal->palette->s_name);
+                buildspans_end_track_span(x, pal, trk);
             } else {
                 buildspans_log(x, "Decision: CONTINUE span. Outcome: Span is contiguous. Math: relative_comparison_val (%.2f) <= limit (%.2f).",
                                 relative_comparison_val, gap_limit);
             }
         } else {
             buildspans_log(x, "Discontiguity check: Re-assessing track %s on palette %s after rating check pruning. No previous bars remain. Decision: CONTINUE span.",
-                            track_sym->s_name, palette_sym->s_name);
+                            trk->track_name, pal->palette->s_name);
         }
     } else {
         buildspans_log(x, "Discontiguity check: Assessing track %s on palette %s. No previous bars found. Decision: CONTINUE span.",
-                        track_sym->s_name, palette_sym->s_name);
+                        trk->track_name, pal->palette->s_name);
     }
 }
 
-void buildspans_process_and_add_note(t_buildspans *x, double calc_timestamp, double store_timestamp, double score, double offset, long bar_length) {
+void buildspans_process_and_add_note(t_buildspans *x, t_span_palette *pal, double calc_timestamp, double store_timestamp, double score, double offset, long bar_length) {
     if (buildspans_is_task_cancelled(x, x->current_task_seq)) return;
     if (offset == 0.0) {
         object_error((t_object *)x, "IMPORTANT: Span initialized with offset 0.0 on track %ld (palette %s)", x->current_track, x->current_palette->s_name);
@@ -1775,59 +1697,32 @@ void buildspans_process_and_add_note(t_buildspans *x, double calc_timestamp, dou
         buildspans_log(x, "*** History: last_msg_type %s", x->last_msg_type->s_name);
         buildspans_log(x, "*** Last note parameters: calc %.2f, store %.2f, score %.2f", x->last_note_calc, x->last_note_store, x->last_note_score);
         buildspans_log(x, "*** Current note parameters: calc %.2f, store %.2f, score %.2f", calc_timestamp, store_timestamp, score);
-        buildspans_log(x, "*** Elucidation: Offset 0.0 detected. If this happened during a 'list' message, it means no existing offset was found in the dictionary for this span (Tier 1 fail) AND the fallback (Tier 2) used either a 0.0 global offset or a 0.0 calc_timestamp.");
+        buildspans_log(x, "*** Elucidation: Offset 0.0 detected. If this happened during a 'list' message, it means no existing offset was found in the index for this span (Tier 1 fail) AND the fallback (Tier 2) used either a 0.0 global offset or a 0.0 calc_timestamp.");
 
         // List active spans
-        long num_keys;
-        t_symbol **keys;
-        dictionary_getkeys(x->building, &num_keys, &keys);
-        if (keys) {
-            char active_spans_str[2048] = "";
-            long active_spans_count = 0;
-            for (long i = 0; i < num_keys; i++) {
-                char *pal_str, *track_str, *bar_str, *prop_str;
-                if (parse_hierarchical_key(keys[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-                    if (strcmp(pal_str, x->current_palette->s_name) == 0 && strcmp(prop_str, "offset") == 0) {
-                        if (active_spans_count > 0) strncat(active_spans_str, ", ", 2048 - strlen(active_spans_str) - 1);
-                        strncat(active_spans_str, track_str, 2048 - strlen(active_spans_str) - 1);
-                        active_spans_count++;
-                    }
-                    sysmem_freeptr(pal_str); sysmem_freeptr(track_str); sysmem_freeptr(bar_str); sysmem_freeptr(prop_str);
-                }
+        char active_spans_str[2048] = "";
+        if (pal) {
+            for (long i = 0; i < pal->track_count; i++) {
+                if (i > 0) strncat(active_spans_str, ", ", 2048 - strlen(active_spans_str) - 1);
+                strncat(active_spans_str, pal->tracks[i]->track_name, 2048 - strlen(active_spans_str) - 1);
             }
-            buildspans_log(x, "*** Active spans on palette %s: %s", x->current_palette->s_name, active_spans_str);
-            sysmem_freeptr(keys);
         }
+        buildspans_log(x, "*** Active spans on palette %s: %s", x->current_palette->s_name, active_spans_str);
 
         // Temporary Fix: Remove the entire span
-        char target_track_str[64];
-        snprintf(target_track_str, 64, "%ld-0", x->current_track);
-        t_symbol *target_track_sym = gensym(target_track_str);
-
-        object_error((t_object *)x, "TEMPORARY FIX: Removing invalid span %s from memory.", target_track_sym->s_name);
-        buildspans_log(x, "*** TEMPORARY FIX: Removing all dictionary entries for span %s on palette %s.", target_track_sym->s_name, x->current_palette->s_name);
-
-        dictionary_getkeys(x->building, &num_keys, &keys);
-        if (keys) {
-            for (long i = 0; i < num_keys; i++) {
-                char *pal_str, *track_str, *bar_str, *prop_str;
-                if (parse_hierarchical_key(keys[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-                    if (strcmp(pal_str, x->current_palette->s_name) == 0 && strcmp(track_str, target_track_sym->s_name) == 0) {
-                        dictionary_deleteentry(x->building, keys[i]);
-                    }
-                    sysmem_freeptr(pal_str); sysmem_freeptr(track_str); sysmem_freeptr(bar_str); sysmem_freeptr(prop_str);
-                }
-            }
-            sysmem_freeptr(keys);
+        object_error((t_object *)x, "TEMPORARY FIX: Removing invalid span %ld-0 from memory.", x->current_track);
+        buildspans_log(x, "*** TEMPORARY FIX: Removing span %ld-0 on palette %s.", x->current_track, x->current_palette->s_name);
+
+        t_span_track *invalid = span_index_track(&x->spans, pal, x->current_track, 0, 0);
+        if (invalid) {
+            span_index_remove_track(&x->spans, pal, invalid);
         }
         buildspans_visualize_memory(x);
         return; // Abort processing for this note
     }
     buildspans_log(x, "buildspans_process_and_add_note: utilizing bar_length %ld", bar_length);
-    // Get current track symbol (using rounded offset for grouping)
-    char track_str[64];
-    snprintf(track_str, 64, "%ld-%ld", x->current_track, (long)round(offset));
-    t_symbol *track_sym = gensym(track_str);
+    // Spans are grouped by the rounded offset
+    long rounded_offset = (long)round(offset);
 
     // Calculate bar timestamp
     double relative_timestamp = calc_timestamp - offset + x->loop_start;
@@ -1835,411 +1730,145 @@ void buildspans_process_and_add_note(t_buildspans *x, double calc_timestamp, dou
     long bar_timestamp_val = floor(relative_timestamp / bar_length) * bar_length;
     buildspans_log(x, "Calculated bar timestamp (rounded down to nearest %ld): %ld", bar_length, bar_timestamp_val);
 
-    // --- Find the most recent bar for the current track to see if this is a new bar ---
-    long last_bar_timestamp = -1;
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    if (keys) {
-        for (long i = 0; i < num_keys; i++) {
-            char *key_pal, *key_track, *key_bar, *key_prop;
-            if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-                if (strcmp(key_pal, x->current_palette->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0) {
-                    long bar_val = atol(key_bar);
-                    if (last_bar_timestamp == -1 || bar_val > last_bar_timestamp) {
-                        last_bar_timestamp = bar_val;
-                    }
-                }
-                sysmem_freeptr(key_pal);
-                sysmem_freeptr(key_track);
-                sysmem_freeptr(key_bar);
-                sysmem_freeptr(key_prop);
-            }
-        }
-        sysmem_freeptr(keys);
-    }
+    if (!pal) return;
 
-    int is_new_bar = (last_bar_timestamp == -1 || bar_timestamp_val > last_bar_timestamp);
+    // --- The most recent bar is the last one, so a new bar is one past it ---
+    t_span_track *trk = span_index_track(&x->spans, pal, x->current_track, rounded_offset, 0);
+    int has_last_bar = (trk && trk->bar_count > 0);
+    int is_new_bar = (!has_last_bar || bar_timestamp_val > trk->bars[trk->bar_count - 1].timestamp);
 
     // --- Deferred span ending logic (only if a new bar is detected) ---
-    if (is_new_bar && last_bar_timestamp != -1) {
-        buildspans_check_discontiguity(x, x->current_palette, track_sym, relative_timestamp);
+    if (is_new_bar && has_last_bar) {
+        buildspans_check_discontiguity(x, pal, trk, relative_timestamp, bar_length);
     }
 
     // --- ADD OR UPDATE BAR ---
-    char bar_str[32];
-    snprintf(bar_str, 32, "%ld", bar_timestamp_val);
-    t_symbol *bar_sym = gensym(bar_str);
-
-    // Update offset
-    t_symbol *offset_key = generate_hierarchical_key(x->current_palette, track_sym, bar_sym, gensym("offset"));
-    if (dictionary_hasentry(x->building, offset_key)) dictionary_deleteentry(x->building, offset_key);
-    dictionary_appendfloat(x->building, offset_key, offset);
-    buildspans_log(x, "%s %.2f", offset_key->s_name, offset);
-    t_atom offset_atom;
-    atom_setfloat(&offset_atom, offset);
-
-    // Update palette
-    t_symbol *palette_key = generate_hierarchical_key(x->current_palette, track_sym, bar_sym, gensym("palette"));
-    if (dictionary_hasentry(x->building, palette_key)) dictionary_deleteentry(x->building, palette_key);
-    dictionary_appendsym(x->building, palette_key, x->current_palette);
-    buildspans_log(x, "%s %s", palette_key->s_name, x->current_palette->s_name);
-    t_atom palette_atom;
-    atom_setsym(&palette_atom, x->current_palette);
-
-    // Update absolutes array
-    t_symbol *absolutes_key = generate_hierarchical_key(x->current_palette, track_sym, bar_sym, gensym("absolutes"));
-    t_atomarray *absolutes_array = NULL;
-    if (dictionary_getatomarray(x->building, absolutes_key, (t_object **)&absolutes_array) != MAX_ERR_NONE || !absolutes_array) {
-        // If not found or if it was a single atom, create a new atomarray
-        t_atom existing_atom;
-        if (dictionary_getatom(x->building, absolutes_key, &existing_atom) == MAX_ERR_NONE) {
-            absolutes_array = atomarray_new(1, &existing_atom);
-        } else {
-            absolutes_array = atomarray_new(0, NULL);
-        }
-        t_atom a; atom_setobj(&a, (t_object *)absolutes_array);
-        if (dictionary_hasentry(x->building, absolutes_key)) dictionary_deleteentry(x->building, absolutes_key);
-        dictionary_appendatom(x->building, absolutes_key, &a);
-    }
-    t_atom new_absolute; atom_setfloat(&new_absolute, store_timestamp + x->loop_start);
-    atomarray_appendatom(absolutes_array, &new_absolute);
-    char *abs_str = atomarray_to_string(absolutes_array);
-    if (abs_str) {
-        buildspans_log(x, "%s %s", absolutes_key->s_name, abs_str);
-        sysmem_freeptr(abs_str);
-    }
-
-    // Update scores array
-    t_symbol *scores_key = generate_hierarchical_key(x->current_palette, track_sym, bar_sym, gensym("scores"));
-    t_atomarray *scores_array = NULL;
-    if (dictionary_getatomarray(x->building, scores_key, (t_object **)&scores_array) != MAX_ERR_NONE || !scores_array) {
-        // If not found or if it was a single atom, create a new atomarray
-        t_atom existing_atom;
-        if (dictionary_getatom(x->building, scores_key, &existing_atom) == MAX_ERR_NONE) {
-            scores_array = atomarray_new(1, &existing_atom);
-        } else {
-            scores_array = atomarray_new(0, NULL);
-        }
-        t_atom a; atom_setobj(&a, (t_object *)scores_array);
-        if (dictionary_hasentry(x->building, scores_key)) dictionary_deleteentry(x->building, scores_key);
-        dictionary_appendatom(x->building, scores_key, &a);
-    }
-    t_atom new_score; atom_setfloat(&new_score, score);
-    atomarray_appendatom(scores_array, &new_score);
-    char *scores_str = atomarray_to_string(scores_array);
-    if (scores_str) {
-        buildspans_log(x, "%s %s", scores_key->s_name, scores_str);
-        sysmem_freeptr(scores_str);
-    }
-
-    // Update mean
-    long scores_count = atomarray_getsize(scores_array);
-    if (scores_count > 0) {
-        double sum = 0.0;
-        long count; t_atom *atoms;
-        atomarray_getatoms(scores_array, &count, &atoms);
-        for (long i = 0; i < count; i++) sum += atom_getfloat(&atoms[i]);
-        double mean = sum / count;
-
-        t_symbol *mean_key = generate_hierarchical_key(x->current_palette, track_sym, bar_sym, gensym("mean"));
-        if (dictionary_hasentry(x->building, mean_key)) dictionary_deleteentry(x->building, mean_key);
-        dictionary_appendfloat(x->building, mean_key, mean);
-        buildspans_log(x, "%s %.2f", mean_key->s_name, mean);
-        t_atom mean_atom;
-        atom_setfloat(&mean_atom, mean);
-    }
-
-    // --- UPDATE AND BACK-PROPAGATE SPAN ---
-    // 1. Get all bar timestamps for the current track AND PALETTE.
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    long bar_timestamps_count = 0;
-    long *bar_timestamps = (long *)sysmem_newptr(num_keys * sizeof(long)); // Over-allocate, then count
-    if (keys) {
-        for (long i = 0; i < num_keys; i++) {
-            char *key_pal, *key_track, *key_bar, *key_prop;
-            if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-                if (strcmp(key_pal, x->current_palette->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0) {
-                    // To avoid duplicates, only add when we see the 'mean' property
-                    if (strcmp(key_prop, "mean") == 0) {
-                        bar_timestamps[bar_timestamps_count++] = atol(key_bar);
-                    }
-                }
-                sysmem_freeptr(key_pal);
-                sysmem_freeptr(key_track);
-                sysmem_freeptr(key_bar);
-                sysmem_freeptr(key_prop);
-            }
-        }
-        sysmem_freeptr(keys);
-    }
-    qsort(bar_timestamps, bar_timestamps_count, sizeof(long), compare_longs);
-
-    // 2. Create the NEW span array and link it to all bars in the track.
-    t_atomarray *new_span_array = atomarray_new(0, NULL);
-    for (long i = 0; i < bar_timestamps_count; i++) {
-        t_atom a; atom_setlong(&a, bar_timestamps[i]);
-        atomarray_appendatom(new_span_array, &a);
+    // The check above may have ended the span, so look it up again (creating it if needed).
+    trk = span_index_track(&x->spans, pal, x->current_track, rounded_offset, 1);
+    if (!trk) return;
+    int bar_existed = 0;
+    long pos = span_track_find_bar(trk, bar_timestamp_val, &bar_existed);
+    t_span_bar *bar = bar_existed ? &trk->bars[pos] : span_track_insert_bar(trk, pos, bar_timestamp_val);
+    if (!bar) return;
+    double old_mean = bar->mean;
+    const char *pal_name = pal->palette->s_name;
+    const char *track_name = trk->track_name;
+
+    bar->offset = offset;
+    buildspans_log(x, "%s::%s::%ld::offset %.2f", pal_name, track_name, bar_timestamp_val, offset);
+    buildspans_log(x, "%s::%s::%ld::palette %s", pal_name, track_name, bar_timestamp_val, pal_name);
+
+    if (!span_bar_add_note(bar, store_timestamp + x->loop_start, score)) {
+        object_error((t_object *)x, "Out of memory adding note to bar %ld of %s.", bar_timestamp_val, track_name);
+        return;
     }
-    char *span_str = atomarray_to_string(new_span_array);
-    if (span_str) {
-        for (long i = 0; i < bar_timestamps_count; i++) {
-            char temp_bar_str[32]; snprintf(temp_bar_str, 32, "%ld", bar_timestamps[i]);
-            t_symbol *temp_bar_sym = gensym(temp_bar_str);
-            t_symbol *span_key = generate_hierarchical_key(x->current_palette, track_sym, temp_bar_sym, gensym("span"));
-            
-            // Create a deep copy for each bar to ensure no shared ownership
-            t_atomarray *span_copy = atomarray_deep_copy(new_span_array);
-            t_atom span_copy_atom;
-            atom_setobj(&span_copy_atom, (t_object *)span_copy);
-            dictionary_appendatom(x->building, span_key, &span_copy_atom);
-
-            // Logging
-            char log_buffer[512];
-            snprintf(log_buffer, 512, "%s %s", span_key->s_name, span_str);
-            buildspans_log(x, "%s", log_buffer);
-        }
-        sysmem_freeptr(span_str);
-    }
-    object_free(new_span_array); // Free the original master array
-
-    // --- RATING CALCULATION & BACK-PROPAGATION ---
-    double final_lowest_mean = -1.0;
-    for (long i = 0; i < bar_timestamps_count; i++) {
-        char temp_bar_str[32]; snprintf(temp_bar_str, 32, "%ld", bar_timestamps[i]);
-        t_symbol *temp_bar_sym = gensym(temp_bar_str);
-        t_symbol *mean_key = generate_hierarchical_key(x->current_palette, track_sym, temp_bar_sym, gensym("mean"));
-        t_atom *m_atoms = NULL;
-        long m_count = 0;
-        t_atomarray *m_aa = NULL;
-        t_atom m_atom;
-        if (dictionary_getatomarray(x->building, mean_key, (t_object **)&m_aa) == MAX_ERR_NONE && m_aa) {
-            atomarray_getatoms(m_aa, &m_count, &m_atoms);
-        } else if (dictionary_getatom(x->building, mean_key, &m_atom) == MAX_ERR_NONE) {
-            m_atoms = &m_atom;
-            m_count = 1;
-        }
-        if (m_count > 0) {
-            double current_bar_mean = atom_getfloat(m_atoms);
-            if (final_lowest_mean == -1.0 || current_bar_mean < final_lowest_mean) {
-                final_lowest_mean = current_bar_mean;
-            }
-        }
+    // The list-valued lines are only built while @log is on; the recorder keeps the scalar ones.
+    char list_str[512];
+    if (x->log) {
+        format_double_list(list_str, sizeof(list_str), bar->absolutes, bar->note_count);
+        buildspans_log(x, "%s::%s::%ld::absolutes %s", pal_name, track_name, bar_timestamp_val, list_str);
+        format_double_list(list_str, sizeof(list_str), bar->scores, bar->note_count);
+        buildspans_log(x, "%s::%s::%ld::scores %s", pal_name, track_name, bar_timestamp_val, list_str);
     }
-    if (final_lowest_mean != -1.0) {
-        double final_rating = final_lowest_mean * bar_timestamps_count;
-        for (long i = 0; i < bar_timestamps_count; i++) {
-            char temp_bar_str[32]; snprintf(temp_bar_str, 32, "%ld", bar_timestamps[i]);
-            t_symbol *temp_bar_sym = gensym(temp_bar_str);
-            t_symbol *rating_key = generate_hierarchical_key(x->current_palette, track_sym, temp_bar_sym, gensym("rating"));
-            if (dictionary_hasentry(x->building, rating_key)) dictionary_deleteentry(x->building, rating_key);
-            dictionary_appendfloat(x->building, rating_key, final_rating);
-            buildspans_log(x, "%s %.2f", rating_key->s_name, final_rating);
-        }
-        buildspans_log(x, "Final rating for span: %.2f (%.2f * %ld)", final_rating, final_lowest_mean, bar_timestamps_count);
+    buildspans_log(x, "%s::%s::%ld::mean %.2f", pal_name, track_name, bar_timestamp_val, bar->mean);
+
+    // --- UPDATE SPAN AND RATING ---
+    // The span is the sorted bar array itself, and the rating (lowest mean * bar count) is shared by
+    // every bar, so only the changed bar needs looking at.
+    span_track_update_rating(trk, bar->mean, old_mean, bar_existed);
+    if (x->log) {
+        format_span_list(list_str, sizeof(list_str), trk, trk->bar_count);
+        buildspans_log(x, "%s::%s::span %s", pal_name, track_name, list_str);
     }
+    buildspans_log(x, "%s::%s::rating %.2f", pal_name, track_name, trk->rating);
+    buildspans_log(x, "Final rating for span: %.2f (%.2f * %ld)", trk->rating, trk->lowest_mean, trk->bar_count);
 
-    sysmem_freeptr(bar_timestamps);
     buildspans_visualize_memory(x);
 }
 
-void buildspans_end_track_span(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym) {
-    if (buildspans_is_task_cancelled(x, x->current_task_seq)) return;
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    if (!keys) return;
-
-    // 1. Find the first 'span' atomarray for the track. They are all shared.
-    t_atomarray *span_to_output = NULL;
-    t_atomarray *span_aa = NULL;
-    t_atom span_atom;
-    int span_found_robustly = 0;
-
-    if (keys) {
-        for (long i = 0; i < num_keys; i++) {
-            char *key_pal, *key_track, *key_bar, *key_prop;
-            if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-                if (strcmp(key_pal, palette_sym->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0 && strcmp(key_prop, "span") == 0) {
-                    if (dictionary_getatomarray(x->building, keys[i], (t_object **)&span_aa) == MAX_ERR_NONE && span_aa) {
-                        span_to_output = span_aa;
-                        span_found_robustly = 1;
-                    } else if (dictionary_getatom(x->building, keys[i], &span_atom) == MAX_ERR_NONE) {
-                        span_to_output = atomarray_new(1, &span_atom);
-                        span_found_robustly = 1;
-                    }
-                    sysmem_freeptr(key_pal);
-                    sysmem_freeptr(key_track);
-                    sysmem_freeptr(key_bar);
-                    sysmem_freeptr(key_prop);
-                    if (span_found_robustly) break; // Found it.
-                }
-                sysmem_freeptr(key_pal);
-                sysmem_freeptr(key_track);
-                sysmem_freeptr(key_bar);
-                sysmem_freeptr(key_prop);
-            }
-        }
+// Send an ended span (the first span_size bars of the track) downstream: detailed bar data, then the
+// track number, then the span list. Goes straight to the bound crucible when there is one.
+void buildspans_output_span(t_buildspans *x, t_span_palette *pal, t_span_track *trk, long span_size, double rating) {
+    // Write log if log is enabled
+    if (x->log) {
+        write_multibar_negative_rating_log(x, pal, trk, span_size, rating);
     }
 
-    // 2. If no span was found (e.g., single bar), create one locally.
-    int local_span_created = 0;
-    if (!span_to_output && keys) {
-        local_span_created = 1;
-        span_to_output = atomarray_new(0, NULL);
-        long bar_count = 0;
-        long *bar_timestamps = (long *)sysmem_newptr(num_keys * sizeof(long));
-        for (long i = 0; i < num_keys; i++) {
-            char *key_pal, *key_track, *key_bar, *key_prop;
-             if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-                if (strcmp(key_pal, palette_sym->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0 && strcmp(key_prop, "mean") == 0) {
-                     bar_timestamps[bar_count++] = atol(key_bar);
-                }
-                sysmem_freeptr(key_pal);
-                sysmem_freeptr(key_track);
-                sysmem_freeptr(key_bar);
-                sysmem_freeptr(key_prop);
-            }
-        }
-        qsort(bar_timestamps, bar_count, sizeof(long), compare_longs);
-        for(long i=0; i<bar_count; ++i) {
-            t_atom a;
-            atom_setlong(&a, bar_timestamps[i]);
-            atomarray_appendatom(span_to_output, &a);
-        }
-        sysmem_freeptr(bar_timestamps);
-    }
-
-
-    // 3. Calculate rating and output.
-    if (span_to_output) {
-        if (buildspans_validate_span_before_output(x, palette_sym, track_sym, span_to_output)) {
-            long span_size;
-            t_atom *span_atoms;
-            atomarray_getatoms(span_to_output, &span_size, &span_atoms);
-
-            double lowest_mean = -1.0;
-            if (span_size > 0) {
-                for (long i = 0; i < span_size; i++) {
-                    long bar_ts = atom_getlong(&span_atoms[i]);
-                    char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_ts);
-                    t_symbol *bar_sym = gensym(bar_str);
-                    t_symbol *mean_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("mean"));
-                    t_atom *m_atoms = NULL;
-                    long m_count = 0;
-                    t_atomarray *m_aa = NULL;
-                    t_atom m_atom;
-                    if (dictionary_getatomarray(x->building, mean_key, (t_object **)&m_aa) == MAX_ERR_NONE && m_aa) {
-                        atomarray_getatoms(m_aa, &m_count, &m_atoms);
-                    } else if (dictionary_getatom(x->building, mean_key, &m_atom) == MAX_ERR_NONE) {
-                        m_atoms = &m_atom;
-                        m_count = 1;
-                    }
-                    if (m_count > 0) {
-                        double bar_mean = atom_getfloat(m_atoms);
-                        if (lowest_mean == -1.0 || bar_mean < lowest_mean) {
-                            lowest_mean = bar_mean;
-                        }
-                    }
-                }
-            }
-            double final_rating = (lowest_mean != -1.0) ? (lowest_mean * span_size) : 0.0;
-            buildspans_log(x, "Ending span for track %s on palette %s with rating %.2f (%.2f * %ld)", track_sym->s_name, palette_sym->s_name, final_rating, lowest_mean, span_size);
-
-            long track_num_to_output;
-            sscanf(track_sym->s_name, "%ld-", &track_num_to_output);
-
-            // Write log if log is enabled
-            if (x->log) {
-                write_multibar_negative_rating_log(x, palette_sym, track_sym, span_to_output, final_rating);
-            }
-
-            // Outlet 3: Detailed span data
-            buildspans_output_span_data(x, palette_sym, track_sym, span_to_output);
+    // A bound crucible gets the whole span as one typed record, borrowing the note buffers.
+    if (x->bound_crucible) {
+        if (buildspans_is_task_cancelled(x, x->current_task_seq)) return;
+        if (!span_reserve((void **)&x->spans.handoff, &x->spans.handoff_capacity, span_size, sizeof(t_crucible_span_bar))) return;
+        for (long i = 0; i < span_size; i++) {
+            t_span_bar *bar = &trk->bars[i];
+            t_crucible_span_bar *out = &x->spans.handoff[i];
+            out->timestamp = bar->timestamp;
+            out->offset = bar->offset;
+            out->mean = bar->mean;
+            out->absolutes = bar->absolutes;
+            out->scores = bar->scores;
+            out->note_count = bar->note_count;
+        }
+        t_crucible_span_record record;
+        record.track = trk->track;
+        record.palette = pal->palette;
+        record.rating = rating;
+        record.bars = x->spans.handoff;
+        record.bar_count = span_size;
+        crucible_submit_span((t_crucible *)x->bound_crucible, &record);
+        return;
+    }
 
-            // Outlet 2: Track number
-            t_atom t_atom_track;
-            atom_setlong(&t_atom_track, track_num_to_output);
-            if (x->bound_crucible) {
-                crucible_do_anything((t_crucible *)x->bound_crucible, gensym("track"), 1, &t_atom_track);
-            } else {
-                if (!x->async || systhread_ismainthread()) {
-                    outlet_anything(x->track_outlet, gensym("track"), 1, &t_atom_track);
-                } else {
-                    defer(x, (method)buildspans_defer_output, gensym("track"), 1, &t_atom_track);
-                }
-            }
+    // Outlet 3: Detailed span data
+    buildspans_output_span_data(x, pal, trk, span_size, rating);
 
-            // Outlet 1: Span list
-            if (x->bound_crucible) {
-                crucible_do_anything((t_crucible *)x->bound_crucible, gensym("span"), (short)span_size, span_atoms);
-            } else {
-                if (!x->async || systhread_ismainthread()) {
-                    outlet_anything(x->span_outlet, gensym("span"), (short)span_size, span_atoms);
-                } else {
-                    defer(x, (method)buildspans_defer_output, gensym("span"), (short)span_size, span_atoms);
-                }
-            }
-        }
+    // Outlet 2: Track number
+    t_atom t_atom_track;
+    atom_setlong(&t_atom_track, trk->track);
+    if (!x->async || systhread_ismainthread()) {
+        outlet_anything(x->track_outlet, gensym("track"), 1, &t_atom_track);
+    } else {
+        defer(x, (method)buildspans_defer_output, gensym("track"), 1, &t_atom_track);
+    }
 
-        if (local_span_created || (span_found_robustly && span_to_output != span_aa)) {
-            object_free(span_to_output);
-        }
+    // Outlet 1: Span list
+    t_atom *span_atoms = span_index_atoms(&x->spans, span_size);
+    if (!span_atoms) return;
+    for (long i = 0; i < span_size; i++) atom_setlong(span_atoms + i, trk->bars[i].timestamp);
+    if (!x->async || systhread_ismainthread()) {
+        outlet_anything(x->span_outlet, gensym("span"), (short)span_size, span_atoms);
+    } else {
+        defer(x, (method)buildspans_defer_output, gensym("span"), (short)span_size, span_atoms);
     }
+}
 
-    // 4. Delete all keys associated with the track AND palette.
-    if (keys) {
-        t_symbol **keys_to_delete = (t_symbol**)sysmem_newptr(num_keys * sizeof(t_symbol*));
-        long delete_count = 0;
-        for(long i=0; i<num_keys; ++i) {
-            char *key_pal, *key_track, *key_bar, *key_prop;
-            if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-                 if (strcmp(key_pal, palette_sym->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0) {
-                     keys_to_delete[delete_count++] = keys[i];
-                 }
-                 sysmem_freeptr(key_pal);
-                 sysmem_freeptr(key_track);
-                 sysmem_freeptr(key_bar);
-                 sysmem_freeptr(key_prop);
-             }
-        }
-        for(long i=0; i<delete_count; ++i) {
-            dictionary_deleteentry(x->building, keys_to_delete[i]);
-        }
-        sysmem_freeptr(keys_to_delete);
-        sysmem_freeptr(keys);
+// End a span: output it if it validates, then remove it from the index. trk is invalid afterwards.
+void buildspans_end_track_span(t_buildspans *x, t_span_palette *pal, t_span_track *trk) {
+    if (buildspans_is_task_cancelled(x, x->current_task_seq)) return;
+
+    // 1. Calculate rating and output. The span is every bar of the track.
+    long span_size = trk->bar_count;
+    if (buildspans_validate_span_before_output(x, pal, trk, span_size)) {
+        double lowest_mean = span_track_lowest_mean(trk, span_size);
+        double final_rating = lowest_mean * span_size;
+        buildspans_log(x, "Ending span for track %s on palette %s with rating %.2f (%.2f * %ld)", trk->track_name, pal->palette->s_name, final_rating, lowest_mean, span_size);
+        buildspans_output_span(x, pal, trk, span_size, final_rating);
     }
 
+    // 2. Remove the span, deferring the cleanup check until the end of the current event.
+    long track = trk->track;
+    long rounded_offset = trk->rounded_offset;
+    span_index_remove_track(&x->spans, pal, trk);
     buildspans_visualize_memory(x);
-    // Defer the cleanup check by adding the track to a temporary dictionary.
-    // We'll store it as palette::track to be sure
-    char deferred_key[256];
-    snprintf(deferred_key, 256, "%s::%s", palette_sym->s_name, track_sym->s_name);
-    dictionary_appendsym(x->tracks_ended_in_current_event, gensym(deferred_key), 0);
+    span_index_mark_ended(&x->spans, pal, track, rounded_offset);
 }
 
 void buildspans_run_cleanup(t_buildspans *x) {
-    long num_ended_tracks;
-    t_symbol **ended_track_keys;
-    dictionary_getkeys(x->tracks_ended_in_current_event, &num_ended_tracks, &ended_track_keys);
-    if (ended_track_keys) {
-        for (long i = 0; i < num_ended_tracks; i++) {
-            // Re-parse the palette and track from the deferred key "pal::track"
-            char *pal_str = NULL;
-            char *track_str = strstr(ended_track_keys[i]->s_name, "::");
-            if (track_str) {
-                size_t pal_len = track_str - ended_track_keys[i]->s_name;
-                pal_str = (char *)sysmem_newptr(pal_len + 1);
-                strncpy(pal_str, ended_track_keys[i]->s_name, pal_len);
-                pal_str[pal_len] = '\0';
-                track_str += 2;
-                buildspans_cleanup_track_offset_if_needed(x, gensym(pal_str), gensym(track_str));
-                sysmem_freeptr(pal_str);
-            }
-        }
-        sysmem_freeptr(ended_track_keys);
+    // Cleanup may remove spans but never ends new ones, so the list is stable while we walk it.
+    for (long i = 0; i < x->spans.ended_count; i++) {
+        t_span_ended *ended = &x->spans.ended[i];
+        buildspans_cleanup_track_offset_if_needed(x, ended->palette, ended->track, ended->rounded_offset);
     }
-    dictionary_clear(x->tracks_ended_in_current_event);
+    x->spans.ended_count = 0;
 }
 
 
@@ -2283,40 +1912,10 @@ void buildspans_do_bang(t_buildspans *x, t_symbol *s, long argc, t_atom *argv) {
     long bar_length = buildspans_get_bar_length(x);
     buildspans_log(x, "Decision: BANG flush. Outcome: Flush triggered by bang. Ending/flushing all currently open spans across all tracks/palettes. Utilizing bar_length: %ld", bar_length);
 
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-
-    if (keys) {
-        long unique_palette_count = 0;
-        t_symbol **unique_palettes = (t_symbol **)sysmem_newptr(num_keys * sizeof(t_symbol *));
-
-        for (long i = 0; i < num_keys; i++) {
-            char *pal_str, *track_str, *bar_str, *prop_str;
-            if (parse_hierarchical_key(keys[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-                int found = 0;
-                for (long j = 0; j < unique_palette_count; j++) {
-                    if (strcmp(unique_palettes[j]->s_name, pal_str) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    unique_palettes[unique_palette_count++] = gensym(pal_str);
-                }
-                sysmem_freeptr(pal_str);
-                sysmem_freeptr(track_str);
-                sysmem_freeptr(bar_str);
-                sysmem_freeptr(prop_str);
-            }
-        }
-
-        for (long i = 0; i < unique_palette_count; i++) {
-            buildspans_flush(x, unique_palettes[i]);
+    for (long p = 0; p < x->spans.palette_count; p++) {
+        if (x->spans.palettes[p]->track_count > 0) {
+            buildspans_flush(x, x->spans.palettes[p], bar_length);
         }
-
-        sysmem_freeptr(unique_palettes);
-        sysmem_freeptr(keys);
     }
 
     if (x->bound_crucible) {
@@ -2336,71 +1935,20 @@ void buildspans_do_bang(t_buildspans *x, t_symbol *s, long argc, t_atom *argv) {
     }
 }
 
-void buildspans_flush(t_buildspans *x, t_symbol *palette_sym) {
-    long bar_length = buildspans_get_bar_length(x);
+void buildspans_flush(t_buildspans *x, t_span_palette *pal, long bar_length) {
     buildspans_log(x, "buildspans_flush: utilizing bar_length %ld", bar_length);
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    if (!keys) return;
-
-    // 1. Identify all unique tracks FOR THIS PALETTE.
-    long track_count = 0;
-    t_symbol **track_syms = (t_symbol **)sysmem_newptr(num_keys * sizeof(t_symbol *));
-    for (long i = 0; i < num_keys; i++) {
-        char *key_pal, *key_track, *key_bar, *key_prop;
-        if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-            if (strcmp(key_pal, palette_sym->s_name) == 0) {
-                int found = 0;
-                for(long j=0; j<track_count; ++j) {
-                    if (strcmp(track_syms[j]->s_name, key_track) == 0) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    track_syms[track_count++] = gensym(key_track);
-                }
-            }
-            sysmem_freeptr(key_pal);
-            sysmem_freeptr(key_track);
-            sysmem_freeptr(key_bar);
-            sysmem_freeptr(key_prop);
-        }
-    }
 
-    // 2. For each track, perform deferred rating check and end the span.
-    for (long i = 0; i < track_count; i++) {
-        t_symbol *track_sym = track_syms[i];
-
-        // Find the last bar for this track.
-        long last_bar_timestamp = -1;
-        for (long j = 0; j < num_keys; j++) {
-            char *key_pal, *key_track, *key_bar, *key_prop;
-            if (parse_hierarchical_key(keys[j], &key_pal, &key_track, &key_bar, &key_prop)) {
-                if (strcmp(key_pal, palette_sym->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0) {
-                    long bar_val = atol(key_bar);
-                    if (last_bar_timestamp == -1 || bar_val > last_bar_timestamp) {
-                        last_bar_timestamp = bar_val;
-                    }
-                }
-                sysmem_freeptr(key_pal);
-                sysmem_freeptr(key_track);
-                sysmem_freeptr(key_bar);
-                sysmem_freeptr(key_prop);
-            }
-        }
-
-        if (last_bar_timestamp != -1) {
-            buildspans_deferred_rating_check(x, palette_sym, track_sym, last_bar_timestamp);
+    // For each track, perform deferred rating check and end the span. Ending removes it from the
+    // palette, so we always take the first one.
+    while (pal->track_count > 0) {
+        if (buildspans_is_task_cancelled(x, x->current_task_seq)) return;
+        t_span_track *trk = pal->tracks[0];
+        if (trk->bar_count > 0) {
+            buildspans_deferred_rating_check(x, pal, trk);
         }
-
-        buildspans_end_track_span(x, palette_sym, track_sym);
+        buildspans_end_track_span(x, pal, trk);
     }
 
-    sysmem_freeptr(track_syms);
-    sysmem_freeptr(keys);
-
     x->last_msg_type = gensym("flush");
     buildspans_run_cleanup(x);
 }
@@ -2410,7 +1958,7 @@ void buildspans_assist(t_buildspans *x, void *b, long m, long a, char *s) {
     if (m == ASSIST_INLET) {
         switch (a) {
             case 0:
-                sprintf(s, "Inlet 1: (list) note data, (bang) flush, (flush) flush track, (clear) clear, (log/visualize/bind/async) attributes.");
+                sprintf(s, "Inlet 1: (list) note data, (notes) note batch, (bang) flush, (flush) flush track, (clear) clear, (log/visualize/bind/async) attributes.");
                 break;
             case 1:
                 sprintf(s, "Inlet 2: (list/float) Offset Timestamp, [Offset, Loop Start]");
@@ -2659,351 +2207,85 @@ t_max_err buildspans_attr_set_visualize(t_buildspans *x, void *attr, long ac, t_
     return MAX_ERR_NONE;
 }
 
-void buildspans_prune_span(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, long bar_to_keep) {
+// End every bar of the span except the most recent one, which starts a new span on its own.
+void buildspans_prune_span(t_buildspans *x, t_span_palette *pal, t_span_track *trk) {
     if (buildspans_is_task_cancelled(x, x->current_task_seq)) return;
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    if (!keys) return;
-
-    // 1. Identify all bars to end.
-    long end_count = 0;
-    long *bars_to_end_vals = (long *)sysmem_newptr(num_keys * sizeof(long));
-
-    for (long i = 0; i < num_keys; i++) {
-        char *key_pal, *key_track, *key_bar, *key_prop;
-        if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-            if (strcmp(key_pal, palette_sym->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0 && strcmp(key_prop, "mean") == 0) {
-                long bar_val = atol(key_bar);
-                if (bar_val != bar_to_keep) {
-                    bars_to_end_vals[end_count++] = bar_val;
-                }
-            }
-            sysmem_freeptr(key_pal);
-            sysmem_freeptr(key_track);
-            sysmem_freeptr(key_bar);
-            sysmem_freeptr(key_prop);
-        }
-    }
+    if (trk->bar_count == 0) return;
+    long bar_to_keep = trk->bars[trk->bar_count - 1].timestamp;
+
+    // 1. The bars to end are everything before the kept one.
+    long end_count = trk->bar_count - 1;
 
     // 2. Finalize the state of the ended bars and then output.
     if (end_count > 0) {
-        buildspans_log(x, "Pruning span for track %s on palette %s, keeping bar %ld", track_sym->s_name, palette_sym->s_name, bar_to_keep);
-        qsort(bars_to_end_vals, end_count, sizeof(long), compare_longs);
-
-        // Create the list of ended bars
-        t_atomarray *ended_span_array = atomarray_new(0, NULL);
-        for(long i = 0; i < end_count; ++i) {
-            t_atom a; atom_setlong(&a, bars_to_end_vals[i]);
-            atomarray_appendatom(ended_span_array, &a);
-        }
+        buildspans_log(x, "Pruning span for track %s on palette %s, keeping bar %ld", trk->track_name, pal->palette->s_name, bar_to_keep);
 
         // Finalize the span data *before* outputting
         buildspans_log(x, "Finalizing ended span...");
-        buildspans_finalize_and_log_span(x, palette_sym, track_sym, ended_span_array);
+        double final_rating = buildspans_finalize_and_log_span(x, pal, trk, end_count);
 
         // Validate and output the finalized data
-        if (buildspans_validate_span_before_output(x, palette_sym, track_sym, ended_span_array)) {
-            long span_size;
-            t_atom *span_atoms;
-            atomarray_getatoms(ended_span_array, &span_size, &span_atoms);
-
-            double lowest_mean = -1.0;
-            if (span_size > 0) {
-                for (long i = 0; i < span_size; i++) {
-                    long bar_ts = atom_getlong(&span_atoms[i]);
-                    char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_ts);
-                    t_symbol *bar_sym = gensym(bar_str);
-                    t_symbol *mean_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("mean"));
-                    t_atom *m_atoms = NULL;
-                    long m_count = 0;
-                    t_atomarray *m_aa = NULL;
-                    t_atom m_atom;
-                    if (dictionary_getatomarray(x->building, mean_key, (t_object **)&m_aa) == MAX_ERR_NONE && m_aa) {
-                        atomarray_getatoms(m_aa, &m_count, &m_atoms);
-                    } else if (dictionary_getatom(x->building, mean_key, &m_atom) == MAX_ERR_NONE) {
-                        m_atoms = &m_atom;
-                        m_count = 1;
-                    }
-                    if (m_count > 0) {
-                        double bar_mean = atom_getfloat(m_atoms);
-                        if (lowest_mean == -1.0 || bar_mean < lowest_mean) {
-                            lowest_mean = bar_mean;
-                        }
-                    }
-                }
-            }
-            double final_rating = (lowest_mean != -1.0) ? (lowest_mean * span_size) : 0.0;
-
-            long track_num_to_output;
-            sscanf(track_sym->s_name, "%ld-", &track_num_to_output);
-
-            // Write log if log is enabled
-            if (x->log) {
-                write_multibar_negative_rating_log(x, palette_sym, track_sym, ended_span_array, final_rating);
-            }
-
-            // Outlet 3: Detailed span data
-            buildspans_output_span_data(x, palette_sym, track_sym, ended_span_array);
-
-            // Outlet 2: Track number
-            t_atom t_atom_track;
-            atom_setlong(&t_atom_track, track_num_to_output);
-            if (x->bound_crucible) {
-                crucible_do_anything((t_crucible *)x->bound_crucible, gensym("track"), 1, &t_atom_track);
-            } else {
-                if (!x->async || systhread_ismainthread()) {
-                    outlet_anything(x->track_outlet, gensym("track"), 1, &t_atom_track);
-                } else {
-                    defer(x, (method)buildspans_defer_output, gensym("track"), 1, &t_atom_track);
-                }
-            }
-
-            // Outlet 1: Span list
-            if (x->bound_crucible) {
-                crucible_do_anything((t_crucible *)x->bound_crucible, gensym("span"), (short)span_size, span_atoms);
-            } else {
-                if (!x->async || systhread_ismainthread()) {
-                    outlet_anything(x->span_outlet, gensym("span"), (short)span_size, span_atoms);
-                } else {
-                    defer(x, (method)buildspans_defer_output, gensym("span"), (short)span_size, span_atoms);
-                }
-            }
+        if (buildspans_validate_span_before_output(x, pal, trk, end_count)) {
+            buildspans_output_span(x, pal, trk, end_count, final_rating);
         }
-        object_free(ended_span_array);
-    }
 
-    // 4. Delete keys for ended bars.
-    t_symbol **keys_to_delete = (t_symbol**)sysmem_newptr(num_keys * sizeof(t_symbol*));
-    long delete_count = 0;
-    for (long j = 0; j < num_keys; j++) {
-        char *key_pal, *key_track, *key_bar, *key_prop;
-        if (parse_hierarchical_key(keys[j], &key_pal, &key_track, &key_bar, &key_prop)) {
-            if (strcmp(key_pal, palette_sym->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0) {
-                long bar_val = atol(key_bar);
-                if (bar_val != bar_to_keep) {
-                    keys_to_delete[delete_count++] = keys[j];
-                }
-            }
-            sysmem_freeptr(key_pal);
-            sysmem_freeptr(key_track);
-            sysmem_freeptr(key_bar);
-            sysmem_freeptr(key_prop);
-        }
+        // 3. Remove the ended bars.
+        span_track_remove_bars(trk, 0, end_count);
     }
-    for(long i=0; i<delete_count; ++i) {
-        dictionary_deleteentry(x->building, keys_to_delete[i]);
-    }
-
-    sysmem_freeptr(keys_to_delete);
-    sysmem_freeptr(bars_to_end_vals);
-    sysmem_freeptr(keys);
 
-    char bar_to_keep_str[32];
-    snprintf(bar_to_keep_str, 32, "%ld", bar_to_keep);
     buildspans_log(x, "Resetting kept bar...");
-    buildspans_reset_bar_to_standalone(x, palette_sym, track_sym, gensym(bar_to_keep_str));
+    buildspans_reset_bar_to_standalone(x, pal, trk);
 
     // Since a span was ended, we need to schedule a cleanup check.
     if (end_count > 0) {
-        char deferred_key[256];
-        snprintf(deferred_key, 256, "%s::%s", palette_sym->s_name, track_sym->s_name);
-        dictionary_appendsym(x->tracks_ended_in_current_event, gensym(deferred_key), 0);
+        span_index_mark_ended(&x->spans, pal, trk->track, trk->rounded_offset);
     }
 
     buildspans_visualize_memory(x);
 }
 
 
-void buildspans_reset_bar_to_standalone(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, t_symbol *bar_sym) {
-    // Update rating to mean
-    t_symbol *mean_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("mean"));
-    t_atom *m_atoms = NULL;
-    long m_count = 0;
-    t_atomarray *m_aa = NULL;
-    t_atom m_atom;
-    if (dictionary_getatomarray(x->building, mean_key, (t_object **)&m_aa) == MAX_ERR_NONE && m_aa) {
-        atomarray_getatoms(m_aa, &m_count, &m_atoms);
-    } else if (dictionary_getatom(x->building, mean_key, &m_atom) == MAX_ERR_NONE) {
-        m_atoms = &m_atom;
-        m_count = 1;
-    }
-
-    if (m_count > 0) {
-        double mean_val = atom_getfloat(m_atoms);
-
-        t_symbol *rating_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("rating"));
-        if (dictionary_hasentry(x->building, rating_key)) dictionary_deleteentry(x->building, rating_key);
-        dictionary_appendfloat(x->building, rating_key, mean_val);
-        buildspans_log(x, "%s %.2f", rating_key->s_name, mean_val);
-    }
-
-    // Update span to be only itself
-    t_atomarray *new_span_array = atomarray_new(0, NULL);
-    t_atom new_bar_atom;
-    atom_setlong(&new_bar_atom, atol(bar_sym->s_name));
-    atomarray_appendatom(new_span_array, &new_bar_atom);
-
-    t_atom new_span_atom;
-    atom_setobj(&new_span_atom, (t_object *)new_span_array);
-
-    t_symbol *span_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("span"));
-    dictionary_appendatom(x->building, span_key, &new_span_atom);
-
-    char *span_str = atomarray_to_string(new_span_array);
-    if (span_str) {
-        buildspans_log(x, "%s %s", span_key->s_name, span_str);
-        sysmem_freeptr(span_str);
-    }
+void buildspans_reset_bar_to_standalone(t_buildspans *x, t_span_palette *pal, t_span_track *trk) {
+    // A lone bar is its own span, rated by its own mean
+    t_span_bar *bar = &trk->bars[0];
+    trk->lowest_mean = bar->mean;
+    trk->rating = bar->mean;
+    buildspans_log(x, "%s::%s::%ld::rating %.2f", pal->palette->s_name, trk->track_name, bar->timestamp, trk->rating);
+    buildspans_log(x, "%s::%s::%ld::span [%ld]", pal->palette->s_name, trk->track_name, bar->timestamp, bar->timestamp);
 }
 
 
-void buildspans_finalize_and_log_span(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, t_atomarray *span_array) {
-    if (!span_array) return;
-
-    long span_size = 0;
-    t_atom *span_atoms = NULL;
-    atomarray_getatoms(span_array, &span_size, &span_atoms);
-    if (span_size == 0) return;
-
-    // 1. Calculate the final rating for this span.
-    double lowest_mean = -1.0;
-    for (long i = 0; i < span_size; i++) {
-        long bar_ts = atom_getlong(&span_atoms[i]);
-        char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_ts);
-        t_symbol *bar_sym = gensym(bar_str);
-        t_symbol *mean_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("mean"));
-        t_atom *m_atoms = NULL;
-        long m_count = 0;
-        t_atomarray *m_aa = NULL;
-        t_atom m_atom;
-        if (dictionary_getatomarray(x->building, mean_key, (t_object **)&m_aa) == MAX_ERR_NONE && m_aa) {
-            atomarray_getatoms(m_aa, &m_count, &m_atoms);
-        } else if (dictionary_getatom(x->building, mean_key, &m_atom) == MAX_ERR_NONE) {
-            m_atoms = &m_atom;
-            m_count = 1;
-        }
-        if (m_count > 0) {
-            double bar_mean = atom_getfloat(m_atoms);
-            if (lowest_mean == -1.0 || bar_mean < lowest_mean) {
-                lowest_mean = bar_mean;
-            }
-        }
-    }
-    double final_rating = (lowest_mean != -1.0) ? (lowest_mean * span_size) : 0.0;
-
-    // 2. Back-propagate the final rating and span to all bars in the span.
-    t_atom rating_atom;
-    atom_setfloat(&rating_atom, final_rating);
-    char *span_str = atomarray_to_string(span_array);
-
-    for (long i = 0; i < span_size; i++) {
-        long bar_ts = atom_getlong(&span_atoms[i]);
-        char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_ts);
-        t_symbol *bar_sym = gensym(bar_str);
-
-        t_symbol *rating_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("rating"));
-        if(dictionary_hasentry(x->building, rating_key)) dictionary_deleteentry(x->building, rating_key);
-        dictionary_appendatom(x->building, rating_key, &rating_atom);
-        buildspans_log(x, "%s %.2f", rating_key->s_name, final_rating);
-
-        // Create a deep copy for each bar to ensure no shared ownership
-        t_atomarray *span_copy = atomarray_deep_copy(span_array);
-        t_atom span_copy_atom;
-        atom_setobj(&span_copy_atom, (t_object *)span_copy);
-        t_symbol *span_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("span"));
-        if (dictionary_hasentry(x->building, span_key)) dictionary_deleteentry(x->building, span_key);
-        dictionary_appendatom(x->building, span_key, &span_copy_atom);
+// Rate the span formed by the first span_size bars (lowest mean * bar count) and log it.
+double buildspans_finalize_and_log_span(t_buildspans *x, t_span_palette *pal, t_span_track *trk, long span_size) {
+    if (span_size == 0) return 0.0;
 
-        if (span_str) {
-            buildspans_log(x, "%s %s", span_key->s_name, span_str);
-        }
+    double final_rating = span_track_lowest_mean(trk, span_size) * span_size;
+    if (x->log) {
+        char span_str[512];
+        format_span_list(span_str, sizeof(span_str), trk, span_size);
+        buildspans_log(x, "%s::%s::span %s", pal->palette->s_name, trk->track_name, span_str);
     }
-    if (span_str) sysmem_freeptr(span_str);
+    buildspans_log(x, "%s::%s::rating %.2f", pal->palette->s_name, trk->track_name, final_rating);
+    return final_rating;
 }
 
 
-int buildspans_deferred_rating_check(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, long last_bar_timestamp) {
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    if (!keys) return 0;
-
-    // 1. Get all bars for the track AND PALETTE
-    long bar_count = 0;
-    long *bar_timestamps = (long *)sysmem_newptr(num_keys * sizeof(long));
-    for (long i = 0; i < num_keys; i++) {
-        char *key_pal, *key_track, *key_bar, *key_prop;
-        if (parse_hierarchical_key(keys[i], &key_pal, &key_track, &key_bar, &key_prop)) {
-            if (strcmp(key_pal, palette_sym->s_name) == 0 && strcmp(key_track, track_sym->s_name) == 0 && strcmp(key_prop, "mean") == 0) {
-                bar_timestamps[bar_count++] = atol(key_bar);
-            }
-            sysmem_freeptr(key_pal);
-            sysmem_freeptr(key_track);
-            sysmem_freeptr(key_bar);
-            sysmem_freeptr(key_prop);
-        }
-    }
-    
+// Judge the track's most recent bar against the rest of its span, pruning the span before it if it
+// drags the rating down or would do better alone. Returns 1 if the span was pruned.
+int buildspans_deferred_rating_check(t_buildspans *x, t_span_palette *pal, t_span_track *trk) {
+    long bar_count = trk->bar_count;
     int prune_span = 0;
     if (bar_count > 1) {
-        // 2. RATING WITH LAST BAR
-        double lowest_mean_with = -1.0;
-        for (long i = 0; i < bar_count; i++) {
-            char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_timestamps[i]);
-            t_symbol *bar_sym = gensym(bar_str);
-            t_symbol *mean_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("mean"));
-            t_atom *m_atoms = NULL;
-            long m_count = 0;
-            t_atomarray *m_aa = NULL;
-            t_atom m_atom;
-            if (dictionary_getatomarray(x->building, mean_key, (t_object **)&m_aa) == MAX_ERR_NONE && m_aa) {
-                atomarray_getatoms(m_aa, &m_count, &m_atoms);
-            } else if (dictionary_getatom(x->building, mean_key, &m_atom) == MAX_ERR_NONE) {
-                m_atoms = &m_atom;
-                m_count = 1;
-            }
-            if (m_count > 0) {
-                double bar_mean = atom_getfloat(m_atoms);
-                if (lowest_mean_with == -1.0 || bar_mean < lowest_mean_with) {
-                    lowest_mean_with = bar_mean;
-                }
-            }
-        }
-        double rating_with = lowest_mean_with * bar_count;
-
-        // 3. RATING WITHOUT LAST BAR
-        double lowest_mean_without = -1.0;
-        long bars_without_count = 0;
-        double last_bar_mean = 0.0;
-        for (long i = 0; i < bar_count; i++) {
-            char bar_str[32]; snprintf(bar_str, 32, "%ld", bar_timestamps[i]);
-            t_symbol *bar_sym = gensym(bar_str);
-            t_symbol *mean_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("mean"));
-            t_atom *m_atoms = NULL;
-            long m_count = 0;
-            t_atomarray *m_aa = NULL;
-            t_atom m_atom;
-            if (dictionary_getatomarray(x->building, mean_key, (t_object **)&m_aa) == MAX_ERR_NONE && m_aa) {
-                atomarray_getatoms(m_aa, &m_count, &m_atoms);
-            } else if (dictionary_getatom(x->building, mean_key, &m_atom) == MAX_ERR_NONE) {
-                m_atoms = &m_atom;
-                m_count = 1;
-            }
-            if (m_count > 0) {
-                double bar_mean = atom_getfloat(m_atoms);
-                if (bar_timestamps[i] == last_bar_timestamp) {
-                    last_bar_mean = bar_mean;
-                } else {
-                     if (lowest_mean_without == -1.0 || bar_mean < lowest_mean_without) {
-                        lowest_mean_without = bar_mean;
-                    }
-                    bars_without_count++;
-                }
-            }
-        }
-        double rating_without = (bars_without_count > 0) ? (lowest_mean_without * bars_without_count) : 0.0;
-        
+        long last_bar_timestamp = trk->bars[bar_count - 1].timestamp;
+
+        // 1. RATING WITH LAST BAR
+        double rating_with = span_track_lowest_mean(trk, bar_count) * bar_count;
+
+        // 2. RATING WITHOUT LAST BAR
+        long bars_without_count = bar_count - 1;
+        double rating_without = span_track_lowest_mean(trk, bars_without_count) * bars_without_count;
+        double last_bar_mean = trk->bars[bar_count - 1].mean;
+
         if (rating_with < rating_without) {
             buildspans_log(x, "Deferred rating check: Including bar %ld decreased rating (%.2f -> %.2f). Pruning span.", last_bar_timestamp, rating_without, rating_with);
             prune_span = 1;
@@ -3015,12 +2297,9 @@ int buildspans_deferred_rating_check(t_buildspans *x, t_symbol *palette_sym, t_s
         }
 
         if (prune_span) {
-            buildspans_prune_span(x, palette_sym, track_sym, last_bar_timestamp);
+            buildspans_prune_span(x, pal, trk);
         }
     }
-    
-    sysmem_freeptr(bar_timestamps);
-    sysmem_freeptr(keys);
     return prune_span;
 }
 
@@ -3031,337 +2310,167 @@ int compare_doubles(const void *a, const void *b) {
     return (da > db) - (da < db);
 }
 
-double find_next_offset(t_buildspans *x, t_symbol *palette_sym, long track_num_to_check, double offset_val_to_check) {
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    if (!keys) return -1.0;
-
-    t_dictionary *unique_offsets_dict = dictionary_new();
-    char track_prefix[32];
-    snprintf(track_prefix, 32, "%ld-", track_num_to_check);
-
-    for (long i = 0; i < num_keys; i++) {
-        char *pal_str, *track_str, *bar_str, *prop_str;
-        if (parse_hierarchical_key(keys[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-            if (strcmp(pal_str, palette_sym->s_name) == 0 && strncmp(track_str, track_prefix, strlen(track_prefix)) == 0 && strcmp(prop_str, "offset") == 0) {
-                t_atom *off_atoms = NULL;
-                long off_count = 0;
-                t_atomarray *off_aa = NULL;
-                t_atom off_atom;
-                if (dictionary_getatomarray(x->building, keys[i], (t_object **)&off_aa) == MAX_ERR_NONE && off_aa) {
-                    atomarray_getatoms(off_aa, &off_count, &off_atoms);
-                } else if (dictionary_getatom(x->building, keys[i], &off_atom) == MAX_ERR_NONE) {
-                    off_atoms = &off_atom;
-                    off_count = 1;
-                }
-                if (off_count > 0) {
-                    double current_offset = atom_getfloat(off_atoms);
-                    char offset_key_str[64];
-                    snprintf(offset_key_str, 64, "%.2f", current_offset);
-                    dictionary_appendfloat(unique_offsets_dict, gensym(offset_key_str), current_offset);
-                }
-            }
-            sysmem_freeptr(pal_str);
-            sysmem_freeptr(track_str);
-            sysmem_freeptr(bar_str);
-            sysmem_freeptr(prop_str);
-        }
-    }
-    if (keys) sysmem_freeptr(keys);
-
-    long num_unique_offsets;
-    t_symbol **offset_keys;
-    dictionary_getkeys(unique_offsets_dict, &num_unique_offsets, &offset_keys);
-    if (!offset_keys) {
-        object_free(unique_offsets_dict);
-        return -1.0;
-    }
-
-    double *offsets = (double *)sysmem_newptr(num_unique_offsets * sizeof(double));
-    for(long i = 0; i < num_unique_offsets; i++) {
-        t_atom a;
-        dictionary_getatom(unique_offsets_dict, offset_keys[i], &a);
-        offsets[i] = atom_getfloat(&a);
-    }
-    
-    qsort(offsets, num_unique_offsets, sizeof(double), compare_doubles);
-    
+// The earliest bar offset after offset_val among the palette's spans for this track number, or -1.0.
+double find_next_offset(t_buildspans *x, t_span_palette *pal, long track_num_to_check, double offset_val_to_check) {
     double next_offset_time = -1.0;
-    for (long i = 0; i < num_unique_offsets; i++) {
-        if (offsets[i] > offset_val_to_check) {
-            next_offset_time = offsets[i];
-            break;
+    for (long t = 0; t < pal->track_count; t++) {
+        t_span_track *trk = pal->tracks[t];
+        if (trk->track != track_num_to_check) continue;
+        for (long b = 0; b < trk->bar_count; b++) {
+            double current_offset = trk->bars[b].offset;
+            if (current_offset > offset_val_to_check && (next_offset_time == -1.0 || current_offset < next_offset_time)) {
+                next_offset_time = current_offset;
+            }
         }
     }
-
-    sysmem_freeptr(offsets);
-    sysmem_freeptr(offset_keys);
-    object_free(unique_offsets_dict);
-
     return next_offset_time;
 }
 
-int buildspans_validate_span_before_output(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, t_atomarray *span_to_output) {
-    long track_num;
-    double offset_val = 0.0;
-
-    if (sscanf(track_sym->s_name, "%ld-", &track_num) != 1) {
-        return 0; // Should not happen
-    }
-
-    // Retrieve actual double offset from dictionary (pick first bar)
-    long ac_span; t_atom *av_span;
-    atomarray_getatoms(span_to_output, &ac_span, &av_span);
-    if (ac_span > 0) {
-        long first_bar_ts = atom_getlong(av_span);
-        char bar_str[32]; snprintf(bar_str, 32, "%ld", first_bar_ts);
-        t_symbol *offset_key = generate_hierarchical_key(palette_sym, track_sym, gensym(bar_str), gensym("offset"));
-        t_atom a;
-        if (dictionary_getatom(x->building, offset_key, &a) == MAX_ERR_NONE) {
-            offset_val = atom_getfloat(&a);
-        } else {
-            // Fallback: parse from symbol if dictionary lookup fails
-            const char *offset_part = strchr(track_sym->s_name, '-');
-            if (offset_part) offset_val = (double)atol(offset_part+1);
-        }
+int buildspans_validate_span_before_output(t_buildspans *x, t_span_palette *pal, t_span_track *trk, long span_size) {
+    if (span_size == 0) { // No bars in span
+        buildspans_log(x, "Validation: Span %s has no notes. Aborting.", trk->track_name);
+        return 0;
     }
 
-    double next_offset = find_next_offset(x, palette_sym, track_num, offset_val);
+    // The span's high-precision offset is held by its first bar
+    double offset_val = trk->bars[0].offset;
+    double next_offset = find_next_offset(x, pal, trk->track, offset_val);
 
     double earliest_absolute = -1.0;
     double latest_absolute = -1.0;
-
-    long span_size;
-    t_atom *span_atoms;
-    atomarray_getatoms(span_to_output, &span_size, &span_atoms);
-
     for (long i = 0; i < span_size; i++) {
-        long bar_ts = atom_getlong(&span_atoms[i]);
-        char bar_str[32];
-        snprintf(bar_str, 32, "%ld", bar_ts);
-        t_symbol *bar_sym = gensym(bar_str);
-        t_symbol *absolutes_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, gensym("absolutes"));
-
-        t_atom *av = NULL;
-        long ac = 0;
-        t_atomarray *aa = NULL;
-        t_atom a;
-        if (dictionary_getatomarray(x->building, absolutes_key, (t_object **)&aa) == MAX_ERR_NONE && aa) {
-            atomarray_getatoms(aa, &ac, &av);
-        } else if (dictionary_getatom(x->building, absolutes_key, &a) == MAX_ERR_NONE) {
-            av = &a;
-            ac = 1;
-        }
-
-        if (ac > 0) {
-            for (long k = 0; k < ac; k++) {
-                double current_time = atom_getfloat(av + k);
-                if (earliest_absolute == -1.0 || current_time < earliest_absolute) {
-                    earliest_absolute = current_time;
-                }
-                if (latest_absolute == -1.0 || current_time > latest_absolute) {
-                    latest_absolute = current_time;
-                }
+        t_span_bar *bar = &trk->bars[i];
+        for (long k = 0; k < bar->note_count; k++) {
+            double current_time = bar->absolutes[k];
+            if (earliest_absolute == -1.0 || current_time < earliest_absolute) {
+                earliest_absolute = current_time;
+            }
+            if (latest_absolute == -1.0 || current_time > latest_absolute) {
+                latest_absolute = current_time;
             }
         }
     }
 
     if (earliest_absolute == -1.0) { // No notes in span
-        buildspans_log(x, "Validation: Span %s has no notes. Aborting.", track_sym->s_name);
+        buildspans_log(x, "Validation: Span %s has no notes. Aborting.", trk->track_name);
         return 0;
     }
 
     if (latest_absolute < offset_val) {
-        buildspans_log(x, "Validation failed for %s: latest absolute (%.2f) is strictly before its own offset (%.2f). Aborting.", track_sym->s_name, latest_absolute, offset_val);
+        buildspans_log(x, "Validation failed for %s: latest absolute (%.2f) is strictly before its own offset (%.2f). Aborting.", trk->track_name, latest_absolute, offset_val);
         return 0;
     }
 
     if (next_offset != -1.0 && earliest_absolute > next_offset) {
-        buildspans_log(x, "Validation failed for %s: earliest absolute (%.2f) is after the next offset (%.2f). Aborting.", track_sym->s_name, earliest_absolute, next_offset);
+        buildspans_log(x, "Validation failed for %s: earliest absolute (%.2f) is after the next offset (%.2f). Aborting.", trk->track_name, earliest_absolute, next_offset);
         return 0;
     }
 
-    buildspans_log(x, "Validation successful for %s (earliest: %.2f, latest: %.2f, offset: %.2f, next_offset: %.2f)", track_sym->s_name, earliest_absolute, latest_absolute, offset_val, next_offset);
+    buildspans_log(x, "Validation successful for %s (earliest: %.2f, latest: %.2f, offset: %.2f, next_offset: %.2f)", trk->track_name, earliest_absolute, latest_absolute, offset_val, next_offset);
     return 1;
 }
 
-void buildspans_output_span_data(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_sym, t_atomarray *span_atom_array) {
-    if (buildspans_is_task_cancelled(x, x->current_task_seq)) return;
-    if (!span_atom_array) return;
-
-    long track_num_to_output;
-    if (sscanf(track_sym->s_name, "%ld-", &track_num_to_output) != 1) {
-        return; // Failed to parse track number
+void buildspans_emit_bar_data(t_buildspans *x, long ac, t_atom *av) {
+    if (!x->async || systhread_ismainthread()) {
+        outlet_anything(x->out_bar_data, gensym("bar_data"), (short)ac, av);
+    } else {
+        defer(x, (method)buildspans_defer_output, gensym("bar_data"), (short)ac, av);
     }
+}
 
-    long span_size;
-    t_atom *span_atoms;
-    atomarray_getatoms(span_atom_array, &span_size, &span_atoms);
+// Output "bar_data <track> <bar> <property> values..." for the first span_size bars, in the order
+// crucible expects: absolutes, scores, mean, offset, palette, rating, span. Keys stay structured
+// (integers plus a fixed set of property symbols), so no symbol is minted per bar.
+void buildspans_output_span_data(t_buildspans *x, t_span_palette *pal, t_span_track *trk, long span_size, double rating) {
+    if (buildspans_is_task_cancelled(x, x->current_task_seq)) return;
 
-    const char* properties_to_output[] = {
-        "absolutes", "scores", "mean", "offset", "palette", "rating", "span"
-    };
-    int num_properties = sizeof(properties_to_output) / sizeof(properties_to_output[0]);
+    long value_count = span_size;
+    for (long i = 0; i < span_size; i++) {
+        if (trk->bars[i].note_count > value_count) value_count = trk->bars[i].note_count;
+    }
+    t_atom *av = span_index_atoms(&x->spans, value_count + 3);
+    if (!av) return;
+    t_atom *values = av + 3;
+    atom_setlong(av, trk->track);
 
     for (long i = 0; i < span_size; i++) {
-        long bar_ts = atom_getlong(&span_atoms[i]);
-        char bar_str[32];
-        snprintf(bar_str, 32, "%ld", bar_ts);
-        t_symbol *bar_sym = gensym(bar_str);
-
-        for (int j = 0; j < num_properties; j++) {
-            t_symbol *prop_sym = gensym(properties_to_output[j]);
-            t_symbol *hierarchical_key = generate_hierarchical_key(palette_sym, track_sym, bar_sym, prop_sym);
-
-            t_atom *av = NULL;
-            long ac = 0;
-            t_atomarray *aa = NULL;
-            t_atom a;
+        t_span_bar *bar = &trk->bars[i];
+        atom_setlong(av + 1, bar->timestamp);
 
-            if (dictionary_getatomarray(x->building, hierarchical_key, (t_object **)&aa) == MAX_ERR_NONE && aa) {
-                atomarray_getatoms(aa, &ac, &av);
-            } else if (dictionary_getatom(x->building, hierarchical_key, &a) == MAX_ERR_NONE) {
-                av = &a;
-                ac = 1;
-            }
+        if (bar->note_count > 0) {
+            for (long k = 0; k < bar->note_count; k++) atom_setfloat(values + k, bar->absolutes[k]);
+            atom_setsym(av + 2, gensym("absolutes"));
+            buildspans_emit_bar_data(x, bar->note_count + 3, av);
 
-            if (ac > 0) {
-                char output_key_str[256];
-                snprintf(output_key_str, 256, "%ld::%s::%s", track_num_to_output, bar_sym->s_name, prop_sym->s_name);
-                t_symbol *output_key_sym = gensym(output_key_str);
-                if (x->bound_crucible) {
-                    crucible_do_anything((t_crucible *)x->bound_crucible, output_key_sym, (short)ac, av);
-                } else {
-                    if (!x->async || systhread_ismainthread()) {
-                        outlet_anything(x->out_bar_data, output_key_sym, (short)ac, av);
-                    } else {
-                        t_atom *new_argv = (t_atom *)sysmem_newptr((ac + 1) * sizeof(t_atom));
-                        if (new_argv) {
-                            atom_setsym(new_argv, output_key_sym);
-                            for (int k = 0; k < ac; k++) new_argv[k+1] = av[k];
-                            defer(x, (method)buildspans_defer_output, gensym("bar_data"), (short)(ac + 1), new_argv);
-                            sysmem_freeptr(new_argv);
-                        }
-                    }
-                }
-            }
+            for (long k = 0; k < bar->note_count; k++) atom_setfloat(values + k, bar->scores[k]);
+            atom_setsym(av + 2, gensym("scores"));
+            buildspans_emit_bar_data(x, bar->note_count + 3, av);
+
+            atom_setfloat(values, bar->mean);
+            atom_setsym(av + 2, gensym("mean"));
+            buildspans_emit_bar_data(x, 4, av);
         }
-    }
-}
 
+        atom_setfloat(values, bar->offset);
+        atom_setsym(av + 2, gensym("offset"));
+        buildspans_emit_bar_data(x, 4, av);
 
-void buildspans_cleanup_track_offset_if_needed(t_buildspans *x, t_symbol *palette_sym, t_symbol *track_offset_sym) {
-    // 1. Parse the track and offset from the input symbol.
-    long track_num_to_check;
-    double offset_val_to_check = 0.0;
+        atom_setsym(values, pal->palette);
+        atom_setsym(av + 2, gensym("palette"));
+        buildspans_emit_bar_data(x, 4, av);
 
-    if (sscanf(track_offset_sym->s_name, "%ld-", &track_num_to_check) != 1) {
-        return; // Not a valid track-offset symbol
+        atom_setfloat(values, rating);
+        atom_setsym(av + 2, gensym("rating"));
+        buildspans_emit_bar_data(x, 4, av);
+
+        for (long k = 0; k < span_size; k++) atom_setlong(values + k, trk->bars[k].timestamp);
+        atom_setsym(av + 2, gensym("span"));
+        buildspans_emit_bar_data(x, span_size + 3, av);
     }
+}
 
-    long num_keys;
-    t_symbol **keys;
-    dictionary_getkeys(x->building, &num_keys, &keys);
-    if (!keys) return;
 
-    // Retrieve actual double offset from dictionary for this track AND palette
-    for (long i = 0; i < num_keys; i++) {
-        char *pal_str, *track_str, *bar_str, *prop_str;
-        if (parse_hierarchical_key(keys[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-            if (strcmp(pal_str, palette_sym->s_name) == 0 && strcmp(track_str, track_offset_sym->s_name) == 0 && strcmp(prop_str, "offset") == 0) {
-                t_atom a;
-                dictionary_getatom(x->building, keys[i], &a);
-                offset_val_to_check = atom_getfloat(&a);
-                sysmem_freeptr(pal_str);
-                sysmem_freeptr(track_str);
-                sysmem_freeptr(bar_str);
-                sysmem_freeptr(prop_str);
-                break;
-            }
-            sysmem_freeptr(pal_str);
-            sysmem_freeptr(track_str);
-            sysmem_freeptr(bar_str);
-            sysmem_freeptr(prop_str);
-        }
-    }
+void buildspans_cleanup_track_offset_if_needed(t_buildspans *x, t_span_palette *pal, long track_num_to_check, long rounded_offset) {
+    // 1. Look up the span; it may have been removed, or re-created by a later note in this event.
+    t_span_track *trk = span_index_track(&x->spans, pal, track_num_to_check, rounded_offset, 0);
+    double offset_val_to_check = (trk && trk->bar_count > 0) ? trk->bars[0].offset : 0.0;
 
-    buildspans_log(x, "--- Cleanup Check for %s on palette %s (Precision offset: %.2f) ---", track_offset_sym->s_name, palette_sym->s_name, offset_val_to_check);
+    buildspans_log(x, "--- Cleanup Check for %ld-%ld on palette %s (Precision offset: %.2f) ---", track_num_to_check, rounded_offset, pal->palette->s_name, offset_val_to_check);
 
-    // --- Single Pass ---
-    // In one loop, we will:
     // a) Find the oldest absolute time for the specific track-offset we are checking.
-    // b) Collect all keys that belong to the track-offset to be checked.
     double oldest_absolute_time = -1.0;
-    t_symbol **keys_to_delete = (t_symbol **)sysmem_newptr(num_keys * sizeof(t_symbol *));
-    long delete_count = 0;
-    
-    for (long i = 0; i < num_keys; i++) {
-        char *pal_str, *track_str, *bar_str, *prop_str;
-        if (parse_hierarchical_key(keys[i], &pal_str, &track_str, &bar_str, &prop_str)) {
-            // Check if it's the specific track-offset and palette we are interested in
-            if (strcmp(pal_str, palette_sym->s_name) == 0 && strcmp(track_str, track_offset_sym->s_name) == 0) {
-                // b) Collect this key for potential deletion
-                keys_to_delete[delete_count++] = keys[i];
-
-                // a) Find the oldest absolute time
-                if (strcmp(prop_str, "absolutes") == 0) {
-                    t_atom *av = NULL;
-                    long ac = 0;
-                    t_atomarray *aa = NULL;
-                    t_atom a;
-                    if (dictionary_getatomarray(x->building, keys[i], (t_object **)&aa) == MAX_ERR_NONE && aa) {
-                        atomarray_getatoms(aa, &ac, &av);
-                    } else if (dictionary_getatom(x->building, keys[i], &a) == MAX_ERR_NONE) {
-                        av = &a;
-                        ac = 1;
-                    }
-                    for (long k = 0; k < ac; k++) {
-                        double current_time = atom_getfloat(av + k);
-                        if (oldest_absolute_time == -1.0 || current_time < oldest_absolute_time) {
-                            oldest_absolute_time = current_time;
-                        }
-                    }
+    if (trk) {
+        for (long b = 0; b < trk->bar_count; b++) {
+            for (long k = 0; k < trk->bars[b].note_count; k++) {
+                double current_time = trk->bars[b].absolutes[k];
+                if (oldest_absolute_time == -1.0 || current_time < oldest_absolute_time) {
+                    oldest_absolute_time = current_time;
                 }
             }
-
-            sysmem_freeptr(pal_str);
-            sysmem_freeptr(track_str);
-            sysmem_freeptr(bar_str);
-            sysmem_freeptr(prop_str);
         }
     }
 
-    // --- Process Collected Data ---
-    
-    // 2. Find the next chronological offset from our unique set.
-    double next_offset_time = find_next_offset(x, palette_sym, track_num_to_check, offset_val_to_check);
+    // 2. Find the next chronological offset.
+    double next_offset_time = find_next_offset(x, pal, track_num_to_check, offset_val_to_check);
 
     if (next_offset_time == -1.0) {
-        buildspans_log(x, "Cleanup: No subsequent offset found for track %ld on palette %s. No action taken.", track_num_to_check, palette_sym->s_name);
-        goto cleanup;
+        buildspans_log(x, "Cleanup: No subsequent offset found for track %ld on palette %s. No action taken.", track_num_to_check, pal->palette->s_name);
+        return;
     }
-    buildspans_log(x, "Cleanup: Next offset for track %ld on palette %s is %.2f.", track_num_to_check, palette_sym->s_name, next_offset_time);
+    buildspans_log(x, "Cleanup: Next offset for track %ld on palette %s is %.2f.", track_num_to_check, pal->palette->s_name, next_offset_time);
 
     if (oldest_absolute_time == -1.0) {
-        buildspans_log(x, "Cleanup: No absolute timestamps found for %s on palette %s. No action taken.", track_offset_sym->s_name, palette_sym->s_name);
-        goto cleanup;
+        buildspans_log(x, "Cleanup: No absolute timestamps found for %ld-%ld on palette %s. No action taken.", track_num_to_check, rounded_offset, pal->palette->s_name);
+        return;
     }
-    buildspans_log(x, "Cleanup: Oldest absolute time for %s on palette %s is %.2f.", track_offset_sym->s_name, palette_sym->s_name, oldest_absolute_time);
+    buildspans_log(x, "Cleanup: Oldest absolute time for %s on palette %s is %.2f.", trk->track_name, pal->palette->s_name, oldest_absolute_time);
 
     // 3. Compare and potentially delete.
     if (oldest_absolute_time >= next_offset_time) {
-        buildspans_log(x, "Cleanup: Condition met (%.2f >= %.2f). Deleting %ld keys for %s on palette %s.", oldest_absolute_time, next_offset_time, delete_count, track_offset_sym->s_name, palette_sym->s_name);
-
-        for (long i = 0; i < delete_count; i++) {
-            dictionary_deleteentry(x->building, keys_to_delete[i]);
-        }
+        buildspans_log(x, "Cleanup: Condition met (%.2f >= %.2f). Deleting %ld bars for %s on palette %s.", oldest_absolute_time, next_offset_time, trk->bar_count, trk->track_name, pal->palette->s_name);
+        span_index_remove_track(&x->spans, pal, trk);
         buildspans_visualize_memory(x);
     } else {
         buildspans_log(x, "Cleanup: Condition not met (%.2f < %.2f). No action taken.", oldest_absolute_time, next_offset_time);
     }
-
-cleanup:
-    sysmem_freeptr(keys_to_delete);
-    if(keys) sysmem_freeptr(keys);
 }
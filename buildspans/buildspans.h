@@ -6,14 +6,97 @@
 #include "ext_dictobj.h"
 #include "ext_buffer.h"
 #include "../shared/async_worker.h"
+#include "../crucible/crucible.h"
 
 // Forward declaration
 struct _buildspans;
 
+// One bar of an open span: the notes it has collected and their running mean. The note buffers are
+// kept when a bar is removed so the slot can be reused without allocating.
+typedef struct _span_bar {
+    long timestamp;
+    double offset;
+    double *absolutes;
+    double *scores;
+    long note_count;
+    long note_capacity;
+    double score_sum;
+    double mean;
+} t_span_bar;
+
+// An open span, identified by its track number and rounded offset ("track-offset"). Bars are kept
+// sorted by timestamp, and every bar shares the span's rating (lowest bar mean * bar count).
+typedef struct _span_track {
+    long track;
+    long rounded_offset;
+    char track_name[48]; // "track-offset", kept out of the symbol table
+    t_span_bar *bars;
+    long bar_count;
+    long bar_capacity;
+    double lowest_mean;
+    double rating;
+} t_span_track;
+
+typedef struct _span_palette {
+    t_symbol *palette;
+    t_span_track **tracks;
+    long track_count;
+    long track_capacity;
+} t_span_palette;
+
+// A span that ended during the current event and still needs its cleanup check.
+typedef struct _span_ended {
+    t_span_palette *palette;
+    long track;
+    long rounded_offset;
+} t_span_ended;
+
+// Primary store for open spans: palette -> track-offset -> sorted bars. Palettes are kept for the
+// lifetime of the object and ended tracks go to a spare list, so steady-state ingestion does not
+// allocate.
+typedef struct _span_index {
+    t_span_palette **palettes;
+    long palette_count;
+    long palette_capacity;
+    t_span_track **spare_tracks;
+    long spare_count;
+    long spare_capacity;
+    t_span_ended *ended;
+    long ended_count;
+    long ended_capacity;
+    long *candidates;
+    long candidate_capacity;
+    t_atom *atoms;
+    long atom_capacity;
+    t_crucible_span_bar *handoff; // Scratch bars for crucible_submit_span
+    long handoff_capacity;
+} t_span_index;
+
+// Flight recorder behind the multibar log files. Every buildspans_log call stores its format string
+// and raw arguments in a fixed ring; text is only produced when a log file is written.
+#define BUILDSPANS_TRACE_CAPACITY 2048 // Power of two
+#define BUILDSPANS_TRACE_MAX_ARGS 8
+#define BUILDSPANS_TRACE_STRING_BYTES 192
+
+typedef union _trace_arg {
+    long l;
+    double d;
+    long s; // Offset of a copied string in the record's string area
+} t_trace_arg;
+
+typedef struct _trace_record {
+    volatile long long ticket; // Ticket of the write that filled the slot, -1 while it is being written
+    double time_ms;
+    const char *fmt;           // The call site's format literal doubles as the format id
+    long arg_count;
+    t_trace_arg args[BUILDSPANS_TRACE_MAX_ARGS];
+    char strings[BUILDSPANS_TRACE_STRING_BYTES];
+} t_trace_record;
+
 typedef struct _buildspans {
     t_object s_obj;
-    t_dictionary *building;
-    t_dictionary *tracks_ended_in_current_event;
+    t_span_index spans;
+    t_dictionary *building; // Debug view of spans, materialized by the building message
     long current_track;
     double current_offset;
     double loop_start;
@@ -32,6 +115,7 @@ typedef struct _buildspans {
     double local_bar_length;
     long instance_id;
     long bar_warn_sent;
+    long in_batch;
     t_symbol *last_msg_type;
     double last_note_calc;
     double last_note_store;
@@ -42,9 +126,8 @@ typedef struct _buildspans {
     void *bind_clock;
     long bind_attempt_count;
 
-    char **log_history;
-    long log_history_count;
-    long log_history_write_ptr;
+    t_trace_record *trace;
+    volatile long long trace_next;
 
     t_systhread_mutex sequence_mutex;
     t_systhread_mutex state_mutex;
@@ -56,6 +139,8 @@ typedef struct _buildspans {
 
 // Function prototypes for direct module-to-module coordination
 void buildspans_do_list(t_buildspans *x, t_symbol *s, long argc, t_atom *argv);
+void buildspans_notes(t_buildspans *x, t_symbol *s, long argc, t_atom *argv);
+void buildspans_do_notes(t_buildspans *x, t_symbol *s, long argc, t_atom *argv);
 void buildspans_do_bang(t_buildspans *x, t_symbol *s, long argc, t_atom *argv);
 void buildspans_do_track(t_buildspans *x, long n);
 void buildspans_do_offset(t_buildspans *x, double f, double loop_start);
@@ -0,0 +1,761 @@
+// Seeded replay suite for buildspans. Drives the object natively (max_stub/ and max_mock.c stand in
+// for Max) with pseudo-random streams of offsets, loop starts, track and palette changes, notes,
+// flushes and bangs, and checks:
+//  - the transcript of every message sent and everything that came out of the outlets, with a
+//    snapshot of the open spans every SNAPSHOT_EVERY messages, against golden/<case>.txt;
+//  - the span index invariants after every message;
+//  - that sending the same notes in notes batches gives the same transcript as one list per note;
+//  - the same session with snapshots of the building view against golden/baseline/<case>.txt,
+//    recorded from the dictionary-backed BASELINE revision (see the Makefile);
+//  - scenarios whose outcome is known by construction.
+// Goldens are recorded with --update. Build and run with `make test`. Built with -DREPLAY_BASELINE
+// against the baseline sources, only the building view sessions are replayed, and --update records
+// golden/baseline/.
+#include "max_mock.h"
+#include "buildspans.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define BAR_LENGTH 1000.0
+#define SNAPSHOT_EVERY 50
+#define MAX_BATCH 64
+
+void ext_main(void *r);
+
+// A generated session: how many messages, and how often each kind of message is sent. The rates are
+// cumulative thresholds on one uniform draw per message; anything above the last one is a note.
+typedef struct {
+    const char *name;
+    unsigned long seed;
+    long messages;
+    double offset_rate;
+    double track_rate;
+    double palette_rate;
+    double flush_rate;
+    double bang_rate;
+} ReplayCase;
+
+static const ReplayCase cases[] = {
+    { "sparse_offsets", 1, 500, 0.03, 0.08, 0.10, 0.105, 0.108 },
+    { "dense_offsets",  2, 500, 0.12, 0.17, 0.19, 0.195, 0.198 },  // Several spans open per track
+    { "track_churn",    3, 500, 0.03, 0.20, 0.25, 0.27,  0.275 },  // Frequent flush <track>
+};
+#define NUM_CASES ((int)(sizeof(cases) / sizeof(cases[0])))
+
+static const char *palettes[] = { "drums", "keys", "bass" };
+
+static unsigned long rng_state = 1;
+
+static double rnd(void) {
+    rng_state = rng_state * 6364136223846793005UL + 1442695040888963407UL;
+    return (double)((rng_state >> 33) & 0xffffff) / 16777216.0;
+}
+
+// Messages
+
+// With batching on, notes are held back and sent as one notes message just before the next message
+// of another kind, before each snapshot, or when MAX_BATCH notes are waiting.
+static int batching = 0;
+static t_atom batch[MAX_BATCH * 2];
+static long batch_notes = 0;
+
+static void send_batch(t_buildspans *x) {
+    if (batch_notes == 0) return;
+    max_mock_send(x, 0, "notes", batch_notes * 2, batch);
+    batch_notes = 0;
+}
+
+static void send_float(t_buildspans *x, long inlet, const char *selector, double f) {
+    t_atom a;
+    atom_setfloat(&a, f);
+    max_mock_send(x, inlet, selector, 1, &a);
+}
+
+static void send_long(t_buildspans *x, long inlet, const char *selector, long n) {
+    t_atom a;
+    atom_setlong(&a, n);
+    max_mock_send(x, inlet, selector, 1, &a);
+}
+
+static void send_offset(t_buildspans *x, double offset, double loop_start) {
+    send_batch(x);
+    fprintf(max_mock_out, "> offset %.6f %.6f\n", offset, loop_start);
+    if (loop_start == 0.0) {
+        send_float(x, 1, "float", offset);
+    } else {
+        t_atom a[2];
+        atom_setfloat(a, offset);
+        atom_setfloat(a + 1, loop_start);
+        max_mock_send(x, 1, "list", 2, a);
+    }
+}
+
+static void send_track(t_buildspans *x, long track) {
+    send_batch(x);
+    fprintf(max_mock_out, "> track %ld\n", track);
+    send_long(x, 2, "in2", track);
+}
+
+static void send_palette(t_buildspans *x, const char *palette) {
+    send_batch(x);
+    fprintf(max_mock_out, "> palette %s\n", palette);
+    max_mock_send(x, 3, palette, 0, NULL);
+}
+
+static void send_note(t_buildspans *x, double timestamp, double score) {
+    t_atom a[2];
+    fprintf(max_mock_out, "> note %.6f %.6f\n", timestamp, score);
+    if (batching) {
+        if (batch_notes == MAX_BATCH) send_batch(x);
+        atom_setfloat(batch + batch_notes * 2, timestamp);
+        atom_setfloat(batch + batch_notes * 2 + 1, score);
+        batch_notes++;
+        return;
+    }
+    atom_setfloat(a, timestamp);
+    atom_setfloat(a + 1, score);
+    max_mock_send(x, 0, "list", 2, a);
+}
+
+static void send_flush(t_buildspans *x, long track) {
+    send_batch(x);
+    fprintf(max_mock_out, "> flush %ld\n", track);
+    send_long(x, 0, "flush", track);
+}
+
+static void send_bang(t_buildspans *x) {
+    send_batch(x);
+    fprintf(max_mock_out, "> bang\n");
+    max_mock_send(x, 0, "bang", 0, NULL);
+}
+
+static t_buildspans *new_buildspans(void) {
+    t_buildspans *x = (t_buildspans *)max_mock_new("buildspans", 0, NULL);
+    if (!x) return NULL;
+    max_mock_name_outlet(x->span_outlet, "0:");
+    max_mock_name_outlet(x->track_outlet, "1:");
+    max_mock_name_outlet(x->out_bar_data, "2:");
+    max_mock_name_outlet(x->log_outlet, "3:");
+    send_float(x, 4, "ft4", BAR_LENGTH);
+    return x;
+}
+
+#ifndef REPLAY_BASELINE
+// The span index
+
+static int compare_tracks(const void *a, const void *b) {
+    const t_span_track *ta = *(const t_span_track *const *)a;
+    const t_span_track *tb = *(const t_span_track *const *)b;
+    if (ta->track != tb->track) return (ta->track > tb->track) - (ta->track < tb->track);
+    return (ta->rounded_offset > tb->rounded_offset) - (ta->rounded_offset < tb->rounded_offset);
+}
+
+// Every open span, in a fixed order that does not depend on how the index stores them.
+static void write_snapshot(t_buildspans *x) {
+    fprintf(max_mock_out, "= open spans\n");
+    for (long p = 0; p < x->spans.palette_count; p++) {
+        t_span_palette *pal = x->spans.palettes[p];
+        t_span_track **sorted = (t_span_track **)malloc(sizeof(t_span_track *) * (size_t)(pal->track_count + 1));
+        memcpy(sorted, pal->tracks, sizeof(t_span_track *) * (size_t)pal->track_count);
+        qsort(sorted, (size_t)pal->track_count, sizeof(t_span_track *), compare_tracks);
+        for (long t = 0; t < pal->track_count; t++) {
+            t_span_track *trk = sorted[t];
+            fprintf(max_mock_out, "= %s %s rating %.6f:", pal->palette->s_name, trk->track_name, trk->rating);
+            for (long b = 0; b < trk->bar_count; b++) {
+                fprintf(max_mock_out, " %ld/%ld/%.6f", trk->bars[b].timestamp, trk->bars[b].note_count, trk->bars[b].mean);
+            }
+            fprintf(max_mock_out, "\n");
+        }
+        free(sorted);
+    }
+}
+
+// Returns a description of the first broken invariant, or NULL.
+static const char *check_index(t_buildspans *x) {
+    static char why[256];
+    t_span_index *idx = &x->spans;
+    if (idx->ended_count != 0) return "ended spans left over after the message";
+    for (long p = 0; p < idx->palette_count; p++) {
+        t_span_palette *pal = idx->palettes[p];
+        for (long q = 0; q < p; q++) {
+            if (idx->palettes[q]->palette == pal->palette) return "palette listed twice";
+        }
+        if (pal->track_count > pal->track_capacity) return "palette track count exceeds its capacity";
+        for (long t = 0; t < pal->track_count; t++) {
+            t_span_track *trk = pal->tracks[t];
+            char name[48];
+            snprintf(name, sizeof(name), "%ld-%ld", trk->track, trk->rounded_offset);
+            if (strcmp(name, trk->track_name)) {
+                snprintf(why, sizeof(why), "span %s is named %s", name, trk->track_name);
+                return why;
+            }
+            for (long u = 0; u < t; u++) {
+                if (pal->tracks[u]->track == trk->track && pal->tracks[u]->rounded_offset == trk->rounded_offset) {
+                    snprintf(why, sizeof(why), "span %s listed twice in %s", name, pal->palette->s_name);
+                    return why;
+                }
+            }
+            if (trk->bar_count > trk->bar_capacity) return "bar count exceeds its capacity";
+            for (long b = 0; b < trk->bar_count; b++) {
+                t_span_bar *bar = &trk->bars[b];
+                if (b > 0 && bar->timestamp <= trk->bars[b - 1].timestamp) {
+                    snprintf(why, sizeof(why), "bars of %s out of order at %ld", name, bar->timestamp);
+                    return why;
+                }
+                if (bar->note_count > bar->note_capacity) return "note count exceeds its capacity";
+                if (bar->note_count > 0 && fabs(bar->mean - bar->score_sum / bar->note_count) > 1e-9) {
+                    snprintf(why, sizeof(why), "bar %ld of %s has mean %f for sum %f over %ld notes", bar->timestamp, name, bar->mean, bar->score_sum, bar->note_count);
+                    return why;
+                }
+            }
+        }
+    }
+    return NULL;
+}
+
+static long open_spans(t_buildspans *x, int any_track, long track) {
+    long n = 0;
+    for (long p = 0; p < x->spans.palette_count; p++) {
+        t_span_palette *pal = x->spans.palettes[p];
+        for (long t = 0; t < pal->track_count; t++) {
+            if (any_track || pal->tracks[t]->track == track) n++;
+        }
+    }
+    return n;
+}
+#endif
+
+// The building view
+
+static int compare_lines(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// Every value the building dictionary holds for the open spans, one sorted line each. The baseline
+// keeps that dictionary as its live state; the index only builds it when sent `building`.
+static void write_building(t_buildspans *x) {
+#ifndef REPLAY_BASELINE
+    FILE *out = max_mock_out;
+    max_mock_out = NULL;
+    max_mock_send(x, 0, "building", 0, NULL);
+    max_mock_out = out;
+#endif
+    char *text = NULL;
+    size_t size = 0;
+    FILE *f = open_memstream(&text, &size);
+    max_mock_write_dictionary(f, x->building);
+    fclose(f);
+
+    long count = 0;
+    for (const char *p = text; *p; p++) count += (*p == '\n');
+    char **lines = (char **)malloc(sizeof(char *) * (size_t)(count + 1));
+    long n = 0;
+    for (char *line = strtok(text, "\n"); line; line = strtok(NULL, "\n")) lines[n++] = line;
+    qsort(lines, (size_t)n, sizeof(char *), compare_lines);
+    fprintf(max_mock_out, "= building\n");
+    for (long i = 0; i < n; i++) fprintf(max_mock_out, "= %s\n", lines[i]);
+    free(lines);
+    free(text);
+}
+
+// Replays
+
+// Writes the case's transcript to out, sending its notes in notes batches if batch is set and taking
+// its snapshots from the building view if building is set. Returns 0, or 1 with a message in why if
+// an invariant broke.
+static int run_case(const ReplayCase *rc, int batch, int building, FILE *out, char *why, size_t why_size) {
+    max_mock_out = out;
+    batching = batch;
+    batch_notes = 0;
+    t_buildspans *x = new_buildspans();
+    if (!x) {
+        snprintf(why, why_size, "could not create buildspans");
+        return 1;
+    }
+    rng_state = rc->seed;
+    send_palette(x, palettes[0]);
+    double t = 5000.0;
+    int failed = 0;
+    for (long i = 0; i < rc->messages && !failed; i++) {
+        double r = rnd();
+        long flushed_track = -1;
+        int banged = 0;
+        if (r < rc->offset_rate) {
+            double offset = t - 200.0 * rnd() + 0.37;
+            send_offset(x, offset, rnd() < 0.2 ? 500.0 : 0.0);
+        } else if (r < rc->track_rate) {
+            send_track(x, (long)(rnd() * 4));
+        } else if (r < rc->palette_rate) {
+            send_palette(x, palettes[(long)(rnd() * 3)]);
+        } else if (r < rc->flush_rate) {
+            flushed_track = (long)(rnd() * 4);
+            send_flush(x, flushed_track);
+        } else if (r < rc->bang_rate) {
+            banged = 1;
+            send_bang(x);
+        } else {
+            t += rnd() < 0.05 ? 2500.0 + 3000.0 * rnd() : 150.0 * rnd();
+            send_note(x, t, rnd() * 2.0 - 0.5);
+        }
+
+#ifndef REPLAY_BASELINE
+        const char *broken = check_index(x);
+        if (!broken && banged && open_spans(x, 1, 0)) broken = "spans still open after a bang";
+        if (!broken && flushed_track >= 0 && open_spans(x, 0, flushed_track)) broken = "spans of the flushed track still open";
+        if (broken) {
+            snprintf(why, why_size, "message %ld: %s", i + 1, broken);
+            failed = 1;
+        }
+#else
+        (void)banged;
+        (void)flushed_track;
+#endif
+        if ((i + 1) % SNAPSHOT_EVERY == 0) {
+            send_batch(x);
+            if (building) write_building(x);
+#ifndef REPLAY_BASELINE
+            else write_snapshot(x);
+#endif
+        }
+    }
+    if (!failed) {
+        send_bang(x);
+#ifndef REPLAY_BASELINE
+        if (open_spans(x, 1, 0)) {
+            snprintf(why, why_size, "spans still open after the final bang");
+            failed = 1;
+        }
+#endif
+    }
+    max_mock_free(x);
+    max_mock_out = NULL;
+    return failed;
+}
+
+// Every bar_data message is `bar_data <track> <bar> <property> <value...>`, with the track and the bar
+// timestamp as ints, as crucible expects.
+static int check_bar_data_format(const char *transcript, char *why, size_t why_size) {
+    long n = 0;
+    for (const char *line = transcript; (line = strstr(line, "2: bar_data ")) != NULL; line++) {
+        const char *p = line + 12;
+        char *end;
+        strtol(p, &end, 10);
+        int ok = end != p && *end == ' ';
+        if (ok) {
+            p = end + 1;
+            strtol(p, &end, 10);
+            ok = end != p && *end == ' ' && end[1] >= 'a' && end[1] <= 'z';
+        }
+        if (!ok) {
+            const char *eol = strchr(line, '\n');
+            snprintf(why, why_size, "malformed bar_data: %.*s", (int)(eol ? eol - line : 80), line);
+            return 1;
+        }
+        n++;
+    }
+    if (n == 0) {
+        snprintf(why, why_size, "no bar_data messages");
+        return 1;
+    }
+    return 0;
+}
+
+static char *read_file(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = (char *)malloc((size_t)size + 1);
+    if (text && fread(text, 1, (size_t)size, f) != (size_t)size) {
+        free(text);
+        text = NULL;
+    }
+    if (text) text[size] = '\0';
+    fclose(f);
+    return text;
+}
+
+// Prints the first line where the transcripts differ. Returns 1 if they differ.
+static int compare_transcripts(const char *name, const char *mode, const char *expected, const char *got) {
+    long line_no = 1;
+    const char *e = expected, *g = got;
+    while (*e || *g) {
+        const char *e_end = strchr(e, '\n'), *g_end = strchr(g, '\n');
+        size_t e_len = e_end ? (size_t)(e_end - e) : strlen(e);
+        size_t g_len = g_end ? (size_t)(g_end - g) : strlen(g);
+        if (e_len != g_len || memcmp(e, g, e_len)) {
+            printf("%-16s %-6s FAILED at transcript line %ld\n", name, mode, line_no);
+            printf("    expected: %.*s\n", (int)(e_len > 200 ? 200 : e_len), *e ? e : "<end>");
+            printf("    got:      %.*s\n", (int)(g_len > 200 ? 200 : g_len), *g ? g : "<end>");
+            return 1;
+        }
+        e = e_end ? e_end + 1 : e + e_len;
+        g = g_end ? g_end + 1 : g + g_len;
+        line_no++;
+    }
+    return 0;
+}
+
+#ifndef REPLAY_BASELINE
+// The transcript without the "> note" lines. Batching moves a note's outlet output to after the
+// last note of its batch, but never past the next message of another kind.
+static char *without_note_lines(const char *transcript) {
+    char *kept = (char *)malloc(strlen(transcript) + 1);
+    char *k = kept;
+    for (const char *line = transcript; *line;) {
+        const char *end = strchr(line, '\n');
+        size_t len = end ? (size_t)(end - line) + 1 : strlen(line);
+        if (strncmp(line, "> note ", 7)) {
+            memcpy(k, line, len);
+            k += len;
+        }
+        line += len;
+    }
+    *k = '\0';
+    return kept;
+}
+#endif
+
+#ifdef REPLAY_BASELINE
+// The baseline sent bar_data with the hierarchical key as its selector, `<track>::<bar>::<property>`;
+// rewrite those lines in the current form so the transcripts can be compared.
+static void rewrite_bar_data(char **transcript, size_t *size) {
+    char *text = NULL;
+    size_t text_size = 0;
+    FILE *f = open_memstream(&text, &text_size);
+    for (const char *line = *transcript; *line;) {
+        const char *end = strchr(line, '\n');
+        size_t len = end ? (size_t)(end - line) + 1 : strlen(line);
+        long track, bar;
+        int used = 0;
+        if (!strncmp(line, "2: ", 3) && sscanf(line + 3, "%ld::%ld::%n", &track, &bar, &used) == 2 && used > 0) {
+            fprintf(f, "2: bar_data %ld %ld ", track, bar);
+            fwrite(line + 3 + used, 1, len - 3 - (size_t)used, f);
+        } else {
+            fwrite(line, 1, len, f);
+        }
+        line += len;
+    }
+    fclose(f);
+    free(*transcript);
+    *transcript = text;
+    *size = text_size;
+}
+#endif
+
+// One span's output: its bar_data lines, its track and its span line.
+typedef struct {
+    const char *text;
+    size_t len;
+    char palette[64];
+    long track;
+    long order;
+} SpanRecord;
+
+static int compare_records(const void *a, const void *b) {
+    const SpanRecord *ra = (const SpanRecord *)a, *rb = (const SpanRecord *)b;
+    int c = strcmp(ra->palette, rb->palette);
+    if (c) return c;
+    if (ra->track != rb->track) return (ra->track > rb->track) - (ra->track < rb->track);
+    return (ra->order > rb->order) - (ra->order < rb->order);
+}
+
+// The transcript with the spans each message emitted grouped by palette and track, keeping their
+// order within a group. The baseline walked its dictionary keys and the index walks palettes, so
+// spans of different tracks or palettes come out interleaved differently; they cannot affect each
+// other, since a span is only validated against the open spans of its own palette and track.
+static char *group_spans(const char *transcript) {
+    size_t size = strlen(transcript);
+    char *grouped = (char *)malloc(size + 1);
+    char *g = grouped;
+    SpanRecord *records = NULL;
+    long capacity = 0;
+    const char *line = transcript;
+    while (*line) {
+        // One message: its "> " line, then everything up to the next one
+        const char *end = strchr(line, '\n');
+        size_t len = end ? (size_t)(end - line) + 1 : strlen(line);
+        memcpy(g, line, len);
+        g += len;
+        line += len;
+        long count = 0;
+        const char *start = line;
+        while (*line && strncmp(line, "> ", 2)) {
+            end = strchr(line, '\n');
+            len = end ? (size_t)(end - line) + 1 : strlen(line);
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 16;
+                records = (SpanRecord *)realloc(records, sizeof(SpanRecord) * (size_t)capacity);
+            }
+            SpanRecord *r = &records[count];
+            if (line == start) {
+                r->text = start;
+                r->palette[0] = '\0';
+                r->track = -1;
+                r->order = count;
+            }
+            if (sscanf(line, "2: bar_data %*d %*d palette %63s", r->palette) != 1) sscanf(line, "1: track %ld", &r->track);
+            line += len;
+            if (!strncmp(line - len, "0: span", 7)) {
+                r->len = (size_t)(line - start);
+                start = line;
+                count++;
+            }
+        }
+        qsort(records, (size_t)count, sizeof(SpanRecord), compare_records);
+        for (long i = 0; i < count; i++) {
+            memcpy(g, records[i].text, records[i].len);
+            g += records[i].len;
+        }
+        memcpy(g, start, (size_t)(line - start));
+        g += line - start;
+    }
+    *g = '\0';
+    free(records);
+    return grouped;
+}
+
+// Replays the case with building view snapshots and checks it against golden/baseline/<case>.txt,
+// which the baseline build records. Returns 1 on a failure.
+static int check_baseline(const ReplayCase *rc, const char *dir, int update) {
+    char path[1024], why[512];
+    snprintf(path, sizeof(path), "%s/baseline/%s.txt", dir, rc->name);
+    char *got = NULL;
+    size_t got_size = 0;
+    FILE *out = open_memstream(&got, &got_size);
+    int broken = run_case(rc, 0, 1, out, why, sizeof(why));
+    fclose(out);
+#ifdef REPLAY_BASELINE
+    rewrite_bar_data(&got, &got_size);
+#else
+    update = 0; // Only the baseline build records these
+#endif
+    char *grouped = group_spans(got);
+    free(got);
+    got = grouped;
+    got_size = strlen(got);
+    int failed = 0;
+    if (broken || check_bar_data_format(got, why, sizeof(why))) {
+        printf("%-16s baseline FAILED: %s\n", rc->name, why);
+        failed = 1;
+    } else if (update) {
+        FILE *f = fopen(path, "wb");
+        int ok = f && fwrite(got, 1, got_size, f) == got_size;
+        if (f) fclose(f);
+        printf("%-16s baseline %s\n", rc->name, ok ? "recorded" : "WRITE FAILED");
+        failed = !ok;
+    } else {
+        char *expected = read_file(path);
+        if (!expected) {
+            printf("%-16s baseline missing golden %s (run make update-baseline-golden)\n", rc->name, path);
+            failed = 1;
+        } else if (compare_transcripts(rc->name, "baseline", expected, got)) {
+            failed = 1;
+        } else {
+            printf("%-16s baseline ok\n", rc->name);
+        }
+        free(expected);
+    }
+    free(got);
+    return failed;
+}
+
+#ifndef REPLAY_BASELINE
+// Scenarios
+
+// Two spans on one track, the second with the earlier offset. Flushes end spans in the order they
+// were opened, as the dictionary version did: the later offset is ended first, so by the time the
+// earlier span is validated there is no later offset left to fail it, and both are emitted.
+static int scenario_flush_order(int use_bang, char *why, size_t why_size) {
+    char *text = NULL;
+    size_t size = 0;
+    max_mock_out = open_memstream(&text, &size);
+    t_buildspans *x = new_buildspans();
+    send_palette(x, "p");
+    send_track(x, 1);
+    send_offset(x, 1018187.0, 0.0);
+    send_note(x, 1018200.0, 1.0);
+    send_offset(x, 1018163.0, 0.0);
+    send_note(x, 1018250.0, 1.0);
+    if (use_bang) send_bang(x);
+    else send_flush(x, 1);
+    max_mock_free(x);
+    fclose(max_mock_out);
+    max_mock_out = NULL;
+
+    long spans = 0;
+    for (const char *p = text; (p = strstr(p, "0: span ")) != NULL; p++) spans++;
+    const char *first = strstr(text, "offset 1018187.000000\n");
+    const char *second = strstr(text, "offset 1018163.000000\n");
+    int in_order = first && second && first < second;
+    free(text);
+    if (spans != 2) {
+        snprintf(why, why_size, "%ld spans emitted, expected 2", spans);
+        return 1;
+    }
+    if (!in_order) {
+        snprintf(why, why_size, "spans not ended in the order they were opened");
+        return 1;
+    }
+    return 0;
+}
+
+// A notes message with a missing score or a value that is not a number is rejected whole, leaving
+// the open spans as they were.
+static int scenario_notes_rejected(char *why, size_t why_size) {
+    char *text = NULL;
+    size_t size = 0;
+    max_mock_out = open_memstream(&text, &size);
+    t_buildspans *x = new_buildspans();
+    send_palette(x, "p");
+    send_track(x, 1);
+    send_note(x, 5000.0, 1.0);
+    send_note(x, 5100.0, 0.5);
+    write_snapshot(x);
+    fflush(max_mock_out);
+    size_t before = size;
+
+    t_atom bad[4];
+    atom_setfloat(bad, 5200.0);
+    atom_setfloat(bad + 1, 0.5);
+    atom_setfloat(bad + 2, 5300.0);
+    max_mock_send(x, 0, "notes", 3, bad);
+    atom_setsym(bad + 2, gensym("x"));
+    atom_setfloat(bad + 3, 0.5);
+    max_mock_send(x, 0, "notes", 4, bad);
+    write_snapshot(x);
+    max_mock_free(x);
+    fclose(max_mock_out);
+    max_mock_out = NULL;
+
+    long errors = 0;
+    for (const char *p = text + before; (p = strstr(p, "error: ")) != NULL; p++) errors++;
+    const char *snapshot = strstr(text, "= open spans\n");
+    const char *after = strstr(text + before, "= open spans\n");
+    size_t snapshot_len = (size_t)(text + before - snapshot);
+    int unchanged = snapshot && after && strlen(after) == snapshot_len && !strncmp(snapshot, after, snapshot_len);
+    free(text);
+    if (errors != 2) {
+        snprintf(why, why_size, "%ld errors for 2 malformed batches", errors);
+        return 1;
+    }
+    if (!unchanged) {
+        snprintf(why, why_size, "a malformed batch changed the open spans");
+        return 1;
+    }
+    return 0;
+}
+#endif
+
+static void usage(void) {
+    fprintf(stderr, "usage: bs_replay [--update] [--case NAME] [--dir DIR]\n");
+}
+
+int main(int argc, char **argv) {
+    const char *dir = "golden";
+    const char *only_case = NULL;
+    int update = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--update")) update = 1;
+        else if (!strcmp(argv[i], "--dir") && i + 1 < argc) dir = argv[++i];
+        else if (!strcmp(argv[i], "--case") && i + 1 < argc) only_case = argv[++i];
+        else { usage(); return 2; }
+    }
+
+    ext_main(NULL);
+    int failures = 0, runs = 0;
+    for (int c = 0; c < NUM_CASES; c++) {
+        const ReplayCase *rc = &cases[c];
+        if (only_case && strcmp(only_case, rc->name)) continue;
+#ifndef REPLAY_BASELINE
+        char path[1024], why[512];
+        snprintf(path, sizeof(path), "%s/%s.txt", dir, rc->name);
+
+        char *got = NULL;
+        size_t got_size = 0;
+        FILE *out = open_memstream(&got, &got_size);
+        int broken = run_case(rc, 0, 0, out, why, sizeof(why));
+        fclose(out);
+        runs++;
+        if (broken || check_bar_data_format(got, why, sizeof(why))) {
+            printf("%-16s list   FAILED: %s\n", rc->name, why);
+            failures++;
+        } else if (update) {
+            FILE *f = fopen(path, "wb");
+            int ok = f && fwrite(got, 1, got_size, f) == got_size;
+            if (f) fclose(f);
+            printf("%-16s list   %s\n", rc->name, ok ? "recorded" : "WRITE FAILED");
+            if (!ok) failures++;
+        } else {
+            char *expected = read_file(path);
+            if (!expected) {
+                printf("%-16s list   missing golden %s (run with --update)\n", rc->name, path);
+                failures++;
+            } else if (compare_transcripts(rc->name, "list", expected, got)) {
+                failures++;
+            } else {
+                printf("%-16s list   ok\n", rc->name);
+            }
+            free(expected);
+        }
+
+        // The same session with its notes sent in batches must match the one-list-per-note transcript.
+        char *batched = NULL;
+        size_t batched_size = 0;
+        out = open_memstream(&batched, &batched_size);
+        broken = run_case(rc, 1, 0, out, why, sizeof(why));
+        fclose(out);
+        runs++;
+        if (broken) {
+            printf("%-16s notes  FAILED: %s\n", rc->name, why);
+            failures++;
+        } else {
+            char *expected = without_note_lines(got);
+            char *got_batched = without_note_lines(batched);
+            if (compare_transcripts(rc->name, "notes", expected, got_batched)) failures++;
+            else printf("%-16s notes  ok\n", rc->name);
+            free(expected);
+            free(got_batched);
+        }
+        free(batched);
+        free(got);
+#endif
+
+        // The same session with the building view as its snapshots must match what the baseline
+        // revision, which kept that dictionary as its live state, sent and held.
+        runs++;
+        failures += check_baseline(rc, dir, update);
+    }
+
+#ifndef REPLAY_BASELINE
+    if (!only_case) {
+        char why[512];
+        static const struct { const char *name; int use_bang; } flush_scenarios[] = {
+            { "flush_order_bang", 1 },
+            { "flush_order_track", 0 },
+        };
+        for (int s = 0; s < 2; s++) {
+            runs++;
+            if (scenario_flush_order(flush_scenarios[s].use_bang, why, sizeof(why))) {
+                printf("%-16s FAILED: %s\n", flush_scenarios[s].name, why);
+                failures++;
+            } else {
+                printf("%-16s ok\n", flush_scenarios[s].name);
+            }
+        }
+        runs++;
+        if (scenario_notes_rejected(why, sizeof(why))) {
+            printf("%-16s FAILED: %s\n", "notes_rejected", why);
+            failures++;
+        } else {
+            printf("%-16s ok\n", "notes_rejected");
+        }
+    }
+#endif
+
+    printf("%d of %d runs passed\n", runs - failures, runs);
+    return failures ? 1 : 0;
+}
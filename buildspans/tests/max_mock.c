@@ -0,0 +1,562 @@
+// Single-threaded Max runtime for the buildspans replay suite. Only the parts buildspans exercises
+// without a patcher behave like Max: symbols, atoms, memory, message dispatch, outlets, dictionaries
+// and atom arrays. Buffers, the async worker, the visualizer and crucible are absent, so an object
+// under test must get its bar length from its local bar length inlet and cannot be bound or run
+// @async.
+#include "max_mock.h"
+#include "ext_systhread.h"
+#include "../../shared/async_worker.h"
+#include "../../crucible/crucible.h"
+#include <stdarg.h>
+
+FILE *max_mock_out = NULL;
+t_symbol *_sym_nothing = NULL;
+
+// Symbols
+
+#define SYMBOL_BUCKETS 1024
+
+typedef struct _mock_symbol {
+    t_symbol sym;
+    struct _mock_symbol *next;
+} t_mock_symbol;
+
+static t_mock_symbol *symbol_table[SYMBOL_BUCKETS];
+
+t_symbol *gensym(const char *s) {
+    unsigned long h = 5381;
+    for (const char *p = s; *p; p++) h = h * 33 + (unsigned char)*p;
+    t_mock_symbol **bucket = &symbol_table[h % SYMBOL_BUCKETS];
+    for (t_mock_symbol *m = *bucket; m; m = m->next) {
+        if (!strcmp(m->sym.s_name, s)) return &m->sym;
+    }
+    t_mock_symbol *m = (t_mock_symbol *)malloc(sizeof(t_mock_symbol));
+    m->sym.s_name = strdup(s);
+    m->next = *bucket;
+    *bucket = m;
+    return &m->sym;
+}
+
+void common_symbols_init(void) {
+    _sym_nothing = gensym("");
+}
+
+// Atoms
+
+void atom_setlong(t_atom *a, long v) { a->a_type = A_LONG; a->a_w.w_long = v; }
+void atom_setfloat(t_atom *a, double v) { a->a_type = A_FLOAT; a->a_w.w_float = v; }
+void atom_setsym(t_atom *a, t_symbol *s) { a->a_type = A_SYM; a->a_w.w_sym = s; }
+void atom_setobj(t_atom *a, void *o) { a->a_type = A_OBJ; a->a_w.w_obj = o; }
+long atom_gettype(const t_atom *a) { return a->a_type; }
+void *atom_getobj(const t_atom *a) { return a->a_type == A_OBJ ? a->a_w.w_obj : NULL; }
+t_symbol *atom_getsym(const t_atom *a) { return a->a_type == A_SYM ? a->a_w.w_sym : _sym_nothing; }
+
+long atom_getlong(const t_atom *a) {
+    if (a->a_type == A_LONG) return a->a_w.w_long;
+    if (a->a_type == A_FLOAT) return (long)a->a_w.w_float;
+    return 0;
+}
+
+double atom_getfloat(const t_atom *a) {
+    if (a->a_type == A_FLOAT) return a->a_w.w_float;
+    if (a->a_type == A_LONG) return (double)a->a_w.w_long;
+    return 0.0;
+}
+
+static void print_atoms(FILE *f, long argc, t_atom *argv) {
+    for (long i = 0; i < argc; i++) {
+        if (argv[i].a_type == A_LONG) fprintf(f, " %ld", argv[i].a_w.w_long);
+        else if (argv[i].a_type == A_FLOAT) fprintf(f, " %.6f", argv[i].a_w.w_float);
+        else if (argv[i].a_type == A_SYM) fprintf(f, " %s", argv[i].a_w.w_sym->s_name);
+        else fprintf(f, " <obj>");
+    }
+}
+
+// Console
+
+void post(const char *fmt, ...) { (void)fmt; }
+void object_post(t_object *x, const char *fmt, ...) { (void)x; (void)fmt; }
+void object_warn(t_object *x, const char *fmt, ...) { (void)x; (void)fmt; }
+
+void object_error(t_object *x, const char *fmt, ...) {
+    (void)x;
+    if (!max_mock_out) return;
+    va_list args;
+    va_start(args, fmt);
+    fprintf(max_mock_out, "error: ");
+    vfprintf(max_mock_out, fmt, args);
+    fprintf(max_mock_out, "\n");
+    va_end(args);
+}
+
+void common_log(void *log_outlet, long log_enabled, const char *object_name, const char *fmt, ...) {
+    (void)log_outlet; (void)log_enabled; (void)object_name; (void)fmt;
+}
+
+void vcommon_log(void *log_outlet, long log_enabled, const char *object_name, const char *fmt, va_list args) {
+    (void)log_outlet; (void)log_enabled; (void)object_name; (void)fmt; (void)args;
+}
+
+// Classes and message dispatch
+
+#define MAX_METHODS 64
+
+typedef struct _mock_method {
+    const char *name;
+    method fn;
+    long type; // First argument type, or A_NOTHING
+} t_mock_method;
+
+struct _class {
+    const char *name;
+    method mnew;
+    method mfree;
+    long size;
+    t_mock_method methods[MAX_METHODS];
+    long method_count;
+};
+
+static t_class *registered_class = NULL;
+
+t_class *class_new(const char *name, method mnew, method mfree, long size, method mmenu, short type, ...) {
+    (void)mmenu; (void)type;
+    t_class *c = (t_class *)calloc(1, sizeof(t_class));
+    c->name = name;
+    c->mnew = mnew;
+    c->mfree = mfree;
+    c->size = size;
+    return c;
+}
+
+void class_addmethod(t_class *c, method m, const char *name, ...) {
+    if (c->method_count >= MAX_METHODS) return;
+    va_list args;
+    va_start(args, name);
+    long type = va_arg(args, int);
+    va_end(args);
+    c->methods[c->method_count].name = name;
+    c->methods[c->method_count].fn = m;
+    c->methods[c->method_count].type = type;
+    c->method_count++;
+}
+
+void class_register(t_symbol *name_space, t_class *c) {
+    (void)name_space;
+    registered_class = c;
+}
+
+t_class *class_findbyname(t_symbol *name_space, t_symbol *classname) { (void)name_space; (void)classname; return NULL; }
+
+void *object_alloc(t_class *c) {
+    return calloc(1, (size_t)c->size);
+}
+
+void *object_method(void *x, t_symbol *s, ...) { (void)x; (void)s; return NULL; }
+void object_obex_lookup(void *x, t_symbol *key, t_object **val) { (void)x; (void)key; *val = NULL; }
+t_symbol *object_classname(void *x) { (void)x; return _sym_nothing; }
+long object_classname_compare(void *x, t_symbol *name) { (void)x; (void)name; return 0; }
+t_symbol *object_attr_getsym(void *x, t_symbol *attrname) { (void)x; (void)attrname; return _sym_nothing; }
+void *object_attach_byptr(void *x, void *registered) { (void)x; (void)registered; return NULL; }
+t_max_err object_detach_byptr(void *x, void *registered) { (void)x; (void)registered; return MAX_ERR_NONE; }
+long attr_args_process(void *x, short ac, t_atom *av) { (void)x; (void)ac; (void)av; return 0; }
+t_object *jpatcher_get_firstobject(t_object *patcher) { (void)patcher; return NULL; }
+t_object *jbox_get_nextobject(t_object *box) { (void)box; return NULL; }
+t_object *jbox_get_object(t_object *box) { (void)box; return NULL; }
+
+void *max_mock_new(const char *classname, long argc, t_atom *argv) {
+    if (!registered_class || strcmp(registered_class->name, classname)) return NULL;
+    return ((void *(*)(t_symbol *, long, t_atom *))registered_class->mnew)(gensym(classname), argc, argv);
+}
+
+void max_mock_free(void *x) {
+    if (registered_class->mfree) ((void (*)(void *))registered_class->mfree)(x);
+    free(x);
+}
+
+static long current_inlet = 0;
+
+long proxy_getinlet(t_object *x) { (void)x; return current_inlet; }
+void *proxy_new(void *x, long id, long *stuffloc) { (void)x; (void)id; (void)stuffloc; return NULL; }
+void *intin(void *x, short n) { (void)x; (void)n; return NULL; }
+void *floatin(void *x, short n) { (void)x; (void)n; return NULL; }
+
+static t_mock_method *find_method(const char *name) {
+    for (long i = 0; i < registered_class->method_count; i++) {
+        if (!strcmp(registered_class->methods[i].name, name)) return &registered_class->methods[i];
+    }
+    return NULL;
+}
+
+int max_mock_send(void *x, long inlet, const char *selector, long argc, t_atom *argv) {
+    t_mock_method *m = find_method(selector);
+    if (!m || m->type == A_CANT) {
+        m = find_method("anything");
+        if (!m) return 0;
+    }
+    current_inlet = inlet;
+    t_symbol *s = gensym(selector);
+    switch (m->type) {
+        case A_GIMME: ((void (*)(void *, t_symbol *, long, t_atom *))m->fn)(x, s, argc, argv); break;
+        case A_FLOAT: ((void (*)(void *, double))m->fn)(x, argc > 0 ? atom_getfloat(argv) : 0.0); break;
+        case A_LONG: ((void (*)(void *, long))m->fn)(x, argc > 0 ? atom_getlong(argv) : 0); break;
+        case A_SYM: ((void (*)(void *, t_symbol *))m->fn)(x, argc > 0 ? atom_getsym(argv) : _sym_nothing); break;
+        default: ((void (*)(void *))m->fn)(x); break;
+    }
+    current_inlet = 0;
+    return 1;
+}
+
+// Outlets
+
+#define MAX_OUTLETS 16
+
+typedef struct _mock_outlet {
+    char name[32];
+} t_mock_outlet;
+
+static t_mock_outlet outlets[MAX_OUTLETS];
+static long outlet_count = 0;
+
+void *outlet_new(void *x, const char *type) {
+    (void)x; (void)type;
+    t_mock_outlet *o = &outlets[outlet_count++ % MAX_OUTLETS];
+    snprintf(o->name, sizeof(o->name), "outlet");
+    return o;
+}
+
+void max_mock_name_outlet(void *outlet, const char *name) {
+    snprintf(((t_mock_outlet *)outlet)->name, sizeof(((t_mock_outlet *)outlet)->name), "%s", name);
+}
+
+void *outlet_int(void *o, long n) {
+    if (max_mock_out) fprintf(max_mock_out, "%s int %ld\n", ((t_mock_outlet *)o)->name, n);
+    return NULL;
+}
+
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av) {
+    if (!max_mock_out) return NULL;
+    fprintf(max_mock_out, "%s %s", ((t_mock_outlet *)o)->name, s->s_name);
+    print_atoms(max_mock_out, ac, av);
+    fprintf(max_mock_out, "\n");
+    return NULL;
+}
+
+// Scheduling: everything runs on the calling thread, which is also the main thread.
+
+void *defer(void *x, method fn, t_symbol *s, short argc, t_atom *argv) {
+    ((void (*)(void *, t_symbol *, long, t_atom *))fn)(x, s, argc, argv);
+    return NULL;
+}
+
+void *defer_low(void *x, method fn, t_symbol *s, short argc, t_atom *argv) {
+    return defer(x, fn, s, argc, argv);
+}
+
+struct _clock { t_object ob; };
+static t_clock dummy_clock;
+
+t_clock *clock_new(void *x, method fn) { (void)x; (void)fn; return &dummy_clock; }
+void clock_delay(t_clock *c, long ms) { (void)c; (void)ms; }
+void clock_unset(t_clock *c) { (void)c; }
+unsigned int systime_ms(void) { return 0; }
+
+// Memory
+
+void *sysmem_newptr(long size) { return malloc(size > 0 ? (size_t)size : 1); }
+void *sysmem_newptrclear(long size) { return calloc(1, size > 0 ? (size_t)size : 1); }
+void *sysmem_resizeptr(void *p, long newsize) { return realloc(p, newsize > 0 ? (size_t)newsize : 1); }
+void sysmem_freeptr(void *p) { free(p); }
+
+// Threads: there is only one, so locks are no-ops and the linked list is a plain array.
+
+void critical_enter(t_critical c) { (void)c; }
+void critical_exit(t_critical c) { (void)c; }
+long systhread_mutex_new(t_systhread_mutex *m, long flags) { (void)flags; *m = NULL; return 0; }
+long systhread_mutex_free(t_systhread_mutex m) { (void)m; return 0; }
+long systhread_mutex_lock(t_systhread_mutex m) { (void)m; return 0; }
+long systhread_mutex_unlock(t_systhread_mutex m) { (void)m; return 0; }
+int systhread_ismainthread(void) { return 1; }
+
+struct _linklist {
+    void **items;
+    long count;
+    long capacity;
+};
+
+t_linklist *linklist_new(void) { return (t_linklist *)calloc(1, sizeof(t_linklist)); }
+
+long linklist_append(t_linklist *l, void *o) {
+    if (l->count == l->capacity) {
+        l->capacity = l->capacity ? l->capacity * 2 : 16;
+        l->items = (void **)realloc(l->items, sizeof(void *) * (size_t)l->capacity);
+    }
+    l->items[l->count++] = o;
+    return l->count - 1;
+}
+
+long linklist_getsize(t_linklist *l) { return l->count; }
+void *linklist_getindex(t_linklist *l, long index) { return (index >= 0 && index < l->count) ? l->items[index] : NULL; }
+
+long linklist_chuckindex(t_linklist *l, long index) {
+    if (index < 0 || index >= l->count) return MAX_ERR_GENERIC;
+    memmove(l->items + index, l->items + index + 1, sizeof(void *) * (size_t)(l->count - index - 1));
+    l->count--;
+    return MAX_ERR_NONE;
+}
+
+void linklist_chuck(t_linklist *l) {
+    free(l->items);
+    free(l);
+}
+
+// Dictionaries and atom arrays: keys keep their insertion order, as Max's do, and replacing a value
+// keeps its key's place. A dictionary owns the arrays and dictionaries stored in it and frees them
+// when they are replaced, deleted or cleared.
+
+#define MOCK_DICTIONARY_MAGIC 0x64696374
+#define MOCK_ATOMARRAY_MAGIC 0x61726179
+
+struct _atomarray {
+    t_object ob;
+    t_atom *atoms;
+    long count;
+    long capacity;
+};
+
+typedef struct _mock_entry {
+    t_symbol *key;
+    t_atom value;
+} t_mock_entry;
+
+struct _dictionary {
+    t_object ob;
+    t_mock_entry *entries;
+    long count;
+    long capacity;
+    t_symbol *name;
+};
+
+t_atomarray *atomarray_new(long ac, t_atom *av) {
+    t_atomarray *a = (t_atomarray *)calloc(1, sizeof(t_atomarray));
+    a->ob.o_magic = MOCK_ATOMARRAY_MAGIC;
+    a->capacity = ac > 0 ? ac : 1;
+    a->atoms = (t_atom *)malloc(sizeof(t_atom) * (size_t)a->capacity);
+    if (ac > 0) memcpy(a->atoms, av, sizeof(t_atom) * (size_t)ac);
+    a->count = ac > 0 ? ac : 0;
+    return a;
+}
+
+t_max_err atomarray_getatoms(t_atomarray *a, long *ac, t_atom **av) {
+    *ac = a->count;
+    *av = a->atoms;
+    return MAX_ERR_NONE;
+}
+
+long atomarray_getsize(t_atomarray *a) { return a->count; }
+
+t_max_err atomarray_getindex(t_atomarray *a, long index, t_atom *av) {
+    if (index < 0 || index >= a->count) return MAX_ERR_GENERIC;
+    *av = a->atoms[index];
+    return MAX_ERR_NONE;
+}
+
+void atomarray_appendatom(t_atomarray *a, t_atom *av) {
+    if (a->count == a->capacity) {
+        a->capacity *= 2;
+        a->atoms = (t_atom *)realloc(a->atoms, sizeof(t_atom) * (size_t)a->capacity);
+    }
+    a->atoms[a->count++] = *av;
+}
+
+static void free_value(t_atom *value) {
+    if (value->a_type == A_OBJ) object_free(value->a_w.w_obj);
+}
+
+static long find_entry(t_dictionary *d, t_symbol *key) {
+    for (long i = 0; i < d->count; i++) {
+        if (d->entries[i].key == key) return i;
+    }
+    return -1;
+}
+
+static t_max_err put_entry(t_dictionary *d, t_symbol *key, const t_atom *value) {
+    long i = find_entry(d, key);
+    if (i >= 0) {
+        free_value(&d->entries[i].value);
+        d->entries[i].value = *value;
+        return MAX_ERR_NONE;
+    }
+    if (d->count == d->capacity) {
+        d->capacity = d->capacity ? d->capacity * 2 : 16;
+        d->entries = (t_mock_entry *)realloc(d->entries, sizeof(t_mock_entry) * (size_t)d->capacity);
+    }
+    d->entries[d->count].key = key;
+    d->entries[d->count].value = *value;
+    d->count++;
+    return MAX_ERR_NONE;
+}
+
+t_dictionary *dictionary_new(void) {
+    t_dictionary *d = (t_dictionary *)calloc(1, sizeof(t_dictionary));
+    d->ob.o_magic = MOCK_DICTIONARY_MAGIC;
+    return d;
+}
+
+t_max_err dictionary_clear(t_dictionary *d) {
+    for (long i = 0; i < d->count; i++) free_value(&d->entries[i].value);
+    d->count = 0;
+    return MAX_ERR_NONE;
+}
+
+t_max_err dictionary_appendlong(t_dictionary *d, t_symbol *key, t_atom_long value) {
+    t_atom a;
+    atom_setlong(&a, value);
+    return put_entry(d, key, &a);
+}
+
+t_max_err dictionary_appendfloat(t_dictionary *d, t_symbol *key, double value) {
+    t_atom a;
+    atom_setfloat(&a, value);
+    return put_entry(d, key, &a);
+}
+
+t_max_err dictionary_appendsym(t_dictionary *d, t_symbol *key, t_symbol *value) {
+    t_atom a;
+    atom_setsym(&a, value);
+    return put_entry(d, key, &a);
+}
+
+t_max_err dictionary_appendatom(t_dictionary *d, t_symbol *key, t_atom *value) {
+    return put_entry(d, key, value);
+}
+
+t_max_err dictionary_appendatoms(t_dictionary *d, t_symbol *key, long argc, t_atom *argv) {
+    t_atom a;
+    atom_setobj(&a, atomarray_new(argc, argv));
+    return put_entry(d, key, &a);
+}
+
+t_max_err dictionary_appenddictionary(t_dictionary *d, t_symbol *key, t_object *value) {
+    t_atom a;
+    atom_setobj(&a, value);
+    return put_entry(d, key, &a);
+}
+
+t_max_err dictionary_getatom(t_dictionary *d, t_symbol *key, t_atom *value) {
+    long i = find_entry(d, key);
+    if (i < 0) return MAX_ERR_GENERIC;
+    *value = d->entries[i].value;
+    return MAX_ERR_NONE;
+}
+
+t_max_err dictionary_getatomarray(t_dictionary *d, t_symbol *key, t_object **value) {
+    long i = find_entry(d, key);
+    if (i < 0 || d->entries[i].value.a_type != A_OBJ) return MAX_ERR_GENERIC;
+    t_object *o = (t_object *)d->entries[i].value.a_w.w_obj;
+    if (o->o_magic != MOCK_ATOMARRAY_MAGIC) return MAX_ERR_GENERIC;
+    *value = o;
+    return MAX_ERR_NONE;
+}
+
+t_max_err dictionary_getkeys(t_dictionary *d, long *numkeys, t_symbol ***keys) {
+    *numkeys = d->count;
+    *keys = NULL;
+    if (d->count == 0) return MAX_ERR_NONE;
+    *keys = (t_symbol **)malloc(sizeof(t_symbol *) * (size_t)d->count);
+    for (long i = 0; i < d->count; i++) (*keys)[i] = d->entries[i].key;
+    return MAX_ERR_NONE;
+}
+
+long dictionary_hasentry(t_dictionary *d, t_symbol *key) { return find_entry(d, key) >= 0; }
+
+t_max_err dictionary_deleteentry(t_dictionary *d, t_symbol *key) {
+    long i = find_entry(d, key);
+    if (i < 0) return MAX_ERR_GENERIC;
+    free_value(&d->entries[i].value);
+    memmove(d->entries + i, d->entries + i + 1, sizeof(t_mock_entry) * (size_t)(d->count - i - 1));
+    d->count--;
+    return MAX_ERR_NONE;
+}
+
+t_dictionary *dictobj_register(t_dictionary *d, t_symbol **name) {
+    static long registered = 0;
+    if (!d) return NULL;
+    char buf[32];
+    snprintf(buf, sizeof(buf), "u%ld", ++registered);
+    d->name = gensym(buf);
+    if (name) *name = d->name;
+    return d;
+}
+
+t_max_err dictobj_unregister(t_dictionary *d) {
+    if (d) d->name = NULL;
+    return MAX_ERR_NONE;
+}
+
+t_symbol *dictobj_namefromptr(t_dictionary *d) { return (d && d->name) ? d->name : NULL; }
+
+// Only the mock's dictionaries and atom arrays are freed here; the object under test frees itself
+// through max_mock_free, and clocks and buffer references are static.
+void object_free(void *x) {
+    t_object *o = (t_object *)x;
+    if (!o) return;
+    if (o->o_magic == MOCK_DICTIONARY_MAGIC) {
+        t_dictionary *d = (t_dictionary *)o;
+        dictionary_clear(d);
+        free(d->entries);
+        free(d);
+    } else if (o->o_magic == MOCK_ATOMARRAY_MAGIC) {
+        free(((t_atomarray *)o)->atoms);
+        free(o);
+    }
+}
+
+static void write_entries(FILE *f, t_dictionary *d, const char *path) {
+    for (long i = 0; i < d->count; i++) {
+        char key[512];
+        snprintf(key, sizeof(key), "%s%s%s", path, *path ? "::" : "", d->entries[i].key->s_name);
+        t_atom *value = &d->entries[i].value;
+        t_object *o = value->a_type == A_OBJ ? (t_object *)value->a_w.w_obj : NULL;
+        if (o && o->o_magic == MOCK_DICTIONARY_MAGIC) {
+            write_entries(f, (t_dictionary *)o, key);
+            continue;
+        }
+        fprintf(f, "%s", key);
+        if (o && o->o_magic == MOCK_ATOMARRAY_MAGIC) print_atoms(f, ((t_atomarray *)o)->count, ((t_atomarray *)o)->atoms);
+        else print_atoms(f, 1, value);
+        fprintf(f, "\n");
+    }
+}
+
+void max_mock_write_dictionary(FILE *f, t_dictionary *d) {
+    if (d) write_entries(f, d, "");
+}
+
+// Buffers: there are none, so lookups by name always fail.
+
+struct _buffer_ref { t_object ob; };
+static t_buffer_ref dummy_buffer_ref;
+
+t_buffer_ref *buffer_ref_new(t_object *self, t_symbol *name) { (void)self; (void)name; return &dummy_buffer_ref; }
+void buffer_ref_set(t_buffer_ref *x, t_symbol *name) { (void)x; (void)name; }
+t_buffer_obj *buffer_ref_getobject(t_buffer_ref *x) { (void)x; return NULL; }
+float *buffer_locksamples(t_buffer_obj *b) { (void)b; return NULL; }
+void buffer_unlocksamples(t_buffer_obj *b) { (void)b; }
+long buffer_getframecount(t_buffer_obj *b) { (void)b; return 0; }
+
+// Shared modules the object links against
+
+t_async_worker *async_worker_create(void) { return NULL; }
+void async_worker_retain(t_async_worker *worker) { (void)worker; }
+void async_worker_release(t_async_worker *worker) { (void)worker; }
+void async_worker_enqueue(t_async_worker *worker, void *x, method m, t_symbol *s, long argc, t_atom *argv) { (void)worker; (void)x; (void)m; (void)s; (void)argc; (void)argv; }
+int async_worker_is_worker_thread(t_async_worker *worker) { (void)worker; return 0; }
+void async_worker_clear_queue(t_async_worker *worker) { (void)worker; }
+
+int visualize_init() { return 0; }
+void visualize_cleanup() {}
+void visualize(void *x, const char *message) { (void)x; (void)message; }
+
+void crucible_do_anything(t_crucible *x, t_symbol *s, long argc, t_atom *argv) { (void)x; (void)s; (void)argc; (void)argv; }
+void crucible_do_local_bar_length(t_crucible *x, t_symbol *s, long argc, t_atom *argv) { (void)x; (void)s; (void)argc; (void)argv; }
+void crucible_submit_span(t_crucible *x, const t_crucible_span_record *record) { (void)x; (void)record; }
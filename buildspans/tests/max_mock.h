@@ -0,0 +1,27 @@
+// A single-threaded stand-in for the Max runtime, for driving externals natively in tests. Messages
+// are dispatched to the methods the class registered, and everything sent out an outlet is written
+// as one line of text to max_mock_out.
+#ifndef MAX_MOCK_H
+#define MAX_MOCK_H
+
+#include "ext.h"
+
+// Where outlet and error lines go; NULL discards them.
+extern FILE *max_mock_out;
+
+// Instantiate and free the class registered by the external's ext_main.
+void *max_mock_new(const char *classname, long argc, t_atom *argv);
+void max_mock_free(void *x);
+
+// Send a message as if it arrived in the given inlet. Selectors not registered by the class go to its
+// "anything" method. Returns 0 if the object has no method to take it.
+int max_mock_send(void *x, long inlet, const char *selector, long argc, t_atom *argv);
+
+// Outlets are named by the test, since the external only keeps their pointers.
+void max_mock_name_outlet(void *outlet, const char *name);
+
+// Write every value in d as one `path values...` line, in key order. Nested dictionaries are
+// flattened, with their keys joined by "::" the way a flat hierarchical key would be.
+void max_mock_write_dictionary(FILE *f, t_dictionary *d);
+
+#endif
@@ -0,0 +1,167 @@
+// Just enough of the Max API for buildspans.c to compile natively, so the replay suite can run it
+// without the SDK. The declarations follow the SDK's names and signatures; the behaviour lives in
+// ../max_mock.c. Only what buildspans.c (and the baseline revision the suite is checked against),
+// crucible.h and the shared headers use is declared here.
+#ifndef MAX_STUB_EXT_H
+#define MAX_STUB_EXT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct _object { long o_magic; } t_object;
+typedef struct _symbol { char *s_name; } t_symbol;
+typedef struct _atom {
+    short a_type;
+    union { long w_long; double w_float; t_symbol *w_sym; void *w_obj; } a_w;
+} t_atom;
+typedef struct _class t_class;
+typedef void *(*method)();
+typedef long t_atom_long;
+typedef double t_atom_float;
+typedef long t_max_err;
+typedef void *t_ptr;
+typedef long t_ptr_size;
+typedef struct _critical *t_critical;
+typedef struct _systhread *t_systhread;
+typedef struct _systhread_mutex *t_systhread_mutex;
+typedef struct _systhread_cond *t_systhread_cond;
+typedef struct _linklist t_linklist;
+typedef struct _clock t_clock;
+typedef struct _qelem t_qelem;
+typedef struct _dictionary t_dictionary;
+typedef struct _atomarray t_atomarray;
+typedef struct _buffer_ref t_buffer_ref;
+typedef struct _buffer_obj t_buffer_obj;
+
+enum { A_NOTHING = 0, A_LONG, A_FLOAT, A_SYM, A_OBJ, A_DEFLONG, A_DEFFLOAT, A_DEFSYM, A_GIMME, A_CANT };
+
+#define ASSIST_INLET 1
+#define ASSIST_OUTLET 2
+#define MAX_ERR_NONE 0
+#define MAX_ERR_GENERIC -1
+#define MAX_PATH_CHARS 2048
+#define CLASS_BOX gensym("box")
+#define CLASS_NOBOX gensym("nobox")
+
+#define CLASS_ATTR_LONG(...)
+#define CLASS_ATTR_SYM(...)
+#define CLASS_ATTR_DOUBLE(...)
+#define CLASS_ATTR_STYLE_LABEL(...)
+#define CLASS_ATTR_ACCESSORS(...)
+#define CLASS_ATTR_DEFAULT(...)
+#define CLASS_ATTR_SAVE(...)
+#define CLASS_ATTR_FILTER_CLIP(...)
+#define CLASS_ATTR_ORDER(...)
+#define CLASS_ATTR_LABEL(...)
+
+extern t_symbol *_sym_nothing;
+
+// Symbols and atoms
+t_symbol *gensym(const char *s);
+void atom_setlong(t_atom *a, long v);
+void atom_setfloat(t_atom *a, double v);
+void atom_setsym(t_atom *a, t_symbol *s);
+void atom_setobj(t_atom *a, void *o);
+long atom_getlong(const t_atom *a);
+double atom_getfloat(const t_atom *a);
+t_symbol *atom_getsym(const t_atom *a);
+void *atom_getobj(const t_atom *a);
+long atom_gettype(const t_atom *a);
+
+// Console
+void post(const char *fmt, ...);
+void object_post(t_object *x, const char *fmt, ...);
+void object_warn(t_object *x, const char *fmt, ...);
+void object_error(t_object *x, const char *fmt, ...);
+
+// Classes, objects, inlets and outlets
+t_class *class_new(const char *name, method mnew, method mfree, long size, method mmenu, short type, ...);
+void class_addmethod(t_class *c, method m, const char *name, ...);
+void class_register(t_symbol *name_space, t_class *c);
+t_class *class_findbyname(t_symbol *name_space, t_symbol *classname);
+void common_symbols_init(void);
+void *object_alloc(t_class *c);
+void object_free(void *x);
+void *object_method(void *x, t_symbol *s, ...);
+void object_obex_lookup(void *x, t_symbol *key, t_object **val);
+t_symbol *object_classname(void *x);
+long object_classname_compare(void *x, t_symbol *name);
+t_symbol *object_attr_getsym(void *x, t_symbol *attrname);
+void *object_attach_byptr(void *x, void *registered);
+t_max_err object_detach_byptr(void *x, void *registered);
+long attr_args_process(void *x, short ac, t_atom *av);
+t_object *jpatcher_get_firstobject(t_object *patcher);
+t_object *jbox_get_nextobject(t_object *box);
+t_object *jbox_get_object(t_object *box);
+void *proxy_new(void *x, long id, long *stuffloc);
+long proxy_getinlet(t_object *x);
+void *intin(void *x, short n);
+void *floatin(void *x, short n);
+void *outlet_new(void *x, const char *type);
+void *outlet_int(void *o, long n);
+void *outlet_anything(void *o, t_symbol *s, short ac, t_atom *av);
+
+// Scheduling
+void *defer(void *x, method fn, t_symbol *s, short argc, t_atom *argv);
+void *defer_low(void *x, method fn, t_symbol *s, short argc, t_atom *argv);
+t_clock *clock_new(void *x, method fn);
+void clock_delay(t_clock *c, long ms);
+void clock_unset(t_clock *c);
+unsigned int systime_ms(void);
+
+// Memory
+void *sysmem_newptr(long size);
+void *sysmem_newptrclear(long size);
+void *sysmem_resizeptr(void *p, long newsize);
+void sysmem_freeptr(void *p);
+
+// Threads
+void critical_enter(t_critical c);
+void critical_exit(t_critical c);
+long systhread_mutex_new(t_systhread_mutex *m, long flags);
+long systhread_mutex_free(t_systhread_mutex m);
+long systhread_mutex_lock(t_systhread_mutex m);
+long systhread_mutex_unlock(t_systhread_mutex m);
+int systhread_ismainthread(void);
+t_linklist *linklist_new(void);
+long linklist_append(t_linklist *l, void *o);
+long linklist_getsize(t_linklist *l);
+void *linklist_getindex(t_linklist *l, long index);
+long linklist_chuckindex(t_linklist *l, long index);
+void linklist_chuck(t_linklist *l);
+
+// Atom arrays and dictionaries
+t_atomarray *atomarray_new(long ac, t_atom *av);
+t_max_err atomarray_getatoms(t_atomarray *a, long *ac, t_atom **av);
+long atomarray_getsize(t_atomarray *a);
+t_max_err atomarray_getindex(t_atomarray *a, long index, t_atom *av);
+void atomarray_appendatom(t_atomarray *a, t_atom *av);
+t_dictionary *dictionary_new(void);
+t_max_err dictionary_clear(t_dictionary *d);
+t_max_err dictionary_appendlong(t_dictionary *d, t_symbol *key, t_atom_long value);
+t_max_err dictionary_appendfloat(t_dictionary *d, t_symbol *key, double value);
+t_max_err dictionary_appendsym(t_dictionary *d, t_symbol *key, t_symbol *value);
+t_max_err dictionary_appendatoms(t_dictionary *d, t_symbol *key, long argc, t_atom *argv);
+t_max_err dictionary_appendatom(t_dictionary *d, t_symbol *key, t_atom *value);
+t_max_err dictionary_appenddictionary(t_dictionary *d, t_symbol *key, t_object *value);
+t_max_err dictionary_getatom(t_dictionary *d, t_symbol *key, t_atom *value);
+t_max_err dictionary_getatomarray(t_dictionary *d, t_symbol *key, t_object **value);
+t_max_err dictionary_getkeys(t_dictionary *d, long *numkeys, t_symbol ***keys);
+long dictionary_hasentry(t_dictionary *d, t_symbol *key);
+t_max_err dictionary_deleteentry(t_dictionary *d, t_symbol *key);
+t_dictionary *dictobj_register(t_dictionary *d, t_symbol **name);
+t_max_err dictobj_unregister(t_dictionary *d);
+t_symbol *dictobj_namefromptr(t_dictionary *d);
+
+// Buffers
+t_buffer_ref *buffer_ref_new(t_object *self, t_symbol *name);
+void buffer_ref_set(t_buffer_ref *x, t_symbol *name);
+t_buffer_obj *buffer_ref_getobject(t_buffer_ref *x);
+float *buffer_locksamples(t_buffer_obj *b);
+void buffer_unlocksamples(t_buffer_obj *b);
+long buffer_getframecount(t_buffer_obj *b);
+
+#endif
@@ -0,0 +1,2 @@
+// Forwards to the single stub header; see ext.h.
+#include "ext.h"
@@ -16,8 +16,12 @@ void crucible_assist(t_crucible *x, void *b, long m, long a, char *s);
 void crucible_log(t_crucible *x, const char *fmt, ...);
 char *crucible_atoms_to_string(long argc, t_atom *argv);
 int parse_selector(const char *selector_str, char **track, char **bar, char **key);
+t_symbol *crucible_number_symbol(t_crucible *x, t_atom_long n);
+void crucible_store_bar_data(t_crucible *x, t_symbol *track_sym, t_symbol *bar_sym, t_symbol *key_sym, long argc, t_atom *argv);
 t_dictionary *dictionary_deep_copy(t_dictionary *src);
 void crucible_output_bar_data(t_crucible *x, t_dictionary *bar_dict, t_atom_long bar_ts_long, t_symbol *track_sym, t_dictionary *incumbent_track_dict);
+void crucible_process_span_ex(t_crucible *x, t_symbol *track_sym, t_atomarray *span_atomarray, const t_crucible_span_record *record);
+t_dictionary *crucible_bar_dict_from_record(const t_crucible_span_record *record, long index);
 void crucible_local_bar_length(t_crucible *x, double f);
 void crucible_do_local_bar_length(t_crucible *x, t_symbol *s, long argc, t_atom *argv);
 t_max_err crucible_attr_set_log(t_crucible *x, void *attr, long ac, t_atom *av);
@@ -320,6 +324,24 @@ char *crucible_atoms_to_string(long argc, t_atom *argv) {
     return buffer;
 }
 
+// Track ids and bar timestamps become dictionary keys, so they have to be symbols. A small
+// direct-mapped cache skips the formatting and symbol-table lookup for the handful of bars that
+// are in play at once; it holds pointers to already-interned symbols and never grows.
+// A bound buildspans calls this from its own thread while the main thread does too, so an entry is
+// a single pointer, read once and checked against the symbol's own text, rather than a value/symbol
+// pair that another thread could be halfway through replacing.
+t_symbol *crucible_number_symbol(t_crucible *x, t_atom_long n) {
+    unsigned long long h = ((unsigned long long)n * 0x9E3779B97F4A7C15ULL) >> (64 - CRUCIBLE_SYMBOL_CACHE_BITS);
+    t_symbol *sym = x->symbol_cache[h];
+    if (sym && strtoll(sym->s_name, NULL, 10) == (long long)n) return sym;
+
+    char str[32];
+    snprintf(str, 32, "%lld", (long long)n);
+    sym = gensym(str);
+    x->symbol_cache[h] = sym;
+    return sym;
+}
+
 int parse_selector(const char *selector_str, char **track, char **bar, char **key) {
     const char *first_delim = strstr(selector_str, "::");
     if (!first_delim) return 0;
@@ -415,6 +437,7 @@ void *crucible_new(t_symbol *s, long argc, t_atom *argv) {
         visualize_init();
         x->challenger_dict = dictionary_new();
         x->last_track_id = gensym("");
+        for (long i = 0; i < CRUCIBLE_SYMBOL_CACHE_SIZE; i++) x->symbol_cache[i] = NULL;
 
         systhread_mutex_new(&x->sequence_mutex, 0);
         systhread_mutex_new(&x->state_mutex, 0);
@@ -625,6 +648,46 @@ void crucible_output_bar_data(t_crucible *x, t_dictionary *bar_dict, t_atom_long
 }
 
 void crucible_process_span(t_crucible *x, t_symbol *track_sym, t_atomarray *span_atomarray) {
+    crucible_process_span_ex(x, track_sym, span_atomarray, NULL);
+}
+
+// Build the incumbent bar dictionary for one bar of a span record, with the same keys and order a
+// challenger bar gets from bar_data messages.
+t_dictionary *crucible_bar_dict_from_record(const t_crucible_span_record *record, long index) {
+    const t_crucible_span_bar *bar = &record->bars[index];
+    long atom_count = (bar->note_count > record->bar_count) ? bar->note_count : record->bar_count;
+    t_atom *atoms = (t_atom *)sysmem_newptr((atom_count + 1) * sizeof(t_atom));
+    t_dictionary *bar_dict = dictionary_new();
+    if (!atoms || !bar_dict) {
+        if (atoms) sysmem_freeptr(atoms);
+        if (bar_dict) object_free(bar_dict);
+        return NULL;
+    }
+
+    if (bar->note_count > 0) {
+        for (long k = 0; k < bar->note_count; k++) atom_setfloat(atoms + k, bar->absolutes[k]);
+        dictionary_appendatomarray(bar_dict, gensym("absolutes"), (t_object *)atomarray_new(bar->note_count, atoms));
+        for (long k = 0; k < bar->note_count; k++) atom_setfloat(atoms + k, bar->scores[k]);
+        dictionary_appendatomarray(bar_dict, gensym("scores"), (t_object *)atomarray_new(bar->note_count, atoms));
+        atom_setfloat(atoms, bar->mean);
+        dictionary_appendatomarray(bar_dict, gensym("mean"), (t_object *)atomarray_new(1, atoms));
+    }
+    atom_setfloat(atoms, bar->offset);
+    dictionary_appendatomarray(bar_dict, gensym("offset"), (t_object *)atomarray_new(1, atoms));
+    atom_setsym(atoms, record->palette);
+    dictionary_appendatomarray(bar_dict, gensym("palette"), (t_object *)atomarray_new(1, atoms));
+    atom_setfloat(atoms, record->rating);
+    dictionary_appendatomarray(bar_dict, gensym("rating"), (t_object *)atomarray_new(1, atoms));
+    for (long k = 0; k < record->bar_count; k++) atom_setlong(atoms + k, record->bars[k].timestamp);
+    dictionary_appendatomarray(bar_dict, gensym("span"), (t_object *)atomarray_new(record->bar_count, atoms));
+
+    sysmem_freeptr(atoms);
+    return bar_dict;
+}
+
+// With a record, challenger ratings and winning bars come straight from it and challenger_dict is
+// not touched; without one they are read from the bars staged by bar_data messages.
+void crucible_process_span_ex(t_crucible *x, t_symbol *track_sym, t_atomarray *span_atomarray, const t_crucible_span_record *record) {
     if (crucible_is_task_cancelled(x, x->current_task_seq)) return;
     t_atom_long bar_length = crucible_get_bar_length(x);
     crucible_log(x, "crucible: entering crucible_process_span (utilizing bar_length %lld, incumbent dict: '%s')", (long long)bar_length, x->incumbent_dict_name->s_name);
@@ -647,42 +710,45 @@ void crucible_process_span(t_crucible *x, t_symbol *track_sym, t_atomarray *span
 
     // Get challenger track dictionary
     t_dictionary *challenger_track_dict = NULL;
-    dictionary_getdictionary(x->challenger_dict, track_sym, (t_object **)&challenger_track_dict);
-    if (!challenger_track_dict) {
+    if (!record) dictionary_getdictionary(x->challenger_dict, track_sym, (t_object **)&challenger_track_dict);
+    if (!record && !challenger_track_dict) {
         object_error((t_object *)x, "Could not find challenger track dict for %s", track_sym->s_name);
         goto cleanup;
     }
 
     for (long i = 0; i < span_len; i++) {
         t_atom_long bar_ts_long = atom_getlong(&span_atoms[i]);
-        char bar_ts_str[64];
-        snprintf(bar_ts_str, 64, "%lld", (long long)bar_ts_long);
-        t_symbol *bar_sym = gensym(bar_ts_str);
-
-        // Get challenger bar dictionary
-        t_dictionary *challenger_bar_dict = NULL;
-        dictionary_getdictionary(challenger_track_dict, bar_sym, (t_object **)&challenger_bar_dict);
-        if (!challenger_bar_dict) {
-            object_error((t_object *)x, "Missing challenger bar dictionary for bar %s", bar_sym->s_name);
-            continue;
-        }
+        t_symbol *bar_sym = crucible_number_symbol(x, bar_ts_long);
+        double challenger_rating = 0.0;
 
-        t_atom *challenger_rating_atoms = NULL;
-        long challenger_rating_len = 0;
-        t_atomarray *challenger_rating_aa = NULL;
-        t_atom challenger_rating_atom;
+        if (record) {
+            challenger_rating = record->rating;
+        } else {
+            // Get challenger bar dictionary
+            t_dictionary *challenger_bar_dict = NULL;
+            dictionary_getdictionary(challenger_track_dict, bar_sym, (t_object **)&challenger_bar_dict);
+            if (!challenger_bar_dict) {
+                object_error((t_object *)x, "Missing challenger bar dictionary for bar %s", bar_sym->s_name);
+                continue;
+            }
 
-        if (dictionary_getatomarray(challenger_bar_dict, gensym("rating"), (t_object **)&challenger_rating_aa) == MAX_ERR_NONE && challenger_rating_aa) {
-            atomarray_getatoms(challenger_rating_aa, &challenger_rating_len, &challenger_rating_atoms);
-        } else if (dictionary_getatom(challenger_bar_dict, gensym("rating"), &challenger_rating_atom) == MAX_ERR_NONE) {
-            challenger_rating_atoms = &challenger_rating_atom;
-            challenger_rating_len = 1;
-        }
-        if (challenger_rating_len == 0) {
-            object_error((t_object *)x, "Missing rating for challenger bar %s", bar_sym->s_name);
-            continue;
+            t_atom *challenger_rating_atoms = NULL;
+            long challenger_rating_len = 0;
+            t_atomarray *challenger_rating_aa = NULL;
+            t_atom challenger_rating_atom;
+
+            if (dictionary_getatomarray(challenger_bar_dict, gensym("rating"), (t_object **)&challenger_rating_aa) == MAX_ERR_NONE && challenger_rating_aa) {
+                atomarray_getatoms(challenger_rating_aa, &challenger_rating_len, &challenger_rating_atoms);
+            } else if (dictionary_getatom(challenger_bar_dict, gensym("rating"), &challenger_rating_atom) == MAX_ERR_NONE) {
+                challenger_rating_atoms = &challenger_rating_atom;
+                challenger_rating_len = 1;
+            }
+            if (challenger_rating_len == 0) {
+                object_error((t_object *)x, "Missing rating for challenger bar %s", bar_sym->s_name);
+                continue;
+            }
+            challenger_rating = atom_getfloat(challenger_rating_atoms);
         }
-        double challenger_rating = atom_getfloat(challenger_rating_atoms);
 
         if (i == 0) {
             challenger_winning_rating = challenger_rating;
@@ -784,9 +850,7 @@ void crucible_process_span(t_crucible *x, t_symbol *track_sym, t_atomarray *span
 
         for (long i = 0; i < span_len; i++) {
             t_atom_long bar_ts_long = atom_getlong(&span_atoms[i]);
-            char bar_ts_str[64];
-            snprintf(bar_ts_str, 64, "%lld", (long long)bar_ts_long);
-            t_symbol *bar_sym = gensym(bar_ts_str);
+            t_symbol *bar_sym = crucible_number_symbol(x, bar_ts_long);
 
             dictionary_appendlong(challenger_span_ts_dict, bar_sym, 1);
 
@@ -869,18 +933,22 @@ void crucible_process_span(t_crucible *x, t_symbol *track_sym, t_atomarray *span
         // Copy bars to incumbent
         for (long i = 0; i < span_len; i++) {
             t_atom_long bar_ts_long = atom_getlong(&span_atoms[i]);
-            char bar_ts_str[64];
-            snprintf(bar_ts_str, 64, "%lld", (long long)bar_ts_long);
-            t_symbol *bar_sym = gensym(bar_ts_str);
+            t_symbol *bar_sym = crucible_number_symbol(x, bar_ts_long);
 
-            t_dictionary *challenger_bar_dict = NULL;
-            dictionary_getdictionary(challenger_track_dict, bar_sym, (t_object **)&challenger_bar_dict);
+            t_dictionary *winning_bar_dict = NULL;
+            if (record) {
+                winning_bar_dict = crucible_bar_dict_from_record(record, i);
+            } else {
+                t_dictionary *challenger_bar_dict = NULL;
+                dictionary_getdictionary(challenger_track_dict, bar_sym, (t_object **)&challenger_bar_dict);
+                if (challenger_bar_dict) winning_bar_dict = dictionary_deep_copy(challenger_bar_dict);
+            }
 
-            if (challenger_bar_dict) {
+            if (winning_bar_dict) {
                 if (dictionary_hasentry(incumbent_track_dict, bar_sym)) {
                      dictionary_deleteentry(incumbent_track_dict, bar_sym);
                 }
-                dictionary_appenddictionary(incumbent_track_dict, bar_sym, (t_object *)dictionary_deep_copy(challenger_bar_dict));
+                dictionary_appenddictionary(incumbent_track_dict, bar_sym, (t_object *)winning_bar_dict);
                 crucible_log(x, "  -> Wrote bar %s to incumbent track %s", bar_sym->s_name, track_sym->s_name);
             }
         }
@@ -1111,9 +1179,7 @@ void crucible_process_span(t_crucible *x, t_symbol *track_sym, t_atomarray *span
 
         for (long i = 0; i < span_len; i++) {
             t_atom_long bar_ts_long = atom_getlong(&span_atoms[i]);
-            char bar_ts_str[64];
-            snprintf(bar_ts_str, 64, "%lld", (long long)bar_ts_long);
-            t_symbol *bar_sym = gensym(bar_ts_str);
+            t_symbol *bar_sym = crucible_number_symbol(x, bar_ts_long);
 
             t_dictionary *bar_dict = NULL;
             dictionary_getdictionary(incumbent_track_dict, bar_sym, (t_object **)&bar_dict);
@@ -1132,6 +1198,41 @@ cleanup:
     if (all_track_keys) sysmem_freeptr(all_track_keys);
 }
 
+// In-process entry point for a bound buildspans: one call per finished span instead of seven
+// bar_data messages per bar plus track and span. Runs synchronously on the caller's thread, with
+// the same sequencing and locking as crucible_do_anything.
+void crucible_submit_span(t_crucible *x, const t_crucible_span_record *record) {
+    if (!record || record->bar_count <= 0) return;
+
+    long seq = crucible_get_task_sequence(x);
+    x->current_task_seq = seq;
+    int on_worker = (x->async && x->worker && async_worker_is_worker_thread(x->worker));
+    if (on_worker) {
+        systhread_mutex_lock(x->state_mutex);
+    }
+
+    if (!crucible_is_task_cancelled(x, seq)) {
+        t_atom *span_atoms = (t_atom *)sysmem_newptr(record->bar_count * sizeof(t_atom));
+        if (span_atoms) {
+            for (long i = 0; i < record->bar_count; i++) atom_setlong(span_atoms + i, record->bars[i].timestamp);
+            t_atomarray *span_aa = atomarray_new(record->bar_count, span_atoms);
+            sysmem_freeptr(span_atoms);
+
+            if (span_aa) {
+                x->last_track_id = crucible_number_symbol(x, record->track);
+                crucible_log(x, "crucible: Received span record for track %s (%ld bars, rating %.4f).", x->last_track_id->s_name, record->bar_count, record->rating);
+                crucible_process_span_ex(x, x->last_track_id, span_aa, record);
+                object_release((t_object *)span_aa);
+            }
+        }
+    }
+
+    x->current_task_seq = -1;
+    if (on_worker) {
+        systhread_mutex_unlock(x->state_mutex);
+    }
+}
+
 t_atom_long crucible_get_bar_length(t_crucible *x) {
     if (x->local_bar_length > 0) {
         return (t_atom_long)x->local_bar_length;
@@ -2626,9 +2727,7 @@ void crucible_do_anything(t_crucible *x, t_symbol *s, long argc, t_atom *argv) {
 
     if (s == gensym("track") && argc > 0) {
         if (atom_gettype(argv) == A_LONG) {
-            char track_id_str[64];
-            snprintf(track_id_str, 64, "%lld", (long long)atom_getlong(argv));
-            x->last_track_id = gensym(track_id_str);
+            x->last_track_id = crucible_number_symbol(x, atom_getlong(argv));
         } else if (atom_gettype(argv) == A_SYM) {
             x->last_track_id = atom_getsym(argv);
         } else {
@@ -2666,6 +2765,23 @@ void crucible_do_anything(t_crucible *x, t_symbol *s, long argc, t_atom *argv) {
         return;
     }
 
+    if (s == gensym("bar_data") && argc >= 3) {
+        // bar_data <track> <bar> <property> values...
+        t_symbol *track_sym = (atom_gettype(argv) == A_SYM) ? atom_getsym(argv) : crucible_number_symbol(x, atom_getlong(argv));
+        t_symbol *bar_sym = (atom_gettype(argv + 1) == A_SYM) ? atom_getsym(argv + 1) : crucible_number_symbol(x, atom_getlong(argv + 1));
+        t_symbol *key_sym = atom_getsym(argv + 2);
+        if (key_sym != _sym_nothing) {
+            crucible_store_bar_data(x, track_sym, bar_sym, key_sym, argc - 3, argv + 3);
+        } else {
+            crucible_log(x, "bar_data: property must be a symbol");
+        }
+        x->current_task_seq = -1;
+        if (on_worker) {
+            systhread_mutex_unlock(x->state_mutex);
+        }
+        return;
+    }
+
     if (s == gensym("replace") && argc >= 2) {
         char *sel_str = NULL;
         if (atom_gettype(argv) == A_SYM) {
@@ -2907,43 +3023,7 @@ void crucible_do_anything(t_crucible *x, t_symbol *s, long argc, t_atom *argv) {
     char *key_str = NULL;
 
     if (parse_selector(s->s_name, &track_str, &bar_str, &key_str)) {
-        t_symbol *track_sym = gensym(track_str);
-        t_symbol *bar_sym = gensym(bar_str);
-        t_symbol *key_sym = gensym(key_str);
-
-        // Get or create track dictionary
-        t_dictionary *track_dict = NULL;
-        if (!dictionary_hasentry(x->challenger_dict, track_sym)) {
-            track_dict = dictionary_new();
-            if (track_dict) {
-                dictionary_appenddictionary(x->challenger_dict, track_sym, (t_object *)track_dict);
-                dictionary_getdictionary(x->challenger_dict, track_sym, (t_object **)&track_dict);
-            }
-        } else {
-            dictionary_getdictionary(x->challenger_dict, track_sym, (t_object **)&track_dict);
-        }
-
-        if (track_dict) {
-            // Get or create bar dictionary
-            t_dictionary *bar_dict = NULL;
-            if (!dictionary_hasentry(track_dict, bar_sym)) {
-                bar_dict = dictionary_new();
-                if (bar_dict) {
-                    dictionary_appenddictionary(track_dict, bar_sym, (t_object *)bar_dict);
-                    dictionary_getdictionary(track_dict, bar_sym, (t_object **)&bar_dict);
-                }
-            } else {
-                dictionary_getdictionary(track_dict, bar_sym, (t_object **)&bar_dict);
-            }
-
-            // Add data to bar dictionary
-            if (bar_dict) {
-                t_atomarray *aa = atomarray_new(argc, argv);
-                if (aa) {
-                    dictionary_appendatomarray(bar_dict, key_sym, (t_object *)aa);
-                }
-            }
-        }
+        crucible_store_bar_data(x, gensym(track_str), gensym(bar_str), gensym(key_str), argc, argv);
 
         sysmem_freeptr(track_str);
         sysmem_freeptr(bar_str);
@@ -2958,10 +3038,47 @@ void crucible_do_anything(t_crucible *x, t_symbol *s, long argc, t_atom *argv) {
 }
 
 
+// Store one property of a challenger bar under challenger_dict[track][bar][key].
+void crucible_store_bar_data(t_crucible *x, t_symbol *track_sym, t_symbol *bar_sym, t_symbol *key_sym, long argc, t_atom *argv) {
+    // Get or create track dictionary
+    t_dictionary *track_dict = NULL;
+    if (!dictionary_hasentry(x->challenger_dict, track_sym)) {
+        track_dict = dictionary_new();
+        if (track_dict) {
+            dictionary_appenddictionary(x->challenger_dict, track_sym, (t_object *)track_dict);
+            dictionary_getdictionary(x->challenger_dict, track_sym, (t_object **)&track_dict);
+        }
+    } else {
+        dictionary_getdictionary(x->challenger_dict, track_sym, (t_object **)&track_dict);
+    }
+
+    if (track_dict) {
+        // Get or create bar dictionary
+        t_dictionary *bar_dict = NULL;
+        if (!dictionary_hasentry(track_dict, bar_sym)) {
+            bar_dict = dictionary_new();
+            if (bar_dict) {
+                dictionary_appenddictionary(track_dict, bar_sym, (t_object *)bar_dict);
+                dictionary_getdictionary(track_dict, bar_sym, (t_object **)&bar_dict);
+            }
+        } else {
+            dictionary_getdictionary(track_dict, bar_sym, (t_object **)&bar_dict);
+        }
+
+        // Add data to bar dictionary
+        if (bar_dict) {
+            t_atomarray *aa = atomarray_new(argc, argv);
+            if (aa) {
+                dictionary_appendatomarray(bar_dict, key_sym, (t_object *)aa);
+            }
+        }
+    }
+}
+
 void crucible_assist(t_crucible *x, void *b, long m, long a, char *s) {
     if (m == ASSIST_INLET) {
         switch (a) {
-            case 0: sprintf(s, "Inlet 1: Primary messages (clear, track, span, reaches, replace, log, consume, fill, visualize, async, rebar). Also sets incumbent dictionary name."); break;
+            case 0: sprintf(s, "Inlet 1: Primary messages (clear, track, span, bar_data, reaches, replace, log, consume, fill, visualize, async, rebar). Also sets incumbent dictionary name."); break;
             case 1: sprintf(s, "Inlet 2: Local Bar Length (float)."); break;
         }
     } else { // ASSIST_OUTLET
@@ -8,10 +8,34 @@
 #include "ext_buffer.h"
 #include "../shared/async_worker.h"
 
+#define CRUCIBLE_SYMBOL_CACHE_BITS 6
+#define CRUCIBLE_SYMBOL_CACHE_SIZE (1 << CRUCIBLE_SYMBOL_CACHE_BITS)
+
+// One bar of a span handed over in-process by a bound buildspans. The note arrays are borrowed
+// and only need to stay valid for the duration of the call.
+typedef struct _crucible_span_bar {
+    t_atom_long timestamp;
+    double offset;
+    double mean;
+    const double *absolutes;
+    const double *scores;
+    long note_count;
+} t_crucible_span_bar;
+
+// A complete challenger span: the typed equivalent of the bar_data, track and span messages.
+typedef struct _crucible_span_record {
+    t_atom_long track;
+    t_symbol *palette;
+    double rating;
+    const t_crucible_span_bar *bars;
+    long bar_count;
+} t_crucible_span_record;
+
 typedef struct _crucible {
     t_object s_obj;
     t_dictionary *challenger_dict;
     t_symbol *last_track_id;
+    t_symbol *symbol_cache[CRUCIBLE_SYMBOL_CACHE_SIZE];
     t_symbol *incumbent_dict_name;
     void *outlet_data;
     void *outlet_rebar;
@@ -55,6 +79,7 @@ void crucible_do_anything(t_crucible *x, t_symbol *s, long argc, t_atom *argv);
 void crucible_local_bar_length(t_crucible *x, double f);
 void crucible_do_local_bar_length(t_crucible *x, t_symbol *s, long argc, t_atom *argv);
 void crucible_process_span(t_crucible *x, t_symbol *track_sym, t_atomarray *span_atomarray);
+void crucible_submit_span(t_crucible *x, const t_crucible_span_record *record);
 void crucible_rebar(t_crucible *x, t_atom_long new_bar_length);
 void crucible_do_rebar(t_crucible *x, t_symbol *s, long argc, t_atom *argv);
 
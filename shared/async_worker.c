@@ -22,49 +22,92 @@ void systhread_cond_new(t_systhread_cond *c, long flags);
 void systhread_cond_wait(t_systhread_cond c, t_systhread_mutex m);
 void systhread_cond_signal(t_systhread_cond c);
 void systhread_cond_free(t_systhread_cond c);
+void systhread_cond_broadcast(t_systhread_cond c);
+#endif
+
+// Wakeup semaphore and atomic exchange. Posting a semaphore never blocks or allocates, unlike
+// signalling a condition variable, which needs the mutex.
+#if defined(_WIN32)
+#include <windows.h>
+static void *async_wake_new(void) { return (void *)CreateSemaphore(NULL, 0, LONG_MAX, NULL); }
+static void async_wake_free(void *w) { CloseHandle((HANDLE)w); }
+static void async_wake_post(void *w) { ReleaseSemaphore((HANDLE)w, 1, NULL); }
+static void async_wake_wait(void *w) { WaitForSingleObject((HANDLE)w, INFINITE); }
+static long async_exchange(volatile long *p, long v) { return InterlockedExchange(p, v); }
+#elif defined(__APPLE__)
+#include <dispatch/dispatch.h>
+static void *async_wake_new(void) { return (void *)dispatch_semaphore_create(0); }
+static void async_wake_free(void *w) { dispatch_release((dispatch_semaphore_t)w); }
+static void async_wake_post(void *w) { dispatch_semaphore_signal((dispatch_semaphore_t)w); }
+static void async_wake_wait(void *w) { dispatch_semaphore_wait((dispatch_semaphore_t)w, DISPATCH_TIME_FOREVER); }
+static long async_exchange(volatile long *p, long v) { return __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL); }
+#else
+#include <semaphore.h>
+#include <errno.h>
+static void *async_wake_new(void) {
+    sem_t *sem = (sem_t *)malloc(sizeof(sem_t));
+    if (sem && sem_init(sem, 0, 0) != 0) { free(sem); sem = NULL; }
+    return sem;
+}
+static void async_wake_free(void *w) { sem_destroy((sem_t *)w); free(w); }
+static void async_wake_post(void *w) { sem_post((sem_t *)w); }
+static void async_wake_wait(void *w) { while (sem_wait((sem_t *)w) != 0 && errno == EINTR) {} }
+static long async_exchange(volatile long *p, long v) { return __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL); }
 #endif
 
 void *async_worker_thread_proc(void *arg) {
     t_async_worker *worker = (t_async_worker *)arg;
     
     while (1) {
-        t_async_task *task = NULL;
-        
-        systhread_mutex_lock(worker->mutex);
-        while (linklist_getsize(worker->queue) == 0 && !worker->exit_flag) {
-            systhread_cond_wait(worker->cond, worker->mutex);
-        }
-        
-        if (worker->exit_flag && linklist_getsize(worker->queue) == 0) {
-            systhread_mutex_unlock(worker->mutex);
-            break;
-        }
-        
-        task = (t_async_task *)linklist_getindex(worker->queue, 0);
-        if (task) {
-            linklist_chuckindex(worker->queue, 0);
+        async_wake_wait(worker->wake);
+
+        // One post may stand for several triggers and tasks, so run everything that is ready
+        while (1) {
+            t_async_trigger *trigger = NULL;
+            t_async_task *task = NULL;
+
+            systhread_mutex_lock(worker->mutex);
+            if (worker->exit_flag && linklist_getsize(worker->queue) == 0) {
+                systhread_mutex_unlock(worker->mutex);
+                systhread_exit(0);
+                return NULL;
+            }
+
+            for (t_async_trigger *t = worker->triggers; t; t = t->next) {
+                if (async_exchange(&t->armed, 0)) {
+                    trigger = t;
+                    break;
+                }
+            }
+            if (!trigger) {
+                task = (t_async_task *)linklist_getindex(worker->queue, 0);
+                if (task) linklist_chuckindex(worker->queue, 0);
+            }
+            if (!trigger && !task) {
+                systhread_mutex_unlock(worker->mutex);
+                break;
+            }
             worker->is_busy = 1;
-        }
-        
-        systhread_mutex_unlock(worker->mutex);
-        
-        if (task) {
-            if (task->m) {
-                ((void (*)(void *, t_symbol *, long, t_atom *))task->m)(task->x, task->s, task->argc, task->argv);
+            worker->running_trigger = trigger;
+            systhread_mutex_unlock(worker->mutex);
+
+            if (trigger) {
+                ((void (*)(void *, t_symbol *, long, t_atom *))trigger->m)(trigger->x, trigger->s, 0, NULL);
+            } else {
+                if (task->m) {
+                    ((void (*)(void *, t_symbol *, long, t_atom *))task->m)(task->x, task->s, task->argc, task->argv);
+                }
+                if (task->argv) sysmem_freeptr(task->argv);
+                sysmem_freeptr(task);
             }
-            
-            if (task->argv) sysmem_freeptr(task->argv);
-            sysmem_freeptr(task);
 
             systhread_mutex_lock(worker->mutex);
             worker->is_busy = 0;
-            systhread_cond_signal(worker->cond);
+            worker->running_trigger = NULL;
+            systhread_cond_broadcast(worker->cond);
             systhread_mutex_unlock(worker->mutex);
         }
     }
-    
-    systhread_exit(0);
-    return NULL;
 }
 
 
@@ -75,6 +118,13 @@ t_async_worker *async_worker_create(void) {
     worker->exit_flag = 0;
     worker->ref_count = 1;
     worker->is_busy = 0;
+    worker->triggers = NULL;
+    worker->running_trigger = NULL;
+    worker->wake = async_wake_new();
+    if (!worker->wake) {
+        sysmem_freeptr(worker);
+        return NULL;
+    }
     worker->queue = linklist_new();
     systhread_mutex_new(&worker->mutex, 0);
     systhread_cond_new(&worker->cond, 0);
@@ -101,10 +151,11 @@ void async_worker_release(t_async_worker *worker) {
         worker->exit_flag = 1;
         should_destroy = 1;
     }
-    systhread_cond_signal(worker->cond);
     systhread_mutex_unlock(worker->mutex);
     
     if (should_destroy) {
+        async_wake_post(worker->wake);
+
         unsigned int ret;
         systhread_join(worker->thread, &ret);
         
@@ -119,7 +170,14 @@ void async_worker_release(t_async_worker *worker) {
             }
         }
         linklist_chuck(worker->queue);
+
+        while (worker->triggers) {
+            t_async_trigger *next = worker->triggers->next;
+            sysmem_freeptr(worker->triggers);
+            worker->triggers = next;
+        }
         
+        async_wake_free(worker->wake);
         systhread_mutex_free(worker->mutex);
         systhread_cond_free(worker->cond);
         sysmem_freeptr(worker);
@@ -149,8 +207,8 @@ void async_worker_enqueue(t_async_worker *worker, void *x, method m, t_symbol *s
     
     systhread_mutex_lock(worker->mutex);
     linklist_append(worker->queue, task);
-    systhread_cond_signal(worker->cond);
     systhread_mutex_unlock(worker->mutex);
+    async_wake_post(worker->wake);
 }
 
 int async_worker_is_worker_thread(t_async_worker *worker) {
@@ -184,9 +242,59 @@ void async_worker_drain(t_async_worker *worker) {
 
     async_worker_clear_queue(worker);
 
+    // Disarm triggers too, so nothing is left to run once drain returns
     systhread_mutex_lock(worker->mutex);
+    for (t_async_trigger *t = worker->triggers; t; t = t->next) {
+        async_exchange(&t->armed, 0);
+    }
     while (worker->is_busy) {
         systhread_cond_wait(worker->cond, worker->mutex);
     }
     systhread_mutex_unlock(worker->mutex);
 }
+
+t_async_trigger *async_worker_trigger_new(t_async_worker *worker, void *x, method m, t_symbol *s) {
+    if (!worker) return NULL;
+
+    t_async_trigger *trigger = (t_async_trigger *)sysmem_newptr(sizeof(t_async_trigger));
+    if (!trigger) return NULL;
+
+    trigger->worker = worker;
+    trigger->x = x;
+    trigger->m = m;
+    trigger->s = s;
+    trigger->armed = 0;
+
+    systhread_mutex_lock(worker->mutex);
+    trigger->next = worker->triggers;
+    worker->triggers = trigger;
+    systhread_mutex_unlock(worker->mutex);
+    return trigger;
+}
+
+void async_worker_trigger_free(t_async_trigger *trigger) {
+    if (!trigger) return;
+    t_async_worker *worker = trigger->worker;
+
+    systhread_mutex_lock(worker->mutex);
+    for (t_async_trigger **p = &worker->triggers; *p; p = &(*p)->next) {
+        if (*p == trigger) {
+            *p = trigger->next;
+            break;
+        }
+    }
+    if (!async_worker_is_worker_thread(worker)) {
+        while (worker->running_trigger == trigger) {
+            systhread_cond_wait(worker->cond, worker->mutex);
+        }
+    }
+    systhread_mutex_unlock(worker->mutex);
+    sysmem_freeptr(trigger);
+}
+
+void async_worker_trigger(t_async_trigger *trigger) {
+    if (!trigger) return;
+    if (async_exchange(&trigger->armed, 1) == 0) {
+        async_wake_post(trigger->worker->wake);
+    }
+}
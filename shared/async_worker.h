@@ -27,11 +27,25 @@ typedef struct _async_task {
     t_atom *argv;           // Arguments
 } t_async_task;
 
+// Preallocated task that a real-time thread can schedule without allocating or locking. Arming an
+// already armed trigger is a no-op, so repeated triggers before the worker gets to it run it once.
+typedef struct _async_trigger {
+    struct _async_worker *worker;
+    void *x;                // Target object
+    method m;               // Method to call
+    t_symbol *s;            // Selector, resolved when the trigger is created
+    volatile long armed;
+    struct _async_trigger *next;
+} t_async_trigger;
+
 typedef struct _async_worker {
     t_systhread thread;
     t_systhread_mutex mutex;
     t_systhread_cond cond;
+    void *wake;             // Counting semaphore the worker sleeps on (platform handle)
     t_linklist *queue;
+    t_async_trigger *triggers;
+    t_async_trigger *running_trigger;
     int exit_flag;
     int ref_count;
     int is_busy;
@@ -45,4 +59,12 @@ int async_worker_is_worker_thread(t_async_worker *worker);
 void async_worker_clear_queue(t_async_worker *worker);
 void async_worker_drain(t_async_worker *worker);
 
+// Register a trigger that calls m(x, s, 0, NULL) on the worker thread. Not real-time safe.
+t_async_trigger *async_worker_trigger_new(t_async_worker *worker, void *x, method m, t_symbol *s);
+// Unregister and free a trigger, waiting for it to finish if it is running. Not real-time safe.
+void async_worker_trigger_free(t_async_trigger *trigger);
+// Schedule the trigger's task. Lock- and allocation-free: an atomic exchange and, when the trigger
+// was not armed yet, a semaphore post. Safe to call from the audio thread.
+void async_worker_trigger(t_async_trigger *trigger);
+
 #endif // ASYNC_WORKER_H
@@ -0,0 +1,126 @@
+#include "thread_pool.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef STANDALONE_TEST
+void *sysmem_newptr(size_t size);
+void sysmem_freeptr(void *ptr);
+int systhread_create(method proc, void *arg, long stack, long priority, long flags, t_systhread *thread);
+void systhread_exit(void *status);
+void systhread_join(t_systhread thread, unsigned int *ret);
+void systhread_mutex_new(t_systhread_mutex *m, long flags);
+void systhread_mutex_lock(t_systhread_mutex m);
+void systhread_mutex_unlock(t_systhread_mutex m);
+void systhread_mutex_free(t_systhread_mutex m);
+void systhread_cond_new(t_systhread_cond *c, long flags);
+void systhread_cond_wait(t_systhread_cond c, t_systhread_mutex m);
+void systhread_cond_signal(t_systhread_cond c);
+void systhread_cond_broadcast(t_systhread_cond c);
+void systhread_cond_free(t_systhread_cond c);
+#endif
+
+// Claim and run indices of the current job until none are left. Called with the mutex held.
+static void thread_pool_work(t_thread_pool *pool) {
+    while (pool->next < pool->count) {
+        long index = pool->next++;
+        t_thread_pool_job job = pool->job;
+        void *ctx = pool->ctx;
+
+        systhread_mutex_unlock(pool->mutex);
+        job(ctx, index);
+        systhread_mutex_lock(pool->mutex);
+
+        if (--pool->pending == 0) {
+            systhread_cond_signal(pool->done_cond);
+        }
+    }
+}
+
+void *thread_pool_thread_proc(void *arg) {
+    t_thread_pool *pool = (t_thread_pool *)arg;
+
+    systhread_mutex_lock(pool->mutex);
+    while (1) {
+        while (!pool->exit_flag && pool->next >= pool->count) {
+            systhread_cond_wait(pool->work_cond, pool->mutex);
+        }
+        if (pool->exit_flag) break;
+        thread_pool_work(pool);
+    }
+    systhread_mutex_unlock(pool->mutex);
+
+    systhread_exit(0);
+    return NULL;
+}
+
+t_thread_pool *thread_pool_create(long num_threads) {
+    t_thread_pool *pool = (t_thread_pool *)sysmem_newptr(sizeof(t_thread_pool));
+    if (!pool) return NULL;
+
+    memset(pool, 0, sizeof(t_thread_pool));
+    systhread_mutex_new(&pool->mutex, 0);
+    systhread_cond_new(&pool->work_cond, 0);
+    systhread_cond_new(&pool->done_cond, 0);
+
+    if (num_threads > 1) {
+        pool->threads = (t_systhread *)sysmem_newptr(sizeof(t_systhread) * (num_threads - 1));
+        if (pool->threads) {
+            for (long i = 0; i < num_threads - 1; i++) {
+                if (systhread_create((method)thread_pool_thread_proc, pool, 0, 0, 0, &pool->threads[i]) != 0) break;
+                pool->num_threads++;
+            }
+        }
+    }
+
+    return pool;
+}
+
+void thread_pool_free(t_thread_pool *pool) {
+    if (!pool) return;
+
+    systhread_mutex_lock(pool->mutex);
+    pool->exit_flag = 1;
+    systhread_cond_broadcast(pool->work_cond);
+    systhread_mutex_unlock(pool->mutex);
+
+    for (long i = 0; i < pool->num_threads; i++) {
+        unsigned int ret;
+        systhread_join(pool->threads[i], &ret);
+    }
+    if (pool->threads) sysmem_freeptr(pool->threads);
+
+    systhread_mutex_free(pool->mutex);
+    systhread_cond_free(pool->work_cond);
+    systhread_cond_free(pool->done_cond);
+    sysmem_freeptr(pool);
+}
+
+long thread_pool_size(t_thread_pool *pool) {
+    return pool ? pool->num_threads + 1 : 1;
+}
+
+void thread_pool_run(t_thread_pool *pool, t_thread_pool_job job, void *ctx, long count) {
+    if (count <= 0) return;
+
+    if (!pool || pool->num_threads == 0 || count == 1) {
+        for (long i = 0; i < count; i++) job(ctx, i);
+        return;
+    }
+
+    systhread_mutex_lock(pool->mutex);
+    pool->job = job;
+    pool->ctx = ctx;
+    pool->next = 0;
+    pool->pending = count;
+    pool->count = count;
+    systhread_cond_broadcast(pool->work_cond);
+
+    // The caller takes indices too, then waits for whatever the pool threads still hold
+    thread_pool_work(pool);
+    while (pool->pending > 0) {
+        systhread_cond_wait(pool->done_cond, pool->mutex);
+    }
+    pool->count = 0;
+    pool->next = 0;
+    systhread_mutex_unlock(pool->mutex);
+}
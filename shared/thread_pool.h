@@ -0,0 +1,41 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#ifndef STANDALONE_TEST
+#include "ext.h"
+#include "ext_systhread.h"
+#else
+#include <stdint.h>
+#include <stddef.h>
+typedef void (*method)(void *x, ...);
+typedef struct _systhread *t_systhread;
+typedef struct _systhread_mutex *t_systhread_mutex;
+typedef struct _systhread_cond *t_systhread_cond;
+#endif
+
+// Fixed set of threads that run one indexed job at a time. thread_pool_run hands out the indices
+// 0..count-1 to the pool threads and the calling thread, and returns once every index has run.
+typedef void (*t_thread_pool_job)(void *ctx, long index);
+
+typedef struct _thread_pool {
+    t_systhread *threads;
+    long num_threads;           // Pool threads, not counting the caller
+    t_systhread_mutex mutex;
+    t_systhread_cond work_cond; // Signalled when a new job is posted or on exit
+    t_systhread_cond done_cond; // Signalled when the last index of a job completes
+    t_thread_pool_job job;
+    void *ctx;
+    long count;
+    long next;                  // Next index to hand out
+    long pending;               // Indices not yet completed
+    int exit_flag;
+} t_thread_pool;
+
+// num_threads is the total parallelism including the caller, so 1 creates no threads at all
+t_thread_pool *thread_pool_create(long num_threads);
+void thread_pool_free(t_thread_pool *pool);
+long thread_pool_size(t_thread_pool *pool);
+// Run job(ctx, i) for every i in [0, count). Not reentrant: one caller at a time.
+void thread_pool_run(t_thread_pool *pool, t_thread_pool_job job, void *ctx, long count);
+
+#endif // THREAD_POOL_H